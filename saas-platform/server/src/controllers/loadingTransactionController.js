@@ -88,172 +88,186 @@ exports.getLoadingTransactionById = async (req, res) => {
 
 exports.createLoadingTransaction = async (req, res) => {
   // Start a database transaction to ensure all operations succeed or fail together
-  const db_req = req.db; // Use the database instance from the request
   const LoadingTransaction = req.db.LoadingTransaction; // Use the LoadingTransaction model from the database instance
-  const LoadingDetail = req.db.LoadingDetail; // Use the LoadingDetail model from the database instance
   const sequelizeInstance = LoadingTransaction.sequelize;
   const dbTransaction = await sequelizeInstance.transaction();
 
   try {
-    const {
-      lorry_id,
-      loading_date,
-      loading_time,
-      loaded_by,
-      status,
-      loadingDetails, // Array of loading details
-    } = req.body;
-
-    // Create the loading transaction
-    const newLoadingTransaction = await LoadingTransaction.create(
-      {
-        lorry_id,
-        loading_date: loading_date || new Date(),
-        loading_time: loading_time || new Date().toTimeString().split(" ")[0],
-        loaded_by,
-        status: status || "Pending",
-      },
-      { transaction: dbTransaction }
+    const result = await exports.recordLoadingTransaction(
+      req,
+      req.body,
+      dbTransaction
     );
 
-    // Process loading details and update inventory
-    let newLoadingDetails = [];
+    // Commit the transaction if everything succeeded
+    await dbTransaction.commit();
 
-    const InventoryTransaction = req.db.InventoryTransaction; // Use the InventoryTransaction model from the database instance
-    const StockInventory = req.db.StockInventory; // Use the StockInventory model from the database instance
-    const db_req = req.db; // Use the database instance from the request
-    if (loadingDetails && loadingDetails.length > 0) {
-      // Process each product being loaded
-      for (const detail of loadingDetails) {
-        // Find current inventory for this product
-        const stockInventory = await StockInventory.findOne({
-          where: { product_id: detail.product_id },
-          transaction: dbTransaction,
-        });
+    res.status(201).json(result);
+  } catch (error) {
+    // Rollback all changes if anything fails
+    await dbTransaction.rollback();
 
-        const product = await db_req.Product.findOne({
-          where: { product_id: detail.product_id },
-        });
+    res.status(500).json({
+      error: error.message,
+      message: "Failed to create loading transaction or update inventory",
+    });
+  }
+};
 
-        if (!stockInventory) {
-          throw new Error(
-            `No inventory found for product ID: ${detail.product_id}`
-          );
-        }
+// Creates the loading transaction and its details and takes the stock out
+// of inventory, all inside the caller's database transaction. Shared with
+// the pallet batch uplink.
+exports.recordLoadingTransaction = async (req, fields, dbTransaction) => {
+  const db_req = req.db; // Use the database instance from the request
+  const LoadingTransaction = req.db.LoadingTransaction; // Use the LoadingTransaction model from the database instance
+  const LoadingDetail = req.db.LoadingDetail; // Use the LoadingDetail model from the database instance
 
-        console.log("Product Get: ", product);
+  const {
+    lorry_id,
+    loading_date,
+    loading_time,
+    loaded_by,
+    status,
+    loadingDetails, // Array of loading details
+  } = fields;
+
+  // Create the loading transaction
+  const newLoadingTransaction = await LoadingTransaction.create(
+    {
+      lorry_id,
+      loading_date: loading_date || new Date(),
+      loading_time: loading_time || new Date().toTimeString().split(" ")[0],
+      loaded_by,
+      status: status || "Pending",
+    },
+    { transaction: dbTransaction }
+  );
+
+  // Process loading details and update inventory
+  let newLoadingDetails = [];
+
+  const InventoryTransaction = req.db.InventoryTransaction; // Use the InventoryTransaction model from the database instance
+  const StockInventory = req.db.StockInventory; // Use the StockInventory model from the database instance
+  if (loadingDetails && loadingDetails.length > 0) {
+    // Process each product being loaded
+    for (const detail of loadingDetails) {
+      // Find current inventory for this product
+      const stockInventory = await StockInventory.findOne({
+        where: { product_id: detail.product_id },
+        transaction: dbTransaction,
+      });
 
-        // Get bottles per case
-        const bottlesPerCase = product.bottles_per_case; // Default or get from product
+      const product = await db_req.Product.findOne({
+        where: { product_id: detail.product_id },
+      });
 
-        // Initialize adjusted quantities with requested quantities
-        let adjustedCasesLoaded = detail.cases_loaded;
-        let adjustedBottlesLoaded = detail.bottles_loaded;
+      if (!stockInventory) {
+        throw new Error(
+          `No inventory found for product ID: ${detail.product_id}`
+        );
+      }
 
-        // Check if we need to convert cases to bottles
-        while (
-          adjustedBottlesLoaded > stockInventory.bottles_qty &&
-          stockInventory.cases_qty > adjustedCasesLoaded
-        ) {
-          // Open a case
-          adjustedCasesLoaded++;
-          adjustedBottlesLoaded -= bottlesPerCase;
-        }
+      console.log("Product Get: ", product);
 
-        // If we still don't have enough bottles (and we've used all cases)
-        if (adjustedBottlesLoaded > stockInventory.bottles_qty) {
-          throw new Error(
-            `Insufficient stock for product ID: ${detail.product_id}. Available: ${stockInventory.cases_qty} cases and ${stockInventory.bottles_qty} bottles. Requested: ${detail.cases_loaded} cases and ${detail.bottles_loaded} bottles.`
-          );
-        }
+      // Get bottles per case
+      const bottlesPerCase = product.bottles_per_case; // Default or get from product
 
-        // Calculate new inventory quantities
-        const newCasesQty = stockInventory.cases_qty - adjustedCasesLoaded;
-        const newBottlesQty =
-          stockInventory.bottles_qty - adjustedBottlesLoaded;
+      // Initialize adjusted quantities with requested quantities
+      let adjustedCasesLoaded = detail.cases_loaded;
+      let adjustedBottlesLoaded = detail.bottles_loaded;
 
-        // Double check that we have enough stock (should never fail at this point)
-        if (newCasesQty < 0 || newBottlesQty < 0) {
-          throw new Error(
-            `Calculation error resulted in negative inventory for product ID: ${detail.product_id}`
-          );
-        }
+      // Check if we need to convert cases to bottles
+      while (
+        adjustedBottlesLoaded > stockInventory.bottles_qty &&
+        stockInventory.cases_qty > adjustedCasesLoaded
+      ) {
+        // Open a case
+        adjustedCasesLoaded++;
+        adjustedBottlesLoaded -= bottlesPerCase;
+      }
 
-        // Calculate total bottles and value
-        const newTotalBottles = newCasesQty * bottlesPerCase + newBottlesQty;
-
-        // Calculate value per bottle (if total_bottles is 0, use a fallback to avoid division by zero)
-        const valuePerBottle =
-          stockInventory.total_bottles > 0
-            ? stockInventory.total_value / stockInventory.total_bottles
-            : 0;
-
-        const newTotalValue = newTotalBottles * valuePerBottle;
-
-        // Update the inventory
-        await stockInventory.update(
-          {
-            cases_qty: newCasesQty,
-            bottles_qty: newBottlesQty,
-            total_bottles: newTotalBottles,
-            total_value: newTotalValue,
-            last_updated: new Date(),
-          },
-          { transaction: dbTransaction }
+      // If we still don't have enough bottles (and we've used all cases)
+      if (adjustedBottlesLoaded > stockInventory.bottles_qty) {
+        throw new Error(
+          `Insufficient stock for product ID: ${detail.product_id}. Available: ${stockInventory.cases_qty} cases and ${stockInventory.bottles_qty} bottles. Requested: ${detail.cases_loaded} cases and ${detail.bottles_loaded} bottles.`
         );
+      }
 
-        // Calculate total bottles loaded (using original request values)
-        const totalBottlesLoaded =
-          detail.cases_loaded * bottlesPerCase + detail.bottles_loaded;
-
-        // Record the transaction
-        await InventoryTransaction.create(
-          {
-            product_id: detail.product_id,
-            transaction_type: "REMOVE",
-            cases_qty: detail.cases_loaded,
-            bottles_qty: detail.bottles_loaded,
-            total_bottles: totalBottlesLoaded,
-            total_value: totalBottlesLoaded * valuePerBottle,
-            notes: "Loading transaction",
-            transaction_date: new Date(),
-          },
-          { transaction: dbTransaction }
-        );
+      // Calculate new inventory quantities
+      const newCasesQty = stockInventory.cases_qty - adjustedCasesLoaded;
+      const newBottlesQty =
+        stockInventory.bottles_qty - adjustedBottlesLoaded;
 
-        // Create the loading detail record
-        const newDetail = await LoadingDetail.create(
-          {
-            loading_id: newLoadingTransaction.loading_id,
-            product_id: detail.product_id,
-            cases_loaded: detail.cases_loaded,
-            bottles_loaded: detail.bottles_loaded,
-            total_bottles_loaded: totalBottlesLoaded,
-            value: totalBottlesLoaded * valuePerBottle,
-          },
-          { transaction: dbTransaction }
+      // Double check that we have enough stock (should never fail at this point)
+      if (newCasesQty < 0 || newBottlesQty < 0) {
+        throw new Error(
+          `Calculation error resulted in negative inventory for product ID: ${detail.product_id}`
         );
-
-        newLoadingDetails.push(newDetail);
       }
-    }
 
-    // Commit the transaction if everything succeeded
-    await dbTransaction.commit();
+      // Calculate total bottles and value
+      const newTotalBottles = newCasesQty * bottlesPerCase + newBottlesQty;
 
-    res.status(201).json({
-      loadingTransaction: newLoadingTransaction,
-      loadingDetails: newLoadingDetails,
-    });
-  } catch (error) {
-    // Rollback all changes if anything fails
-    await dbTransaction.rollback();
+      // Calculate value per bottle (if total_bottles is 0, use a fallback to avoid division by zero)
+      const valuePerBottle =
+        stockInventory.total_bottles > 0
+          ? stockInventory.total_value / stockInventory.total_bottles
+          : 0;
 
-    res.status(500).json({
-      error: error.message,
-      message: "Failed to create loading transaction or update inventory",
-    });
+      const newTotalValue = newTotalBottles * valuePerBottle;
+
+      // Update the inventory
+      await stockInventory.update(
+        {
+          cases_qty: newCasesQty,
+          bottles_qty: newBottlesQty,
+          total_bottles: newTotalBottles,
+          total_value: newTotalValue,
+          last_updated: new Date(),
+        },
+        { transaction: dbTransaction }
+      );
+
+      // Calculate total bottles loaded (using original request values)
+      const totalBottlesLoaded =
+        detail.cases_loaded * bottlesPerCase + detail.bottles_loaded;
+
+      // Record the transaction
+      await InventoryTransaction.create(
+        {
+          product_id: detail.product_id,
+          transaction_type: "REMOVE",
+          cases_qty: detail.cases_loaded,
+          bottles_qty: detail.bottles_loaded,
+          total_bottles: totalBottlesLoaded,
+          total_value: totalBottlesLoaded * valuePerBottle,
+          notes: "Loading transaction",
+          transaction_date: new Date(),
+        },
+        { transaction: dbTransaction }
+      );
+
+      // Create the loading detail record
+      const newDetail = await LoadingDetail.create(
+        {
+          loading_id: newLoadingTransaction.loading_id,
+          product_id: detail.product_id,
+          cases_loaded: detail.cases_loaded,
+          bottles_loaded: detail.bottles_loaded,
+          total_bottles_loaded: totalBottlesLoaded,
+          value: totalBottlesLoaded * valuePerBottle,
+        },
+        { transaction: dbTransaction }
+      );
+
+      newLoadingDetails.push(newDetail);
+    }
   }
+
+  return {
+    loadingTransaction: newLoadingTransaction,
+    loadingDetails: newLoadingDetails,
+  };
 };
 
 exports.updateLoadingTransaction = async (req, res) => {
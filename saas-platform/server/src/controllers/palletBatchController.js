@@ -0,0 +1,190 @@
+const {
+  Op,
+  UniqueConstraintError,
+  ConnectionError,
+  TimeoutError,
+} = require("sequelize");
+const { recordLoadingTransaction } = require("./loadingTransactionController");
+const {
+  recordUnloadingTransaction,
+} = require("./unloadingTransactionController");
+
+// Each transaction in a batch gets its own result, keyed by its
+// idempotency key, so the pallet clears exactly what the server holds:
+//   stored    - created now
+//   duplicate - already stored by an earlier attempt
+//   rejected  - will never be accepted as sent (unknown truck or product,
+//               not enough stock, malformed)
+//   retry     - the server could not decide now; send it again later
+const result = (key, status, reason) =>
+  reason
+    ? { idempotency_key: key, status, reason }
+    : { idempotency_key: key, status };
+
+// The pallet's clock is millis() since boot; age_ms, when it is known,
+// places the transaction on the server's clock instead
+const occurredAt = (transaction) => {
+  const age = Number(transaction.age_ms);
+  return Number.isFinite(age) && age >= 0
+    ? new Date(Date.now() - age)
+    : new Date();
+};
+
+const storeTransaction = async (req, paletteId, transaction) => {
+  const db = req.db;
+  const key = transaction.idempotency_key;
+
+  const type = transaction.transaction_type;
+  const bottleCount = Number(transaction.bottle_count);
+  if (
+    (type !== "LOAD" && type !== "UNLOAD") ||
+    typeof transaction.truck_id !== "string" ||
+    typeof transaction.product_size !== "string" ||
+    !Number.isInteger(bottleCount)
+  ) {
+    return result(key, "rejected", "Malformed transaction");
+  }
+  if (bottleCount <= 0) {
+    return result(key, "rejected", "No bottles counted");
+  }
+
+  const existing = await db.PalletTransaction.findOne({
+    where: { idempotency_key: key },
+  });
+  if (existing) return result(key, "duplicate");
+
+  const lorry = await db.Lorry.findOne({
+    where: { lorry_number: transaction.truck_id, active: true },
+  });
+  if (!lorry) {
+    return result(key, "rejected", `Unknown truck ${transaction.truck_id}`);
+  }
+
+  const product = await db.Product.findOne({
+    where: {
+      size: { [Op.iLike]: transaction.product_size },
+      active: true,
+    },
+  });
+  if (!product) {
+    return result(
+      key,
+      "rejected",
+      `No product of size ${transaction.product_size}`
+    );
+  }
+
+  // The pallet counts loose bottles; the books keep full cases apart
+  const cases = Math.floor(bottleCount / product.bottles_per_case);
+  const bottles = bottleCount % product.bottles_per_case;
+  const at = occurredAt(transaction);
+  const time = at.toTimeString().split(" ")[0];
+  const by = `Pallet ${paletteId}`;
+
+  const dbTransaction = await req.sequelize.transaction();
+  try {
+    let ids;
+    if (type === "LOAD") {
+      const created = await recordLoadingTransaction(
+        req,
+        {
+          lorry_id: lorry.lorry_id,
+          loading_date: at,
+          loading_time: time,
+          loaded_by: by,
+          loadingDetails: [
+            {
+              product_id: product.product_id,
+              cases_loaded: cases,
+              bottles_loaded: bottles,
+            },
+          ],
+        },
+        dbTransaction
+      );
+      ids = { loading_id: created.loadingTransaction.loading_id };
+    } else {
+      const created = await recordUnloadingTransaction(
+        req,
+        {
+          lorry_id: lorry.lorry_id,
+          unloading_date: at,
+          unloading_time: time,
+          unloaded_by: by,
+          unloadingDetails: [
+            {
+              product_id: product.product_id,
+              cases_returned: cases,
+              bottles_returned: bottles,
+            },
+          ],
+        },
+        dbTransaction
+      );
+      ids = { unloading_id: created.unloadingTransaction.unloading_id };
+    }
+
+    // Same database transaction, so the key exists only if the stock moved
+    await db.PalletTransaction.create(
+      {
+        idempotency_key: key,
+        palette_id: paletteId,
+        transaction_type: type,
+        truck_id: transaction.truck_id,
+        product_size: transaction.product_size,
+        bottle_count: bottleCount,
+        weight: transaction.weight,
+        weight_change: transaction.weight_change,
+        settled: transaction.settled === true,
+        count_confidence: transaction.count_confidence,
+        count_check: transaction.count_check === true,
+        ...ids,
+      },
+      { transaction: dbTransaction }
+    );
+
+    await dbTransaction.commit();
+    return { ...result(key, "stored"), ...ids };
+  } catch (error) {
+    await dbTransaction.rollback();
+
+    // A concurrent retry of the same batch got there first
+    if (error instanceof UniqueConstraintError) {
+      return result(key, "duplicate");
+    }
+    if (error instanceof ConnectionError || error instanceof TimeoutError) {
+      return result(key, "retry", error.message);
+    }
+    return result(key, "rejected", error.message);
+  }
+};
+
+exports.receivePalletBatch = async (req, res) => {
+  const { palette_id, transactions = [] } = req.body || {};
+
+  if (typeof palette_id !== "string" || !Array.isArray(transactions)) {
+    return res
+      .status(400)
+      .json({ message: "palette_id and a transactions array are required" });
+  }
+
+  // Progress samples only drive live status on the pallet side; nothing
+  // here stores them yet
+  const results = [];
+  for (const transaction of transactions) {
+    const key = transaction && transaction.idempotency_key;
+    if (typeof key !== "string" || key.length === 0) {
+      results.push(result(null, "rejected", "Missing idempotency_key"));
+      continue;
+    }
+
+    try {
+      results.push(await storeTransaction(req, palette_id, transaction));
+    } catch (error) {
+      // Lookups failed before anything was written
+      results.push(result(key, "retry", error.message));
+    }
+  }
+
+  res.status(200).json({ results });
+};
@@ -39,193 +39,207 @@ exports.getUnloadingTransactionById = async (req, res) => {
 
 exports.createUnloadingTransaction = async (req, res) => {
   // Start a database transaction to ensure all operations succeed or fail together
-  const db = req.db;
-  const UnloadingTransaction = db.UnloadingTransaction;
-  const UnloadingDetail = db.UnloadingDetail;
-  const StockInventory = db.StockInventory;
-  const InventoryTransaction = db.InventoryTransaction;
-  const sequelizeInstance = UnloadingTransaction.sequelize;
+  const sequelizeInstance = req.db.UnloadingTransaction.sequelize;
   const dbTransaction = await sequelizeInstance.transaction();
 
   try {
-    const {
-      lorry_id,
-      unloading_date,
-      unloading_time,
-      unloaded_by,
-      status,
-      unloadingDetails, // Array of unloading details
-    } = req.body;
-
-    // Create the unloading transaction
-    const newUnloadingTransaction = await UnloadingTransaction.create(
-      {
-        lorry_id,
-        unloading_date: unloading_date || new Date(),
-        unloading_time:
-          unloading_time || new Date().toTimeString().split(" ")[0],
-        unloaded_by,
-        status: status || "Pending",
-      },
-      { transaction: dbTransaction }
+    const result = await exports.recordUnloadingTransaction(
+      req,
+      req.body,
+      dbTransaction
     );
 
-    // Process unloading details and update inventory
-    let newUnloadingDetails = [];
-
-    if (unloadingDetails && unloadingDetails.length > 0) {
-      // Process each product being unloaded
-      for (const detail of unloadingDetails) {
-        // Get product information first
-        const product = await db.Product.findOne({
-          where: { product_id: detail.product_id },
-          transaction: dbTransaction,
-        });
-
-        if (!product) {
-          throw new Error(`Product with ID ${detail.product_id} not found`);
-        }
-
-        const bottlesPerCase = product.bottles_per_case;
-
-        // Find current inventory for this product
-        const stockInventory = await StockInventory.findOne({
-          where: { product_id: detail.product_id },
-          transaction: dbTransaction,
-        });
-
-        // Calculate the new quantities properly
-        let newCasesQty, newBottlesQty, newTotalBottles;
+    // Commit the transaction if everything succeeded
+    await dbTransaction.commit();
 
-        if (!stockInventory) {
-          // If no inventory exists, create with proper conversion
-          const totalBottlesReturned =
-            detail.cases_returned * bottlesPerCase + detail.bottles_returned;
+    res.status(201).json(result);
+  } catch (error) {
+    // Rollback all changes if anything fails
+    await dbTransaction.rollback();
 
-          // Convert excess bottles to cases
-          newCasesQty = Math.floor(totalBottlesReturned / bottlesPerCase);
-          newBottlesQty = totalBottlesReturned % bottlesPerCase;
-          newTotalBottles = totalBottlesReturned;
+    res.status(500).json({
+      error: error.message,
+      message: "Failed to create unloading transaction or update inventory",
+    });
+  }
+};
 
-          const valuePerBottle = product.unit_price;
+// Creates the unloading transaction and its details, returns the stock to
+// inventory and records the day's sales, all inside the caller's database
+// transaction. Shared with the pallet batch uplink.
+exports.recordUnloadingTransaction = async (req, fields, dbTransaction) => {
+  const db = req.db;
+  const UnloadingTransaction = db.UnloadingTransaction;
+  const UnloadingDetail = db.UnloadingDetail;
+  const StockInventory = db.StockInventory;
+  const InventoryTransaction = db.InventoryTransaction;
 
-          // Create new inventory record
-          await StockInventory.create(
-            {
-              product_id: detail.product_id,
-              cases_qty: newCasesQty,
-              bottles_qty: newBottlesQty,
-              total_bottles: newTotalBottles,
-              total_value: newTotalBottles * valuePerBottle,
-              last_updated: new Date(),
-            },
-            { transaction: dbTransaction }
-          );
-        } else {
-          // Calculate total bottles being returned
-          const totalBottlesReturned =
-            detail.cases_returned * bottlesPerCase + detail.bottles_returned;
+  const {
+    lorry_id,
+    unloading_date,
+    unloading_time,
+    unloaded_by,
+    status,
+    unloadingDetails, // Array of unloading details
+  } = fields;
+
+  // Create the unloading transaction
+  const newUnloadingTransaction = await UnloadingTransaction.create(
+    {
+      lorry_id,
+      unloading_date: unloading_date || new Date(),
+      unloading_time:
+        unloading_time || new Date().toTimeString().split(" ")[0],
+      unloaded_by,
+      status: status || "Pending",
+    },
+    { transaction: dbTransaction }
+  );
+
+  // Process unloading details and update inventory
+  let newUnloadingDetails = [];
+
+  if (unloadingDetails && unloadingDetails.length > 0) {
+    // Process each product being unloaded
+    for (const detail of unloadingDetails) {
+      // Get product information first
+      const product = await db.Product.findOne({
+        where: { product_id: detail.product_id },
+        transaction: dbTransaction,
+      });
 
-          // Add to existing inventory
-          const newTotalBottlesInInventory =
-            stockInventory.total_bottles + totalBottlesReturned;
+      if (!product) {
+        throw new Error(`Product with ID ${detail.product_id} not found`);
+      }
 
-          // Convert total bottles to proper cases and bottles format
-          newCasesQty = Math.floor(newTotalBottlesInInventory / bottlesPerCase);
-          newBottlesQty = newTotalBottlesInInventory % bottlesPerCase;
-          newTotalBottles = newTotalBottlesInInventory;
+      const bottlesPerCase = product.bottles_per_case;
 
-          // Calculate value per bottle
-          const valuePerBottle = product.unit_price;
-          const newTotalValue = newTotalBottles * valuePerBottle;
+      // Find current inventory for this product
+      const stockInventory = await StockInventory.findOne({
+        where: { product_id: detail.product_id },
+        transaction: dbTransaction,
+      });
 
-          // Update the inventory with properly calculated values
-          await stockInventory.update(
-            {
-              cases_qty: newCasesQty,
-              bottles_qty: newBottlesQty,
-              total_bottles: newTotalBottles,
-              total_value: newTotalValue,
-              last_updated: new Date(),
-            },
-            { transaction: dbTransaction }
-          );
-        }
+      // Calculate the new quantities properly
+      let newCasesQty, newBottlesQty, newTotalBottles;
 
-        // Create the unloading detail record
+      if (!stockInventory) {
+        // If no inventory exists, create with proper conversion
         const totalBottlesReturned =
           detail.cases_returned * bottlesPerCase + detail.bottles_returned;
+
+        // Convert excess bottles to cases
+        newCasesQty = Math.floor(totalBottlesReturned / bottlesPerCase);
+        newBottlesQty = totalBottlesReturned % bottlesPerCase;
+        newTotalBottles = totalBottlesReturned;
+
         const valuePerBottle = product.unit_price;
 
-        // Record the inventory transaction
-        await InventoryTransaction.create(
+        // Create new inventory record
+        await StockInventory.create(
           {
             product_id: detail.product_id,
-            transaction_type: "ADD",
-            cases_qty: detail.cases_returned,
-            bottles_qty: detail.bottles_returned,
-            total_bottles: totalBottlesReturned,
-            total_value: totalBottlesReturned * valuePerBottle,
-            notes: "Unloading transaction",
-            transaction_date: new Date(),
+            cases_qty: newCasesQty,
+            bottles_qty: newBottlesQty,
+            total_bottles: newTotalBottles,
+            total_value: newTotalBottles * valuePerBottle,
+            last_updated: new Date(),
           },
           { transaction: dbTransaction }
         );
+      } else {
+        // Calculate total bottles being returned
+        const totalBottlesReturned =
+          detail.cases_returned * bottlesPerCase + detail.bottles_returned;
+
+        // Add to existing inventory
+        const newTotalBottlesInInventory =
+          stockInventory.total_bottles + totalBottlesReturned;
 
-        // Create unloading detail
-        const newDetail = await UnloadingDetail.create(
+        // Convert total bottles to proper cases and bottles format
+        newCasesQty = Math.floor(newTotalBottlesInInventory / bottlesPerCase);
+        newBottlesQty = newTotalBottlesInInventory % bottlesPerCase;
+        newTotalBottles = newTotalBottlesInInventory;
+
+        // Calculate value per bottle
+        const valuePerBottle = product.unit_price;
+        const newTotalValue = newTotalBottles * valuePerBottle;
+
+        // Update the inventory with properly calculated values
+        await stockInventory.update(
           {
-            unloading_id: newUnloadingTransaction.unloading_id,
-            product_id: detail.product_id,
-            cases_returned: detail.cases_returned,
-            bottles_returned: detail.bottles_returned,
-            total_bottles_returned: totalBottlesReturned,
-            value: totalBottlesReturned * valuePerBottle,
+            cases_qty: newCasesQty,
+            bottles_qty: newBottlesQty,
+            total_bottles: newTotalBottles,
+            total_value: newTotalValue,
+            last_updated: new Date(),
           },
           { transaction: dbTransaction }
         );
-
-        newUnloadingDetails.push(newDetail);
       }
-    }
 
-    // Update all loading transactions for this lorry to "Unloaded" state
-    await db.LoadingTransaction.update(
-      { status: "Unloaded" },
-      {
-        where: {
-          lorry_id: lorry_id,
-          status: { [Op.ne]: "Unloaded" }, // Only update non-unloaded transactions
-        },
-        transaction: dbTransaction,
-      }
-    );
-
-    // Create daily sales by comparing loading and unloading transactions
-    await createDailySalesFromUnloading(
-      lorry_id,
-      unloading_date || new Date(),
-      newUnloadingTransaction.unloading_id,
-      dbTransaction,
-      req
-    );
+      // Create the unloading detail record
+      const totalBottlesReturned =
+        detail.cases_returned * bottlesPerCase + detail.bottles_returned;
+      const valuePerBottle = product.unit_price;
 
-    // Commit the transaction if everything succeeded
-    await dbTransaction.commit();
+      // Record the inventory transaction
+      await InventoryTransaction.create(
+        {
+          product_id: detail.product_id,
+          transaction_type: "ADD",
+          cases_qty: detail.cases_returned,
+          bottles_qty: detail.bottles_returned,
+          total_bottles: totalBottlesReturned,
+          total_value: totalBottlesReturned * valuePerBottle,
+          notes: "Unloading transaction",
+          transaction_date: new Date(),
+        },
+        { transaction: dbTransaction }
+      );
 
-    res.status(201).json({
-      unloadingTransaction: newUnloadingTransaction,
-      unloadingDetails: newUnloadingDetails,
-    });
-  } catch (error) {
-    // Rollback all changes if anything fails
-    await dbTransaction.rollback();
+      // Create unloading detail
+      const newDetail = await UnloadingDetail.create(
+        {
+          unloading_id: newUnloadingTransaction.unloading_id,
+          product_id: detail.product_id,
+          cases_returned: detail.cases_returned,
+          bottles_returned: detail.bottles_returned,
+          total_bottles_returned: totalBottlesReturned,
+          value: totalBottlesReturned * valuePerBottle,
+        },
+        { transaction: dbTransaction }
+      );
 
-    res.status(500).json({
-      error: error.message,
-      message: "Failed to create unloading transaction or update inventory",
-    });
+      newUnloadingDetails.push(newDetail);
+    }
   }
+
+  // Update all loading transactions for this lorry to "Unloaded" state
+  await db.LoadingTransaction.update(
+    { status: "Unloaded" },
+    {
+      where: {
+        lorry_id: lorry_id,
+        status: { [Op.ne]: "Unloaded" }, // Only update non-unloaded transactions
+      },
+      transaction: dbTransaction,
+    }
+  );
+
+  // Create daily sales by comparing loading and unloading transactions
+  await createDailySalesFromUnloading(
+    lorry_id,
+    unloading_date || new Date(),
+    newUnloadingTransaction.unloading_id,
+    dbTransaction,
+    req
+  );
+
+  return {
+    unloadingTransaction: newUnloadingTransaction,
+    unloadingDetails: newUnloadingDetails,
+  };
 };
 
 // New helper function to create daily sales records
@@ -1,3 +1,4 @@
+const crypto = require("crypto");
 const jwt = require("jsonwebtoken");
 
 exports.verifyToken = (req, res, next) => {
@@ -21,6 +22,29 @@ exports.verifyToken = (req, res, next) => {
   }
 };
 
+// Pallets have no user session; they send the shared PALLET_API_KEY as a
+// bearer token instead
+exports.verifyApiKey = (req, res, next) => {
+  const expected = process.env.PALLET_API_KEY;
+  if (!expected) {
+    return res
+      .status(503)
+      .json({ message: "Pallet uplink is not configured on this server" });
+  }
+
+  const authHeader = req.headers.authorization;
+  const key = (authHeader && authHeader.split(" ")[1]) || "";
+
+  // Compare in constant time so the key cannot be guessed byte by byte
+  const given = crypto.createHash("sha256").update(key).digest();
+  const wanted = crypto.createHash("sha256").update(expected).digest();
+  if (!crypto.timingSafeEqual(given, wanted)) {
+    return res.status(401).json({ message: "Invalid API key" });
+  }
+
+  next();
+};
+
 // For role-based authorization (optional enhancement)
 exports.authorize = (roles = []) => {
   if (typeof roles === "string") {
@@ -0,0 +1,130 @@
+const express = require("express");
+
+// Decodes one MessagePack value. Covers everything ArduinoJson writes:
+// nil, booleans, integers, floats, strings, binary, arrays and maps.
+const decode = (buffer) => {
+  let offset = 0;
+
+  const take = (length) => {
+    if (offset + length > buffer.length) {
+      throw new Error("Truncated MessagePack body");
+    }
+    const start = offset;
+    offset += length;
+    return start;
+  };
+
+  const readString = (length) => {
+    const start = take(length);
+    return buffer.toString("utf8", start, start + length);
+  };
+
+  const readBinary = (length) => {
+    const start = take(length);
+    return buffer.subarray(start, start + length);
+  };
+
+  const readArray = (length) => {
+    const array = [];
+    for (let i = 0; i < length; i++) array.push(readValue());
+    return array;
+  };
+
+  const readMap = (length) => {
+    const map = {};
+    for (let i = 0; i < length; i++) {
+      const key = readValue();
+      map[key] = readValue();
+    }
+    return map;
+  };
+
+  const readValue = () => {
+    const type = buffer[take(1)];
+
+    if (type <= 0x7f) return type;
+    if (type >= 0xe0) return type - 0x100;
+    if (type >= 0x80 && type <= 0x8f) return readMap(type & 0x0f);
+    if (type >= 0x90 && type <= 0x9f) return readArray(type & 0x0f);
+    if (type >= 0xa0 && type <= 0xbf) return readString(type & 0x1f);
+
+    switch (type) {
+      case 0xc0:
+        return null;
+      case 0xc2:
+        return false;
+      case 0xc3:
+        return true;
+      case 0xc4:
+        return readBinary(buffer.readUInt8(take(1)));
+      case 0xc5:
+        return readBinary(buffer.readUInt16BE(take(2)));
+      case 0xc6:
+        return readBinary(buffer.readUInt32BE(take(4)));
+      case 0xca:
+        return buffer.readFloatBE(take(4));
+      case 0xcb:
+        return buffer.readDoubleBE(take(8));
+      case 0xcc:
+        return buffer.readUInt8(take(1));
+      case 0xcd:
+        return buffer.readUInt16BE(take(2));
+      case 0xce:
+        return buffer.readUInt32BE(take(4));
+      case 0xcf:
+        return Number(buffer.readBigUInt64BE(take(8)));
+      case 0xd0:
+        return buffer.readInt8(take(1));
+      case 0xd1:
+        return buffer.readInt16BE(take(2));
+      case 0xd2:
+        return buffer.readInt32BE(take(4));
+      case 0xd3:
+        return Number(buffer.readBigInt64BE(take(8)));
+      case 0xd9:
+        return readString(buffer.readUInt8(take(1)));
+      case 0xda:
+        return readString(buffer.readUInt16BE(take(2)));
+      case 0xdb:
+        return readString(buffer.readUInt32BE(take(4)));
+      case 0xdc:
+        return readArray(buffer.readUInt16BE(take(2)));
+      case 0xdd:
+        return readArray(buffer.readUInt32BE(take(4)));
+      case 0xde:
+        return readMap(buffer.readUInt16BE(take(2)));
+      case 0xdf:
+        return readMap(buffer.readUInt32BE(take(4)));
+      default:
+        throw new Error(`Unsupported MessagePack type 0x${type.toString(16)}`);
+    }
+  };
+
+  const value = readValue();
+  if (offset !== buffer.length) {
+    throw new Error("Trailing bytes after MessagePack body");
+  }
+  return value;
+};
+
+const rawMsgPack = express.raw({ type: "application/msgpack", limit: "64kb" });
+
+// Parses an application/msgpack body into req.body, so a handler sees the
+// same object whether the device sent JSON or MessagePack
+exports.parseMsgPack = (req, res, next) => {
+  rawMsgPack(req, res, (error) => {
+    if (error) return next(error);
+    if (!Buffer.isBuffer(req.body)) return next();
+
+    try {
+      req.body = decode(req.body);
+    } catch (error) {
+      return res
+        .status(400)
+        .json({ message: "Invalid MessagePack body", error: error.message });
+    }
+    next();
+  });
+};
+
+exports.decodeMsgPack = decode;
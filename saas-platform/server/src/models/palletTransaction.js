@@ -0,0 +1,98 @@
+"use strict";
+const { Model } = require("sequelize");
+
+module.exports = (sequelize, DataTypes) => {
+  class PalletTransaction extends Model {
+    static associate(models) {
+      // A pallet load becomes one LoadingTransaction
+      PalletTransaction.belongsTo(models.LoadingTransaction, {
+        foreignKey: "loading_id",
+        as: "loadingTransaction",
+      });
+
+      // A pallet unload becomes one UnloadingTransaction
+      PalletTransaction.belongsTo(models.UnloadingTransaction, {
+        foreignKey: "unloading_id",
+        as: "unloadingTransaction",
+      });
+    }
+  }
+
+  PalletTransaction.init(
+    {
+      pallet_transaction_id: {
+        type: DataTypes.INTEGER,
+        allowNull: false,
+        autoIncrement: true,
+        primaryKey: true,
+      },
+      // "<palette>-<journal>-<sequence>"; a retried batch is stored once
+      idempotency_key: {
+        type: DataTypes.STRING(64),
+        allowNull: false,
+        unique: true,
+      },
+      palette_id: {
+        type: DataTypes.STRING(32),
+        allowNull: false,
+      },
+      transaction_type: {
+        type: DataTypes.ENUM("LOAD", "UNLOAD"),
+        allowNull: false,
+      },
+      truck_id: {
+        type: DataTypes.STRING(32),
+        allowNull: false,
+      },
+      product_size: {
+        type: DataTypes.STRING(16),
+        allowNull: false,
+      },
+      bottle_count: {
+        type: DataTypes.INTEGER,
+        allowNull: false,
+      },
+      weight: {
+        type: DataTypes.DECIMAL(10, 3),
+        allowNull: false,
+      },
+      weight_change: {
+        type: DataTypes.DECIMAL(10, 3),
+      },
+      settled: {
+        type: DataTypes.BOOLEAN,
+        defaultValue: false,
+      },
+      count_confidence: {
+        type: DataTypes.INTEGER,
+      },
+      count_check: {
+        type: DataTypes.BOOLEAN,
+        defaultValue: false,
+      },
+      loading_id: {
+        type: DataTypes.INTEGER,
+        references: {
+          model: "LoadingTransactions",
+          key: "loading_id",
+        },
+      },
+      unloading_id: {
+        type: DataTypes.INTEGER,
+        references: {
+          model: "UnloadingTransactions",
+          key: "unloading_id",
+        },
+      },
+    },
+    {
+      sequelize,
+      modelName: "PalletTransaction",
+      tableName: "PalletTransactions",
+      timestamps: true,
+      underscored: true,
+    }
+  );
+
+  return PalletTransaction;
+};
@@ -27,6 +27,7 @@ const dailySalesRoutes = require("./dailySalesRoutes");
 const cocaColaMonthRoutes = require("./cocaColaMonthRoutes");
 const shopRoutes = require("./shopRoutes");
 const subDiscountTypeRoutes = require("./subDiscountTypeRoutes");
+const palletBatchRoutes = require("./palletBatchRoutes");
 const { verifyToken, authorize } = require("../middleware/authMiddleware");
 
 const adminOnly = authorize("admin");
@@ -57,5 +58,7 @@ router.use("/daily-sales", dailySalesRoutes);
 router.use("/coca-cola-months", cocaColaMonthRoutes);
 router.use("/shops", shopRoutes);
 router.use("/sub-discount-types", subDiscountTypeRoutes);
+// Path fixed by the pallet firmware (API_BATCH_URL)
+router.use("/palletBatch", palletBatchRoutes);
 
 module.exports = router;
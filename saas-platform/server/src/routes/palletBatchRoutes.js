@@ -0,0 +1,15 @@
+const express = require("express");
+const router = express.Router();
+const palletBatchController = require("../controllers/palletBatchController");
+const { verifyApiKey } = require("../middleware/authMiddleware");
+const { parseMsgPack } = require("../middleware/msgpackMiddleware");
+
+// Receive a pallet's batched uplink, as JSON or MessagePack
+router.post(
+  "/",
+  verifyApiKey,
+  parseMsgPack,
+  palletBatchController.receivePalletBatch
+);
+
+module.exports = router;
@@ -20,12 +20,19 @@
 // ============================================================================
 // MEASUREMENT SETTINGS
 // ============================================================================
+// Defaults; 's' overrides the interval, filter and threshold settings and
+// keeps them in flash
 #define READING_INTERVAL     100    // Weight reading interval (ms) - 10Hz
 #define DISPLAY_INTERVAL     250    // Display update interval (ms) - 4Hz
 #define FILTER_SAMPLES       10     // Moving average filter samples
 #define STABILITY_THRESHOLD  0.05   // Weight stability threshold (kg)
 #define MIN_WEIGHT_THRESHOLD 0.05   // Minimum weight to consider (kg)
-#define BOTTLE_WEIGHT        0.1    // Weight per bottle (kg) - adjust as needed
+#define SETTLE_QUIET_MS      200    // No step for this long before the weight is stable (ms)
+#define DEFAULT_PRODUCT      "175 mL" // Product size counted until 'p' selects another
+
+// Glitch rejection on the raw reads (Hampel filter), fixed at build time
+#define GLITCH_WINDOW        3      // Readings in the median; a real step shows one reading late
+#define GLITCH_MIN_COUNTS    350    // Never a glitch this close to the median (50 g at -7050 counts/kg)
 
 // ============================================================================
 // CALIBRATION VALUES (Will be updated during calibration)
@@ -0,0 +1,134 @@
+/*
+  Smart Inventory Palette v1.0 - Native Simulation Harness
+
+  Runs the phase 1 firmware against the shared simulated drivers in
+  ../smart-palette-system/sim, replaying a raw HX711 trace on the virtual
+  clock, and reports host CPU time per loop() pass.
+
+  Usage:
+    pio run -e native && .pio/build/native/program [options]
+
+    --trace <file>     raw HX711 counts, one per line
+    --rate <sps>       trace sample rate (default 80)
+    --duration <s>     virtual seconds to run (default 30)
+    --quiet            suppress the firmware's Serial output
+*/
+
+#include <Arduino.h>
+#include <SimControl.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "config.h"
+
+void setup();
+void loop();
+
+// ============================================================================
+// SCENARIO
+// ============================================================================
+const long SIM_TARE_OFFSET = 84200;
+const float SIM_SCALE_FACTOR = -7050.0;
+
+// Five 1 kg weights added one per second, then removed together
+std::vector<long> buildDefaultTrace(uint32_t sampleRate, uint32_t durationMs) {
+  std::vector<long> raw;
+  uint32_t seed = 12345;
+  size_t samples = static_cast<size_t>(durationMs / 1000.0 * sampleRate) + 1;
+  for (size_t i = 0; i < samples; i++) {
+    float t = static_cast<float>(i) / sampleRate;
+    float mass = 0;
+    for (int w = 0; w < 5; w++) {
+      if (t >= 5.0f + w && t < 20.0f) mass += 1.0f;
+    }
+    float noise = 0;
+    for (int k = 0; k < 4; k++) {
+      seed = seed * 1664525u + 1013904223u;
+      noise += (seed >> 8) / 16777216.0f - 0.5f;
+    }
+    raw.push_back(SIM_TARE_OFFSET + static_cast<long>(SIM_SCALE_FACTOR * mass + noise * 60));
+  }
+  return raw;
+}
+
+bool loadTrace(const char* path, std::vector<long>& raw) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    raw.push_back(std::strtol(line.c_str(), nullptr, 10));
+  }
+  return !raw.empty();
+}
+
+// ============================================================================
+// ENTRY POINT
+// ============================================================================
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  uint32_t sampleRate = 80;
+  uint32_t durationMs = 30000;
+
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--trace") && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc) {
+      sampleRate = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--duration") && i + 1 < argc) {
+      durationMs = static_cast<uint32_t>(std::atof(argv[++i]) * 1000);
+    } else if (!std::strcmp(argv[i], "--quiet")) {
+      sim::setSerialEcho(false);
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (sampleRate == 0) sampleRate = 80;
+
+  std::vector<long> raw;
+  if (tracePath) {
+    if (!loadTrace(tracePath, raw)) {
+      std::fprintf(stderr, "Cannot read trace %s\n", tracePath);
+      return 1;
+    }
+  } else {
+    raw = buildDefaultTrace(sampleRate, durationMs);
+  }
+  sim::loadHx711Trace(HX711_DOUT_PIN, HX711_SCK_PIN, raw, 1000000 / sampleRate);
+
+  // Stand in for a calibrated unit instead of the 1.0 factor in main.cpp
+  TARE_OFFSET = SIM_TARE_OFFSET;
+  SCALE_FACTOR = SIM_SCALE_FACTOR;
+
+  setup();
+
+  auto hostStart = std::chrono::steady_clock::now();
+  uint64_t loopStartUs = sim::nowMicros();
+  unsigned long passes = 0;
+  while (sim::nowMicros() < static_cast<uint64_t>(durationMs) * 1000) {
+    loop();
+    passes++;
+    // loop() never blocks on its own; give it a 1 ms tick of virtual time
+    delay(1);
+  }
+  double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+
+  std::printf("\n========================================\n");
+  std::printf("Simulation summary\n");
+  std::printf("========================================\n");
+  std::printf("Virtual time: %.3f s, host time: %.3f s\n", (sim::nowMicros() - loopStartUs) / 1e6, hostSeconds);
+  std::printf("loop(): %lu passes, %.0f ns/pass\n", passes, passes ? hostSeconds * 1e9 / passes : 0.0);
+  std::printf("HX711: %zu samples read, %zu missed\n",
+              sim::hx711SamplesRead(HX711_DOUT_PIN), sim::hx711SamplesMissed(HX711_DOUT_PIN));
+  sim::DisplayStats display = sim::displayStats();
+  std::printf("Display: %zu full frames, %zu bytes over I2C\n", display.frames, display.bytesPushed);
+
+  std::fflush(stdout);
+  std::_Exit(0);
+}
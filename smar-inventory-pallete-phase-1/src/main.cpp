@@ -14,7 +14,15 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <OledPanel.h>
 #include <HX711.h>
+#include <WeightFilter.h>
+#include <WeightEstimator.h>
+#include <FilterChain.h>
+#include <LoadCellCalibration.h>
+#include <BottleCounter.h>
+#include <Preferences.h>
+#include <ParameterStore.h>
 #include "config.h"
 
 // ============================================================================
@@ -22,30 +30,83 @@
 // ============================================================================
 HX711 scale;
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+OledPanel panel(display);
 
 // ============================================================================
-// CALIBRATION VALUES (Update these after calibration!)
+// CALIBRATION
 // ============================================================================
+// Used until a calibration is saved; 'c' stores one in flash
 long TARE_OFFSET = 0;           // Zero point offset
-float SCALE_FACTOR = 1.0;       // Scale factor (kg per unit)
+float SCALE_FACTOR = 1.0;       // Scale factor (counts per kg)
+
+CellCalibration calibration;
+CalibrationStore calibration_store;
 
 // ============================================================================
 // MEASUREMENT VARIABLES
 // ============================================================================
-float current_weight = 0.0;
+int32_t current_counts = 0;     // Latest raw reading
 float filtered_weight = 0.0;
 int bottle_count = 0;
+BottleCount count_estimate = {0, 0, 1, 0, false};
 bool is_stable = false;
 bool system_ready = false;
 
+// Display fields; the layout replaces the start-up screen on first update
+uint8_t display_address = SCREEN_ADDRESS;
+bool display_layout_ready = false;
+int8_t weight_field, bottles_field, status_field;
+int stable_indicator = -1;      // Indicator last drawn: 1 solid, 0 empty, -1 none
+
 // Timing variables
 unsigned long last_reading_time = 0;
 unsigned long last_display_time = 0;
 unsigned long last_serial_time = 0;
 
-// Moving average filter
-float weight_readings[FILTER_SAMPLES];
-int reading_index = 0;
+// A single corrupt read (a bit slip, a knock on the scale) is replaced by
+// the median of its neighbours before the window or the estimator see it
+Hampel<GLITCH_WINDOW, GLITCH_MIN_COUNTS> glitch_filter;
+
+// Moving average filter over raw counts (shared with smart-palette-system),
+// shown while the load moves
+WeightFilter weight_filter(FILTER_SAMPLES);
+
+// Kalman estimate of the weight and its rate, shown once settled. It
+// follows a step within a reading or two, where the window needs all of
+// its samples to let go of the old weight. Its bounds scale with the
+// stability threshold.
+const float ESTIMATE_NOISE_RATIO = 0.25;  // Reading noise it assumes
+const float ESTIMATE_SETTLE_RATIO = 0.3;  // Uncertainty of a settled estimate
+WeightEstimator estimator(STABILITY_THRESHOLD * ESTIMATE_NOISE_RATIO, STABILITY_THRESHOLD * ESTIMATE_SETTLE_RATIO,
+                          SETTLE_QUIET_MS);
+
+// Measurement settings, defaults from config.h; 's' changes them and
+// keeps them in flash. Bump TUNING_VERSION when an entry changes meaning.
+enum TuningParam : uint8_t {
+    TUNE_FILTER_SAMPLES,
+    TUNE_STABILITY,
+    TUNE_MIN_WEIGHT,
+    TUNE_READING_MS,
+    TUNE_DISPLAY_MS,
+    TUNE_SETTLE_QUIET_MS,
+    TUNING_PARAM_COUNT
+};
+
+const ParamSpec TUNING_PARAMS[TUNING_PARAM_COUNT] = {
+    {"filter_samples", PARAM_INT, 2, 100, FILTER_SAMPLES, "samples"},
+    {"stability_kg", PARAM_FLOAT, 0.005f, 1.0f, STABILITY_THRESHOLD, "kg"},
+    {"min_weight_kg", PARAM_FLOAT, 0.0f, 1.0f, MIN_WEIGHT_THRESHOLD, "kg"},
+    {"reading_ms", PARAM_INT, 20, 1000, READING_INTERVAL, "ms"},
+    {"display_ms", PARAM_INT, 50, 5000, DISPLAY_INTERVAL, "ms"},
+    {"settle_quiet_ms", PARAM_INT, 0, 2000, SETTLE_QUIET_MS, "ms"}
+};
+const uint16_t TUNING_VERSION = 1;
+ParameterStore tuning(TUNING_PARAMS, TUNING_PARAM_COUNT, TUNING_VERSION, "tuning");
+
+// Product being weighed, an index into STANDARD_SKUS; 'p' changes it and
+// keeps the choice in flash
+uint8_t product = 0;
+Preferences product_prefs;
 
 // ============================================================================
 // FUNCTION DECLARATIONS
@@ -53,12 +114,22 @@ int reading_index = 0;
 void initializeHardware();
 void initializeDisplay();
 void initializeScale();
+void initializeProduct();
+void initializeTuning();
+void configureEstimator();
 void readWeight();
+void initializeDisplayLayout();
 void updateDisplay();
 void updateSerial();
 void handleSerialCommands();
 void calibrateScale();
 void tareScale();
+void selectProduct();
+void changeSettings();
+void printSettings();
+void saveCalibration();
+void printCalibrationPoints();
+String waitForLine();
 void showRawReadings();
 void showSystemInfo();
 void printHelp();
@@ -83,11 +154,6 @@ void setup() {
     // Initialize hardware components
     initializeHardware();
     
-    // Initialize filter array
-    for (int i = 0; i < FILTER_SAMPLES; i++) {
-        weight_readings[i] = 0.0;
-    }
-    
     // System ready
     system_ready = true;
     Serial.println("System initialization complete!");
@@ -110,13 +176,13 @@ void loop() {
     }
     
     // Read weight at regular intervals
-    if (current_time - last_reading_time >= READING_INTERVAL) {
+    if (current_time - last_reading_time >= (unsigned long)tuning.getInt(TUNE_READING_MS)) {
         readWeight();
         last_reading_time = current_time;
     }
     
     // Update display at regular intervals
-    if (current_time - last_display_time >= DISPLAY_INTERVAL) {
+    if (current_time - last_display_time >= (unsigned long)tuning.getInt(TUNE_DISPLAY_MS)) {
         updateDisplay();
         last_display_time = current_time;
     }
@@ -142,6 +208,8 @@ void initializeHardware() {
     
     // Initialize scale
     initializeScale();
+    initializeProduct();
+    initializeTuning();
     
     Serial.println("Hardware initialization completed successfully!");
 }
@@ -164,6 +232,7 @@ void initializeDisplay() {
             while (true) delay(1000); // Stop execution
         } else {
             Serial.println("SUCCESS at 0x3D!");
+            display_address = 0x3D;
         }
     } else {
         Serial.println("SUCCESS at 0x3C!");
@@ -195,9 +264,11 @@ void initializeScale() {
     if (checkHX711Connection()) {
         Serial.println("SUCCESS!");
         
-        // Set calibration values
-        scale.set_scale(SCALE_FACTOR);
-        scale.set_offset(TARE_OFFSET);
+        // A saved calibration survives reboots; otherwise start linear
+        bool restored = calibration_store.load(&calibration, 1) == 1;
+        if (!restored) {
+            calibration.setLinear(TARE_OFFSET, SCALE_FACTOR);
+        }
         
         // Update display
         display.println("HX711: Connected");
@@ -206,8 +277,12 @@ void initializeScale() {
         Serial.println("HX711 configuration:");
         Serial.printf("- Data pin (DT): GPIO %d\n", HX711_DOUT_PIN);
         Serial.printf("- Clock pin (SCK): GPIO %d\n", HX711_SCK_PIN);
-        Serial.printf("- Scale factor: %.1f\n", SCALE_FACTOR);
-        Serial.printf("- Tare offset: %ld\n", TARE_OFFSET);
+        if (restored) {
+            Serial.printf("- Calibration: %u points, restored from flash\n", calibration.pointCount);
+        } else {
+            Serial.printf("- Calibration: none saved, scale factor %.1f, tare offset %ld\n",
+                          SCALE_FACTOR, TARE_OFFSET);
+        }
         
     } else {
         Serial.println("FAILED!");
@@ -227,6 +302,34 @@ void initializeScale() {
     }
 }
 
+void initializeProduct() {
+    char size[16] = "";
+    if (product_prefs.begin("product", true)) {
+        product_prefs.getString("size", size, sizeof(size));
+        product_prefs.end();
+    }
+    int index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, size);
+    if (index < 0) index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, DEFAULT_PRODUCT);
+    product = index >= 0 ? index : 0;
+    
+    const ProductSku& sku = STANDARD_SKUS[product];
+    Serial.printf("Product: %s, %.3f kg a bottle, %u per case\n", sku.size, sku.bottleKg, sku.bottlesPerCase);
+}
+
+void initializeTuning() {
+    uint8_t restored = tuning.load();
+    weight_filter.resize(tuning.getInt(TUNE_FILTER_SAMPLES));
+    configureEstimator();
+    Serial.printf("Settings: %u of %u changed from the defaults\n", restored, tuning.count());
+}
+
+// Starts the estimate over; the weight reads as unstable for a reading or two
+void configureEstimator() {
+    float stability = tuning.getFloat(TUNE_STABILITY);
+    estimator = WeightEstimator(stability * ESTIMATE_NOISE_RATIO, stability * ESTIMATE_SETTLE_RATIO,
+                                tuning.getInt(TUNE_SETTLE_QUIET_MS));
+}
+
 // ============================================================================
 // WEIGHT READING AND PROCESSING
 // ============================================================================
@@ -236,42 +339,39 @@ void readWeight() {
         return;
     }
     
-    // Get raw weight reading
-    current_weight = scale.get_units(1);
-    
-    // Handle negative weights (consider as zero)
-    if (current_weight < 0) {
-        current_weight = 0.0;
-    }
-    
-    // Apply moving average filter
-    weight_readings[reading_index] = current_weight;
-    reading_index = (reading_index + 1) % FILTER_SAMPLES;
-    
-    // Calculate filtered weight
-    float sum = 0.0;
-    for (int i = 0; i < FILTER_SAMPLES; i++) {
-        sum += weight_readings[i];
-    }
-    filtered_weight = sum / FILTER_SAMPLES;
-    
-    // Check weight stability
-    float max_deviation = 0.0;
-    for (int i = 0; i < FILTER_SAMPLES; i++) {
-        float deviation = abs(weight_readings[i] - filtered_weight);
-        if (deviation > max_deviation) {
-            max_deviation = deviation;
-        }
+    // The window filters raw counts in integer arithmetic; only its
+    // result goes through the calibration curve, compensated to the die
+    // temperature. A new tare or curve applies to the whole window at once.
+    current_counts = scale.read();
+    int32_t counts = glitch_filter.add(current_counts);
+    weight_filter.add(counts);
+    
+    float temperature = temperatureRead();
+    estimator.add(calibration.toKg(counts, temperature), millis());
+    
+    // Stable once the estimate has settled, and then it is the weight,
+    // with its own uncertainty. Until then the window is shown, and its
+    // spread, in kilograms at this load, is the measurement noise. A
+    // reading held back as a possible glitch may be the front of a step,
+    // and at this rate it is a whole reading old, so it is not stable.
+    float noise;
+    is_stable = estimator.isSettled() && !glitch_filter.holding();
+    if (is_stable) {
+        filtered_weight = estimator.weight();
+        noise = sqrtf(estimator.variance());
+    } else {
+        int32_t mean = weight_filter.mean();
+        filtered_weight = calibration.toKg(mean, temperature);
+        noise = fabsf(calibration.toKg(mean + weight_filter.maxDeviation(), temperature) - filtered_weight);
     }
-    is_stable = (max_deviation < STABILITY_THRESHOLD);
     
-    // Calculate bottle count
-    if (filtered_weight > MIN_WEIGHT_THRESHOLD) {
-        bottle_count = (int)(filtered_weight / BOTTLE_WEIGHT);
-    } else {
-        bottle_count = 0;
+    // Most likely whole count of the product, with how sure it is.
+    // Negative readings (noise around zero) are averaged in, then cut here.
+    if (filtered_weight <= tuning.getFloat(TUNE_MIN_WEIGHT)) {
         filtered_weight = 0.0; // Force small weights to zero
     }
+    count_estimate = BottleCounter::estimate(STANDARD_SKUS[product], filtered_weight, noise);
+    bottle_count = count_estimate.bottles;
     
     // Ensure weight doesn't exceed maximum
     if (filtered_weight > MAX_WEIGHT) {
@@ -283,57 +383,84 @@ void readWeight() {
 // ============================================================================
 // DISPLAY UPDATE
 // ============================================================================
-void updateDisplay() {
+// Every text row sits on its own 8-pixel page, so OledPanel only sends
+// the columns of the rows that actually changed
+void initializeDisplayLayout() {
     display.clearDisplay();
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
     
-    // Title bar
+    // Title bar and label never change
     display.setCursor(0, 0);
     display.println("Smart Palette v1.0");
     display.drawLine(0, 10, SCREEN_WIDTH, 10, SSD1306_WHITE);
+    display.setCursor(0, 16);
+    display.print("Weight:");
+    
+    weight_field = panel.addField(0, 24, 10, 2);    // Large font, pages 3-4
+    bottles_field = panel.addField(0, 40, OledPanel::MAX_FIELD_CHARS);
+    status_field = panel.addField(0, 56, 17);       // Leaves room for the indicator
+    panel.begin(display_address);
+    display_layout_ready = true;
+}
+
+void updateDisplay() {
+    if (!display_layout_ready) {
+        initializeDisplayLayout();
+    }
     
     // Weight display (large font)
-    display.setCursor(0, 15);
-    display.print("Weight:");
-    display.setTextSize(2);
-    display.setCursor(0, 25);
     if (filtered_weight < 10.0) {
-        display.printf("%.2f kg", filtered_weight);
+        panel.printf(weight_field, "%.2f kg", filtered_weight);
     } else {
-        display.printf("%.1f kg", filtered_weight);
+        panel.printf(weight_field, "%.1f kg", filtered_weight);
     }
     
     // Bottle count
-    display.setTextSize(1);
-    display.setCursor(0, 45);
-    display.printf("Bottles: ~%d units", bottle_count);
+    // An ambiguous count wants a check by hand
+    if (count_estimate.ambiguous) {
+        panel.printf(bottles_field, "Bottles: ~%d CHECK", bottle_count);
+    } else {
+        panel.printf(bottles_field, "Bottles: %d units", bottle_count);
+    }
     
     // Status indicator
-    display.setCursor(0, 55);
-    display.print("Status: ");
+    int indicator = -1;
     if (!system_ready) {
-        display.print("Starting");
+        panel.setText(status_field, "Status: Starting");
     } else if (is_stable) {
-        display.print("Ready");
-        // Solid circle for stable reading
-        display.fillCircle(120, 58, 3, SSD1306_WHITE);
+        panel.setText(status_field, "Status: Ready");
+        indicator = 1;
     } else {
-        display.print("Measuring");
-        // Empty circle for unstable reading
-        display.drawCircle(120, 58, 3, SSD1306_WHITE);
+        panel.setText(status_field, "Status: Measuring");
+        indicator = 0;
     }
     
-    display.display();
+    if (indicator != stable_indicator) {
+        display.fillRect(116, 56, 9, 8, SSD1306_BLACK);
+        if (indicator == 1) {
+            // Solid circle for stable reading
+            display.fillCircle(120, 59, 3, SSD1306_WHITE);
+        } else if (indicator == 0) {
+            // Empty circle for unstable reading
+            display.drawCircle(120, 59, 3, SSD1306_WHITE);
+        }
+        panel.markDirty(116, 56, 9, 8);
+        stable_indicator = indicator;
+    }
+    
+    // Sends nothing when the screen is unchanged
+    panel.flush();
 }
 
 // ============================================================================
 // SERIAL OUTPUT UPDATE
 // ============================================================================
 void updateSerial() {
-    Serial.printf("Weight: %.3f kg | Bottles: %d | Stable: %s | Raw: %.3f\n", 
-                  filtered_weight, bottle_count, 
-                  is_stable ? "YES" : "NO", current_weight);
+    Serial.printf("Weight: %.3f kg | Bottles: %d (%.0f%%%s) | Stable: %s | Raw: %.3f\n", 
+                  filtered_weight, bottle_count, count_estimate.confidence * 100,
+                  count_estimate.ambiguous ? ", check" : "",
+                  is_stable ? "YES" : "NO", calibration.toKg(current_counts, temperatureRead()));
 }
 
 // ============================================================================
@@ -354,6 +481,16 @@ void handleSerialCommands() {
             calibrateScale();
             break;
             
+        case 'p':
+        case 'P':
+            selectProduct();
+            break;
+            
+        case 's':
+        case 'S':
+            changeSettings();
+            break;
+            
         case 'r':
         case 'R':
             showRawReadings();
@@ -375,6 +512,45 @@ void handleSerialCommands() {
     }
 }
 
+// ============================================================================
+// PRODUCT SELECTION
+// ============================================================================
+void selectProduct() {
+    Serial.println("Products (size, bottle, bottles per case, case):");
+    for (uint8_t i = 0; i < STANDARD_SKU_COUNT; i++) {
+        const ProductSku& sku = STANDARD_SKUS[i];
+        Serial.printf("%c %2u. %-8s %.3f kg  %2u  %.2f kg\n", i == product ? '*' : ' ', i + 1,
+                      sku.size, sku.bottleKg, sku.bottlesPerCase, sku.caseKg);
+    }
+    Serial.println("Enter a number or a size (blank keeps the current one):");
+    
+    String line = waitForLine();
+    if (line.length() == 0) return;
+    
+    // A list number, unless there is more to it ("1.5 L" is a size)
+    char* end;
+    long number = strtol(line.c_str(), &end, 10);
+    int index = -1;
+    if (*end == '\0' && number >= 1 && number <= STANDARD_SKU_COUNT) {
+        index = number - 1;
+    } else {
+        index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, line.c_str());
+    }
+    if (index < 0) {
+        Serial.printf("Unknown product '%s'\n", line.c_str());
+        return;
+    }
+    
+    product = index;
+    bool saved = product_prefs.begin("product", false);
+    if (saved) {
+        saved = product_prefs.putString("size", STANDARD_SKUS[product].size) > 0;
+        product_prefs.end();
+    }
+    Serial.printf("Counting %s bottles%s\n", STANDARD_SKUS[product].size,
+                  saved ? "" : " (NOT saved to flash)");
+}
+
 // ============================================================================
 // CALIBRATION FUNCTIONS
 // ============================================================================
@@ -386,9 +562,12 @@ void tareScale() {
         return;
     }
     
-    scale.tare(20); // Average 20 readings
+    // Shifts the whole curve; the calibrated gain is kept
+    long zero = scale.read_average(20); // Average 20 readings
+    calibration.tare(zero, temperatureRead());
+    saveCalibration();
     Serial.println("Scale tared successfully!");
-    Serial.printf("New tare offset: %ld\n", scale.get_offset());
+    Serial.printf("New zero: %ld counts\n", zero);
 }
 
 void calibrateScale() {
@@ -404,70 +583,79 @@ void calibrateScale() {
     // Step 1: Remove all weight
     Serial.println("Step 1: Remove ALL weight from the scale");
     Serial.println("Press Enter when the scale is empty...");
-    while (!Serial.available()) delay(100);
-    Serial.read(); // Clear input
+    waitForLine();
     
+    // Starts over from the zero; the old curve stays in use until the end
+    CellCalibration updated = calibration;
+    updated.clear();
     Serial.println("Taring scale...");
-    scale.tare(25); // Use more samples for better accuracy
-    long tare_value = scale.get_offset();
-    Serial.printf("Tare offset set to: %ld\n", tare_value);
-    
-    // Step 2: Add known weight
-    Serial.println("\nStep 2: Place a KNOWN WEIGHT on the scale");
-    Serial.println("For best results, use 1kg or heavier");
-    Serial.println("Enter the exact weight in kg (e.g., 1.5 for 1.5kg):");
-    
-    while (!Serial.available()) delay(100);
-    float known_weight = Serial.parseFloat();
-    while (Serial.available()) Serial.read(); // Clear input
-    
-    if (known_weight <= 0 || known_weight > MAX_WEIGHT) {
-        Serial.printf("ERROR: Invalid weight! Must be between 0 and %.1f kg\n", MAX_WEIGHT);
-        return;
+    long zero = scale.read_average(25); // Use more samples for better accuracy
+    updated.setPoint(zero, 0, temperatureRead());
+    Serial.printf("Zero set to: %ld counts\n", zero);
+    
+    // Step 2: Known weights, lightest to heaviest. Several points spread
+    // over the range follow a load cell that is not quite linear.
+    Serial.println("\nStep 2: Place KNOWN WEIGHTS on the scale, one at a time");
+    Serial.println("For best results, use 1kg or heavier and spread them over the range");
+    float known_weight = 0;
+    long average_reading = 0;
+    
+    while (updated.pointCount < CellCalibration::MAX_POINTS) {
+        Serial.printf("\nPoint %u: enter the exact weight in kg (e.g., 1.5 for 1.5kg),\n", updated.pointCount);
+        Serial.println("or just press Enter to finish:");
+        String line = waitForLine();
+        if (line.length() == 0) break;
+        
+        float weight = line.toFloat();
+        if (weight <= 0 || weight > MAX_WEIGHT) {
+            Serial.printf("ERROR: Invalid weight! Must be between 0 and %.1f kg\n", MAX_WEIGHT);
+            continue;
+        }
+        
+        Serial.printf("Using calibration weight: %.3f kg\n", weight);
+        Serial.println("Make sure the weight is stable, then press Enter...");
+        waitForLine();
+        
+        // Step 3: Take calibration reading
+        Serial.println("Taking calibration readings...");
+        long total_reading = 0;
+        const int calibration_samples = 30;
+        
+        for (int i = 0; i < calibration_samples; i++) {
+            total_reading += scale.read();
+            delay(100);
+            if (i % 5 == 0) Serial.print(".");
+        }
+        Serial.println();
+        
+        long reading = total_reading / calibration_samples;
+        if (!updated.setPoint(reading, weight, temperatureRead())) {
+            Serial.printf("ERROR: Reading %ld does not fit the other points - check the weight and try again\n", reading);
+            continue;
+        }
+        Serial.printf("Raw reading: %ld\n", reading);
+        known_weight = weight;
+        average_reading = reading;
     }
     
-    Serial.printf("Using calibration weight: %.3f kg\n", known_weight);
-    Serial.println("Make sure the weight is stable, then press Enter...");
-    while (!Serial.available()) delay(100);
-    Serial.read(); // Clear input
-    
-    // Step 3: Take calibration reading
-    Serial.println("Taking calibration readings...");
-    long total_reading = 0;
-    const int calibration_samples = 30;
-    
-    for (int i = 0; i < calibration_samples; i++) {
-        total_reading += scale.read();
-        delay(100);
-        if (i % 5 == 0) Serial.print(".");
+    if (!updated.isMultiPoint()) {
+        Serial.println("No known weight taken - calibration unchanged");
+        return;
     }
-    Serial.println();
-    
-    long average_reading = total_reading / calibration_samples;
-    float new_scale_factor = (average_reading - tare_value) / known_weight;
+    calibration = updated;
     
     // Display calibration results
     Serial.println("\n========================================");
     Serial.println("CALIBRATION RESULTS:");
-    Serial.printf("Tare offset: %ld\n", tare_value);
-    Serial.printf("Scale factor: %.2f\n", new_scale_factor);
-    Serial.printf("Calibration weight: %.3f kg\n", known_weight);
-    Serial.printf("Raw reading: %ld\n", average_reading);
-    Serial.println("========================================");
-    Serial.println("UPDATE YOUR CODE WITH THESE VALUES:");
-    Serial.printf("TARE_OFFSET = %ld;\n", tare_value);
-    Serial.printf("SCALE_FACTOR = %.2f;\n", new_scale_factor);
+    printCalibrationPoints();
     Serial.println("========================================");
+    saveCalibration();
     
-    // Apply calibration temporarily
-    scale.set_scale(new_scale_factor);
-    scale.set_offset(tare_value);
-    
-    // Test calibration
+    // Test calibration against the last weight, still on the scale
     Serial.println("Testing calibration...");
     delay(2000);
-    float test_weight = scale.get_units(15);
-    Serial.printf("Test reading: %.3f kg (expected: %.3f kg)\n", test_weight, known_weight);
+    float test_weight = calibration.toKg(scale.read_average(15), temperatureRead());
+    Serial.printf("Test reading: %.3f kg (expected: %.3f kg, raw %ld)\n", test_weight, known_weight, average_reading);
     
     float error = abs(test_weight - known_weight);
     Serial.printf("Calibration error: %.0f grams\n", error * 1000);
@@ -480,10 +668,73 @@ void calibrateScale() {
         Serial.println("⚠ Calibration needs improvement");
         Serial.println("Try using a heavier, more precise weight");
     }
+}
+
+void saveCalibration() {
+    if (calibration_store.save(&calibration, 1)) {
+        Serial.println("Calibration saved to flash");
+    } else {
+        Serial.println("WARNING: Calibration NOT saved - it is lost on reboot");
+    }
+}
+
+void printCalibrationPoints() {
+    for (uint8_t i = 0; i < calibration.pointCount; i++) {
+        Serial.printf("%8.3f kg at %ld counts\n", calibration.points[i].kg, (long)calibration.points[i].counts);
+    }
+    if (!isnan(calibration.referenceTempC)) {
+        Serial.printf("Taken at %.1f C die temperature\n", calibration.referenceTempC);
+    }
+}
+
+// ============================================================================
+// MEASUREMENT SETTINGS
+// ============================================================================
+void changeSettings() {
+    printSettings();
+    Serial.println("Enter '<name> <value>', or 'reset' for the defaults (blank keeps them):");
+    
+    String line = waitForLine();
+    if (line.length() == 0) return;
+    
+    int old_window = tuning.getInt(TUNE_FILTER_SAMPLES);
+    float old_stability = tuning.getFloat(TUNE_STABILITY);
+    int old_quiet = tuning.getInt(TUNE_SETTLE_QUIET_MS);
+    if (line == "reset") {
+        if (!tuning.reset()) Serial.println("Defaults applied but NOT cleared from flash");
+    } else {
+        int space = line.indexOf(' ');
+        String name = space > 0 ? line.substring(0, space) : line;
+        String value = space > 0 ? line.substring(space + 1) : String("");
+        value.trim();
+        ParamResult result = tuning.set(name.c_str(), value.c_str());
+        if (result != PARAM_OK) {
+            Serial.printf("%s: %s\n", name.c_str(), ParameterStore::resultName(result));
+            if (result != PARAM_NOT_SAVED) return;
+        }
+    }
     
-    Serial.println("\nTo make this calibration permanent:");
-    Serial.println("1. Update the TARE_OFFSET and SCALE_FACTOR values in your code");
-    Serial.println("2. Build and upload the updated code");
+    // A new window starts empty; the weight reads as unstable until it fills
+    if (tuning.getInt(TUNE_FILTER_SAMPLES) != old_window) {
+        weight_filter.resize(tuning.getInt(TUNE_FILTER_SAMPLES));
+    }
+    if (tuning.getFloat(TUNE_STABILITY) != old_stability || tuning.getInt(TUNE_SETTLE_QUIET_MS) != old_quiet) {
+        configureEstimator();
+    }
+    printSettings();
+}
+
+void printSettings() {
+    for (uint8_t i = 0; i < tuning.count(); i++) {
+        const ParamSpec& spec = tuning.spec(i);
+        if (spec.type == PARAM_INT) {
+            Serial.printf("  %-16s %8ld %-8s (%.0f..%.0f)%s\n", spec.key, (long)tuning.getInt(i), spec.unit,
+                          spec.minimum, spec.maximum, tuning.isDefault(i) ? "" : " *");
+        } else {
+            Serial.printf("  %-16s %8.3f %-8s (%g..%g)%s\n", spec.key, tuning.getFloat(i), spec.unit,
+                          spec.minimum, spec.maximum, tuning.isDefault(i) ? "" : " *");
+        }
+    }
 }
 
 // ============================================================================
@@ -498,10 +749,11 @@ void showRawReadings() {
     while (!Serial.available()) {
         if (checkHX711Connection()) {
             long raw_value = scale.read();
-            float weight_value = scale.get_units();
+            float temperature = temperatureRead();
+            float weight_value = calibration.toKg(raw_value, temperature);
             
-            Serial.printf("Raw: %8ld | Weight: %8.3f kg | Offset: %8ld | Scale: %8.2f\n", 
-                         raw_value, weight_value, scale.get_offset(), scale.get_scale());
+            Serial.printf("Raw: %8ld | Weight: %8.3f kg | Points: %u | Die: %5.1f C\n", 
+                         raw_value, weight_value, calibration.pointCount, temperature);
         } else {
             Serial.println("HX711 not responding!");
         }
@@ -532,17 +784,29 @@ void showSystemInfo() {
     Serial.printf("Display SCL Pin: GPIO %d\n", DISPLAY_SCL_PIN);
     Serial.println("----------------------------------------");
     Serial.printf("Current Weight: %.3f kg\n", filtered_weight);
-    Serial.printf("Bottle Count: %d\n", bottle_count);
+    Serial.printf("Product: %s (%u per case)\n", STANDARD_SKUS[product].size,
+                  STANDARD_SKUS[product].bottlesPerCase);
+    Serial.printf("Bottle Count: %d in %d cases, %.0f%% sure%s\n", bottle_count,
+                  (int)count_estimate.cases, count_estimate.confidence * 100,
+                  count_estimate.ambiguous ? " - check by hand" : "");
     Serial.printf("System Status: %s\n", is_stable ? "Stable" : "Measuring");
-    Serial.printf("Scale Factor: %.2f\n", scale.get_scale());
-    Serial.printf("Tare Offset: %ld\n", scale.get_offset());
+    Serial.printf("Glitches Rejected: %lu\n", (unsigned long)glitch_filter.rejected());
+    Serial.printf("Die Temperature: %.1f C\n", temperatureRead());
+    Serial.println("----------------------------------------");
+    Serial.printf("Calibration: %u points%s\n", calibration.pointCount,
+                  calibration.isMultiPoint() ? "" : " (nominal scale factor)");
+    printCalibrationPoints();
+    Serial.println("Settings (* changed from the defaults):");
+    printSettings();
     Serial.println("========================================");
 }
 
 void printHelp() {
     Serial.println("AVAILABLE COMMANDS:");
     Serial.println("'t' or 'T' - Tare scale (set current weight as zero)");
-    Serial.println("'c' or 'C' - Start calibration process");
+    Serial.println("'c' or 'C' - Calibrate with known weights (saved to flash)");
+    Serial.println("'p' or 'P' - Select the product being counted");
+    Serial.println("'s' or 'S' - Change the measurement settings (saved to flash)");
     Serial.println("'r' or 'R' - Show raw sensor readings");
     Serial.println("'i' or 'I' - Show system information");
     Serial.println("'h' or 'H' - Show this help menu");
@@ -553,4 +817,12 @@ void printHelp() {
 // ============================================================================
 bool checkHX711Connection() {
     return scale.is_ready();
+}
+
+// Waits for a line of input, without its line ending
+String waitForLine() {
+    while (!Serial.available()) delay(100);
+    String line = Serial.readStringUntil('\n');
+    line.trim();
+    return line;
 }
\ No newline at end of file
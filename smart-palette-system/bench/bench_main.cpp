@@ -0,0 +1,237 @@
+/*
+  Smart Inventory Palette - Benchmark harness
+
+  Native (pio run -e bench): times the stage benchmarks on the host, then
+  boots the unmodified firmware in the simulator and measures tap to
+  commit - a completion tap handed to processNfcEvent() until the
+  transaction is on flash - on the virtual clock, which is deterministic,
+  plus the host CPU the tasks spent on it. Results go to a JSON file;
+  any result above its limit fails the run.
+
+    .pio/build/bench/program [options]
+
+    --out <file>         results file (default bench_results.json)
+    --thresholds <file>  limits, one "name limit" line per result, # comments
+    --samples <n>        iterations per sample-pipeline benchmark (default 200000)
+    --verbose            show the firmware's Serial output
+
+  Exit status: 0 passed, 1 a result over its limit, 2 bad arguments.
+
+  On the board (pio run -e bench_esp32 -t upload) the stage benchmarks
+  run once at boot and are printed as a table and as JSON; the workflow
+  needs the simulator and is native only.
+
+  File: bench_main.cpp
+*/
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "bench_suite.h"
+#include "../src/config.h"
+
+#ifdef ESP_PLATFORM
+
+const uint32_t BENCH_SAMPLES = 20000;
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000);
+  Wire.begin(PN532_SDA, PN532_SCL);
+
+  BenchSuite suite;
+  runStageBenchmarks(suite, BENCH_SAMPLES);
+  suite.printTable(Serial);
+  suite.printJson(Serial, "esp32");
+}
+
+void loop() {
+  delay(1000);
+}
+
+#else
+
+#include <SimControl.h>
+#include <TransactionJournal.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../src/nfc_reader.h"
+
+void setup();
+extern TransactionJournal journal;
+void processNfcEvent(const NfcTap& tap);
+
+// ============================================================================
+// WORKFLOW SCENARIO
+// ============================================================================
+const uint8_t NUM_CELLS = LOAD_CELLS;
+const uint8_t CELL_DOUT[] = {HX711_1_DT, HX711_2_DT, HX711_3_DT, HX711_4_DT};
+const uint8_t CELL_SCK[] = {HX711_1_SCK, HX711_2_SCK, HX711_3_SCK, HX711_4_SCK};
+const long CELL_ZERO[] = {84200, -12650, 40310, -61020};
+const float COUNTS_PER_KG = -7050.0;
+const uint32_t SAMPLE_PERIOD_US = 12500;  // 80 SPS
+const float CRATE_WEIGHT = 24 * 0.36f + 1.6f;
+const NfcUid TRUCK_CARD = {{0x04, 0x52, 0xF3, 0x2A}, 4};  // TRUCK_A, a built-in default
+
+// Each transaction: start tap, a crate lands a second later, completion
+// tap once it has settled, then the completed screen runs out
+const uint32_t FIRST_TAP_MS = 8000;
+const uint32_t TRANSACTION_MS = 8000;
+const uint32_t CRATE_AT_MS = 1000;
+const uint32_t COMPLETE_AT_MS = 3000;
+const uint32_t TRANSACTIONS = 8;
+const uint64_t COMMIT_TIMEOUT_US = 10000000;
+
+float scenarioMass(uint32_t ms) {
+  if (ms < FIRST_TAP_MS + CRATE_AT_MS) return 0;
+  uint32_t landed = (ms - FIRST_TAP_MS - CRATE_AT_MS) / TRANSACTION_MS + 1;
+  return CRATE_WEIGHT * (landed < TRANSACTIONS ? landed : TRANSACTIONS);
+}
+
+void loadScenarioTraces() {
+  uint32_t samples = (FIRST_TAP_MS + TRANSACTIONS * TRANSACTION_MS) * 1000 / SAMPLE_PERIOD_US + 1;
+  uint32_t seed = 7;
+  for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+    std::vector<long> counts(samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      float kg = scenarioMass(i * SAMPLE_PERIOD_US / 1000) / NUM_CELLS;
+      counts[i] = CELL_ZERO[cell] + static_cast<long>(kg * COUNTS_PER_KG) + static_cast<long>(seed >> 28) - 8;
+    }
+    sim::loadHx711Trace(CELL_DOUT[cell], CELL_SCK[cell], counts, SAMPLE_PERIOD_US);
+  }
+}
+
+uint64_t tasksHostNanos() {
+  uint64_t total = 0;
+  for (const sim::TaskStats& task : sim::taskStats()) total += task.hostNanos;
+  return total;
+}
+
+void tap() {
+  NfcTap tap;
+  tap.uid = TRUCK_CARD;
+  tap.timestampMs = millis();
+  processNfcEvent(tap);
+}
+
+void runUntilMs(uint32_t ms) {
+  if (millis() < ms) sim::runFor(ms - millis());
+}
+
+void benchTapToCommit(BenchSuite& suite) {
+  loadScenarioTraces();
+  sim::setWifiConnected(true);
+  setup();
+
+  uint32_t committed = 0;
+  uint64_t totalUs = 0, worstUs = 0, hostNanos = 0;
+  for (uint32_t i = 0; i < TRANSACTIONS; i++) {
+    uint32_t startMs = FIRST_TAP_MS + i * TRANSACTION_MS;
+    runUntilMs(startMs);
+    tap();
+
+    runUntilMs(startMs + COMPLETE_AT_MS);
+    uint32_t before = journal.lastSequence();
+    uint64_t hostBefore = tasksHostNanos();
+    uint64_t tappedAt = sim::nowMicros();
+    tap();
+    while (journal.lastSequence() == before && sim::nowMicros() - tappedAt < COMMIT_TIMEOUT_US) {
+      sim::sleepMicros(100);
+    }
+    if (journal.lastSequence() == before) continue;
+
+    uint64_t latency = sim::nowMicros() - tappedAt;
+    committed++;
+    totalUs += latency;
+    if (latency > worstUs) worstUs = latency;
+    hostNanos += tasksHostNanos() - hostBefore;
+  }
+
+  suite.add("tap_to_commit_missed", "taps", TRANSACTIONS - committed);
+  if (committed == 0) return;
+  suite.add("tap_to_commit_mean", "ms", totalUs / 1e3 / committed);
+  suite.add("tap_to_commit_worst", "ms", worstUs / 1e3);
+  suite.add("tap_to_commit_cpu", "us/tap", hostNanos / 1e3 / committed);
+}
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE* file) : file_(file) {}
+  size_t write(uint8_t c) override { return std::fputc(c, file_) == EOF ? 0 : 1; }
+
+private:
+  FILE* file_;
+};
+
+bool loadThresholds(const char* path, BenchSuite& suite) {
+  FILE* file = std::fopen(path, "r");
+  if (!file) return false;
+  char line[128];
+  while (std::fgets(line, sizeof(line), file)) {
+    char name[64];
+    double limit;
+    if (line[0] == '#' || std::sscanf(line, "%63s %lf", name, &limit) != 2) continue;
+    if (!suite.setLimit(name, limit)) std::fprintf(stderr, "Threshold for unknown benchmark %s\n", name);
+  }
+  std::fclose(file);
+  return true;
+}
+
+// ============================================================================
+// ENTRY POINT
+// ============================================================================
+int main(int argc, char** argv) {
+  const char* outPath = "bench_results.json";
+  const char* thresholdsPath = nullptr;
+  uint32_t samples = 200000;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--out") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--thresholds") && i + 1 < argc) {
+      thresholdsPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--samples") && i + 1 < argc) {
+      samples = static_cast<uint32_t>(std::atol(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--verbose")) {
+      verbose = true;
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (samples == 0) samples = 1;
+  sim::setSerialEcho(verbose);
+
+  BenchSuite suite;
+  runStageBenchmarks(suite, samples);
+  benchTapToCommit(suite);
+
+  if (thresholdsPath && !loadThresholds(thresholdsPath, suite)) {
+    std::fprintf(stderr, "Cannot read thresholds %s\n", thresholdsPath);
+    return 2;
+  }
+
+  FilePrint console(stdout);
+  suite.printTable(console);
+  FILE* out = std::fopen(outPath, "w");
+  if (!out) {
+    std::fprintf(stderr, "Cannot write %s\n", outPath);
+    return 2;
+  }
+  FilePrint results(out);
+  suite.printJson(results, "native");
+  std::fclose(out);
+  std::printf("Results written to %s%s\n", outPath, suite.passed() ? "" : " - REGRESSION");
+
+  // Firmware tasks never return; leave without unwinding their threads
+  std::fflush(stdout);
+  std::_Exit(suite.passed() ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*
+  Smart Inventory Palette - Stage benchmarks
+
+  Each stage runs on the same synthetic input every time: a 20 kg load
+  on two cells with a few counts of deterministic noise, so a change in
+  the numbers comes from the code and not from the data. The filter
+  settings are the ones main.cpp uses.
+
+  File: bench_stages.cpp
+*/
+
+#include "bench_suite.h"
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+#include <OledPanel.h>
+#include <WeightFilter.h>
+#include <FilterChain.h>
+#include <PlateauDetector.h>
+#include <WeightEstimator.h>
+#include <LoadCellCalibration.h>
+#include <CellFusion.h>
+#include <BottleCounter.h>
+#include <string.h>
+#include "../src/config.h"
+#include "../src/uplink_batcher.h"
+
+namespace {
+
+// As in main.cpp with the default tuning from config.h
+const float PLATEAU_DRIFT = STABILITY_THRESHOLD / 2;
+const float PLATEAU_THRESHOLD = STABILITY_THRESHOLD * 4;
+const float ESTIMATE_NOISE = STABILITY_THRESHOLD / 4;
+const float ESTIMATE_SETTLE = STABILITY_THRESHOLD * 0.3f;
+const float COUNTS_PER_KG = -7050.0;
+
+const uint32_t SAMPLE_PERIOD_MS = 12;  // 80 SPS
+const uint32_t UPLINK_BATCHES = 2000;
+const uint32_t DISPLAY_FRAMES = 500;
+
+// Results feed this so the compiler cannot drop the work
+volatile float sink;
+
+int32_t noiseCounts(uint32_t& seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return static_cast<int32_t>(seed >> 28) - 8;
+}
+
+float noiseKg(uint32_t& seed) {
+  return noiseCounts(seed) / -COUNTS_PER_KG;
+}
+
+double perIteration(uint64_t startNs, uint32_t iterations) {
+  return static_cast<double>(benchNanos() - startNs) / iterations;
+}
+
+// On raw counts, as phase 1 filters them
+void benchWeightFilter(BenchSuite& suite, uint32_t samples) {
+  WeightFilter filter(FILTER_SAMPLES);
+  const int32_t load = static_cast<int32_t>(20.0f * -COUNTS_PER_KG);
+  uint32_t seed = 1;
+  int64_t total = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    filter.add(load + noiseCounts(seed));
+    total += filter.mean() + filter.maxDeviation();
+  }
+  suite.add("weight_filter", "ns/sample", perIteration(start, samples));
+  sink = total;
+}
+
+// A notch and an EMA on the fixed-point total, the fullest chain a
+// pallet variant builds
+void benchFilterChain(BenchSuite& suite, uint32_t samples) {
+  FilterChain<Notch<80, 12>, Ema<2>> chain;
+  uint32_t seed = 5;
+  int64_t total = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    total += chain.add(2000000 + noiseCounts(seed) * 14);
+  }
+  suite.add("filter_chain", "ns/sample", perIteration(start, samples));
+  sink = total;
+}
+
+// One cell's raw counts with a bit slip every 500 samples, so the
+// rejection path is part of the run
+void benchGlitchFilter(BenchSuite& suite, uint32_t samples) {
+  Hampel<GLITCH_WINDOW, GLITCH_MIN_COUNTS> filter;
+  const int32_t load = static_cast<int32_t>(10.0f * -COUNTS_PER_KG);
+  uint32_t seed = 6;
+  int64_t total = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    int32_t counts = load + noiseCounts(seed);
+    if (i % 500 == 250) counts ^= 1 << 18;
+    total += filter.add(counts);
+  }
+  suite.add("glitch_filter", "ns/sample", perIteration(start, samples));
+  sink = total + filter.rejected();
+}
+
+void benchPlateau(BenchSuite& suite, uint32_t samples) {
+  PlateauDetector plateau(PLATEAU_DRIFT, PLATEAU_THRESHOLD, PLATEAU_MIN_SAMPLES);
+  uint32_t seed = 2;
+  uint32_t settled = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    // A crate lands every 1000 samples, so change points are part of the run
+    float kg = 20.0f + (i / 1000 % 2) * 10.24f + noiseKg(seed);
+    if (plateau.add(kg, i * SAMPLE_PERIOD_MS) && plateau.isSettled()) settled++;
+  }
+  suite.add("plateau", "ns/sample", perIteration(start, samples));
+  sink = settled + plateau.variance();
+}
+
+// The plateau's stream, also timing each crate from landing to a
+// settled estimate
+void benchWeightEstimator(BenchSuite& suite, uint32_t samples) {
+  WeightEstimator estimator(ESTIMATE_NOISE, ESTIMATE_SETTLE, SETTLE_QUIET_MS);
+  uint32_t seed = 2;
+  uint32_t landedMs = 0, settleMs = 0, crates = 0;
+  bool landed = false;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    uint32_t atMs = i * SAMPLE_PERIOD_MS;
+    if (i % 1000 == 0) {
+      landedMs = atMs;
+      landed = true;
+    }
+    float kg = 20.0f + (i / 1000 % 2) * 10.24f + noiseKg(seed);
+    estimator.add(kg, atMs);
+    if (landed && estimator.isSettled()) {
+      settleMs += atMs - landedMs;
+      crates++;
+      landed = false;
+    }
+  }
+  suite.add("weight_estimator", "ns/sample", perIteration(start, samples));
+  if (crates > 0) suite.add("estimator_settle", "ms", static_cast<double>(settleMs) / crates);
+  sink = estimator.weight() + settleMs;
+}
+
+void benchCellFusion(BenchSuite& suite, uint32_t samples) {
+  const uint8_t cells = 2;
+  CellCalibration calibration[cells];
+  calibration[0].setLinear(84200, COUNTS_PER_KG);
+  calibration[1].setLinear(-12650, COUNTS_PER_KG);
+  float corners[cells] = {1.0f, 1.0f};
+  CellFusion fusion(cells, PLATEAU_DRIFT * -COUNTS_PER_KG, PLATEAU_THRESHOLD * -COUNTS_PER_KG, PLATEAU_MIN_SAMPLES);
+
+  uint32_t seed = 3;
+  int32_t counts[cells];
+  float total = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    counts[0] = 84200 + static_cast<int32_t>(11.0f * COUNTS_PER_KG) + noiseCounts(seed);
+    counts[1] = -12650 + static_cast<int32_t>(9.0f * COUNTS_PER_KG) + noiseCounts(seed);
+    total += fusion.add(counts, 0x03, calibration, corners, 40.0f, i * SAMPLE_PERIOD_MS);
+  }
+  suite.add("cell_fusion", "ns/sample", perIteration(start, samples));
+  sink = total;
+}
+
+void benchBottleCount(BenchSuite& suite, uint32_t samples) {
+  const ProductSku& sku = STANDARD_SKUS[0];
+  uint32_t seed = 4;
+  int32_t bottles = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < samples; i++) {
+    // Up to ten crates, the count moving every sample
+    int32_t n = (i % 240) + 1;
+    bottles += BottleCounter::estimate(sku, BottleCounter::modelKg(sku, n) + noiseKg(seed), 0.005f).bottles;
+  }
+  suite.add("bottle_count", "ns/call", perIteration(start, samples));
+  sink = bottles;
+}
+
+// A full batch: every progress slot and transaction slot taken
+void benchUplinkEncode(BenchSuite& suite) {
+  static UplinkBatcher batcher("https://bench.invalid/api/palletBatch", "bench", "PALETTE_001");
+  for (size_t i = 0; i < UplinkBatcher::MAX_PROGRESS; i++) {
+    ProgressSample sample = {static_cast<uint32_t>(5000 * i), 2, "TRUCK_A", 10.24f * i, static_cast<int32_t>(24 * i)};
+    batcher.addProgress(sample);
+  }
+  for (size_t i = 0; i < UplinkBatcher::MAX_TRANSACTIONS; i++) {
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.sequence = i + 1;
+    record.type = i % 2 ? JOURNAL_UNLOAD : JOURNAL_LOAD;
+    strcpy(record.truckId, "TRUCK_A");
+    record.bottleCount = 240;
+    record.weight = 102.4f;
+    record.weightChange = 102.4f;
+    record.timestamp = 60000 * i;
+    record.weightVariance = 4.6e-5f;
+    record.settleTime = 320;
+    record.settled = 1;
+    record.countConfidence = 98;
+    batcher.addTransaction(record);
+  }
+
+  size_t length = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < UPLINK_BATCHES; i++) {
+    length = batcher.encode(0x1234ABCD);
+  }
+  suite.add("uplink_encode", UPLINK_MSGPACK ? "ns/msgpack" : "ns/json", perIteration(start, UPLINK_BATCHES));
+  suite.add("uplink_body", "bytes", length);
+}
+
+// The weight task's screen: a new weight every frame, the rest unchanged
+void benchDisplay(BenchSuite& suite) {
+  static Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+  static OledPanel panel(display);
+  if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) return;
+  display.clearDisplay();
+  int8_t weightField = panel.addField(0, 16, OledPanel::MAX_FIELD_CHARS);
+  int8_t bottlesField = panel.addField(0, 24, OledPanel::MAX_FIELD_CHARS);
+  int8_t stateField = panel.addField(0, 32, OledPanel::MAX_FIELD_CHARS);
+  panel.begin(SCREEN_ADDRESS);
+  panel.setText(stateField, "State: LOADING");
+  panel.flush();
+
+  size_t bytes = 0;
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < DISPLAY_FRAMES; i++) {
+    panel.printf(weightField, "Weight: %.2f kg", 20.0f + 0.01f * i);
+    panel.printf(bottlesField, "Bottles: ~%d", static_cast<int>(i / 10));
+    bytes += panel.flush();
+  }
+  suite.add("display_refresh", "ns/frame", perIteration(start, DISPLAY_FRAMES));
+  suite.add("display_i2c", "bytes/frame", static_cast<double>(bytes) / DISPLAY_FRAMES);
+}
+
+}  // namespace
+
+void runStageBenchmarks(BenchSuite& suite, uint32_t samples) {
+  benchWeightFilter(suite, samples);
+  benchFilterChain(suite, samples);
+  benchGlitchFilter(suite, samples);
+  benchPlateau(suite, samples);
+  benchWeightEstimator(suite, samples);
+  benchCellFusion(suite, samples);
+  benchBottleCount(suite, samples);
+  benchUplinkEncode(suite);
+  benchDisplay(suite);
+}
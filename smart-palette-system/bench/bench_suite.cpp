@@ -0,0 +1,75 @@
+/*
+  Smart Inventory Palette - Benchmark suite
+
+  File: bench_suite.cpp
+*/
+
+#include "bench_suite.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef ESP_PLATFORM
+#include <chrono>
+#endif
+
+uint64_t benchNanos() {
+#ifdef ESP_PLATFORM
+  return static_cast<uint64_t>(esp_timer_get_time()) * 1000;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void BenchSuite::add(const char* name, const char* unit, double value) {
+  if (count_ >= MAX_RESULTS) return;
+  results_[count_++] = {name, unit, value, NAN};
+}
+
+bool BenchSuite::setLimit(const char* name, double limit) {
+  for (size_t i = 0; i < count_; i++) {
+    if (strcmp(results_[i].name, name) == 0) {
+      results_[i].limit = limit;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BenchSuite::passed(const BenchResult& result) const {
+  return isnan(result.limit) || result.value <= result.limit;
+}
+
+bool BenchSuite::passed() const {
+  for (size_t i = 0; i < count_; i++) {
+    if (!passed(results_[i])) return false;
+  }
+  return true;
+}
+
+void BenchSuite::printTable(Print& out) const {
+  out.printf("%-24s %14s %12s %-10s\n", "Benchmark", "Value", "Limit", "Unit");
+  for (size_t i = 0; i < count_; i++) {
+    const BenchResult& r = results_[i];
+    if (isnan(r.limit)) {
+      out.printf("%-24s %14.1f %12s %-10s\n", r.name, r.value, "-", r.unit);
+    } else {
+      out.printf("%-24s %14.1f %12.1f %-10s%s\n", r.name, r.value, r.limit, r.unit, passed(r) ? "" : " REGRESSION");
+    }
+  }
+}
+
+void BenchSuite::printJson(Print& out, const char* platform) const {
+  out.printf("{\"platform\":\"%s\",\"passed\":%s,\"results\":[", platform, passed() ? "true" : "false");
+  for (size_t i = 0; i < count_; i++) {
+    const BenchResult& r = results_[i];
+    out.printf("%s\n  {\"name\":\"%s\",\"unit\":\"%s\",\"value\":%.3f,", i ? "," : "", r.name, r.unit, r.value);
+    if (isnan(r.limit)) {
+      out.print("\"limit\":null,");
+    } else {
+      out.printf("\"limit\":%.3f,", r.limit);
+    }
+    out.printf("\"passed\":%s}", passed(r) ? "true" : "false");
+  }
+  out.println("\n]}");
+}
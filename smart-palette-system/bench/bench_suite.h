@@ -0,0 +1,54 @@
+/*
+  Smart Inventory Palette - Benchmark suite
+
+  Collects named measurements, compares them with regression limits and
+  writes them out as JSON. Builds for the board and for the native
+  harness alike; timing comes from the host clock in the simulator, where
+  micros() only moves on the virtual clock.
+
+  File: bench_suite.h
+*/
+
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include <Arduino.h>
+
+struct BenchResult {
+  const char* name;
+  const char* unit;
+  double value;
+  double limit;           // NAN: no limit set
+};
+
+class BenchSuite {
+public:
+  static const size_t MAX_RESULTS = 24;
+
+  void add(const char* name, const char* unit, double value);
+
+  // Limits match results by name; returns false for a name not measured
+  bool setLimit(const char* name, double limit);
+
+  size_t count() const { return count_; }
+  const BenchResult& result(size_t index) const { return results_[index]; }
+  bool passed(const BenchResult& result) const;
+  bool passed() const;
+
+  void printTable(Print& out) const;
+  // {"platform": ..., "passed": ..., "results": [{"name", "unit", "value", "limit", "passed"}]}
+  void printJson(Print& out, const char* platform) const;
+
+private:
+  BenchResult results_[MAX_RESULTS];
+  size_t count_ = 0;
+};
+
+// Nanoseconds on a free-running clock, only for differences
+uint64_t benchNanos();
+
+// The sample pipeline, bottle count, uplink encoding and display refresh,
+// each over `samples` iterations
+void runStageBenchmarks(BenchSuite& suite, uint32_t samples);
+
+#endif
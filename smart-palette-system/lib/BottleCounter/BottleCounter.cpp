@@ -0,0 +1,103 @@
+/*
+  BottleCounter - bottle count from a settled weight, with a confidence
+
+  File: BottleCounter.cpp
+*/
+
+#include "BottleCounter.h"
+#include <ctype.h>
+#include <math.h>
+
+const ProductSku STANDARD_SKUS[] = {
+  // size      bottle  spread  case   per case
+  {"175 mL",   0.36f,  0.008f, 1.60f, 24},   // Returnable glass in crates
+  {"250 mL",   0.45f,  0.010f, 1.40f, 16},
+  {"300 mL",   0.55f,  0.010f, 1.80f, 24},
+  {"355 mL",   0.38f,  0.004f, 0.10f, 24},   // Cans on a tray
+  {"400 mL",   0.43f,  0.005f, 0.08f, 24},   // PET, shrink-wrapped
+  {"500 mL",   0.52f,  0.005f, 0.08f, 24},
+  {"750 mL",   1.20f,  0.015f, 1.50f, 9},
+  {"1 L",      1.03f,  0.008f, 0.08f, 15},
+  {"1050 mL",  1.09f,  0.008f, 0.08f, 12},
+  {"1.5 L",    1.55f,  0.010f, 0.10f, 12},
+  {"2 L",      2.07f,  0.012f, 0.10f, 9},
+};
+const uint8_t STANDARD_SKU_COUNT = sizeof(STANDARD_SKUS) / sizeof(STANDARD_SKUS[0]);
+
+float BottleCounter::modelKg(const ProductSku& sku, int32_t bottles) {
+  int32_t cases = (bottles + sku.bottlesPerCase - 1) / sku.bottlesPerCase;
+  return bottles * sku.bottleKg + cases * sku.caseKg;
+}
+
+BottleCount BottleCounter::estimate(const ProductSku& sku, float massKg, float noiseSdKg) {
+  BottleCount result = {0, 0, 1, massKg, false};
+  if (sku.bottleKg <= 0 || sku.bottlesPerCase == 0) return result;
+  if (massKg < 0) massKg = 0;
+
+  float noise = noiseSdKg > MIN_NOISE_KG ? noiseSdKg : MIN_NOISE_KG;
+  float noiseVar = noise * noise;
+  float bottleVar = sku.bottleSdKg * sku.bottleSdKg;
+
+  // Centre on the count whose weight is closest: start from a full-case
+  // average bottle and walk, since an opened case weighs a whole crate
+  // more than its bottles. Then score as many counts either side as the
+  // spread there can reach.
+  float perBottle = sku.bottleKg + sku.caseKg / sku.bottlesPerCase;
+  int32_t centre = static_cast<int32_t>(massKg / perBottle);
+  while (centre > 0 && modelKg(sku, centre) > massKg) centre--;
+  while (modelKg(sku, centre + 1) <= massKg) centre++;
+  if (modelKg(sku, centre + 1) - massKg < massKg - modelKg(sku, centre)) centre++;
+  float tolerance = SCALE_TOLERANCE * massKg;
+  float spread = sqrtf(noiseVar + centre * bottleVar + tolerance * tolerance);
+  int32_t reach = static_cast<int32_t>(ceilf(4 * spread / sku.bottleKg)) + 1;
+  if (reach > MAX_CANDIDATES / 2) reach = MAX_CANDIDATES / 2;
+  int32_t first = centre - reach > 0 ? centre - reach : 0;
+  int32_t last = centre + reach;
+
+  // Log-likelihoods first, so the normalisation can start from the best
+  float logLikelihood[MAX_CANDIDATES + 1];
+  float looseOdds = logf(LOOSE_BOTTLE_ODDS);
+  int32_t best = first;
+  for (int32_t n = first; n <= last; n++) {
+    float expected = modelKg(sku, n);
+    float scale = SCALE_TOLERANCE * expected;
+    float variance = noiseVar + n * bottleVar + scale * scale;
+    float residual = massKg - expected;
+    float l = -0.5f * residual * residual / variance - 0.5f * logf(variance);
+    if (n % sku.bottlesPerCase != 0) l += looseOdds;
+    logLikelihood[n - first] = l;
+    if (l > logLikelihood[best - first]) best = n;
+  }
+
+  float total = 0;
+  for (int32_t n = first; n <= last; n++) {
+    total += expf(logLikelihood[n - first] - logLikelihood[best - first]);
+  }
+
+  result.bottles = best;
+  result.cases = (best + sku.bottlesPerCase - 1) / sku.bottlesPerCase;
+  result.confidence = 1 / total;
+  result.residualKg = massKg - modelKg(sku, best);
+  // A weight no count explains is another product, or something else
+  // left on the pallet, however sure the pick among the counts is
+  float scale = SCALE_TOLERANCE * modelKg(sku, best);
+  float bestSd = sqrtf(noiseVar + best * bottleVar + scale * scale);
+  result.ambiguous = result.confidence < ACCEPT_CONFIDENCE || fabsf(result.residualKg) > MAX_RESIDUAL_SD * bestSd;
+  return result;
+}
+
+int BottleCounter::find(const ProductSku* skus, uint8_t count, const char* size) {
+  for (uint8_t i = 0; i < count; i++) {
+    const char* a = skus[i].size;
+    const char* b = size;
+    while (true) {
+      while (*a == ' ') a++;
+      while (*b == ' ') b++;
+      if (!*a || !*b || tolower(*a) != tolower(*b)) break;
+      a++;
+      b++;
+    }
+    if (!*a && !*b) return i;
+  }
+  return -1;
+}
@@ -0,0 +1,81 @@
+/*
+  BottleCounter - bottle count from a settled weight, with a confidence
+
+  Bottles travel in cases (crates for returnable glass, shrink-wrapped
+  trays for PET), so n bottles of one product weigh
+
+    m(n) = n * bottle + ceil(n / bottlesPerCase) * case
+
+  on top of the tared pallet. Dividing the weight by a bottle weight and
+  truncating ignores the cases and turns 23.99 kg into one bottle short.
+
+  Instead every count near the measurement is scored against it. The
+  spread allowed around m(n) grows with the count: the measurement noise
+  (the plateau's standard deviation), the bottle-to-bottle spread of the
+  product (glass, fill level) over n bottles, and the calibration's
+  relative error:
+
+    sd(n)^2 = noise^2 + n * bottleSd^2 + (SCALE_TOLERANCE * m(n))^2
+
+  Full cases are far more common than loose bottles, so a count that
+  leaves a case partly filled starts LOOSE_BOTTLE_ODDS times less likely.
+  The most likely count is returned with its probability among all the
+  counts scored. Below ACCEPT_CONFIDENCE, or if even that count misses
+  the weight by more than MAX_RESIDUAL_SD (another product on the pallet,
+  something left on it), it is flagged as ambiguous and should be
+  checked by hand.
+
+  File: BottleCounter.h
+*/
+
+#ifndef BOTTLE_COUNTER_H
+#define BOTTLE_COUNTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One product size. The server's products differ by size, not brand, as
+// far as the scale can tell.
+struct ProductSku {
+  const char* size;          // As in the server's product table, e.g. "300 mL"
+  float bottleKg;            // One full bottle
+  float bottleSdKg;          // Spread between bottles
+  float caseKg;              // Empty crate or tray
+  uint8_t bottlesPerCase;    // bottles_per_case on the server
+};
+
+struct BottleCount {
+  int32_t bottles;
+  int32_t cases;             // Cases the count fills, the last one perhaps partly
+  float confidence;          // Probability of `bottles`, 0..1
+  float residualKg;          // Measured minus m(bottles)
+  bool ambiguous;            // Not to be accepted without a check
+};
+
+// Nominal weights for the server's product sizes; weigh a full and an
+// empty case of your own stock to refine them
+extern const ProductSku STANDARD_SKUS[];
+extern const uint8_t STANDARD_SKU_COUNT;
+
+class BottleCounter {
+public:
+  static constexpr float ACCEPT_CONFIDENCE = 0.95f;
+  static constexpr float SCALE_TOLERANCE = 0.002f;   // Calibration error, relative
+  static constexpr float MIN_NOISE_KG = 0.002f;      // Floor for a quiet or unknown noise
+  static constexpr float LOOSE_BOTTLE_ODDS = 0.05f;
+  static constexpr float MAX_RESIDUAL_SD = 3.0f;     // Beyond this the weight is not explained
+  static const int32_t MAX_CANDIDATES = 64;
+
+  // Most likely count of `sku` bottles in `massKg` (net of the pallet),
+  // measured with standard deviation `noiseSdKg`
+  static BottleCount estimate(const ProductSku& sku, float massKg, float noiseSdKg);
+
+  // Expected weight of `bottles`, cases included
+  static float modelKg(const ProductSku& sku, int32_t bottles);
+
+  // Index of the product whose size matches `size` (case-insensitive,
+  // spaces ignored), or -1
+  static int find(const ProductSku* skus, uint8_t count, const char* size);
+};
+
+#endif
@@ -0,0 +1,189 @@
+/*
+  CellFusion - per-cell weight fusion with fault detection
+
+  File: CellFusion.cpp
+*/
+
+#include "CellFusion.h"
+#include <math.h>
+
+// The HX711 clamps its output to the 24-bit range
+static const int32_t FULL_SCALE_HIGH = 0x7FFFFF;
+static const int32_t FULL_SCALE_LOW = -0x800000;
+
+CellFusion::CellFusion(uint8_t cellCount, float driftCounts, float thresholdCounts, uint32_t minSamples)
+    : cellCount_(cellCount < MAX_CELLS ? cellCount : MAX_CELLS) {
+  setPlateau(driftCounts, thresholdCounts, minSamples);
+}
+
+void CellFusion::setPlateau(float driftCounts, float thresholdCounts, uint32_t minSamples) {
+  for (uint8_t i = 0; i < cellCount_; i++) {
+    cells_[i].plateau = PlateauDetector(driftCounts, thresholdCounts, minSamples);
+  }
+}
+
+void CellFusion::resume(uint32_t atMs) {
+  for (uint8_t i = 0; i < cellCount_; i++) cells_[i].lastSettledMs = atMs;
+}
+
+float CellFusion::add(const int32_t* counts, uint8_t present, const CellCalibration* cells,
+                      const float* cornerFactors, float tempC, uint32_t atMs) {
+  for (uint8_t i = 0; i < cellCount_; i++) {
+    Cell& cell = cells_[i];
+    if (!(present & (1u << i))) {
+      cell.faults |= CELL_SILENT;
+      continue;
+    }
+    cell.faults &= ~CELL_SILENT;
+    checkRaw(cell, counts[i]);
+
+    // A cell seen for the first time has been "at rest" since now
+    if (cell.plateau.count() == 0) cell.lastSettledMs = atMs;
+    cell.plateau.add(counts[i], atMs);
+    if (cell.plateau.isSettled()) cell.lastSettledMs = atMs;
+
+    float factor = cornerFactors ? cornerFactors[i] : 1.0f;
+    cell.kg = cells[i].toKg(counts[i], tempC) * factor;
+  }
+
+  // Divergence compares cells, so every plateau must be up to date first
+  float healthy = 0;
+  float missingShare = 0;
+  faultyCells_ = 0;
+  for (uint8_t i = 0; i < cellCount_; i++) {
+    checkDivergence(i, atMs);
+    if (cells_[i].faults) {
+      faultyCells_ |= 1u << i;
+      missingShare += cells_[i].share;
+    } else {
+      healthy += cells_[i].kg;
+    }
+  }
+
+  total_ = healthy;
+  if (faultyCells_ == 0) {
+    learnShares();
+  } else if (missingShare > 0 && missingShare < MAX_ESTIMATED_SHARE) {
+    total_ = healthy / (1 - missingShare);
+  }
+  return total_;
+}
+
+void CellFusion::checkRaw(Cell& cell, int32_t counts) {
+  if (counts == cell.lastCounts) {
+    if (cell.repeats < STUCK_SAMPLES) cell.repeats++;
+  } else {
+    cell.repeats = 0;
+  }
+  cell.lastCounts = counts;
+  if (cell.repeats >= STUCK_SAMPLES) {
+    cell.faults |= CELL_STUCK;
+  } else {
+    cell.faults &= ~CELL_STUCK;
+  }
+
+  if (counts >= FULL_SCALE_HIGH || counts <= FULL_SCALE_LOW) {
+    cell.faults |= CELL_SATURATED;
+    cell.inRange = 0;
+  } else if (cell.inRange < RECOVERY_SAMPLES && ++cell.inRange == RECOVERY_SAMPLES) {
+    cell.faults &= ~CELL_SATURATED;
+  }
+}
+
+void CellFusion::checkDivergence(uint8_t index, uint32_t atMs) {
+  Cell& cell = cells_[index];
+  if (cell.faults & CELL_SILENT) return;
+
+  // At rest, only a load the cell cannot carry is wrong
+  if (cell.plateau.isSettled()) {
+    if (cell.kg < -NEGATIVE_KG) {
+      cell.faults |= CELL_DIVERGING;
+    } else {
+      cell.faults &= ~CELL_DIVERGING;
+    }
+    return;
+  }
+  if (atMs - cell.lastSettledMs < DIVERGE_MS) return;
+
+  // Moving for a while. A load being handled moves every cell under it,
+  // so only a cell that keeps moving on its own is diverging.
+  uint8_t stillCells = 0;
+  for (uint8_t i = 0; i < cellCount_; i++) {
+    const Cell& other = cells_[i];
+    if (i == index || other.faults) continue;
+    if (!other.plateau.isSettled() || atMs - other.plateau.settledAt() < DIVERGE_MS) return;
+    stillCells++;
+  }
+  if (stillCells > 0) cell.faults |= CELL_DIVERGING;
+}
+
+// Shares are only learned from a healthy load at rest on every cell
+void CellFusion::learnShares() {
+  if (!allSettled()) return;
+  float sum = 0;
+  for (uint8_t i = 0; i < cellCount_; i++) sum += cells_[i].kg;
+  if (sum < SHARE_MIN_KG) return;
+  for (uint8_t i = 0; i < cellCount_; i++) cells_[i].share = cells_[i].kg / sum;
+}
+
+int32_t CellFusion::rawMean(uint8_t cell) const {
+  return static_cast<int32_t>(lroundf(cells_[cell].plateau.mean()));
+}
+
+bool CellFusion::allSettled() const {
+  for (uint8_t i = 0; i < cellCount_; i++) {
+    if (!cells_[i].plateau.isSettled()) return false;
+  }
+  return true;
+}
+
+const char* CellFusion::faultName(uint8_t faults) {
+  if (faults & CELL_SILENT) return "silent";
+  if (faults & CELL_SATURATED) return "saturated";
+  if (faults & CELL_STUCK) return "stuck";
+  if (faults & CELL_DIVERGING) return "diverging";
+  return "ok";
+}
+
+bool CellFusion::solveCornerFactors(const float* readings, const float* knownKg, uint8_t n, float* factors) {
+  if (n == 0 || n > MAX_CELLS) return false;
+
+  // Gaussian elimination with partial pivoting on [readings | knownKg]
+  float m[MAX_CELLS][MAX_CELLS + 1];
+  for (uint8_t p = 0; p < n; p++) {
+    for (uint8_t i = 0; i < n; i++) m[p][i] = readings[p * n + i];
+    m[p][n] = knownKg[p];
+  }
+
+  for (uint8_t col = 0; col < n; col++) {
+    uint8_t pivot = col;
+    for (uint8_t row = col + 1; row < n; row++) {
+      if (fabsf(m[row][col]) > fabsf(m[pivot][col])) pivot = row;
+    }
+    // A placement that loads no cell more than another leaves a column
+    // without a usable pivot
+    if (fabsf(m[pivot][col]) < 1e-3f) return false;
+    if (pivot != col) {
+      for (uint8_t i = 0; i <= n; i++) {
+        float t = m[col][i];
+        m[col][i] = m[pivot][i];
+        m[pivot][i] = t;
+      }
+    }
+    for (uint8_t row = col + 1; row < n; row++) {
+      float f = m[row][col] / m[col][col];
+      for (uint8_t i = col; i <= n; i++) m[row][i] -= f * m[col][i];
+    }
+  }
+
+  float solved[MAX_CELLS];
+  for (int8_t row = n - 1; row >= 0; row--) {
+    float sum = m[row][n];
+    for (uint8_t i = row + 1; i < n; i++) sum -= m[row][i] * solved[i];
+    solved[row] = sum / m[row][row];
+    if (!(solved[row] >= 0.5f && solved[row] <= 2.0f)) return false;
+  }
+
+  for (uint8_t i = 0; i < n; i++) factors[i] = solved[i];
+  return true;
+}
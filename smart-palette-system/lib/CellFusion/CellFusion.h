@@ -0,0 +1,122 @@
+/*
+  CellFusion - per-cell weight fusion with fault detection
+
+  Combines one sample set from every load cell of a pallet (2 to
+  MAX_CELLS, one HX711 each) into a total. Each cell's raw counts go
+  through its own calibration curve and a corner factor: the frame
+  shares a load between the cells differently depending on where it
+  stands, and the factors - solved from a known weight placed over each
+  corner in turn - make the total the same wherever it is put:
+
+    total = sum(factor[i] * kg[i])
+
+  Every cell's raw stream is also watched on its own, and a cell is
+  marked faulty when it is
+
+    silent     no conversion arrived (disconnected, powered down)
+    stuck      STUCK_SAMPLES identical counts in a row; a live 24-bit
+               converter always shows a few counts of noise
+    saturated  at the converter's full scale (overload, open bridge)
+    diverging  still moving DIVERGE_MS after every other cell came to
+               rest (creep, a loose wire), or at rest on a load below
+               -NEGATIVE_KG, which a cell under a pallet cannot carry
+
+  A faulty cell drops out of the total. While every cell was healthy
+  and loaded, each one's share of the total was learned; the healthy
+  cells' sum is scaled up by the shares of the missing ones, so the
+  load already on the pallet keeps reading right without a re-weigh.
+  The estimate only holds while the load stays where it was, so
+  callers should flag totals taken with faultyCells() != 0.
+
+  Each cell also keeps a plateau of its raw counts, which is what a
+  calibration point is captured from.
+
+  File: CellFusion.h
+*/
+
+#ifndef CELL_FUSION_H
+#define CELL_FUSION_H
+
+#include <stdint.h>
+#include <PlateauDetector.h>
+#include <LoadCellCalibration.h>
+
+enum CellFault : uint8_t {
+  CELL_SILENT = 0x01,
+  CELL_STUCK = 0x02,
+  CELL_SATURATED = 0x04,
+  CELL_DIVERGING = 0x08
+};
+
+class CellFusion {
+public:
+  static const uint8_t MAX_CELLS = 4;
+  static const uint16_t STUCK_SAMPLES = 40;      // 0.5 s at 80 SPS
+  static const uint16_t RECOVERY_SAMPLES = 40;   // In range again before a saturation clears
+  static const uint32_t DIVERGE_MS = 5000;
+  static constexpr float NEGATIVE_KG = 0.5f;
+  static constexpr float SHARE_MIN_KG = 2.0f;    // Lighter loads do not teach shares
+  static constexpr float MAX_ESTIMATED_SHARE = 0.75f;  // Beyond this, report the healthy sum
+
+  // The plateau parameters are in raw counts (see PlateauDetector)
+  CellFusion(uint8_t cellCount, float driftCounts, float thresholdCounts, uint32_t minSamples);
+  // New plateau parameters; every cell's plateau starts over, faults and
+  // learned shares are kept
+  void setPlateau(float driftCounts, float thresholdCounts, uint32_t minSamples);
+  // Sampling paused with every cell at rest: they count as settled until
+  // atMs, so a load arriving afterwards is not mistaken for divergence
+  void resume(uint32_t atMs);
+
+  // Fuse one sample set. Bit i of `present` marks counts[i] as valid; a
+  // cell left out is silent. `cornerFactors` may be null (all 1).
+  // Returns the total in kg, unclamped.
+  float add(const int32_t* counts, uint8_t present, const CellCalibration* cells,
+            const float* cornerFactors, float tempC, uint32_t atMs);
+
+  uint8_t cellCount() const { return cellCount_; }
+  float total() const { return total_; }
+
+  // Corrected weight on a cell at its last sample
+  float cellKg(uint8_t cell) const { return cells_[cell].kg; }
+  // Learned share of the total; 0 until a healthy load has been seen
+  float share(uint8_t cell) const { return cells_[cell].share; }
+  uint8_t faults(uint8_t cell) const { return cells_[cell].faults; }
+  // Bit per faulty cell
+  uint8_t faultyCells() const { return faultyCells_; }
+
+  int32_t rawMean(uint8_t cell) const;
+  bool isSettled(uint8_t cell) const { return cells_[cell].plateau.isSettled(); }
+  bool allSettled() const;
+
+  // Name of the most serious fault in `faults`, "ok" if none
+  static const char* faultName(uint8_t faults);
+
+  // Corner factors from n known-weight placements, one over each corner:
+  // readings[p * n + i] is cell i's weight (without corner factors) with
+  // knownKg[p] over corner p. Fails on a singular set or a factor outside
+  // 0.5..2, which means a placement was repeated or the weight moved.
+  static bool solveCornerFactors(const float* readings, const float* knownKg, uint8_t n, float* factors);
+
+private:
+  struct Cell {
+    PlateauDetector plateau;
+    int32_t lastCounts = 0;
+    uint16_t repeats = 0;
+    uint16_t inRange = 0;
+    uint32_t lastSettledMs = 0;
+    float kg = 0;
+    float share = 0;
+    uint8_t faults = 0;
+  };
+
+  void checkRaw(Cell& cell, int32_t counts);
+  void checkDivergence(uint8_t index, uint32_t atMs);
+  void learnShares();
+
+  uint8_t cellCount_;
+  Cell cells_[MAX_CELLS];
+  uint8_t faultyCells_ = 0;
+  float total_ = 0;
+};
+
+#endif
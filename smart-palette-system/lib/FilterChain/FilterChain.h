@@ -0,0 +1,282 @@
+/*
+  FilterChain - compile-time composed sample filters
+
+  A chain is a type: FilterChain<Notch<80, 12>, Ema<3>> runs every
+  sample through the notch, then the EMA. Each stage is a plain class
+  with add(), reset() and prime(), and the chain calls them directly,
+  so the whole pipeline inlines into one kernel with no virtual calls
+  and no allocation. A pallet variant picks its stages and constants
+  with build flags and gets a kernel specialised for them.
+
+  Samples are int32_t: raw HX711 counts or a fixed-point weight (see
+  WeightFilter). Coefficients are worked out by the compiler in double
+  and rounded once to Q28. The filters themselves use only integer
+  arithmetic with 64-bit accumulators, so for the same input samples the
+  host build and the ESP32 give the same bits.
+
+  The first sample after a reset primes every stage as if the input had
+  always been at that value, so a chain starts without a transient.
+
+  File: FilterChain.h
+*/
+
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace filter_chain {
+
+const int COEFF_BITS = 28;
+const int64_t COEFF_ONE = int64_t(1) << COEFF_BITS;
+
+constexpr double PI = 3.14159265358979323846;
+
+// Taylor series, enough terms for |x| <= pi; std::sin/cos are not
+// constexpr in C++17
+constexpr double sinTaylor(double x) {
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 20; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double cosTaylor(double x) {
+  double term = 1;
+  double sum = 1;
+  for (int n = 1; n < 20; n++) {
+    term *= -x * x / ((2 * n - 1) * (2 * n));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr int32_t toCoeff(double value) {
+  return static_cast<int32_t>(value * COEFF_ONE + (value >= 0 ? 0.5 : -0.5));
+}
+
+// Q28 product sum back to a sample, rounded half up
+inline int32_t fromAccumulator(int64_t acc) {
+  return static_cast<int32_t>((acc + (COEFF_ONE >> 1)) >> COEFF_BITS);
+}
+
+// Insertion sort; the windows here are a handful of samples, so this
+// beats anything cleverer and its worst case is fixed at compile time
+template <size_t N>
+inline void sortSmall(int32_t* values) {
+  for (size_t i = 1; i < N; i++) {
+    int32_t value = values[i];
+    size_t j = i;
+    for (; j > 0 && values[j - 1] > value; j--) values[j] = values[j - 1];
+    values[j] = value;
+  }
+}
+
+}  // namespace filter_chain
+
+// ============================================================================
+// STAGES
+// ============================================================================
+
+// Second-order notch (RBJ biquad) removing a ripple at NotchHz from a
+// stream sampled at SampleHz, with quality QTenths / 10; a lower Q
+// removes a wider band and rings for less time after a step. DC gain is
+// exactly 1 in the rounded coefficients too, so a static load reads the
+// same with or without the notch. NotchHz 0 makes the stage a pass-through.
+template <uint32_t SampleHz, uint32_t NotchHz, uint32_t QTenths = 10>
+class Notch {
+  static_assert(NotchHz == 0 || 2 * NotchHz < SampleHz, "Notch frequency must be below Nyquist");
+  static_assert(QTenths > 0, "Notch Q must be positive");
+
+  static constexpr double W0 = 2 * filter_chain::PI * NotchHz / SampleHz;
+  static constexpr double ALPHA = filter_chain::sinTaylor(W0) / (2 * QTenths / 10.0);
+
+public:
+  // Normalised by a0; a2 follows from b0 so that b0 + b1 + b2 == 1 + a1 + a2
+  static constexpr int32_t B0 = filter_chain::toCoeff(1 / (1 + ALPHA));
+  static constexpr int32_t B1 = filter_chain::toCoeff(-2 * filter_chain::cosTaylor(W0) / (1 + ALPHA));
+  static constexpr int32_t A2 = static_cast<int32_t>(2 * int64_t(B0) - filter_chain::COEFF_ONE);
+
+  int32_t add(int32_t x) {
+    if (NotchHz == 0) return x;
+    if (!primed_) prime(x);
+    // b2 == b0 and a1 == b1 for a notch
+    int64_t acc = int64_t(B0) * (int64_t(x) + x2_) + int64_t(B1) * (int64_t(x1_) - y1_) - int64_t(A2) * y2_;
+    int32_t y = filter_chain::fromAccumulator(acc);
+    x2_ = x1_;
+    x1_ = x;
+    y2_ = y1_;
+    y1_ = y;
+    return y;
+  }
+
+  void prime(int32_t x) {
+    x1_ = x2_ = y1_ = y2_ = x;
+    primed_ = true;
+  }
+
+  void reset() { primed_ = false; }
+
+private:
+  int32_t x1_ = 0, x2_ = 0, y1_ = 0, y2_ = 0;
+  bool primed_ = false;
+};
+
+// Exponential moving average with alpha = 1 / 2^Shift, kept with 8
+// fraction bits so small steps are not lost to truncation
+template <uint8_t Shift>
+class Ema {
+  static_assert(Shift < 16, "EMA shift out of range");
+
+public:
+  int32_t add(int32_t x) {
+    if (!primed_) prime(x);
+    state_ += ((int64_t(x) << 8) - state_) >> Shift;
+    return static_cast<int32_t>((state_ + 128) >> 8);
+  }
+
+  void prime(int32_t x) {
+    state_ = int64_t(x) << 8;
+    primed_ = true;
+  }
+
+  void reset() { primed_ = false; }
+
+private:
+  int64_t state_ = 0;
+  bool primed_ = false;
+};
+
+// Hampel filter: a sample further from the median of the last Window
+// samples (itself included) than KTenths / 10 scaled MADs is a glitch (a
+// bit slip in the HX711 read, a knock on the pallet) and is replaced by
+// that median. Deviations up to MinDeviation always pass, so a quiet
+// stream with a MAD near zero does not reject its own noise. The window
+// keeps the raw samples, so a real step is through after Window / 2
+// samples. Two small sorts per sample: bounded time, no allocation.
+template <uint8_t Window, int32_t MinDeviation, uint32_t KTenths = 30>
+class Hampel {
+  static_assert(Window >= 3 && Window % 2 == 1 && Window <= 15, "Hampel window must be odd, 3 to 15");
+  static_assert(MinDeviation >= 0, "Hampel minimum deviation must not be negative");
+
+  // The MAD scaled to a normal standard deviation (x 1.4826), times K,
+  // in integer arithmetic
+  static const int64_t MAD_SCALE = 14826;
+  static const int64_t LIMIT_SCALE = 100000;
+
+public:
+  int32_t add(int32_t x) {
+    if (!primed_) prime(x);
+    window_[head_] = x;
+    head_ = head_ + 1 < Window ? head_ + 1 : 0;
+
+    int32_t sorted[Window];
+    for (uint8_t i = 0; i < Window; i++) sorted[i] = window_[i];
+    filter_chain::sortSmall<Window>(sorted);
+    int32_t median = sorted[Window / 2];
+
+    if (!isOutlier(x, median, sorted)) {
+      // Back at the level the run started from: it was a glitch. A run
+      // that ends at a new level was a step held back, not counted.
+      if (run_ > 0 && llabs(int64_t(x) - runLevel_) <= MinDeviation) rejected_ += run_;
+      run_ = 0;
+      return x;
+    }
+    if (run_ == 0) runLevel_ = median;
+    run_++;
+    return median;
+  }
+
+  void prime(int32_t x) {
+    for (uint8_t i = 0; i < Window; i++) window_[i] = x;
+    head_ = 0;
+    primed_ = true;
+  }
+
+  // The rejection count is kept across resets
+  void reset() {
+    primed_ = false;
+    run_ = 0;
+  }
+
+  // Samples replaced as glitches so far
+  uint32_t rejected() const { return rejected_; }
+  // The last sample was replaced: a glitch, or the front of a real step
+  // that is not through yet
+  bool holding() const { return run_ > 0; }
+
+private:
+  bool isOutlier(int32_t x, int32_t median, int32_t* scratch) const {
+    int64_t deviation = llabs(int64_t(x) - median);
+    if (deviation <= MinDeviation) return false;
+    for (uint8_t i = 0; i < Window; i++) {
+      int64_t spread = llabs(int64_t(window_[i]) - median);
+      scratch[i] = spread < INT32_MAX ? static_cast<int32_t>(spread) : INT32_MAX;
+    }
+    filter_chain::sortSmall<Window>(scratch);
+    int64_t mad = scratch[Window / 2];
+    return deviation * LIMIT_SCALE > int64_t(KTenths) * MAD_SCALE * mad;
+  }
+
+  int32_t window_[Window] = {};
+  uint8_t head_ = 0;
+  bool primed_ = false;
+  uint8_t run_ = 0;          // Samples replaced in a row
+  int32_t runLevel_ = 0;     // Median when the run started
+  uint32_t rejected_ = 0;
+};
+
+// ============================================================================
+// CHAIN
+// ============================================================================
+template <typename... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<> {
+public:
+  static const size_t STAGES = 0;
+  int32_t add(int32_t x) { return x; }
+  void prime(int32_t) {}
+  void reset() {}
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...> {
+public:
+  static const size_t STAGES = 1 + sizeof...(Rest);
+
+  inline __attribute__((always_inline)) int32_t add(int32_t x) { return rest_.add(first_.add(x)); }
+
+  void prime(int32_t x) {
+    first_.prime(x);
+    rest_.prime(x);
+  }
+
+  void reset() {
+    first_.reset();
+    rest_.reset();
+  }
+
+  // Stage I of the chain, for its settings or counters
+  template <size_t I>
+  auto& stage() {
+    static_assert(I < STAGES, "No such stage");
+    if constexpr (I == 0) {
+      return first_;
+    } else {
+      return rest_.template stage<I - 1>();
+    }
+  }
+
+private:
+  First first_;
+  FilterChain<Rest...> rest_;
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*
+  LoadCellCalibration - multi-point, temperature-compensated load cell
+  calibration kept in NVS
+
+  File: LoadCellCalibration.cpp
+*/
+
+#include "LoadCellCalibration.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const float SAME_WEIGHT_KG = 0.001f;
+
+void CellCalibration::setLinear(int32_t zeroCounts, float countsPerKg) {
+  clear();
+  nominalCountsPerKg = countsPerKg;
+  points[0].counts = zeroCounts;
+  points[0].kg = 0;
+  pointCount = 1;
+}
+
+void CellCalibration::clear() {
+  float nominal = format == FORMAT ? nominalCountsPerKg : 0;
+  memset(this, 0, sizeof(*this));
+  format = FORMAT;
+  nominalCountsPerKg = nominal;
+  referenceTempC = NAN;
+}
+
+float CellCalibration::compensate(int32_t counts, float tempC) const {
+  float c = static_cast<float>(counts);
+  if (isnan(tempC) || isnan(referenceTempC)) return c;
+
+  float dT = tempC - referenceTempC;
+  c -= offsetTempco * dT;
+  if (spanTempco != 0) {
+    float zero = countsAt(0);
+    c = zero + (c - zero) / (1 + spanTempco * dT);
+  }
+  return c;
+}
+
+float CellCalibration::toKg(int32_t counts, float tempC) const {
+  if (pointCount == 0) return 0;
+  float c = compensate(counts, tempC);
+
+  if (pointCount == 1) {
+    if (nominalCountsPerKg == 0) return points[0].kg;
+    return points[0].kg + (c - points[0].counts) / nominalCountsPerKg;
+  }
+
+  // Counts run the same way along every segment; pick the first one whose
+  // upper end lies beyond c, or the last one to extrapolate
+  bool rising = points[1].counts > points[0].counts;
+  uint8_t i = 0;
+  while (i < pointCount - 2 && (rising ? c > points[i + 1].counts : c < points[i + 1].counts)) i++;
+
+  const CalibrationPoint& a = points[i];
+  const CalibrationPoint& b = points[i + 1];
+  return a.kg + (c - a.counts) * (b.kg - a.kg) / (b.counts - a.counts);
+}
+
+float CellCalibration::countsAt(float kg) const {
+  if (pointCount == 0) return 0;
+  if (pointCount == 1) return points[0].counts + (kg - points[0].kg) * nominalCountsPerKg;
+
+  uint8_t i = 0;
+  while (i < pointCount - 2 && kg > points[i + 1].kg) i++;
+
+  const CalibrationPoint& a = points[i];
+  const CalibrationPoint& b = points[i + 1];
+  return a.counts + (kg - a.kg) * (b.counts - a.counts) / (b.kg - a.kg);
+}
+
+bool CellCalibration::setPoint(int32_t counts, float kg, float tempC) {
+  if (format != FORMAT) clear();
+  // The first point taken at a known temperature fixes the reference
+  if (pointCount == 0 || isnan(referenceTempC)) referenceTempC = tempC;
+
+  CalibrationPoint point = {static_cast<int32_t>(lroundf(compensate(counts, tempC))), kg};
+  CalibrationPoint merged[MAX_POINTS];
+  uint8_t count = 0;
+  bool placed = false;
+
+  for (uint8_t i = 0; i < pointCount; i++) {
+    if (fabsf(points[i].kg - kg) < SAME_WEIGHT_KG) continue;
+    if (!placed && kg < points[i].kg) {
+      merged[count++] = point;
+      placed = true;
+    }
+    if (count == MAX_POINTS) return false;
+    merged[count++] = points[i];
+  }
+  if (!placed) {
+    if (count == MAX_POINTS) return false;
+    merged[count++] = point;
+  }
+
+  // Strictly monotonic counts, or interpolation has no meaning
+  for (uint8_t i = 1; i < count; i++) {
+    int32_t step = merged[i].counts - merged[i - 1].counts;
+    int32_t first = merged[1].counts - merged[0].counts;
+    if (labs(step) < MIN_POINT_SPACING || (step > 0) != (first > 0)) return false;
+  }
+
+  memcpy(points, merged, sizeof(merged[0]) * count);
+  pointCount = count;
+  return true;
+}
+
+bool CellCalibration::tare(int32_t counts, float tempC) {
+  if (pointCount == 0) return setPoint(counts, 0, tempC);
+
+  int32_t shift = static_cast<int32_t>(lroundf(compensate(counts, tempC) - countsAt(0)));
+  for (uint8_t i = 0; i < pointCount; i++) {
+    points[i].counts += shift;
+  }
+  return true;
+}
+
+bool CellCalibration::learnOffsetTempco(int32_t counts, float tempC) {
+  if (pointCount == 0 || isnan(tempC) || isnan(referenceTempC)) return false;
+  float dT = tempC - referenceTempC;
+  if (fabsf(dT) < MIN_TEMPCO_SPAN_C) return false;
+
+  offsetTempco = (counts - countsAt(0)) / dT;
+  return true;
+}
+
+// ============================================================================
+// NVS
+// ============================================================================
+uint8_t CalibrationStore::load(CellCalibration* cells, uint8_t count) {
+  if (!prefs_.begin(namespace_, true)) return 0;
+
+  uint8_t restored = 0;
+  char key[8];
+  for (uint8_t i = 0; i < count; i++) {
+    snprintf(key, sizeof(key), "cell%u", i);
+    CellCalibration cell;
+    if (prefs_.getBytesLength(key) != sizeof(cell)) continue;
+    if (prefs_.getBytes(key, &cell, sizeof(cell)) != sizeof(cell)) continue;
+    if (cell.format != CellCalibration::FORMAT || cell.pointCount == 0 ||
+        cell.pointCount > CellCalibration::MAX_POINTS) continue;
+    cells[i] = cell;
+    restored++;
+  }
+  prefs_.end();
+  return restored;
+}
+
+bool CalibrationStore::save(const CellCalibration* cells, uint8_t count) {
+  if (!prefs_.begin(namespace_, false)) return false;
+
+  bool ok = true;
+  char key[8];
+  for (uint8_t i = 0; i < count; i++) {
+    snprintf(key, sizeof(key), "cell%u", i);
+    ok = prefs_.putBytes(key, &cells[i], sizeof(cells[i])) == sizeof(cells[i]) && ok;
+  }
+  prefs_.end();
+  return ok;
+}
+
+bool CalibrationStore::loadCorners(float* factors, uint8_t count) {
+  if (!prefs_.begin(namespace_, true)) return false;
+  size_t bytes = sizeof(float) * count;
+  bool ok = prefs_.getBytesLength("corners") == bytes && prefs_.getBytes("corners", factors, bytes) == bytes;
+  prefs_.end();
+  return ok;
+}
+
+bool CalibrationStore::saveCorners(const float* factors, uint8_t count) {
+  if (!prefs_.begin(namespace_, false)) return false;
+  size_t bytes = sizeof(float) * count;
+  bool ok = prefs_.putBytes("corners", factors, bytes) == bytes;
+  prefs_.end();
+  return ok;
+}
+
+bool CalibrationStore::erase() {
+  if (!prefs_.begin(namespace_, false)) return false;
+  bool ok = prefs_.clear();
+  prefs_.end();
+  return ok;
+}
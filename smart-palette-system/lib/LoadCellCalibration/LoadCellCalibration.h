@@ -0,0 +1,104 @@
+/*
+  LoadCellCalibration - multi-point, temperature-compensated load cell
+  calibration kept in NVS
+
+  Each cell maps raw HX711 counts to kilograms through up to MAX_POINTS
+  known weights, interpolated piecewise-linearly and extended along the
+  outer segments. A cell with a single point (a zero) uses its nominal
+  gain, so a bare tare is already a usable calibration.
+
+  Counts are first brought back to the reference temperature at which
+  the points were taken:
+
+    c' = c - offsetTempco * dT                      (zero drift)
+    c' = zero + (c' - zero) / (1 + spanTempco * dT)  (gain drift)
+
+  with dT = T - referenceTempC. Both coefficients default to 0, which
+  turns compensation off; so does a NAN temperature.
+
+  CellCalibration is plain data: copy it freely between tasks and store
+  it as a blob. CalibrationStore keeps one blob per cell in an NVS
+  namespace, so a boot restores the curve instead of taring whatever
+  happens to be on the pallet.
+
+  File: LoadCellCalibration.h
+*/
+
+#ifndef LOAD_CELL_CALIBRATION_H
+#define LOAD_CELL_CALIBRATION_H
+
+#include <Preferences.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct CalibrationPoint {
+  int32_t counts;          // At the reference temperature
+  float kg;
+};
+
+struct CellCalibration {
+  static const uint8_t MAX_POINTS = 6;
+  static const uint8_t FORMAT = 1;   // Bump when the layout changes
+
+  uint8_t format;
+  uint8_t pointCount;
+  CalibrationPoint points[MAX_POINTS];   // Ascending kg
+  float nominalCountsPerKg;  // Gain used while only one point is known
+  float referenceTempC;
+  float offsetTempco;        // Counts per degree C
+  float spanTempco;          // Fraction per degree C
+
+  // Zero at `zeroCounts` with a nominal gain, nothing learned yet
+  void setLinear(int32_t zeroCounts, float countsPerKg);
+  void clear();
+
+  bool isValid() const { return format == FORMAT && pointCount > 0; }
+  bool isMultiPoint() const { return pointCount > 1; }
+
+  float toKg(int32_t counts, float tempC) const;
+
+  // Record `counts` as reading `kg`. Replaces a point within 1 g of the
+  // same weight. Fails if the reading does not keep counts monotonic in
+  // kg, or lies within MIN_POINT_SPACING counts of a neighbour: the wrong
+  // weight was entered, the load moved or it stood on the other cell.
+  static const int32_t MIN_POINT_SPACING = 100;
+  bool setPoint(int32_t counts, float kg, float tempC);
+
+  // Shift every point so that `counts` reads 0 kg; the gain is kept
+  bool tare(int32_t counts, float tempC);
+
+  // Learn the zero drift from an empty reading at a temperature at least
+  // MIN_TEMPCO_SPAN_C away from the reference
+  static constexpr float MIN_TEMPCO_SPAN_C = 5.0f;
+  bool learnOffsetTempco(int32_t counts, float tempC);
+
+  // Counts at the reference temperature that read `kg`
+  float countsAt(float kg) const;
+
+private:
+  float compensate(int32_t counts, float tempC) const;
+};
+
+class CalibrationStore {
+public:
+  explicit CalibrationStore(const char* nvsNamespace = "calibration") : namespace_(nvsNamespace) {}
+
+  // Restore each cell saved under this namespace; cells without a valid
+  // blob are left untouched. Returns how many were restored.
+  uint8_t load(CellCalibration* cells, uint8_t count);
+
+  bool save(const CellCalibration* cells, uint8_t count);
+
+  // Load-position factors of a multi-cell scale, one per cell; left
+  // untouched unless a set of `count` was saved
+  bool loadCorners(float* factors, uint8_t count);
+  bool saveCorners(const float* factors, uint8_t count);
+
+  bool erase();
+
+private:
+  const char* namespace_;
+  Preferences prefs_;
+};
+
+#endif
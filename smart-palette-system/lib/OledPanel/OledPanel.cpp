@@ -0,0 +1,142 @@
+/*
+  OledPanel - retained-mode text layer for the SSD1306
+
+  File: OledPanel.cpp
+*/
+
+#include "OledPanel.h"
+#include <string.h>
+#include <stdio.h>
+
+static const uint8_t SSD1306_CONTROL_COMMAND = 0x00;
+static const uint8_t SSD1306_CONTROL_DATA = 0x40;
+static const uint8_t SSD1306_SET_COLUMN_RANGE = 0x21;
+static const uint8_t SSD1306_SET_PAGE_RANGE = 0x22;
+static const size_t I2C_CHUNK = 32;          // Fits every Arduino Wire buffer
+static const uint32_t I2C_FAST_CLOCK = 400000;
+static const uint8_t GLYPH_WIDTH = 6;
+static const uint8_t GLYPH_HEIGHT = 8;
+
+OledPanel::OledPanel(Adafruit_SSD1306& display, TwoWire& wire) : display_(display), wire_(wire) {
+  for (uint8_t page = 0; page < MAX_PAGES; page++) {
+    dirtyFirst_[page] = INT16_MAX;
+    dirtyLast_[page] = -1;
+  }
+}
+
+void OledPanel::begin(uint8_t address) {
+  address_ = address;
+  invalidate();
+}
+
+int8_t OledPanel::addField(int16_t x, int16_t y, uint8_t chars, uint8_t textSize) {
+  if (fieldCount_ >= MAX_FIELDS || chars == 0) return -1;
+  Field& field = fields_[fieldCount_];
+  field.x = x;
+  field.y = y;
+  field.chars = chars < MAX_FIELD_CHARS ? chars : MAX_FIELD_CHARS;
+  field.size = textSize > 0 ? textSize : 1;
+  memset(field.text, ' ', field.chars);
+  field.text[field.chars] = '\0';
+  // Drawn blank on the first flush, so the field area is cleared
+  field.firstDirty = 0;
+  field.lastDirty = field.chars - 1;
+  return static_cast<int8_t>(fieldCount_++);
+}
+
+void OledPanel::setText(int8_t id, const char* text) {
+  if (id < 0 || id >= fieldCount_) return;
+  Field& field = fields_[id];
+
+  bool ended = false;
+  for (uint8_t i = 0; i < field.chars; i++) {
+    if (!ended && text[i] == '\0') ended = true;
+    char c = ended ? ' ' : text[i];
+    if (field.text[i] == c) continue;
+    field.text[i] = c;
+    if (field.firstDirty > field.lastDirty) {
+      field.firstDirty = field.lastDirty = i;
+    } else {
+      if (i < field.firstDirty) field.firstDirty = i;
+      if (i > field.lastDirty) field.lastDirty = i;
+    }
+  }
+}
+
+void OledPanel::printf(int8_t id, const char* format, ...) {
+  char text[MAX_FIELD_CHARS + 1];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  setText(id, text);
+}
+
+void OledPanel::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t x0 = x < 0 ? 0 : x;
+  int16_t x1 = x + w - 1 < display_.width() ? x + w - 1 : display_.width() - 1;
+  int16_t y0 = y < 0 ? 0 : y;
+  int16_t y1 = y + h - 1 < display_.height() ? y + h - 1 : display_.height() - 1;
+  if (x0 > x1 || y0 > y1) return;
+
+  for (int16_t page = y0 / 8; page <= y1 / 8 && page < MAX_PAGES; page++) {
+    if (x0 < dirtyFirst_[page]) dirtyFirst_[page] = x0;
+    if (x1 > dirtyLast_[page]) dirtyLast_[page] = x1;
+  }
+}
+
+size_t OledPanel::flush() {
+  for (uint8_t i = 0; i < fieldCount_; i++) {
+    Field& field = fields_[i];
+    if (field.firstDirty > field.lastDirty) continue;
+
+    // Opaque glyphs overwrite the old cell, no separate clear needed
+    int16_t cellWidth = GLYPH_WIDTH * field.size;
+    for (uint8_t c = field.firstDirty; c <= field.lastDirty; c++) {
+      display_.drawChar(field.x + c * cellWidth, field.y, field.text[c], SSD1306_WHITE, SSD1306_BLACK, field.size);
+    }
+    markDirty(field.x + field.firstDirty * cellWidth, field.y,
+              (field.lastDirty - field.firstDirty + 1) * cellWidth, GLYPH_HEIGHT * field.size);
+    field.firstDirty = 1;
+    field.lastDirty = 0;
+  }
+
+  size_t sent = 0;
+  uint32_t busClock = wire_.getClock();
+  for (uint8_t page = 0; page < MAX_PAGES; page++) {
+    if (dirtyFirst_[page] > dirtyLast_[page]) continue;
+    if (sent == 0) wire_.setClock(I2C_FAST_CLOCK);
+    sent += sendPage(page, static_cast<uint8_t>(dirtyFirst_[page]), static_cast<uint8_t>(dirtyLast_[page]));
+    dirtyFirst_[page] = INT16_MAX;
+    dirtyLast_[page] = -1;
+  }
+  if (sent > 0) wire_.setClock(busClock);
+
+  bytesSent_ += sent;
+  return sent;
+}
+
+// Point the controller's write window at one page span, then stream the
+// matching framebuffer bytes (horizontal addressing, set up by begin())
+size_t OledPanel::sendPage(uint8_t page, uint8_t firstColumn, uint8_t lastColumn) {
+  const uint8_t window[] = {SSD1306_CONTROL_COMMAND, SSD1306_SET_COLUMN_RANGE, firstColumn, lastColumn,
+                            SSD1306_SET_PAGE_RANGE, page, page};
+  wire_.beginTransmission(address_);
+  wire_.write(window, sizeof(window));
+  wire_.endTransmission();
+  size_t sent = sizeof(window);
+
+  const uint8_t* data = display_.getBuffer() + page * display_.width() + firstColumn;
+  size_t remaining = lastColumn - firstColumn + 1;
+  while (remaining > 0) {
+    size_t chunk = remaining < I2C_CHUNK - 1 ? remaining : I2C_CHUNK - 1;
+    wire_.beginTransmission(address_);
+    wire_.write(SSD1306_CONTROL_DATA);
+    wire_.write(data, chunk);
+    wire_.endTransmission();
+    data += chunk;
+    remaining -= chunk;
+    sent += chunk + 1;
+  }
+  return sent;
+}
@@ -0,0 +1,75 @@
+/*
+  OledPanel - retained-mode text layer for the SSD1306
+
+  Adafruit_SSD1306::display() sends the whole 1 KB framebuffer over I2C
+  no matter how little changed. OledPanel keeps the text last drawn in
+  each field instead; setText() compares the new text character by
+  character, flush() redraws only the glyph cells that differ and sends
+  only the changed column span of each affected 8-pixel page. An
+  unchanged screen costs no bus traffic at all.
+
+  Fields sit at a fixed position and width. With y a multiple of 8, a
+  size-1 field fills exactly one page. Anything drawn straight into the
+  display buffer (rules, icons) is sent after markDirty().
+
+  File: OledPanel.h
+*/
+
+#ifndef OLED_PANEL_H
+#define OLED_PANEL_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+class OledPanel {
+public:
+  static const uint8_t MAX_FIELDS = 8;
+  static const uint8_t MAX_FIELD_CHARS = 21;   // 128 px / 6 px per glyph
+  static const uint8_t MAX_PAGES = 8;
+
+  explicit OledPanel(Adafruit_SSD1306& display, TwoWire& wire = Wire);
+
+  // Call after display.begin(). The next flush() sends the whole screen.
+  void begin(uint8_t address);
+
+  // Returns the field id, or -1 if there is no room
+  int8_t addField(int16_t x, int16_t y, uint8_t chars, uint8_t textSize = 1);
+
+  // Text is cut or space-padded to the field width
+  void setText(int8_t field, const char* text);
+  void printf(int8_t field, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+  void invalidate() { markDirty(0, 0, display_.width(), display_.height()); }
+
+  // Redraw changed cells and send them; returns the I2C bytes written
+  size_t flush();
+
+  Adafruit_SSD1306& gfx() { return display_; }
+  uint32_t bytesSent() const { return bytesSent_; }
+
+private:
+  struct Field {
+    int16_t x;
+    int16_t y;
+    uint8_t chars;
+    uint8_t size;
+    char text[MAX_FIELD_CHARS + 1];
+    uint8_t firstDirty;        // Changed cells not yet redrawn; first > last = none
+    uint8_t lastDirty;
+  };
+
+  size_t sendPage(uint8_t page, uint8_t firstColumn, uint8_t lastColumn);
+
+  Adafruit_SSD1306& display_;
+  TwoWire& wire_;
+  uint8_t address_ = 0;
+  Field fields_[MAX_FIELDS];
+  uint8_t fieldCount_ = 0;
+  int16_t dirtyFirst_[MAX_PAGES];   // Column span per page; first > last = clean
+  int16_t dirtyLast_[MAX_PAGES];
+  uint32_t bytesSent_ = 0;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+  ParameterStore - typed, validated tuning parameters kept in NVS
+
+  File: ParameterStore.cpp
+*/
+
+#include "ParameterStore.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* VERSION_KEY = "_version";
+
+ParameterStore::ParameterStore(const ParamSpec* specs, uint8_t count, uint16_t version, const char* nvsNamespace)
+    : specs_(specs), count_(count < MAX_PARAMS ? count : MAX_PARAMS), version_(version), namespace_(nvsNamespace) {
+  for (uint8_t i = 0; i < count_; i++) values_[i] = specs_[i].defaultValue;
+}
+
+uint8_t ParameterStore::load() {
+  for (uint8_t i = 0; i < count_; i++) values_[i] = specs_[i].defaultValue;
+  generation_++;
+  if (!prefs_.begin(namespace_, false)) return 0;
+
+  // Values saved under another schema mean something else now
+  if (prefs_.isKey(VERSION_KEY) && prefs_.getUInt(VERSION_KEY, 0) != version_) {
+    prefs_.clear();
+    prefs_.end();
+    return 0;
+  }
+
+  uint8_t restored = 0;
+  for (uint8_t i = 0; i < count_; i++) {
+    const ParamSpec& spec = specs_[i];
+    if (!prefs_.isKey(spec.key)) continue;
+    float value = spec.type == PARAM_INT ? prefs_.getInt(spec.key, 0) : prefs_.getFloat(spec.key, NAN);
+    if (!(value >= spec.minimum && value <= spec.maximum)) {
+      prefs_.remove(spec.key);
+      continue;
+    }
+    values_[i] = value;
+    restored++;
+  }
+  prefs_.end();
+  return restored;
+}
+
+int ParameterStore::find(const char* key) const {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (strcmp(specs_[i].key, key) == 0) return i;
+  }
+  return -1;
+}
+
+ParamResult ParameterStore::set(const char* key, const char* text) {
+  int index = find(key);
+  if (index < 0) return PARAM_UNKNOWN;
+
+  char* end;
+  float value;
+  if (specs_[index].type == PARAM_INT) {
+    value = strtol(text, &end, 10);
+  } else {
+    value = strtof(text, &end);
+  }
+  if (end == text || *end != '\0') return PARAM_INVALID;
+  return set(index, value);
+}
+
+ParamResult ParameterStore::set(uint8_t index, float value) {
+  if (index >= count_) return PARAM_UNKNOWN;
+  const ParamSpec& spec = specs_[index];
+  if (spec.type == PARAM_INT && value != floorf(value)) return PARAM_INVALID;
+  if (!(value >= spec.minimum && value <= spec.maximum)) return PARAM_OUT_OF_RANGE;
+
+  values_[index] = value;
+  generation_++;
+  return save(index) ? PARAM_OK : PARAM_NOT_SAVED;
+}
+
+bool ParameterStore::reset() {
+  for (uint8_t i = 0; i < count_; i++) values_[i] = specs_[i].defaultValue;
+  generation_++;
+  if (!prefs_.begin(namespace_, false)) return false;
+  bool ok = prefs_.clear();
+  prefs_.end();
+  return ok;
+}
+
+// A default is stored as no key at all
+bool ParameterStore::save(uint8_t index) {
+  if (!prefs_.begin(namespace_, false)) return false;
+  const ParamSpec& spec = specs_[index];
+  bool ok = prefs_.putUInt(VERSION_KEY, version_) == sizeof(uint32_t);
+  if (isDefault(index)) {
+    if (prefs_.isKey(spec.key)) ok = prefs_.remove(spec.key) && ok;
+  } else if (spec.type == PARAM_INT) {
+    ok = prefs_.putInt(spec.key, getInt(index)) == sizeof(int32_t) && ok;
+  } else {
+    ok = prefs_.putFloat(spec.key, values_[index]) == sizeof(float) && ok;
+  }
+  prefs_.end();
+  return ok;
+}
+
+const char* ParameterStore::resultName(ParamResult result) {
+  switch (result) {
+    case PARAM_OK: return "ok";
+    case PARAM_UNKNOWN: return "unknown parameter";
+    case PARAM_INVALID: return "not a valid number";
+    case PARAM_OUT_OF_RANGE: return "out of range";
+    case PARAM_NOT_SAVED: return "applied but NOT saved to NVS";
+  }
+  return "?";
+}
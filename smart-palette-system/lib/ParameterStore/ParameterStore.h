@@ -0,0 +1,90 @@
+/*
+  ParameterStore - typed, validated tuning parameters kept in NVS
+
+  The firmware describes its parameters in a ParamSpec table: the NVS key
+  (also the name used on the console), integer or float, the accepted
+  range and the default, which is usually the config.h value. Only values
+  changed from their default are written, one NVS key each, so a later
+  firmware with new defaults still picks them up.
+
+  The store carries a schema version. When a table changes meaning
+  (a unit, a range, a key reused), bump the version: saved values from
+  another version are discarded at load instead of being misread. A
+  saved value outside its range is dropped the same way.
+
+  generation() goes up with every change, so tasks holding derived state
+  (filter windows, intervals) can tell when to pick the new values up.
+  The store itself is not locked; callers serialise access.
+
+  File: ParameterStore.h
+*/
+
+#ifndef PARAMETER_STORE_H
+#define PARAMETER_STORE_H
+
+#include <Preferences.h>
+#include <stdint.h>
+
+enum ParamType : uint8_t {
+  PARAM_INT,
+  PARAM_FLOAT
+};
+
+struct ParamSpec {
+  const char* key;          // NVS key, at most 15 characters
+  ParamType type;
+  float minimum;
+  float maximum;
+  float defaultValue;
+  const char* unit;
+};
+
+enum ParamResult : uint8_t {
+  PARAM_OK,
+  PARAM_UNKNOWN,            // No parameter of that name
+  PARAM_INVALID,            // Not a number, or not whole for an integer
+  PARAM_OUT_OF_RANGE,
+  PARAM_NOT_SAVED           // Applied, but NVS refused the write
+};
+
+class ParameterStore {
+public:
+  static const uint8_t MAX_PARAMS = 16;
+
+  ParameterStore(const ParamSpec* specs, uint8_t count, uint16_t version, const char* nvsNamespace = "params");
+
+  // Restore saved values over the defaults; returns how many were restored
+  uint8_t load();
+
+  uint8_t count() const { return count_; }
+  const ParamSpec& spec(uint8_t index) const { return specs_[index]; }
+  int find(const char* key) const;
+
+  int32_t getInt(uint8_t index) const { return static_cast<int32_t>(values_[index]); }
+  float getFloat(uint8_t index) const { return values_[index]; }
+  bool isDefault(uint8_t index) const { return values_[index] == specs_[index].defaultValue; }
+
+  // Parse, validate and save one value
+  ParamResult set(const char* key, const char* text);
+  ParamResult set(uint8_t index, float value);
+
+  // Every parameter back to its default; the saved values are erased
+  bool reset();
+
+  uint32_t generation() const { return generation_; }
+
+  static const char* resultName(ParamResult result);
+
+private:
+  bool save(uint8_t index);
+
+  const ParamSpec* specs_;
+  uint8_t count_;
+  uint16_t version_;
+  const char* namespace_;
+  Preferences prefs_;
+  float values_[MAX_PARAMS];
+  uint32_t generation_ = 0;
+};
+
+#endif
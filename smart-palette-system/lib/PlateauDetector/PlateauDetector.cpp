@@ -0,0 +1,54 @@
+/*
+  PlateauDetector - change-point segmentation of the weight stream
+
+  File: PlateauDetector.cpp
+*/
+
+#include "PlateauDetector.h"
+
+PlateauDetector::PlateauDetector(float drift, float threshold, uint32_t minSamples)
+    : drift_(drift), threshold_(threshold), minSamples_(minSamples > 1 ? minSamples : 2) {}
+
+void PlateauDetector::reset() {
+  count_ = 0;
+  mean_ = 0;
+  m2_ = 0;
+  upperSum_ = 0;
+  lowerSum_ = 0;
+  settled_ = false;
+}
+
+void PlateauDetector::restart(float sample, uint32_t atMs) {
+  reset();
+  count_ = 1;
+  mean_ = sample;
+  startedAtMs_ = atMs;
+}
+
+bool PlateauDetector::add(float sample, uint32_t atMs) {
+  if (count_ == 0) {
+    restart(sample, atMs);
+    return true;
+  }
+
+  float deviation = sample - mean_;
+  upperSum_ += deviation - drift_;
+  lowerSum_ += -deviation - drift_;
+  if (upperSum_ < 0) upperSum_ = 0;
+  if (lowerSum_ < 0) lowerSum_ = 0;
+
+  if (upperSum_ > threshold_ || lowerSum_ > threshold_) {
+    restart(sample, atMs);
+    changePoints_++;
+    return true;
+  }
+
+  count_++;
+  mean_ += deviation / count_;
+  m2_ += deviation * (sample - mean_);
+
+  bool settled = count_ >= minSamples_ && variance() < drift_ * drift_;
+  if (settled && !settled_) settledAtMs_ = atMs;
+  settled_ = settled;
+  return false;
+}
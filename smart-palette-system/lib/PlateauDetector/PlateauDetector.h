@@ -0,0 +1,71 @@
+/*
+  PlateauDetector - change-point segmentation of the weight stream
+
+  Splits the sample stream into flat segments. Each sample is compared
+  with the mean of the current segment by a two-sided CUSUM: deviations
+  beyond `drift` accumulate, and once either sum passes `threshold` a
+  change point is declared and a new segment starts at that sample. A
+  crate being set down, or the ringing after it, keeps restarting the
+  segment; a pallet that has come to rest grows one long segment.
+
+  A segment counts as a settled plateau once it holds `minSamples`
+  samples and its standard deviation is below `drift`. Its mean and
+  variance are kept with Welford's update, so they cover the whole
+  plateau, not just a fixed window, in O(1) per sample and no storage.
+
+  Times are whatever millisecond clock the caller passes in; only
+  differences are used, so wrap-around is harmless.
+
+  File: PlateauDetector.h
+*/
+
+#ifndef PLATEAU_DETECTOR_H
+#define PLATEAU_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class PlateauDetector {
+public:
+  // `drift`: deviation from the plateau mean still treated as noise.
+  // `threshold`: accumulated excess deviation that ends a plateau.
+  PlateauDetector(float drift, float threshold, uint32_t minSamples);
+  // For arrays; assign a configured detector before use
+  PlateauDetector() : PlateauDetector(0, 0, 2) {}
+
+  void reset();
+
+  // Returns true if this sample started a new segment
+  bool add(float sample, uint32_t atMs);
+
+  bool isSettled() const { return settled_; }
+  float mean() const { return mean_; }
+  float variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0; }
+  uint32_t count() const { return count_; }
+
+  // First sample of the current segment
+  uint32_t startedAt() const { return startedAtMs_; }
+  // Sample at which the current segment became a plateau (if settled)
+  uint32_t settledAt() const { return settledAtMs_; }
+
+  uint32_t changePoints() const { return changePoints_; }
+
+private:
+  void restart(float sample, uint32_t atMs);
+
+  float drift_;
+  float threshold_;
+  uint32_t minSamples_;
+
+  uint32_t count_ = 0;
+  float mean_ = 0;
+  float m2_ = 0;
+  float upperSum_ = 0;
+  float lowerSum_ = 0;
+  bool settled_ = false;
+  uint32_t startedAtMs_ = 0;
+  uint32_t settledAtMs_ = 0;
+  uint32_t changePoints_ = 0;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+  RawTrace - binary format for raw load cell and NFC recordings
+
+  File: RawTrace.cpp
+*/
+
+#include "RawTrace.h"
+#include <string.h>
+
+static const char MAGIC[4] = {'P', 'L', 'R', 'T'};
+
+void RawTrace::makeHeader(RawTraceHeader& header, uint8_t cells, uint16_t sampleRate, uint32_t startMs) {
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.cells = cells;
+  header.sampleRate = sampleRate;
+  header.startMs = startMs;
+}
+
+bool RawTrace::validHeader(const RawTraceHeader& header) {
+  return memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+         header.cells > 0 && header.cells <= MAX_CELLS;
+}
+
+size_t RawTrace::encode(uint8_t* out, size_t room, uint8_t type, uint8_t flags, uint32_t timestampUs,
+                        const void* payload, uint16_t length) {
+  size_t size = RECORD_HEAD_SIZE + length;
+  if (size > room) return 0;
+  out[0] = type;
+  out[1] = flags;
+  memcpy(out + 2, &length, sizeof(length));
+  memcpy(out + 4, &timestampUs, sizeof(timestampUs));
+  if (length) memcpy(out + RECORD_HEAD_SIZE, payload, length);
+  return size;
+}
+
+size_t RawTrace::encodeSample(uint8_t* out, size_t room, uint32_t timestampUs, uint8_t present,
+                              const int32_t* counts, uint8_t cells) {
+  return encode(out, room, RAW_SAMPLE, present, timestampUs, counts, sizeof(int32_t) * cells);
+}
+
+RawTraceReader::RawTraceReader(const uint8_t* data, size_t size)
+    : data_(data), size_(size), offset_(RawTrace::HEADER_SIZE), valid_(false) {
+  if (size < RawTrace::HEADER_SIZE) return;
+  memcpy(&header_, data, sizeof(header_));
+  valid_ = RawTrace::validHeader(header_);
+}
+
+bool RawTraceReader::next(RawTraceRecord& record) {
+  if (!valid_ || size_ - offset_ < RawTrace::RECORD_HEAD_SIZE) return false;
+  const uint8_t* head = data_ + offset_;
+  record.type = head[0];
+  record.flags = head[1];
+  memcpy(&record.length, head + 2, sizeof(record.length));
+  memcpy(&record.timestampUs, head + 4, sizeof(record.timestampUs));
+  if (size_ - offset_ - RawTrace::RECORD_HEAD_SIZE < record.length) return false;
+  record.payload = head + RawTrace::RECORD_HEAD_SIZE;
+  offset_ += RawTrace::RECORD_HEAD_SIZE + record.length;
+  return true;
+}
+
+int32_t RawTraceReader::counts(const RawTraceRecord& record, uint8_t cell) {
+  int32_t value = 0;
+  if (record.type == RAW_SAMPLE && (cell + 1) * sizeof(int32_t) <= record.length) {
+    memcpy(&value, record.payload + cell * sizeof(int32_t), sizeof(value));
+  }
+  return value;
+}
@@ -0,0 +1,101 @@
+/*
+  RawTrace - binary format for raw load cell and NFC recordings
+
+  A recording is a header followed by records back to back, in the
+  ESP32's little-endian layout:
+
+    header   "PLRT", version, cell count, nominal sample rate, millis()
+             at the start
+    record   type, flags, payload length, timestamp (micros() of the
+             event), then the payload:
+
+      RAW_SAMPLE       one int32 of raw counts per cell; bit i of flags
+                       marks cell i as present in the set
+      RAW_TAP          the card's UID bytes
+      RAW_CALIBRATION  the CellCalibration of cell `flags`, then its
+                       corner factor (float), as in force when the
+                       recording started
+      RAW_TEMPERATURE  die temperature in C (float), at the start and
+                       every few seconds after
+
+  Raw counts, not kilograms, so a recording can be run again through a
+  different calibration or different filter settings. A sample set at
+  80 SPS on two cells costs 16 bytes, about 1.3 KB a second.
+
+  A record cut short (power lost while writing) ends the recording; the
+  reader stops there.
+
+  File: RawTrace.h
+*/
+
+#ifndef RAW_TRACE_H
+#define RAW_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum RawTraceRecordType : uint8_t {
+  RAW_SAMPLE = 1,
+  RAW_TAP = 2,
+  RAW_CALIBRATION = 3,
+  RAW_TEMPERATURE = 4
+};
+
+struct RawTraceHeader {
+  char magic[4];            // "PLRT"
+  uint8_t version;
+  uint8_t cells;
+  uint16_t sampleRate;      // Nominal, per cell
+  uint32_t startMs;         // millis() when recording began
+  uint32_t reserved;
+};
+
+struct RawTraceRecord {
+  uint8_t type;             // RawTraceRecordType
+  uint8_t flags;
+  uint16_t length;          // Payload bytes
+  uint32_t timestampUs;
+  const uint8_t* payload;   // Into the reader's buffer; not stored
+};
+
+class RawTrace {
+public:
+  static const uint8_t VERSION = 1;
+  static const size_t HEADER_SIZE = sizeof(RawTraceHeader);
+  static const size_t RECORD_HEAD_SIZE = 8;
+  static const uint8_t MAX_CELLS = 8;   // A sample set's presence bits
+
+  static void makeHeader(RawTraceHeader& header, uint8_t cells, uint16_t sampleRate, uint32_t startMs);
+  static bool validHeader(const RawTraceHeader& header);
+
+  // Encode one record into `out`; returns its size, 0 if it does not fit
+  static size_t encode(uint8_t* out, size_t room, uint8_t type, uint8_t flags, uint32_t timestampUs,
+                       const void* payload, uint16_t length);
+  static size_t encodeSample(uint8_t* out, size_t room, uint32_t timestampUs, uint8_t present,
+                             const int32_t* counts, uint8_t cells);
+};
+
+// Walks a recording held in memory
+class RawTraceReader {
+public:
+  RawTraceReader(const uint8_t* data, size_t size);
+
+  // False if the data does not start with a valid header
+  bool valid() const { return valid_; }
+  const RawTraceHeader& header() const { return header_; }
+
+  // Next complete record; false at the end or at a truncated record
+  bool next(RawTraceRecord& record);
+
+  // Raw counts of cell `cell` in a RAW_SAMPLE record
+  static int32_t counts(const RawTraceRecord& record, uint8_t cell);
+
+private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_;
+  RawTraceHeader header_;
+  bool valid_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+  SampleRing - lock-free single-producer/single-consumer ring buffer
+
+  One side (typically an ISR) calls push(), the other (a task) calls
+  peek()/pop(). Head and tail are each written by only one side, so
+  plain acquire/release atomics are enough - no critical sections, no
+  disabled interrupts. When the ring is full push() fails and the drop
+  is counted instead of overwriting unread data.
+
+  Capacity must be a power of two; one slot is never used so that full
+  and empty can be told apart.
+
+  File: SampleRing.h
+*/
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define SAMPLE_RING_INLINE inline __attribute__((always_inline))
+
+template <typename T, size_t Capacity>
+class SampleRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  // Producer side. Safe to call from an ISR: always inlined, no locks.
+  SAMPLE_RING_INLINE bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t next = (head + 1) & MASK;
+    if (next == tail_.load(std::memory_order_acquire)) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    items_[head] = item;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool peek(T& item) const {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    item = items_[tail];
+    return true;
+  }
+
+  bool pop(T& item) {
+    if (!peek(item)) return false;
+    tail_.store((tail_.load(std::memory_order_relaxed) + 1) & MASK, std::memory_order_release);
+    return true;
+  }
+
+  // Drop everything currently queued (consumer side only)
+  void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+  size_t size() const {
+    return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & MASK;
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return Capacity - 1; }
+
+  // Items rejected because the consumer fell behind
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t MASK = Capacity - 1;
+
+  T items_[Capacity];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+
+#endif
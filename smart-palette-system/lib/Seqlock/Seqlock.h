@@ -0,0 +1,59 @@
+/*
+  Seqlock - single-writer, lock-free-reader snapshot
+
+  The writer bumps a sequence counter to an odd value, copies the new
+  value in, then bumps it back to even. Readers copy the value and retry
+  if the counter was odd or changed underneath them. The writer never
+  waits for readers and readers never block the writer, which is what a
+  real-time producer needs when slow consumers (display, network) want a
+  consistent view of its state.
+
+  T must be trivially copyable. There must be exactly one writer.
+
+  File: Seqlock.h
+*/
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+public:
+  Seqlock() = default;
+  explicit Seqlock(const T& initial) : value_(initial) {}
+
+  void write(const T& value) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T copy;
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      copy = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+  }
+
+  // Number of completed writes; lets readers tell whether anything changed
+  uint32_t version() const { return seq_.load(std::memory_order_acquire) >> 1; }
+
+private:
+  T value_{};
+  std::atomic<uint32_t> seq_{0};
+};
+
+#endif
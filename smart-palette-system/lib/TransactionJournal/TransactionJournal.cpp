@@ -0,0 +1,269 @@
+/*
+  TransactionJournal - append-only, CRC-protected flash journal
+
+  File: TransactionJournal.cpp
+*/
+
+#include "TransactionJournal.h"
+#include <string.h>
+#include <stdio.h>
+
+static const uint16_t ENTRY_MAGIC = 0x4A54;   // "TJ"
+static const size_t ENTRY_OVERHEAD = 8;       // magic, type, length, CRC-32
+static const size_t RECORD_ENTRY_BYTES = ENTRY_OVERHEAD + sizeof(JournalRecord);
+static_assert(sizeof(JournalRecord) <= 255, "JournalRecord must fit the one-byte entry length");
+
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static size_t writeEntry(fs::File& file, uint8_t type, const void* payload, uint8_t length) {
+  uint8_t frame[ENTRY_OVERHEAD + 255];
+  frame[0] = ENTRY_MAGIC & 0xFF;
+  frame[1] = ENTRY_MAGIC >> 8;
+  frame[2] = type;
+  frame[3] = length;
+  memcpy(frame + 4, payload, length);
+  uint32_t crc = crc32(frame, 4 + length);
+  memcpy(frame + 4 + length, &crc, sizeof(crc));
+
+  size_t size = ENTRY_OVERHEAD + length;
+  return file.write(frame, size) == size ? size : 0;
+}
+
+TransactionJournal::TransactionJournal(const char* path, size_t maxBytes, size_t compactBytes)
+    : path_(path), maxBytes_(maxBytes), compactBytes_(compactBytes) {}
+
+bool TransactionJournal::begin(fs::FS& fs, uint32_t newJournalId) {
+  fs_ = &fs;
+  size_ = 0;
+  readOffset_ = 0;
+  lastSequence_ = 0;
+  ackedSequence_ = 0;
+  deadLetters_ = 0;
+
+  // Finish or discard a compaction that was interrupted by a reset
+  char tmpPath[48];
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path_);
+  if (fs.exists(tmpPath)) {
+    if (fs.exists(path_)) {
+      fs.remove(tmpPath);
+    } else {
+      fs.rename(tmpPath, path_);
+    }
+  }
+
+  fs::File file = fs.open(path_, FILE_READ);
+  bool haveHeader = false;
+  size_t validBytes = 0;
+  size_t fileSize = 0;
+
+  if (file) {
+    fileSize = file.size();
+    EntryType type;
+    uint8_t payload[255];
+    uint16_t length;
+    while (readEntry(file, type, payload, length)) {
+      validBytes = file.position();
+      uint32_t value = 0;
+      JournalRecord record;
+      if (type == ENTRY_RECORD && decodeRecord(payload, length, record)) {
+        value = record.sequence;
+      } else if (length == sizeof(uint32_t)) {
+        memcpy(&value, payload, sizeof(value));
+      }
+
+      if (type == ENTRY_HEADER && !haveHeader) {
+        journalId_ = value;
+        haveHeader = true;
+      } else if (type == ENTRY_RECORD && value > lastSequence_) {
+        lastSequence_ = value;
+      } else if (type == ENTRY_ACK && value > ackedSequence_) {
+        ackedSequence_ = value;
+      } else if (type == ENTRY_DEAD) {
+        deadLetters_++;
+      }
+    }
+    file.close();
+  }
+
+  if (ackedSequence_ > lastSequence_) lastSequence_ = ackedSequence_;
+  size_ = validBytes;
+
+  if (!haveHeader) {
+    // Nothing usable: start a fresh journal under a new id
+    discardedBytes_ += fileSize;
+    fs.remove(path_);
+    size_ = 0;
+    lastSequence_ = 0;
+    ackedSequence_ = 0;
+    deadLetters_ = 0;
+    journalId_ = newJournalId;
+    return appendEntry(ENTRY_HEADER, &journalId_, sizeof(journalId_));
+  }
+
+  if (validBytes < fileSize) {
+    // Torn or corrupt tail; later appends must not land behind it
+    discardedBytes_ += fileSize - validBytes;
+    return rewrite(validBytes, false);
+  }
+  return true;
+}
+
+bool TransactionJournal::append(JournalRecord& record) {
+  if (!fs_) return false;
+  if (size_ + RECORD_ENTRY_BYTES > maxBytes_) return false;
+
+  record.sequence = lastSequence_ + 1;
+  if (!appendEntry(ENTRY_RECORD, &record, sizeof(record))) return false;
+  lastSequence_ = record.sequence;
+  return true;
+}
+
+size_t TransactionJournal::peek(JournalRecord* records, size_t maxRecords) {
+  if (!fs_ || pendingCount() == 0 || maxRecords == 0) return 0;
+
+  fs::File file = fs_->open(path_, FILE_READ);
+  if (!file || !file.seek(readOffset_)) return 0;
+
+  EntryType type;
+  uint8_t payload[255];
+  uint16_t length;
+  size_t found = 0;
+  size_t entryStart = file.position();
+  while (found < maxRecords && readEntry(file, type, payload, length)) {
+    if (type == ENTRY_RECORD && decodeRecord(payload, length, records[found])) {
+      JournalRecord& record = records[found];
+      if (record.sequence > ackedSequence_) {
+        if (found == 0) readOffset_ = entryStart;
+        found++;
+      }
+    }
+    entryStart = file.position();
+  }
+  if (found == 0) readOffset_ = entryStart;
+  return found;
+}
+
+bool TransactionJournal::acknowledge(uint32_t sequence) {
+  if (!fs_ || sequence > lastSequence_) return false;
+  if (sequence <= ackedSequence_) return true;
+
+  // Acks may exceed maxBytes_ - refusing them would wedge a full journal
+  if (!appendEntry(ENTRY_ACK, &sequence, sizeof(sequence))) return false;
+  ackedSequence_ = sequence;
+
+  size_t liveBytes = (pendingCount() + deadLetters_) * RECORD_ENTRY_BYTES;
+  if (size_ > liveBytes + compactBytes_) return rewrite(0, true);
+  return true;
+}
+
+// Exempt from maxBytes_ like an ack: the record it replaces is about to
+// be acknowledged, and compaction bounds how many are kept
+bool TransactionJournal::deadLetter(const JournalRecord& record) {
+  if (!fs_) return false;
+  if (!appendEntry(ENTRY_DEAD, &record, sizeof(record))) return false;
+  deadLetters_++;
+  return true;
+}
+
+// A record of any other length is not one this firmware wrote
+bool TransactionJournal::decodeRecord(const uint8_t* payload, uint16_t length, JournalRecord& record) {
+  if (length != sizeof(JournalRecord)) return false;
+  memcpy(&record, payload, length);
+  return true;
+}
+
+bool TransactionJournal::appendEntry(EntryType type, const void* payload, uint16_t length) {
+  fs::File file = fs_->open(path_, FILE_APPEND);
+  if (!file) return false;
+  size_t written = writeEntry(file, type, payload, static_cast<uint8_t>(length));
+  file.close();
+
+  if (!written) {
+    // A short write leaves a partial frame behind; cut it off now
+    rewrite(size_, false);
+    return false;
+  }
+  size_ += written;
+  return true;
+}
+
+bool TransactionJournal::readEntry(fs::File& file, EntryType& type, uint8_t* payload, uint16_t& length) {
+  uint8_t head[4];
+  if (file.read(head, sizeof(head)) != sizeof(head)) return false;
+  if ((head[0] | (head[1] << 8)) != ENTRY_MAGIC) return false;
+
+  type = static_cast<EntryType>(head[2]);
+  length = head[3];
+  if (file.read(payload, length) != length) return false;
+
+  uint32_t stored;
+  if (file.read(reinterpret_cast<uint8_t*>(&stored), sizeof(stored)) != sizeof(stored)) return false;
+  return crc32(payload, length, crc32(head, sizeof(head))) == stored;
+}
+
+// Write a replacement next to the journal, then swap it in. With
+// `compact` only the header, the ack cursor, pending records and the
+// latest dead letters are kept; otherwise the first `keepBytes` bytes are
+// copied verbatim.
+bool TransactionJournal::rewrite(size_t keepBytes, bool compact) {
+  char tmpPath[48];
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path_);
+
+  fs::File source = fs_->open(path_, FILE_READ);
+  fs::File target = fs_->open(tmpPath, FILE_WRITE);
+  if (!source || !target) return false;
+
+  size_t written = 0;
+  bool ok = true;
+  uint32_t deadLetters = deadLetters_;
+  if (compact) {
+    uint32_t dropDead = deadLetters > MAX_DEAD_LETTERS ? deadLetters - MAX_DEAD_LETTERS : 0;
+    deadLetters -= dropDead;
+    written += writeEntry(target, ENTRY_HEADER, &journalId_, sizeof(journalId_));
+    written += writeEntry(target, ENTRY_ACK, &ackedSequence_, sizeof(ackedSequence_));
+    EntryType type;
+    uint8_t payload[255];
+    uint16_t length;
+    while (ok && readEntry(source, type, payload, length)) {
+      JournalRecord record;
+      if (type != ENTRY_RECORD && type != ENTRY_DEAD) continue;
+      if (!decodeRecord(payload, length, record)) continue;
+      if (type == ENTRY_RECORD && record.sequence <= ackedSequence_) continue;
+      if (type == ENTRY_DEAD && dropDead > 0) {
+        dropDead--;
+        continue;
+      }
+      size_t n = writeEntry(target, type, &record, sizeof(record));
+      ok = n > 0;
+      written += n;
+    }
+    ok = ok && written >= 2 * ENTRY_OVERHEAD + 2 * sizeof(uint32_t);
+  } else {
+    uint8_t buffer[128];
+    while (ok && written < keepBytes) {
+      size_t chunk = keepBytes - written < sizeof(buffer) ? keepBytes - written : sizeof(buffer);
+      ok = source.read(buffer, chunk) == chunk && target.write(buffer, chunk) == chunk;
+      if (ok) written += chunk;
+    }
+  }
+  source.close();
+  target.close();
+
+  if (!ok) {
+    fs_->remove(tmpPath);
+    return false;
+  }
+  fs_->remove(path_);
+  if (!fs_->rename(tmpPath, path_)) return false;
+  size_ = written;
+  readOffset_ = 0;
+  deadLetters_ = deadLetters;
+  return true;
+}
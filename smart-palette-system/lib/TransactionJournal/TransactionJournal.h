@@ -0,0 +1,116 @@
+/*
+  TransactionJournal - append-only, CRC-protected flash journal
+
+  Completed transactions are appended before any attempt to send them and
+  only dropped once the server has acknowledged them, so a Wi-Fi outage
+  or a reboot never loses a record. Acknowledgements are appended to the
+  same file; on mount the journal is scanned to rebuild the pending set.
+
+  Every entry is framed as  magic | type | length | payload | CRC-32.
+  A torn tail (power lost mid-write) fails its CRC and is cut off on the
+  next mount. Once nothing is pending and the file has grown past its
+  compaction size it is rewritten down to a single header + ack.
+
+  Sequence numbers never repeat for a given journal id, so
+  "<journal id>-<sequence>" is a stable idempotency key for the server.
+
+  A record the server keeps rejecting can be set aside as a dead letter:
+  a copy stays in the file for inspection, and the record itself is then
+  acknowledged so it no longer holds back the ones behind it. Compaction
+  keeps the latest MAX_DEAD_LETTERS of them.
+
+  Not thread-safe: callers serialise access.
+
+  File: TransactionJournal.h
+*/
+
+#ifndef TRANSACTION_JOURNAL_H
+#define TRANSACTION_JOURNAL_H
+
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum JournalRecordType : uint8_t {
+  JOURNAL_LOAD = 1,
+  JOURNAL_UNLOAD = 2
+};
+
+struct JournalRecord {
+  uint32_t sequence;       // Assigned by append()
+  uint8_t type;            // JournalRecordType
+  char truckId[16];
+  int32_t bottleCount;
+  float weight;
+  float weightChange;
+  uint32_t timestamp;      // millis() when the transaction completed
+  float weightVariance;    // kg^2, of the settled weight estimate
+  uint16_t settleTime;     // ms from the completion tap to the capture
+  uint8_t settled;         // 0 if captured on the settle timeout
+  uint8_t faultyCells;     // Bit per load cell estimated during the transaction
+  uint8_t sku;             // Product counted, an index into STANDARD_SKUS
+  uint8_t countConfidence; // Percent
+  uint8_t countCheck;      // 1 if the count needs a check by hand
+  uint32_t bootId;         // Boot whose millis() clock `timestamp` is on
+};
+
+class TransactionJournal {
+public:
+  explicit TransactionJournal(const char* path = "/journal.bin", size_t maxBytes = 64 * 1024,
+                              size_t compactBytes = 8 * 1024);
+
+  // Mount on an already-begun filesystem. `newJournalId` is only used if
+  // no journal exists yet (pass a random value).
+  bool begin(fs::FS& fs, uint32_t newJournalId);
+
+  // Store a completed transaction; fills in record.sequence
+  bool append(JournalRecord& record);
+
+  // Oldest record not yet acknowledged
+  bool peek(JournalRecord& record) { return peek(&record, 1) == 1; }
+
+  // Up to `maxRecords` of the oldest unacknowledged records, in order
+  size_t peek(JournalRecord* records, size_t maxRecords);
+
+  // Mark everything up to and including `sequence` as delivered
+  bool acknowledge(uint32_t sequence);
+
+  // Keep a copy of a record the server will not take; acknowledge it next
+  bool deadLetter(const JournalRecord& record);
+
+  uint32_t journalId() const { return journalId_; }
+  uint32_t pendingCount() const { return lastSequence_ - ackedSequence_; }
+  uint32_t lastSequence() const { return lastSequence_; }
+  size_t sizeBytes() const { return size_; }
+  uint32_t discardedBytes() const { return discardedBytes_; }
+  uint32_t deadLetterCount() const { return deadLetters_; }
+
+  static const uint32_t MAX_DEAD_LETTERS = 16;
+
+private:
+  enum EntryType : uint8_t {
+    ENTRY_HEADER = 1,
+    ENTRY_RECORD = 2,
+    ENTRY_ACK = 3,
+    ENTRY_DEAD = 4
+  };
+
+  static bool decodeRecord(const uint8_t* payload, uint16_t length, JournalRecord& record);
+  bool appendEntry(EntryType type, const void* payload, uint16_t length);
+  bool readEntry(fs::File& file, EntryType& type, uint8_t* payload, uint16_t& length);
+  bool rewrite(size_t keepBytes, bool compact);
+
+  fs::FS* fs_ = nullptr;
+  const char* path_;
+  size_t maxBytes_;
+  size_t compactBytes_;
+  size_t size_ = 0;
+  size_t readOffset_ = 0;       // No unacknowledged record lies before this
+  uint32_t journalId_ = 0;
+  uint32_t lastSequence_ = 0;
+  uint32_t ackedSequence_ = 0;
+  uint32_t discardedBytes_ = 0;
+  uint32_t deadLetters_ = 0;
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*
+  TruckRegistry - NFC card UID to truck lookup, persisted to flash
+
+  File: TruckRegistry.cpp
+*/
+
+#include "TruckRegistry.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint32_t FILE_MAGIC = 0x314B5254;   // "TRK1"
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint16_t count;
+  uint16_t entrySize;
+};
+
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static uint32_t hashUid(const uint8_t* uid, uint8_t length) {
+  uint32_t hash = 2166136261u;
+  for (uint8_t i = 0; i < length; i++) {
+    hash ^= uid[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void copyText(char* target, size_t size, const char* source) {
+  strncpy(target, source ? source : "", size - 1);
+  target[size - 1] = '\0';
+}
+
+TruckRegistry::TruckRegistry(const char* path) : path_(path) {
+  clear();
+}
+
+bool TruckRegistry::begin(fs::FS& fs) {
+  fs_ = &fs;
+  clear();
+  dirty_ = false;
+
+  // Finish or discard a save that was interrupted by a reset
+  char tmpPath[48];
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path_);
+  if (fs.exists(tmpPath)) {
+    if (fs.exists(path_)) {
+      fs.remove(tmpPath);
+    } else {
+      fs.rename(tmpPath, path_);
+    }
+  }
+
+  fs::File file = fs.open(path_, FILE_READ);
+  if (!file) return false;
+
+  FileHeader header;
+  bool ok = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == FILE_MAGIC && header.entrySize == sizeof(TruckEntry) &&
+            header.count <= CAPACITY;
+  uint32_t crc = ok ? crc32(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) : 0;
+
+  for (uint16_t i = 0; ok && i < header.count; i++) {
+    TruckEntry entry;
+    ok = file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) == sizeof(entry);
+    if (!ok) break;
+    crc = crc32(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry), crc);
+    put(entry.uid, entry.uidLength, entry.truckId, entry.driverName);
+  }
+
+  uint32_t stored = 0;
+  ok = ok && file.read(reinterpret_cast<uint8_t*>(&stored), sizeof(stored)) == sizeof(stored) &&
+       stored == crc;
+  file.close();
+
+  if (!ok) {
+    clear();
+    return false;
+  }
+  version_ = header.version;
+  dirty_ = false;
+  return true;
+}
+
+bool TruckRegistry::save() {
+  if (!fs_) return false;
+
+  char tmpPath[48];
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path_);
+  fs::File file = fs_->open(tmpPath, FILE_WRITE);
+  if (!file) return false;
+
+  FileHeader header = {FILE_MAGIC, version_, static_cast<uint16_t>(count_), sizeof(TruckEntry)};
+  bool ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+  uint32_t crc = crc32(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+
+  for (size_t i = 0; ok && i < CAPACITY; i++) {
+    if (entries_[i].uidLength == 0) continue;
+    TruckEntry entry = entries_[i];
+    entry.flags = 0;
+    ok = file.write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry)) == sizeof(entry);
+    crc = crc32(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry), crc);
+  }
+  ok = ok && file.write(reinterpret_cast<const uint8_t*>(&crc), sizeof(crc)) == sizeof(crc);
+  file.close();
+
+  if (!ok) {
+    fs_->remove(tmpPath);
+    return false;
+  }
+  fs_->remove(path_);
+  if (!fs_->rename(tmpPath, path_)) return false;
+  dirty_ = false;
+  return true;
+}
+
+// Slot holding this UID, or the empty slot that ends its probe sequence
+size_t TruckRegistry::slotOf(const uint8_t* uid, uint8_t length) const {
+  size_t slot = hashUid(uid, length) & (INDEX_SLOTS - 1);
+  while (index_[slot] != EMPTY_SLOT) {
+    const TruckEntry& entry = entries_[index_[slot] - 1];
+    if (entry.uidLength == length && memcmp(entry.uid, uid, length) == 0) break;
+    slot = (slot + 1) & (INDEX_SLOTS - 1);
+  }
+  return slot;
+}
+
+int16_t TruckRegistry::find(const uint8_t* uid, uint8_t length) const {
+  if (length == 0 || length > UID_MAX_LENGTH) return -1;
+  size_t slot = slotOf(uid, length);
+  return index_[slot] == EMPTY_SLOT ? -1 : static_cast<int16_t>(index_[slot] - 1);
+}
+
+int16_t TruckRegistry::put(const uint8_t* uid, uint8_t length, const char* truckId, const char* driverName) {
+  if (length == 0 || length > UID_MAX_LENGTH || !truckId || truckId[0] == '\0') return -1;
+
+  size_t slot = slotOf(uid, length);
+  size_t handle;
+  if (index_[slot] != EMPTY_SLOT) {
+    handle = index_[slot] - 1;
+  } else {
+    if (count_ >= CAPACITY) return -1;
+    while (entries_[firstFree_].uidLength != 0) firstFree_++;
+    handle = firstFree_;
+    index_[slot] = static_cast<uint16_t>(handle + 1);
+    count_++;
+  }
+
+  TruckEntry& entry = entries_[handle];
+  memcpy(entry.uid, uid, length);
+  entry.uidLength = length;
+  entry.flags = 0;
+  copyText(entry.truckId, sizeof(entry.truckId), truckId);
+  copyText(entry.driverName, sizeof(entry.driverName), driverName);
+  dirty_ = true;
+  return static_cast<int16_t>(handle);
+}
+
+bool TruckRegistry::remove(const uint8_t* uid, uint8_t length) {
+  if (length == 0 || length > UID_MAX_LENGTH) return false;
+  size_t slot = slotOf(uid, length);
+  if (index_[slot] == EMPTY_SLOT) return false;
+  removeAt(slot);
+  return true;
+}
+
+// Free the entry behind `slot` and close the gap in its probe run, so
+// lookups never need tombstones
+void TruckRegistry::removeAt(size_t slot) {
+  size_t handle = index_[slot] - 1;
+  memset(&entries_[handle], 0, sizeof(TruckEntry));
+  if (handle < firstFree_) firstFree_ = handle;
+  count_--;
+  dirty_ = true;
+
+  size_t hole = slot;
+  size_t next = (slot + 1) & (INDEX_SLOTS - 1);
+  while (index_[next] != EMPTY_SLOT) {
+    const TruckEntry& entry = entries_[index_[next] - 1];
+    size_t home = hashUid(entry.uid, entry.uidLength) & (INDEX_SLOTS - 1);
+    // Move it back unless its home lies cyclically in (hole, next]
+    bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+    if (!stays) {
+      index_[hole] = index_[next];
+      hole = next;
+    }
+    next = (next + 1) & (INDEX_SLOTS - 1);
+  }
+  index_[hole] = EMPTY_SLOT;
+}
+
+void TruckRegistry::clear() {
+  memset(entries_, 0, sizeof(entries_));
+  memset(index_, 0, sizeof(index_));
+  if (count_ > 0) dirty_ = true;
+  count_ = 0;
+  firstFree_ = 0;
+}
+
+const TruckEntry* TruckRegistry::entry(int16_t handle) const {
+  if (handle < 0 || static_cast<size_t>(handle) >= CAPACITY) return nullptr;
+  return entries_[handle].uidLength ? &entries_[handle] : nullptr;
+}
+
+void TruckRegistry::beginUpdate() {
+  for (size_t i = 0; i < CAPACITY; i++) {
+    if (entries_[i].uidLength) entries_[i].flags |= FLAG_STALE;
+  }
+}
+
+void TruckRegistry::commitUpdate(uint32_t version) {
+  for (size_t i = 0; i < CAPACITY; i++) {
+    if (entries_[i].uidLength && (entries_[i].flags & FLAG_STALE)) {
+      removeAt(slotOf(entries_[i].uid, entries_[i].uidLength));
+    }
+  }
+  if (version != version_) dirty_ = true;
+  version_ = version;
+}
+
+void TruckRegistry::abortUpdate() {
+  for (size_t i = 0; i < CAPACITY; i++) entries_[i].flags &= ~FLAG_STALE;
+}
+
+bool TruckRegistry::parseUid(const char* text, uint8_t* uid, uint8_t& length) {
+  length = 0;
+  while (*text) {
+    if (*text == ':' || *text == ' ') {
+      text++;
+      continue;
+    }
+    char hex[3] = {text[0], text[1], '\0'};
+    char* end;
+    unsigned long value = strtoul(hex, &end, 16);
+    if (end != hex + 2 || length >= UID_MAX_LENGTH) return false;
+    uid[length++] = static_cast<uint8_t>(value);
+    text += 2;
+  }
+  return length > 0;
+}
+
+void TruckRegistry::formatUid(const uint8_t* uid, uint8_t length, char* buffer, size_t size) {
+  size_t used = 0;
+  buffer[0] = '\0';
+  for (uint8_t i = 0; i < length && used < size; i++) {
+    int n = snprintf(buffer + used, size - used, i > 0 ? ":%02X" : "%02X", uid[i]);
+    if (n < 0) break;
+    used += n;
+  }
+}
@@ -0,0 +1,93 @@
+/*
+  TruckRegistry - NFC card UID to truck lookup, persisted to flash
+
+  Trucks live in a fixed pool of entries; an open-addressed index
+  (FNV-1a over the raw UID bytes, linear probing, at most 75% full) maps
+  a UID to its entry, so a lookup costs the same for three trucks or
+  three hundred. An entry never moves while it is registered: its pool
+  position is the handle the rest of the firmware keeps instead of a
+  copy of the truck ID.
+
+  The registry is saved as one CRC-32 checked snapshot, written to a
+  temporary file and renamed over the old one, so a reset mid-save
+  leaves the previous fleet in place.
+
+  A full fleet download is applied as beginUpdate() / put()... /
+  commitUpdate(): trucks missing from the download are removed only on
+  commit, so an interrupted download never drops anyone.
+
+  Not thread-safe: callers serialise access.
+
+  File: TruckRegistry.h
+*/
+
+#ifndef TRUCK_REGISTRY_H
+#define TRUCK_REGISTRY_H
+
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct TruckEntry {
+  uint8_t uid[10];
+  uint8_t uidLength;           // 0 = free
+  uint8_t flags;
+  char truckId[16];
+  char driverName[20];
+};
+
+class TruckRegistry {
+public:
+  static const size_t CAPACITY = 384;
+  static const size_t INDEX_SLOTS = 512;   // Power of two, >= CAPACITY / 0.75
+  static const size_t UID_MAX_LENGTH = sizeof(TruckEntry::uid);
+
+  explicit TruckRegistry(const char* path = "/trucks.bin");
+
+  // Load the saved fleet from an already-begun filesystem. Returns false
+  // (and leaves the registry empty) if there is none or it is corrupt.
+  bool begin(fs::FS& fs);
+  bool save();
+
+  // Handle of the truck with this card, or -1
+  int16_t find(const uint8_t* uid, uint8_t length) const;
+
+  // Add a truck or update the one holding this card. Returns its handle,
+  // or -1 if the registry is full or the arguments are invalid.
+  int16_t put(const uint8_t* uid, uint8_t length, const char* truckId, const char* driverName);
+  bool remove(const uint8_t* uid, uint8_t length);
+  void clear();
+
+  // nullptr for a handle that is not registered
+  const TruckEntry* entry(int16_t handle) const;
+
+  size_t count() const { return count_; }
+  uint32_t version() const { return version_; }
+  bool dirty() const { return dirty_; }
+
+  void beginUpdate();
+  void commitUpdate(uint32_t version);
+  void abortUpdate();
+
+  // "04:52:F3:2A" or "0452F32A"
+  static bool parseUid(const char* text, uint8_t* uid, uint8_t& length);
+  static void formatUid(const uint8_t* uid, uint8_t length, char* buffer, size_t size);
+
+private:
+  static const uint16_t EMPTY_SLOT = 0;    // Index slots hold handle + 1
+  static const uint8_t FLAG_STALE = 0x01;
+
+  size_t slotOf(const uint8_t* uid, uint8_t length) const;
+  void removeAt(size_t slot);
+
+  fs::FS* fs_ = nullptr;
+  const char* path_;
+  TruckEntry entries_[CAPACITY];
+  uint16_t index_[INDEX_SLOTS];
+  size_t count_ = 0;
+  size_t firstFree_ = 0;         // No free entry lies before this
+  uint32_t version_ = 0;
+  bool dirty_ = false;
+};
+
+#endif
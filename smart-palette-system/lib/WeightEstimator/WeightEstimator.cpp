@@ -0,0 +1,79 @@
+/*
+  WeightEstimator - adaptive Kalman filter for the pallet weight
+
+  File: WeightEstimator.cpp
+*/
+
+#include "WeightEstimator.h"
+#include <math.h>
+
+WeightEstimator::WeightEstimator(float noiseKg, float settleKg, uint32_t quietMs)
+    : noiseVar_(noiseKg * noiseKg), settleKg_(settleKg), quietMs_(quietMs) {}
+
+void WeightEstimator::reset() {
+  count_ = 0;
+  weight_ = 0;
+  rate_ = 0;
+  pWeight_ = 0;
+  pCross_ = 0;
+  pRate_ = 0;
+  fit_ = 1;
+  settled_ = false;
+}
+
+bool WeightEstimator::add(float sample, uint32_t atMs) {
+  if (count_ == 0) {
+    count_ = 1;
+    weight_ = sample;
+    rate_ = 0;
+    pWeight_ = noiseVar_;
+    pCross_ = 0;
+    pRate_ = STEP_RATE_SD * STEP_RATE_SD;
+    lastMs_ = atMs;
+    steppedAtMs_ = atMs;
+    settled_ = false;
+    return true;
+  }
+
+  // Predict. Samples sharing a millisecond still get a sliver of time.
+  uint32_t elapsedMs = atMs - lastMs_;
+  float dt = (elapsedMs > 0 ? elapsedMs : 1) / 1000.0f;
+  lastMs_ = atMs;
+  weight_ += rate_ * dt;
+  float q = QUIET_RATE_NOISE * QUIET_RATE_NOISE;
+  pWeight_ += dt * (2 * pCross_ + dt * pRate_) + q * dt * dt * dt / 3;
+  pCross_ += dt * pRate_ + q * dt * dt / 2;
+  pRate_ += q * dt;
+
+  // A sample outside the gate: the load has moved, forget the old level
+  float innovation = sample - weight_;
+  float spread = pWeight_ + noiseVar_;
+  bool step = innovation * innovation > GATE_SD * GATE_SD * spread;
+  if (step) {
+    pWeight_ += innovation * innovation;
+    pRate_ += STEP_RATE_SD * STEP_RATE_SD;
+    spread = pWeight_ + noiseVar_;
+    steppedAtMs_ = atMs;
+    steps_++;
+    fit_ = 1;
+  } else {
+    fit_ += (innovation * innovation / spread - fit_) / FIT_SAMPLES;
+  }
+
+  // Update
+  float gainWeight = pWeight_ / spread;
+  float gainRate = pCross_ / spread;
+  weight_ += gainWeight * innovation;
+  rate_ += gainRate * innovation;
+  pRate_ -= gainRate * pCross_;
+  pCross_ -= gainWeight * pCross_;
+  pWeight_ -= gainWeight * pWeight_;
+  count_++;
+
+  float horizon = quietMs_ / 1000.0f;
+  bool settled = atMs - steppedAtMs_ >= quietMs_ && pWeight_ < settleKg_ * settleKg_ &&
+                 fabsf(rate_) * horizon < settleKg_ && fit_ < MAX_FIT;
+  if (settled && !settled_) settledAtMs_ = atMs;
+  settled_ = settled;
+  return step;
+}
@@ -0,0 +1,94 @@
+/*
+  WeightEstimator - adaptive Kalman filter for the pallet weight
+
+  Tracks the weight and its rate of change (kg/s) with a constant-rate
+  model, one predict/update per sample, and keeps the variance of the
+  weight estimate. At rest the process noise is small, so the estimate
+  averages every sample since the load last moved, much as a plateau
+  mean does, and its uncertainty shrinks as the samples come in.
+
+  A sample further from the prediction than GATE_SD standard deviations
+  of the innovation is taken as a step: a crate put down or lifted off,
+  or the ringing after it. The weight's variance is then widened by the
+  innovation, so the estimate jumps to the new level in a sample or two
+  instead of averaging its way across, and the rate is freed to follow
+  the ringing. Once the samples fall back inside the gate the filter
+  tightens again on its own.
+
+  The estimate is settled once no step has been seen for `quietMs`,
+  its standard deviation is under `settleKg`, the rate would not move
+  it by more than `settleKg` over another `quietMs`, and the recent
+  innovations are no larger than the model expects. That takes a few
+  samples once the ringing has died away, where a plateau or a boxcar
+  window needs its full length.
+
+  Times are whatever millisecond clock the caller passes in; only
+  differences are used, so wrap-around is harmless.
+
+  File: WeightEstimator.h
+*/
+
+#ifndef WEIGHT_ESTIMATOR_H
+#define WEIGHT_ESTIMATOR_H
+
+#include <stdint.h>
+
+class WeightEstimator {
+public:
+  static constexpr float GATE_SD = 3.0f;
+  // Process noise at rest, as a rate random walk: the weight of a load
+  // at rest only creeps (temperature, a settling pallet)
+  static constexpr float QUIET_RATE_NOISE = 0.001f;   // kg/s per sqrt(s)
+  // Rate uncertainty after a step: the ringing of a dropped crate
+  static constexpr float STEP_RATE_SD = 5.0f;         // kg/s
+  // Innovations at rest average one variance of their own; ringing too
+  // small to trip the gate keeps the average up and holds off settling
+  static constexpr float FIT_SAMPLES = 8;
+  static constexpr float MAX_FIT = 2;
+
+  // `noiseKg`: standard deviation of one sample at rest.
+  // `settleKg`: uncertainty below which the estimate counts as settled.
+  WeightEstimator(float noiseKg, float settleKg, uint32_t quietMs);
+  // For arrays; assign a configured estimator before use
+  WeightEstimator() : WeightEstimator(0.01f, 0.01f, 100) {}
+
+  void reset();
+
+  // Returns true if this sample was taken as a step
+  bool add(float sample, uint32_t atMs);
+
+  float weight() const { return weight_; }
+  float rate() const { return rate_; }
+  // Of the weight estimate, kg^2
+  float variance() const { return pWeight_; }
+  uint32_t count() const { return count_; }
+
+  bool isSettled() const { return settled_; }
+  // Sample at which the estimate last settled (if settled)
+  uint32_t settledAt() const { return settledAtMs_; }
+  // Last sample taken as a step
+  uint32_t steppedAt() const { return steppedAtMs_; }
+
+  uint32_t steps() const { return steps_; }
+
+private:
+  float noiseVar_;
+  float settleKg_;
+  uint32_t quietMs_;
+
+  uint32_t count_ = 0;
+  float weight_ = 0;
+  float rate_ = 0;
+  // Covariance of (weight, rate)
+  float pWeight_ = 0;
+  float pCross_ = 0;
+  float pRate_ = 0;
+  float fit_ = 1;
+  uint32_t lastMs_ = 0;
+  bool settled_ = false;
+  uint32_t settledAtMs_ = 0;
+  uint32_t steppedAtMs_ = 0;
+  uint32_t steps_ = 0;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+  WeightFilter - sliding-window mean and stability detector
+
+  File: WeightFilter.cpp
+*/
+
+#include "WeightFilter.h"
+
+WeightFilter::WeightFilter(size_t windowSize) {
+  resize(windowSize);
+}
+
+WeightFilter::~WeightFilter() {
+  delete[] samples_;
+  delete[] minDq_.seq;
+  delete[] maxDq_.seq;
+}
+
+bool WeightFilter::resize(size_t windowSize) {
+  if (windowSize == 0) return false;
+  if (windowSize != window_) {
+    int32_t* samples = new int32_t[windowSize];
+    uint32_t* minSeq = new uint32_t[windowSize];
+    uint32_t* maxSeq = new uint32_t[windowSize];
+    delete[] samples_;
+    delete[] minDq_.seq;
+    delete[] maxDq_.seq;
+    samples_ = samples;
+    minDq_.seq = minSeq;
+    maxDq_.seq = maxSeq;
+    window_ = windowSize;
+  }
+  reset();
+  return true;
+}
+
+void WeightFilter::reset() {
+  count_ = 0;
+  nextSeq_ = 0;
+  sum_ = 0;
+  minDq_.head = minDq_.size = 0;
+  maxDq_.head = maxDq_.size = 0;
+}
+
+void WeightFilter::add(int32_t sample) {
+  uint32_t seq = nextSeq_++;
+
+  // Sequence numbers wrap after 2^32 samples; restart the window cleanly
+  // rather than let modulo arithmetic alias old slots
+  if (nextSeq_ == 0) {
+    reset();
+    seq = nextSeq_++;
+  }
+
+  if (count_ == window_) {
+    sum_ -= valueAt(seq - window_);
+  } else {
+    count_++;
+  }
+  samples_[seq % window_] = sample;
+  sum_ += sample;
+
+  uint32_t oldest = seq + 1 - static_cast<uint32_t>(count_);
+  expire(minDq_, oldest);
+  expire(maxDq_, oldest);
+  pushMin(seq, sample);
+  pushMax(seq, sample);
+}
+
+void WeightFilter::expire(MonoDeque& dq, uint32_t oldestSeq) {
+  while (dq.size > 0 && front(dq) < oldestSeq) {
+    dq.head = (dq.head + 1) % window_;
+    dq.size--;
+  }
+}
+
+void WeightFilter::pushMin(uint32_t seq, int32_t value) {
+  while (minDq_.size > 0 && valueAt(back(minDq_)) >= value) minDq_.size--;
+  minDq_.seq[(minDq_.head + minDq_.size) % window_] = seq;
+  minDq_.size++;
+}
+
+void WeightFilter::pushMax(uint32_t seq, int32_t value) {
+  while (maxDq_.size > 0 && valueAt(back(maxDq_)) <= value) maxDq_.size--;
+  maxDq_.seq[(maxDq_.head + maxDq_.size) % window_] = seq;
+  maxDq_.size++;
+}
+
+int32_t WeightFilter::mean() const {
+  if (count_ == 0) return 0;
+  int64_t n = static_cast<int64_t>(count_);
+  int64_t half = sum_ < 0 ? -n / 2 : n / 2;
+  return static_cast<int32_t>((sum_ + half) / n);
+}
+
+int32_t WeightFilter::minimum() const {
+  return minDq_.size > 0 ? valueAt(front(minDq_)) : 0;
+}
+
+int32_t WeightFilter::maximum() const {
+  return maxDq_.size > 0 ? valueAt(front(maxDq_)) : 0;
+}
+
+int32_t WeightFilter::maxDeviation() const {
+  if (count_ == 0) return 0;
+  int32_t m = mean();
+  int32_t above = maximum() - m;
+  int32_t below = m - minimum();
+  return above > below ? above : below;
+}
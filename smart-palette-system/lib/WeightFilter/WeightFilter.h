@@ -0,0 +1,80 @@
+/*
+  WeightFilter - sliding-window mean and spread
+
+  Keeps a running sum plus monotonic min/max deques over the last N
+  samples, so adding a sample and reading the mean or the spread all
+  cost O(1) regardless of the window size.
+
+  Samples are integers: raw HX711 counts, or a weight in fixed point
+  (smart-palette-system uses units of 10 mg). The 64-bit sum is exact,
+  so the window adds no rounding of its own to drift and needs no
+  soft-float double on the ESP32. It is only as exact as its input: a
+  weight that went through float arithmetic before it was quantised
+  (calibration curves, cell fusion) can differ in the last unit between
+  the host build and the chip. Convert to kilograms when the result is
+  shown or sent, not per sample.
+
+  Whether the weight is at rest is not decided here; WeightEstimator
+  does that. The window supplies the weight shown while the load moves,
+  and maxDeviation(), max(max - mean, mean - min), stands in for the
+  noise until the estimate has settled.
+
+  File: WeightFilter.h
+*/
+
+#ifndef WEIGHT_FILTER_H
+#define WEIGHT_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class WeightFilter {
+public:
+  explicit WeightFilter(size_t windowSize = 10);
+  ~WeightFilter();
+
+  WeightFilter(const WeightFilter&) = delete;
+  WeightFilter& operator=(const WeightFilter&) = delete;
+
+  // Change the window length; drops all samples. Allocates, so call it
+  // at startup or on reconfiguration, never per sample.
+  bool resize(size_t windowSize);
+  void reset();
+
+  void add(int32_t sample);
+
+  bool isFull() const { return count_ == window_; }
+  size_t count() const { return count_; }
+  size_t windowSize() const { return window_; }
+
+  // Rounded to the nearest integer, halves away from zero
+  int32_t mean() const;
+  int32_t minimum() const;
+  int32_t maximum() const;
+  int32_t maxDeviation() const;
+
+private:
+  // Index deque over sample sequence numbers, stored as a ring
+  struct MonoDeque {
+    uint32_t* seq;
+    size_t head;
+    size_t size;
+  };
+
+  int32_t valueAt(uint32_t seq) const { return samples_[seq % window_]; }
+  void pushMin(uint32_t seq, int32_t value);
+  void pushMax(uint32_t seq, int32_t value);
+  void expire(MonoDeque& dq, uint32_t oldestSeq);
+  uint32_t front(const MonoDeque& dq) const { return dq.seq[dq.head]; }
+  uint32_t back(const MonoDeque& dq) const { return dq.seq[(dq.head + dq.size - 1) % window_]; }
+
+  size_t window_ = 0;
+  size_t count_ = 0;
+  uint32_t nextSeq_ = 0;
+  int64_t sum_ = 0;
+  int32_t* samples_ = nullptr;
+  MonoDeque minDq_ = {nullptr, 0, 0};
+  MonoDeque maxDq_ = {nullptr, 0, 0};
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+  Native simulator - Adafruit GFX
+
+  Pixel-level drawing primitives and a fixed 6x8 text cell renderer. The
+  glyph bitmaps are synthetic (deterministic per character) rather than a
+  real font: the point is realistic per-pixel cost, not legibility.
+*/
+
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : width_(w), height_(h) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size);
+
+  void setCursor(int16_t x, int16_t y) { cursorX_ = x; cursorY_ = y; }
+  void setTextSize(uint8_t size) { textSize_ = size > 0 ? size : 1; }
+  void setTextColor(uint16_t c) { textColor_ = c; textBg_ = c; }
+  void setTextColor(uint16_t c, uint16_t bg) { textColor_ = c; textBg_ = bg; }
+  void setTextWrap(bool wrap) { wrap_ = wrap; }
+  int16_t getCursorX() const { return cursorX_; }
+  int16_t getCursorY() const { return cursorY_; }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+protected:
+  int16_t width_;
+  int16_t height_;
+  int16_t cursorX_ = 0;
+  int16_t cursorY_ = 0;
+  uint8_t textSize_ = 1;
+  uint16_t textColor_ = 0xFFFF;
+  uint16_t textBg_ = 0xFFFF;
+  bool wrap_ = true;
+};
+
+#endif
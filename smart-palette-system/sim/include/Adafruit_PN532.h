@@ -0,0 +1,35 @@
+/*
+  Native simulator - PN532 NFC reader
+
+  Mirrors the Adafruit_PN532 I2C API. Card taps are scripted by the
+  harness (time, UID and how long the card stays in the field). The IRQ
+  pin falls when an armed detection finds a card. Unlike the real driver
+  a blocking poll with no card in the field returns immediately.
+*/
+
+#ifndef SIM_ADAFRUIT_PN532_H
+#define SIM_ADAFRUIT_PN532_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define PN532_MIFARE_ISO14443A (0x00)
+
+class Adafruit_PN532 {
+public:
+  Adafruit_PN532(uint8_t irq, uint8_t reset, TwoWire* theWire = &Wire);
+
+  bool begin();
+  uint32_t getFirmwareVersion();
+  bool SAMConfig();
+  bool readPassiveTargetID(uint8_t cardbaudrate, uint8_t* uid, uint8_t* uidLength, uint16_t timeout = 0);
+  bool startPassiveTargetIDDetection(uint8_t cardbaudrate);
+  bool readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength);
+
+private:
+  uint8_t irq_;
+  uint8_t reset_;
+  TwoWire* wire_;
+};
+
+#endif
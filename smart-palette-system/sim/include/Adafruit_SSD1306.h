@@ -0,0 +1,40 @@
+/*
+  Native simulator - SSD1306 OLED
+
+  Framebuffer-only display: drawing lands in the same 1 KB page-organised
+  buffer layout as the real driver, and display() accounts the I2C bytes
+  a full frame push would cost instead of talking to a panel.
+*/
+
+#ifndef SIM_ADAFRUIT_SSD1306_H
+#define SIM_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK   0
+#define SSD1306_WHITE   1
+#define SSD1306_INVERSE 2
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC  0x01
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi = &Wire, int8_t rst_pin = -1);
+  ~Adafruit_SSD1306() override;
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0, bool reset = true, bool periphBegin = true);
+  void display();
+  void clearDisplay();
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y);
+  uint8_t* getBuffer() { return buffer_; }
+
+private:
+  TwoWire* wire_;
+  uint8_t* buffer_ = nullptr;
+  uint8_t address_ = 0;
+};
+
+#endif
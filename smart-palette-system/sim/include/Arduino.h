@@ -0,0 +1,144 @@
+/*
+  Native simulator - Arduino core
+
+  Minimal host implementation of the Arduino-ESP32 core used by the
+  firmware: virtual clock, GPIO, Print/Stream, Serial and ESP. Time only
+  advances when the firmware (or the harness) waits, so a run is fully
+  deterministic and executes as fast as the host allows.
+*/
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+#include "WString.h"
+
+using std::abs;
+using std::min;
+using std::max;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define digitalPinToInterrupt(p) (p)
+
+// ============================================================================
+// TIMING AND GPIO
+// ============================================================================
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// ISRs run synchronously at the virtual time of the edge that raised them
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// Hardware RNG on the chip; a fixed-seed generator here so runs repeat
+uint32_t esp_random();
+
+// Die temperature in degrees C; set by the harness (sim::setDieTemperature)
+float temperatureRead();
+
+// ============================================================================
+// PRINT / STREAM
+// ============================================================================
+class Print {
+public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str);
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(int value, int base = DEC) { return print(String(value, static_cast<unsigned char>(base))); }
+  size_t print(unsigned int value, int base = DEC) { return print(String(value, static_cast<unsigned char>(base))); }
+  size_t print(long value, int base = DEC) { return print(String(value, static_cast<unsigned char>(base))); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, static_cast<unsigned char>(base))); }
+  size_t print(double value, int digits = 2) { return print(String(value, static_cast<unsigned int>(digits))); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+  long parseInt();
+  float parseFloat();
+  String readStringUntil(char terminator);
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+
+protected:
+  unsigned long timeoutMs_ = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { baud_ = baud; }
+  void end() {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() {}
+  operator bool() const { return true; }
+
+private:
+  unsigned long baud_ = 0;
+};
+
+extern HardwareSerial Serial;
+
+// ============================================================================
+// ESP SYSTEM INFO
+// ============================================================================
+class EspClass {
+public:
+  const char* getChipModel() { return "ESP32-SIM"; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount();
+  uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  void restart();
+};
+
+extern EspClass ESP;
+
+#endif
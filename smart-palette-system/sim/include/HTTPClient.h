@@ -0,0 +1,46 @@
+/*
+  Native simulator - HTTP client
+
+  Requests are never sent; the harness chooses the response code (and
+  the body returned to GETs) and can inspect what the firmware posted
+  through SimControl.h. Each request
+  blocks the caller for a round trip, plus a TLS handshake whenever the
+  connection cannot be reused.
+*/
+
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient {
+public:
+  bool begin(const String& url);
+  bool begin(WiFiClient& client, const String& url);
+  void end();
+  void setReuse(bool reuse) { reuse_ = reuse; }
+  void setTimeout(uint16_t timeoutMs) { timeoutMs_ = timeoutMs; }
+  void useHTTP10(bool http10) { http10_ = http10; }
+  void addHeader(const String& name, const String& value);
+  int POST(const String& payload);
+  int POST(const uint8_t* payload, size_t size);
+  int GET();
+  int getSize();
+  WiFiClient* getStreamPtr() { return client_; }
+  String getString();
+
+private:
+  bool connect();
+
+  WiFiClient ownClient_;
+  WiFiClient* client_ = &ownClient_;
+  String url_;
+  bool reuse_ = true;
+  bool http10_ = false;
+  uint16_t timeoutMs_ = 5000;
+};
+
+#endif
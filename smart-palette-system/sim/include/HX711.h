@@ -0,0 +1,46 @@
+/*
+  Native simulator - HX711 load cell ADC
+
+  Mirrors the bogde/HX711 API. Each instance binds to the trace that the
+  harness loaded for its DOUT pin and replays it at the configured sample
+  rate on the virtual clock: is_ready() reports whether a new conversion
+  is due, read() waits for the next one like the real chip does. The same
+  channel can also be bit-banged directly through digitalWrite(SCK) /
+  digitalRead(DOUT), and raises DOUT falling-edge interrupts.
+*/
+
+#ifndef SIM_HX711_H
+#define SIM_HX711_H
+
+#include <Arduino.h>
+
+class HX711 {
+public:
+  void begin(uint8_t dout, uint8_t pd_sck, uint8_t gain = 128);
+  bool is_ready();
+  void wait_ready(unsigned long delay_ms = 0);
+  bool wait_ready_timeout(unsigned long timeout = 1000, unsigned long delay_ms = 0);
+  void set_gain(uint8_t gain = 128) { gain_ = gain; }
+
+  long read();
+  long read_average(uint8_t times = 10);
+  double get_value(uint8_t times = 1);
+  float get_units(uint8_t times = 1);
+  void tare(uint8_t times = 10);
+
+  void set_scale(float scale = 1.f) { scale_ = scale; }
+  float get_scale() { return scale_; }
+  void set_offset(long offset = 0) { offset_ = offset; }
+  long get_offset() { return offset_; }
+
+  void power_down();
+  void power_up();
+
+private:
+  uint8_t dout_ = 0;
+  uint8_t gain_ = 128;
+  long offset_ = 0;
+  float scale_ = 1.f;
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+  Native simulator - LittleFS
+
+  Mounts an in-memory volume that starts empty on every run.
+*/
+
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <FS.h>
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+             const char* partitionLabel = "spiffs");
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+  void end() { mounted_ = false; }
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,49 @@
+/*
+  Native simulator - Preferences (NVS key/value store)
+
+  Mirrors the Arduino-ESP32 Preferences API over an in-memory NVS that
+  starts empty on every run. Writes cost virtual time like an NVS commit
+  to flash.
+*/
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
+  void end();
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putBytes(const char* key, const void* value, size_t length);
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buffer, size_t maxLength);
+
+  size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0);
+  size_t putFloat(const char* key, float value) { return putBytes(key, &value, sizeof(value)); }
+  float getFloat(const char* key, float defaultValue = 0);
+  // Stored with the terminator, as on the device
+  size_t putString(const char* key, const char* value) { return putBytes(key, value, strlen(value) + 1); }
+  size_t getString(const char* key, char* value, size_t maxLength) {
+    size_t length = getBytesLength(key);
+    return length && length <= maxLength ? getBytes(key, value, maxLength) : 0;
+  }
+
+private:
+  std::string namespace_;
+  bool open_ = false;
+  bool readOnly_ = true;
+};
+
+#endif
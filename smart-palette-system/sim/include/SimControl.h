@@ -0,0 +1,108 @@
+/*
+  Native simulator - harness control surface
+
+  Everything a host harness needs to script the simulated hardware and
+  read back what the firmware did. Not available in the ESP32 build.
+*/
+
+#ifndef SIM_CONTROL_H
+#define SIM_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// Virtual clock. advance*() models busy CPU time in the running task;
+// sleepMicros() blocks it and lets other tasks run in the meantime.
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+void advanceMillis(uint32_t ms);
+void sleepMicros(uint64_t us);
+
+// Let the firmware's tasks run for `ms` of virtual time
+void runFor(uint32_t ms);
+
+// Serial: echo firmware output to stdout (default on), feed input bytes
+void setSerialEcho(bool enabled);
+void serialInput(const char* text);
+
+// Chip temperature returned by temperatureRead() (default 40 C)
+void setDieTemperature(float celsius);
+
+// GPIO. Level changes on watched pins are logged with their time.
+int pinLevel(uint8_t pin);
+void watchPin(uint8_t pin);
+struct PinEdge {
+  uint64_t atMicros;
+  int level;
+};
+const std::vector<PinEdge>& pinEdges(uint8_t pin);
+
+// HX711: replay raw 24-bit counts on the channel wired to doutPin/sckPin
+void loadHx711Trace(uint8_t doutPin, uint8_t sckPin, const std::vector<long>& rawCounts,
+                    uint32_t samplePeriodUs = 12500);
+// A disconnected channel holds DOUT high: no conversions, no edges
+void setHx711Connected(uint8_t doutPin, bool connected);
+size_t hx711SamplesRead(uint8_t doutPin);
+size_t hx711SamplesMissed(uint8_t doutPin);
+uint64_t hx711PoweredDownMicros(uint8_t doutPin);   // Time spent with SCK held high
+
+// PN532: a card with `uid` enters the field at `atMillis` and stays for
+// `holdMillis`. Taps are missed if no read finds the card meanwhile.
+void scheduleNfcTap(uint32_t atMillis, const std::vector<uint8_t>& uid, uint32_t holdMillis = 400);
+size_t pendingNfcTaps();
+size_t missedNfcTaps();
+size_t nfcTargetsRead();
+
+// I2C: payload bytes written to the device at `address`
+size_t i2cBytesWritten(uint8_t address);
+
+// SSD1306: full frames pushed by display(), and every byte sent to the
+// panel including partial updates written straight over Wire
+struct DisplayStats {
+  size_t frames;
+  size_t bytesPushed;
+};
+DisplayStats displayStats();
+
+// Network
+void setWifiConnected(bool connected);
+void setHttpResponseCode(int code);
+size_t httpRequestCount();
+size_t httpHandshakeCount();
+size_t httpBytesPosted();
+const std::string& lastHttpPayload();
+const std::string& lastHttpUrl();
+std::string lastHttpHeader(const char* name);
+void setHttpGetResponse(int code, const std::string& body);
+// A 2xx to a POST answers each "idempotency_key" in its body: "stored"
+// the first time, "duplicate" after, and "rejected" for keys ending in
+// a suffix given here
+void rejectIdempotencyKeys(const std::string& suffix);
+size_t httpGetCount();
+
+// Scripted endpoints: requests to a URL starting with `urlPrefix` go to
+// the handler instead of the fixed responses above, and are left out of
+// the request counts and last-payload record
+typedef std::function<int(const std::string& url, std::string& response)> HttpGetHandler;
+typedef std::function<int(const std::string& url, const std::string& body)> HttpPostHandler;
+void setHttpGetHandler(const char* urlPrefix, HttpGetHandler handler);
+void setHttpPostHandler(const char* urlPrefix, HttpPostHandler handler);
+
+// FreeRTOS: tasks registered by setup(), and the host CPU time each one
+// consumed between being scheduled and blocking again
+struct TaskStats {
+  const char* name;
+  uint64_t activations;
+  uint64_t hostNanos;
+};
+size_t registeredTaskCount();
+std::vector<TaskStats> taskStats();
+
+}  // namespace sim
+
+#endif
@@ -0,0 +1,101 @@
+/*
+  Native simulator - Arduino String
+
+  Host-side stand-in for the Arduino core String class, backed by
+  std::string. Only the subset used by the firmware is provided.
+*/
+
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String {
+public:
+  String() = default;
+  String(const char* s) : str_(s ? s : "") {}
+  String(const std::string& s) : str_(s) {}
+  explicit String(char c) : str_(1, c) {}
+  String(int value, unsigned char base = DEC) : str_(formatSigned(value, base)) {}
+  String(unsigned int value, unsigned char base = DEC) : str_(formatInteger(value, base, false)) {}
+  String(long value, unsigned char base = DEC) : str_(formatSigned(value, base)) {}
+  String(unsigned long value, unsigned char base = DEC) : str_(formatInteger(value, base, false)) {}
+  String(unsigned char value, unsigned char base = DEC) : str_(formatInteger(value, base, false)) {}
+  String(float value, unsigned int decimals = 2) : str_(formatFloat(value, decimals)) {}
+  String(double value, unsigned int decimals = 2) : str_(formatFloat(value, decimals)) {}
+
+  const char* c_str() const { return str_.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(str_.size()); }
+  bool isEmpty() const { return str_.empty(); }
+  bool reserve(unsigned int size) { str_.reserve(size); return true; }
+
+  char charAt(unsigned int index) const { return index < str_.size() ? str_[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  bool concat(const String& s) { str_ += s.str_; return true; }
+  bool concat(const char* s) { if (s) str_ += s; return true; }
+  bool concat(char c) { str_ += c; return true; }
+
+  String& operator+=(const String& s) { str_ += s.str_; return *this; }
+  String& operator+=(const char* s) { if (s) str_ += s; return *this; }
+  String& operator+=(char c) { str_ += c; return *this; }
+  String& operator+=(int value) { str_ += String(value).str_; return *this; }
+  String& operator+=(unsigned long value) { str_ += String(value).str_; return *this; }
+
+  friend String operator+(const String& a, const String& b) { return String(a.str_ + b.str_); }
+  friend String operator+(const String& a, const char* b) { return String(a.str_ + (b ? b : "")); }
+  friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.str_); }
+
+  bool equals(const String& s) const { return str_ == s.str_; }
+  bool operator==(const String& s) const { return str_ == s.str_; }
+  bool operator==(const char* s) const { return str_ == (s ? s : ""); }
+  bool operator!=(const String& s) const { return str_ != s.str_; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+  bool operator<(const String& s) const { return str_ < s.str_; }
+
+  bool startsWith(const String& prefix) const { return str_.compare(0, prefix.str_.size(), prefix.str_) == 0; }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t pos = str_.find(c, from);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+  }
+  String substring(unsigned int from) const { return from < str_.size() ? String(str_.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from >= str_.size() || to <= from) return String();
+    return String(str_.substr(from, to - from));
+  }
+
+  void toUpperCase() { for (auto& c : str_) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c))); }
+  void toLowerCase() { for (auto& c : str_) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+  void trim() {
+    size_t begin = str_.find_first_not_of(" \t\r\n");
+    size_t end = str_.find_last_not_of(" \t\r\n");
+    str_ = (begin == std::string::npos) ? std::string() : str_.substr(begin, end - begin + 1);
+  }
+
+  long toInt() const { return std::strtol(str_.c_str(), nullptr, 10); }
+  float toFloat() const { return std::strtof(str_.c_str(), nullptr); }
+
+private:
+  static std::string formatInteger(unsigned long long value, unsigned char base, bool negative);
+  static std::string formatSigned(long long value, unsigned char base) {
+    return value < 0 ? formatInteger(0ULL - static_cast<unsigned long long>(value), base, true)
+                     : formatInteger(static_cast<unsigned long long>(value), base, false);
+  }
+  static std::string formatFloat(double value, unsigned int decimals) {
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimals), value);
+    return buf;
+  }
+
+  std::string str_;
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+  Native simulator - WiFi station
+
+  Connection state is driven by the harness through SimControl.h.
+*/
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets_{a, b, c, d} {}
+  String toString() const;
+
+private:
+  uint8_t octets_[4];
+};
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* password = nullptr);
+  bool disconnect(bool wifiOff = false);
+  bool reconnect();
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+  IPAddress localIP();
+  int8_t RSSI() { return -55; }
+};
+
+extern WiFiClass WiFi;
+
+#endif
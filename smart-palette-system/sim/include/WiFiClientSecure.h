@@ -0,0 +1,46 @@
+/*
+  Native simulator - TLS client
+
+  Holds no socket; HTTPClient uses it to tell whether a connection (and
+  its TLS session) is still open and can be reused, and hands the
+  scripted response body to the firmware through it as a Stream.
+*/
+
+#ifndef SIM_WIFICLIENTSECURE_H
+#define SIM_WIFICLIENTSECURE_H
+
+#include <Arduino.h>
+
+class WiFiClient : public Stream {
+public:
+  bool connected() const { return connected_; }
+  void stop() { connected_ = false; }
+
+  // Requests are captured by HTTPClient; bytes written here are dropped
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+  using Print::write;
+  int available() override { return static_cast<int>(response_.size() - responsePos_); }
+  int read() override { return responsePos_ < response_.size() ? static_cast<unsigned char>(response_[responsePos_++]) : -1; }
+  int peek() override { return responsePos_ < response_.size() ? static_cast<unsigned char>(response_[responsePos_]) : -1; }
+
+  // Simulator bookkeeping, driven by HTTPClient
+  bool connected_ = false;
+  uint32_t epoch_ = 0;
+  String host_;
+  std::string response_;
+  size_t responsePos_ = 0;
+};
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setCACert(const char* rootCA) { rootCA_ = rootCA; }
+  void setInsecure() { rootCA_ = nullptr; }
+  void setHandshakeTimeout(unsigned long seconds) { handshakeTimeout_ = seconds; }
+
+private:
+  const char* rootCA_ = nullptr;
+  unsigned long handshakeTimeout_ = 120;
+};
+
+#endif
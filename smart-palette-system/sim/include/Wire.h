@@ -0,0 +1,39 @@
+/*
+  Native simulator - I2C bus
+
+  Counts bus transactions and bytes so display/NFC traffic can be
+  measured on the host. No device is actually addressed.
+*/
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire : public Stream {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  void setClock(uint32_t frequency) { frequency_ = frequency; }
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  uint32_t getClock() const { return frequency_; }
+
+private:
+  // Eight data bits plus ACK per byte on the wire
+  uint32_t byteTimeUs() const { return 9000000u / frequency_; }
+
+  uint32_t frequency_ = 100000;
+  uint8_t txAddress_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,40 @@
+/*
+  Native simulator - FreeRTOS kernel types
+
+  The simulator is single-threaded: tasks are registered but never
+  started, and the harness calls the firmware's task bodies itself.
+  Blocking calls advance the virtual clock instead of sleeping.
+*/
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+#define portMAX_DELAY      ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define configTICK_RATE_HZ 1000
+
+// The ISR's caller already reschedules once the ISR returns
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+// One thread, and an ISR is never interrupted: nothing to lock out
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux))
+
+#endif
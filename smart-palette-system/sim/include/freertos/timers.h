@@ -0,0 +1,18 @@
+#ifndef SIM_FREERTOS_TIMERS_H
+#define SIM_FREERTOS_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimTimer* TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+// Callbacks run in a "Tmr Svc" task, created with the first timer
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                           TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void* pvTimerGetTimerID(TimerHandle_t timer);
+
+#endif
@@ -0,0 +1,605 @@
+/*
+  Smart Inventory Palette - Native Simulation Harness
+
+  Boots the unmodified firmware (setup() + its FreeRTOS tasks) against the
+  simulated HX711 / PN532 / SSD1306 drivers, replays a weight trace and a
+  script of NFC taps on the virtual clock, then reports how much host CPU
+  each task consumed.
+
+  Usage:
+    pio run -e native && .pio/build/native/program [options]
+
+    --trace <file>     raw HX711 counts, one "cell1,cell2[,...]" line per sample,
+                       a column per load cell; a trace shorter than the run
+                       repeats its last line, which reads as a stuck cell
+    --taps <file>      NFC taps, one "millis,04:52:F3:2A[,hold ms]" line per tap
+    --rate <sps>       trace sample rate (default 80)
+    --duration <s>     virtual seconds to run (default 60)
+    --wifi-outage <a,b> drop Wi-Fi from second a to second b
+    --disconnect <cell,a,b> unplug load cell n (1-based) from second a to b
+    --vibration <hz,kg> add a sinusoidal ripple to the built-in load profile
+    --glitches <n>     flip one bit in n raw samples per cell per minute, as a
+                       slipped HX711 read does
+    --trucks <file>    fleet list served to the truck download (see truck_sync.h)
+    --console <file>   remote console commands, one "seconds command" line each;
+                       replies are printed as the server receives them
+    --insecure         no pinned root CA: the remote console is read-only and
+                       nothing is uploaded or downloaded
+    --reject <n>       the server rejects journal record n on every attempt
+    --replay <file>    a `rec` recording, raw or as dumped by `rec dump`:
+                       its counts, taps, die temperature and calibration,
+                       after REPLAY_LEAD_MS of its first sample for the boot
+    --quiet            suppress the firmware's Serial output
+
+  Without --trace/--taps a built-in load/unload scenario is used; scripted
+  taps without a trace are played against its load profile.
+
+  File: sim_main.cpp
+*/
+
+#include <Arduino.h>
+#include <SimControl.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <RawTrace.h>
+#include <LoadCellCalibration.h>
+#include "../src/config.h"
+#include "../src/heap_monitor.h"
+
+void setup();
+void loop();
+
+// PEM root certificate in main.cpp; the simulated server accepts any
+extern const char* API_ROOT_CA;
+const char SIM_ROOT_CA[] = "-----BEGIN CERTIFICATE-----\nsimulated\n-----END CERTIFICATE-----\n";
+
+// ============================================================================
+// SCENARIO
+// ============================================================================
+const uint8_t NUM_CELLS = LOAD_CELLS;
+const uint8_t CELL_DOUT[] = {HX711_1_DT, HX711_2_DT, HX711_3_DT, HX711_4_DT};
+const uint8_t CELL_SCK[] = {HX711_1_SCK, HX711_2_SCK, HX711_3_SCK, HX711_4_SCK};
+const long CELL_ZERO[] = {84200, -12650, 40310, -61020};  // Raw counts with an empty pallet
+// Off-centre crates do not load the cells evenly
+const float LOAD_SHARES[][4] = {{1}, {0.55f, 0.45f}, {0.4f, 0.35f, 0.25f}, {0.3f, 0.25f, 0.25f, 0.2f}};
+const float COUNTS_PER_KG = -7050.0;  // Matches set_scale() in main.cpp
+const float CRATE_WEIGHT = 24 * 0.36f + 1.6f;  // 24 bottles of 175 mL, the default product
+const char* CONSOLE_URL = "https://your-saas-domain.com/api/palletConsole";  // API_CONSOLE_URL
+
+struct Scenario {
+  std::vector<std::vector<long>> cells = std::vector<std::vector<long>>(NUM_CELLS);
+  uint32_t sampleRate = 80;
+  uint32_t durationMs = 60000;
+  uint32_t wifiDownMs = 0;      // Outage window; equal values = none
+  uint32_t wifiUpMs = 0;
+  int disconnectedCell = -1;    // 0-based, unplugged from disconnectMs to reconnectMs
+  uint32_t disconnectMs = 0;
+  uint32_t reconnectMs = 0;
+  std::vector<uint32_t> tapsMs;
+  std::vector<std::pair<uint32_t, float>> temperatures;  // Die temperature from ms on
+  float vibrationHz = 0;        // Forklift or conveyor ripple on the built-in profile
+  float vibrationKg = 0;
+  float glitchesPerMinute = 0;  // Corrupt raw reads, on any load profile
+};
+
+void scheduleTap(Scenario& scenario, uint32_t atMillis, const std::vector<uint8_t>& uid, uint32_t holdMillis = 400) {
+  sim::scheduleNfcTap(atMillis, uid, holdMillis);
+  scenario.tapsMs.push_back(atMillis);
+}
+
+// Deterministic noise: sum of uniforms from a fixed-seed LCG
+float noise(uint32_t& seed, float amplitude) {
+  float sum = 0;
+  for (int i = 0; i < 4; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    sum += (seed >> 8) / 16777216.0f - 0.5f;
+  }
+  return sum * amplitude;
+}
+
+// Pallet mass in kg at time t for the built-in scenario: ten crates are
+// loaded one by one, then four are taken off again. Each placement rings
+// for a few hundred milliseconds like a crate dropped by hand.
+float scenarioMass(float t) {
+  float mass = 0;
+  for (int crate = 0; crate < 10; crate++) {
+    float placedAt = 8.0f + crate * 2.0f;
+    if (t >= placedAt) {
+      float dt = t - placedAt;
+      mass += CRATE_WEIGHT * (1.0f + 0.4f * std::exp(-dt * 8.0f) * std::sin(dt * 40.0f));
+    }
+  }
+  for (int crate = 0; crate < 4; crate++) {
+    if (t >= 42.0f + crate * 2.0f) mass -= CRATE_WEIGHT;
+  }
+  return mass;
+}
+
+// The default load profile, also used under scripted taps without a trace
+void buildDefaultWeights(Scenario& scenario) {
+  uint32_t seed = 12345;
+  // A few seconds past the end, so the last samples are not repeated
+  // into a stuck cell while the run finishes
+  size_t samples = static_cast<size_t>((scenario.durationMs / 1000.0 + 5) * scenario.sampleRate) + 1;
+  const float* shares = LOAD_SHARES[NUM_CELLS - 1];
+  for (size_t i = 0; i < samples; i++) {
+    float t = static_cast<float>(i) / scenario.sampleRate;
+    float mass = scenarioMass(t);
+    mass += scenario.vibrationKg * std::sin(2 * static_cast<float>(M_PI) * scenario.vibrationHz * t);
+    for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+      scenario.cells[cell].push_back(CELL_ZERO[cell] +
+                                     static_cast<long>(COUNTS_PER_KG * mass * shares[cell] + noise(seed, 60)));
+    }
+  }
+}
+
+void buildDefaultScenario(Scenario& scenario) {
+  buildDefaultWeights(scenario);
+
+  const std::vector<uint8_t> truckA = {0x04, 0x52, 0xF3, 0x2A};
+  const std::vector<uint8_t> truckB = {0x04, 0xA1, 0xB2, 0x3C};
+  scheduleTap(scenario, 6000, truckA);         // start load
+  scheduleTap(scenario, 30000, truckA);        // finish load
+  scheduleTap(scenario, 40000, truckB, 300);   // next truck, double tap
+  scheduleTap(scenario, 40700, truckB, 300);   // for an unload
+  scheduleTap(scenario, 52000, truckB, 2500);  // card left on the reader
+
+  // Yard Wi-Fi drops across the first completion; it must be replayed
+  scenario.wifiDownMs = 25000;
+  scenario.wifiUpMs = 48000;
+}
+
+// One bit of the 24-bit reading flipped, at spread-out but irregular
+// samples, independently on each cell
+void addGlitches(Scenario& scenario) {
+  if (scenario.glitchesPerMinute <= 0) return;
+  size_t spacing = static_cast<size_t>(scenario.sampleRate * 60 / scenario.glitchesPerMinute);
+  if (spacing < 2) spacing = 2;
+  uint32_t seed = 777;
+  for (std::vector<long>& counts : scenario.cells) {
+    for (size_t start = 0; start + spacing <= counts.size(); start += spacing) {
+      seed = seed * 1664525u + 1013904223u;
+      size_t at = start + (seed >> 8) % spacing;
+      counts[at] ^= 1L << (10 + (seed >> 4) % 13);
+    }
+  }
+}
+
+bool loadTrace(const char* path, Scenario& scenario) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    long raw[NUM_CELLS];
+    const char* field = line.c_str();
+    uint8_t columns = 0;
+    while (columns < NUM_CELLS) {
+      char* end;
+      raw[columns] = std::strtol(field, &end, 10);
+      if (end == field) break;
+      columns++;
+      if (*end != ',') break;
+      field = end + 1;
+    }
+    if (columns != NUM_CELLS) continue;
+    for (uint8_t cell = 0; cell < NUM_CELLS; cell++) scenario.cells[cell].push_back(raw[cell]);
+  }
+  return !scenario.cells[0].empty();
+}
+
+bool loadFleet(const char* path) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::stringstream body;
+  body << file.rdbuf();
+  sim::setHttpGetResponse(200, body.str());
+  return true;
+}
+
+bool loadTaps(const char* path, Scenario& scenario) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    size_t comma = line.find(',');
+    if (comma == std::string::npos) continue;
+    uint32_t at = static_cast<uint32_t>(std::strtoul(line.c_str(), nullptr, 10));
+    size_t holdComma = line.find(',', comma + 1);
+    uint32_t hold = holdComma == std::string::npos ? 400 : static_cast<uint32_t>(std::strtoul(line.c_str() + holdComma + 1, nullptr, 10));
+    std::vector<uint8_t> uid;
+    std::stringstream bytes(line.substr(comma + 1, holdComma == std::string::npos ? std::string::npos : holdComma - comma - 1));
+    std::string byte;
+    while (std::getline(bytes, byte, ':')) uid.push_back(static_cast<uint8_t>(std::strtoul(byte.c_str(), nullptr, 16)));
+    scheduleTap(scenario, at, uid, hold);
+  }
+  return true;
+}
+
+// A recording replays after the firmware has booted and settled; the
+// recorder's micros() become the sim's, shifted by this. Its first second
+// plays over and over meanwhile, as a held value would read as stuck.
+const uint32_t REPLAY_LEAD_MS = 5000;
+
+bool decodeBase64(const std::string& text, std::vector<uint8_t>& out) {
+  uint32_t group = 0;
+  int bits = 0;
+  for (char c : text) {
+    int value;
+    if (c >= 'A' && c <= 'Z') value = c - 'A';
+    else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') value = c - '0' + 52;
+    else if (c == '+') value = 62;
+    else if (c == '/') value = 63;
+    else if (c == '=' || std::isspace(static_cast<unsigned char>(c))) continue;
+    else return false;
+    group = (group << 6) | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<uint8_t>(group >> bits));
+    }
+  }
+  return true;
+}
+
+// The file itself, or a serial log with a `rec dump` in it
+bool readRecording(const char* path, std::vector<uint8_t>& data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size_t begin = content.find("-----BEGIN RAW TRACE-----");
+  if (begin == std::string::npos) {
+    data.assign(content.begin(), content.end());
+    return true;
+  }
+  begin = content.find('\n', begin);
+  size_t end = content.find("-----END RAW TRACE-----", begin);
+  if (begin == std::string::npos || end == std::string::npos) return false;
+  return decodeBase64(content.substr(begin, end - begin), data);
+}
+
+// Sample sets are put back on the nominal period, each cell holding its
+// last value, since the sim's HX711 converts at a fixed rate. The
+// calibration goes to NVS for setup() to restore.
+bool loadReplay(const char* path, Scenario& scenario) {
+  std::vector<uint8_t> data;
+  if (!readRecording(path, data)) return false;
+  RawTraceReader reader(data.data(), data.size());
+  if (!reader.valid()) {
+    std::fprintf(stderr, "%s is not a raw trace\n", path);
+    return false;
+  }
+  if (reader.header().cells != NUM_CELLS) {
+    std::fprintf(stderr, "%s has %u cells, this build %u (-DLOAD_CELLS)\n", path, reader.header().cells, NUM_CELLS);
+    return false;
+  }
+  scenario.sampleRate = reader.header().sampleRate ? reader.header().sampleRate : 80;
+
+  CellCalibration calibration[NUM_CELLS];
+  float corners[NUM_CELLS];
+  uint8_t calibrated = 0;
+  long last[NUM_CELLS] = {};
+  bool started = false;
+  uint32_t firstUs = 0;
+  uint32_t periodUs = 1000000 / scenario.sampleRate;
+  size_t leadSamples = REPLAY_LEAD_MS / 1000 * scenario.sampleRate;
+  std::vector<std::vector<long>> cells(NUM_CELLS);
+
+  RawTraceRecord record;
+  while (reader.next(record)) {
+    // Records ahead of the first sample set (calibration, temperature) land at its time
+    int32_t sinceFirstUs = started ? static_cast<int32_t>(record.timestampUs - firstUs) : 0;
+    uint32_t atMs = REPLAY_LEAD_MS + (sinceFirstUs > 0 ? sinceFirstUs / 1000 : 0);
+    if (record.type == RAW_SAMPLE) {
+      for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+        if (record.flags & (1u << cell)) last[cell] = RawTraceReader::counts(record, cell);
+      }
+      if (!started) {
+        started = true;
+        firstUs = record.timestampUs;
+        sinceFirstUs = 0;
+      }
+      size_t index = sinceFirstUs / periodUs;
+      for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+        if (cells[cell].size() <= index) cells[cell].resize(index + 1, cells[cell].empty() ? last[cell] : cells[cell].back());
+        cells[cell][index] = last[cell];
+      }
+    } else if (record.type == RAW_TAP) {
+      scheduleTap(scenario, atMs, std::vector<uint8_t>(record.payload, record.payload + record.length));
+    } else if (record.type == RAW_TEMPERATURE && record.length == sizeof(float)) {
+      float celsius;
+      std::memcpy(&celsius, record.payload, sizeof(celsius));
+      scenario.temperatures.push_back({started ? atMs : 0, celsius});
+    } else if (record.type == RAW_CALIBRATION && record.flags < NUM_CELLS &&
+               record.length == sizeof(CellCalibration) + sizeof(float)) {
+      std::memcpy(&calibration[record.flags], record.payload, sizeof(CellCalibration));
+      std::memcpy(&corners[record.flags], record.payload + sizeof(CellCalibration), sizeof(float));
+      calibrated |= 1u << record.flags;
+    }
+  }
+  if (!started) {
+    std::fprintf(stderr, "%s holds no samples\n", path);
+    return false;
+  }
+  size_t loop = std::min<size_t>(cells[0].size(), scenario.sampleRate);
+  for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+    scenario.cells[cell].clear();
+    for (size_t i = 0; i < leadSamples; i++) scenario.cells[cell].push_back(cells[cell][i % loop]);
+    scenario.cells[cell].insert(scenario.cells[cell].end(), cells[cell].begin(), cells[cell].end());
+  }
+
+  if (calibrated == (1u << NUM_CELLS) - 1) {
+    CalibrationStore store;
+    store.save(calibration, NUM_CELLS);
+    store.saveCorners(corners, NUM_CELLS);
+  }
+  std::printf("Replaying %s: %zu samples a cell at %u SPS, %zu taps, calibration %s\n", path,
+              scenario.cells[0].size() - leadSamples, scenario.sampleRate, scenario.tapsMs.size(),
+              calibrated == (1u << NUM_CELLS) - 1 ? "restored" : "missing");
+  return true;
+}
+
+// Remote console queue; a command's sequence is its line number in the
+// script and it is served once its time has come
+struct ConsoleCommand {
+  uint32_t atMs;
+  std::string line;
+};
+std::vector<ConsoleCommand> consoleScript;
+
+bool loadConsole(const char* path) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    char* command;
+    float at = std::strtof(line.c_str(), &command);
+    while (*command == ' ') command++;
+    consoleScript.push_back({static_cast<uint32_t>(at * 1000), command});
+  }
+  return true;
+}
+
+void serveConsole() {
+  sim::setHttpGetHandler(CONSOLE_URL, [](const std::string& url, std::string& response) {
+    size_t after = url.find("after=");
+    uint32_t acked = after == std::string::npos ? 0 : static_cast<uint32_t>(std::strtoul(url.c_str() + after + 6, nullptr, 10));
+    response.clear();
+    for (uint32_t seq = acked + 1; seq <= consoleScript.size() && consoleScript[seq - 1].atMs <= millis(); seq++) {
+      response += std::to_string(seq) + " " + consoleScript[seq - 1].line + "\n";
+    }
+    return response.empty() ? 204 : 200;
+  });
+  sim::setHttpPostHandler(CONSOLE_URL, [](const std::string&, const std::string& body) {
+    std::printf("[server %7.3f s] console replies:\n%s", millis() / 1000.0, body.c_str());
+    return 200;
+  });
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+// First status LED change after each tap; taps that change no state
+// (or land after the run) are left out
+void printTapLatency(const Scenario& scenario) {
+  const uint8_t leds[] = {BLUE_LED, GREEN_LED, RED_LED};
+  size_t measured = 0;
+  uint64_t totalUs = 0, worstUs = 0;
+  for (size_t i = 0; i < scenario.tapsMs.size(); i++) {
+    uint64_t from = static_cast<uint64_t>(scenario.tapsMs[i]) * 1000;
+    uint64_t until = i + 1 < scenario.tapsMs.size() ? static_cast<uint64_t>(scenario.tapsMs[i + 1]) * 1000 : UINT64_MAX;
+    uint64_t first = UINT64_MAX;
+    for (uint8_t led : leds) {
+      for (const sim::PinEdge& edge : sim::pinEdges(led)) {
+        if (edge.atMicros >= from && edge.atMicros < until && edge.atMicros < first) first = edge.atMicros;
+      }
+    }
+    if (first == UINT64_MAX) continue;
+    measured++;
+    totalUs += first - from;
+    if (first - from > worstUs) worstUs = first - from;
+  }
+  if (measured > 0) {
+    std::printf("     tap to LED: %.1f ms average, %.1f ms worst over %zu taps\n",
+                totalUs / 1e3 / measured, worstUs / 1e3, measured);
+  }
+}
+
+void printReport(const Scenario& scenario, uint64_t virtualUs, double hostSeconds) {
+  std::printf("\n========================================\n");
+  std::printf("Simulation summary\n");
+  std::printf("========================================\n");
+  std::printf("Virtual time: %.3f s, host time: %.3f s (%.0fx real time)\n",
+              virtualUs / 1e6, hostSeconds, hostSeconds > 0 ? virtualUs / 1e6 / hostSeconds : 0.0);
+
+  std::printf("%-16s %10s %12s %10s\n", "Task", "Runs", "Host us", "ns/run");
+  for (const sim::TaskStats& task : sim::taskStats()) {
+    std::printf("%-16s %10llu %12.1f %10.0f\n", task.name,
+                static_cast<unsigned long long>(task.activations), task.hostNanos / 1e3,
+                task.activations ? static_cast<double>(task.hostNanos) / task.activations : 0.0);
+  }
+
+  for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+    std::printf("HX711 #%u: %zu samples read, %zu missed, powered down %.0f%% of the time\n", cell + 1,
+                sim::hx711SamplesRead(CELL_DOUT[cell]), sim::hx711SamplesMissed(CELL_DOUT[cell]),
+                virtualUs ? 100.0 * sim::hx711PoweredDownMicros(CELL_DOUT[cell]) / virtualUs : 0.0);
+  }
+
+  sim::DisplayStats display = sim::displayStats();
+  std::printf("Display: %zu full frames, %zu bytes over I2C\n", display.frames, display.bytesPushed);
+  std::printf("HTTP: %zu requests, %zu TLS handshakes, %zu bytes, last %s\n", sim::httpRequestCount(),
+              sim::httpHandshakeCount(), sim::httpBytesPosted(), sim::lastHttpUrl().c_str());
+  std::printf("      %s\n", sim::lastHttpPayload().c_str());
+  std::printf("      %zu fleet downloads\n", sim::httpGetCount());
+  std::printf("NFC: %zu scripted taps, %zu missed, %zu not yet due, %zu target reads\n", scenario.tapsMs.size(),
+              sim::missedNfcTaps(), sim::pendingNfcTaps(), sim::nfcTargetsRead());
+  printTapLatency(scenario);
+
+  std::printf("%-16s %10s %10s\n", "Heap", "Allocs", "Frees");
+  for (size_t i = 0; i < heapMonitorTaskCount(); i++) {
+    HeapTaskStats heap = heapMonitorTaskStats(i);
+    std::printf("%-16s %10u %10u\n", heap.name, heap.allocations, heap.frees);
+  }
+}
+
+// ============================================================================
+// ENTRY POINT
+// ============================================================================
+int main(int argc, char** argv) {
+  Scenario scenario;
+  const char* tracePath = nullptr;
+  const char* tapsPath = nullptr;
+  const char* outage = nullptr;
+  const char* disconnect = nullptr;
+  const char* vibration = nullptr;
+  const char* glitches = nullptr;
+  const char* fleetPath = nullptr;
+  const char* consolePath = nullptr;
+  const char* replayPath = nullptr;
+  bool durationGiven = false;
+  bool insecure = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--trace") && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--taps") && i + 1 < argc) {
+      tapsPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc) {
+      scenario.sampleRate = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--duration") && i + 1 < argc) {
+      scenario.durationMs = static_cast<uint32_t>(std::atof(argv[++i]) * 1000);
+      durationGiven = true;
+    } else if (!std::strcmp(argv[i], "--wifi-outage") && i + 1 < argc) {
+      outage = argv[++i];
+    } else if (!std::strcmp(argv[i], "--disconnect") && i + 1 < argc) {
+      disconnect = argv[++i];
+    } else if (!std::strcmp(argv[i], "--vibration") && i + 1 < argc) {
+      vibration = argv[++i];
+    } else if (!std::strcmp(argv[i], "--glitches") && i + 1 < argc) {
+      glitches = argv[++i];
+    } else if (!std::strcmp(argv[i], "--trucks") && i + 1 < argc) {
+      fleetPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--console") && i + 1 < argc) {
+      consolePath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--replay") && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--reject") && i + 1 < argc) {
+      sim::rejectIdempotencyKeys(std::string("-") + argv[++i]);
+    } else if (!std::strcmp(argv[i], "--insecure")) {
+      insecure = true;
+    } else if (!std::strcmp(argv[i], "--quiet")) {
+      sim::setSerialEcho(false);
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (scenario.sampleRate == 0) scenario.sampleRate = 80;
+  if (vibration && std::sscanf(vibration, "%f,%f", &scenario.vibrationHz, &scenario.vibrationKg) != 2) {
+    std::fprintf(stderr, "--vibration wants hz,kg\n");
+    return 1;
+  }
+  if (glitches) scenario.glitchesPerMinute = static_cast<float>(std::atof(glitches));
+
+  if (replayPath) {
+    if (tracePath || tapsPath) {
+      std::fprintf(stderr, "--replay brings its own samples and taps\n");
+      return 1;
+    }
+    if (!loadReplay(replayPath, scenario)) {
+      std::fprintf(stderr, "Cannot replay %s\n", replayPath);
+      return 1;
+    }
+    // Stop with the recording, before its last value reads as stuck
+    if (!durationGiven) scenario.durationMs = scenario.cells[0].size() * 1000 / scenario.sampleRate;
+  } else if (tracePath || tapsPath) {
+    if (tracePath && !loadTrace(tracePath, scenario)) {
+      std::fprintf(stderr, "Cannot read trace %s\n", tracePath);
+      return 1;
+    }
+    if (tapsPath && !loadTaps(tapsPath, scenario)) {
+      std::fprintf(stderr, "Cannot read taps %s\n", tapsPath);
+      return 1;
+    }
+    if (!tracePath) buildDefaultWeights(scenario);
+  } else {
+    buildDefaultScenario(scenario);
+  }
+  addGlitches(scenario);
+  if (fleetPath && !loadFleet(fleetPath)) {
+    std::fprintf(stderr, "Cannot read fleet %s\n", fleetPath);
+    return 1;
+  }
+  if (consolePath && !loadConsole(consolePath)) {
+    std::fprintf(stderr, "Cannot read console script %s\n", consolePath);
+    return 1;
+  }
+  serveConsole();
+  if (outage) {
+    float from = 0, to = 0;
+    std::sscanf(outage, "%f,%f", &from, &to);
+    scenario.wifiDownMs = static_cast<uint32_t>(from * 1000);
+    scenario.wifiUpMs = static_cast<uint32_t>(to * 1000);
+  }
+  if (disconnect) {
+    int cell = 0;
+    float from = 0, to = 0;
+    if (std::sscanf(disconnect, "%d,%f,%f", &cell, &from, &to) != 3 || cell < 1 || cell > NUM_CELLS) {
+      std::fprintf(stderr, "Bad --disconnect %s (cells 1 to %u)\n", disconnect, NUM_CELLS);
+      return 1;
+    }
+    scenario.disconnectedCell = cell - 1;
+    scenario.disconnectMs = static_cast<uint32_t>(from * 1000);
+    scenario.reconnectMs = static_cast<uint32_t>(to * 1000);
+  }
+
+  uint32_t periodUs = 1000000 / scenario.sampleRate;
+  for (uint8_t cell = 0; cell < NUM_CELLS; cell++) {
+    sim::loadHx711Trace(CELL_DOUT[cell], CELL_SCK[cell], scenario.cells[cell], periodUs);
+  }
+
+  sim::watchPin(BLUE_LED);
+  sim::watchPin(GREEN_LED);
+  sim::watchPin(RED_LED);
+
+  // A production build pins the API host's certificate
+  if (!insecure) API_ROOT_CA = SIM_ROOT_CA;
+
+  auto hostStart = std::chrono::steady_clock::now();
+
+  size_t nextTemperature = 0;
+
+  setup();
+  while (sim::nowMicros() < static_cast<uint64_t>(scenario.durationMs) * 1000) {
+    uint32_t now = millis();
+    while (nextTemperature < scenario.temperatures.size() && scenario.temperatures[nextTemperature].first <= now) {
+      sim::setDieTemperature(scenario.temperatures[nextTemperature++].second);
+    }
+    sim::setWifiConnected(now < scenario.wifiDownMs || now >= scenario.wifiUpMs);
+    if (scenario.disconnectedCell >= 0) {
+      sim::setHx711Connected(CELL_DOUT[scenario.disconnectedCell],
+                             now < scenario.disconnectMs || now >= scenario.reconnectMs);
+    }
+    loop();
+  }
+
+  double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+  printReport(scenario, sim::nowMicros(), hostSeconds);
+
+  // Firmware tasks never return; leave without unwinding their threads
+  std::fflush(stdout);
+  std::_Exit(0);
+}
@@ -0,0 +1,290 @@
+/*
+  Native simulator - Arduino core, virtual clock, Serial and GPIO
+*/
+
+#include <Arduino.h>
+#include <SimControl.h>
+#include "sim_internal.h"
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+struct InterruptHandler {
+  void (*isr)(void);
+  void (*isrArg)(void*);
+  void* arg;
+  int mode;
+};
+
+uint64_t virtualMicros = 0;
+bool inIsr = false;
+bool serialEcho = true;
+float dieTemperature = 40.0f;
+std::deque<char> serialRx;
+std::map<uint8_t, int> pinLevels;
+std::map<uint8_t, InterruptHandler> interrupts;
+std::map<uint8_t, std::vector<sim::PinEdge>> watchedPins;
+std::vector<sim::internal::EventSource*> eventSources;
+
+}  // namespace
+
+namespace sim {
+
+uint64_t nowMicros() { return virtualMicros; }
+
+// Busy time: any interrupts that fall due meanwhile run at their own
+// timestamps, just as they would preempt a spinning task on the chip.
+void advanceMicros(uint64_t us) {
+  uint64_t target = virtualMicros + us;
+  while (internal::fireNextEvent(target)) {
+  }
+  if (virtualMicros < target) virtualMicros = target;
+}
+
+void advanceMillis(uint32_t ms) { advanceMicros(static_cast<uint64_t>(ms) * 1000); }
+
+void setSerialEcho(bool enabled) { serialEcho = enabled; }
+void setDieTemperature(float celsius) { dieTemperature = celsius; }
+void serialInput(const char* text) {
+  while (text && *text) serialRx.push_back(*text++);
+}
+
+int pinLevel(uint8_t pin) {
+  auto it = pinLevels.find(pin);
+  return it == pinLevels.end() ? LOW : it->second;
+}
+
+// Logging is capped at the reserved size so a firmware task writing the
+// pin never allocates
+void watchPin(uint8_t pin) { watchedPins[pin].reserve(1024); }
+
+const std::vector<PinEdge>& pinEdges(uint8_t pin) { return watchedPins[pin]; }
+
+namespace internal {
+
+void addEventSource(EventSource* source) { eventSources.push_back(source); }
+
+bool fireNextEvent(uint64_t limitUs) {
+  // Interrupts are masked while an ISR runs; pending edges wait for it
+  if (inIsr) return false;
+
+  EventSource* due = nullptr;
+  uint64_t dueAt = 0;
+  for (EventSource* source : eventSources) {
+    uint64_t at;
+    if (source->nextEvent(limitUs, at) && (!due || at < dueAt)) {
+      due = source;
+      dueAt = at;
+    }
+  }
+  if (!due) return false;
+
+  if (dueAt > virtualMicros) virtualMicros = dueAt;
+  inIsr = true;
+  due->fire();
+  inIsr = false;
+  return true;
+}
+
+bool hasInterrupt(uint8_t pin) {
+  auto it = interrupts.find(pin);
+  return it != interrupts.end() && (it->second.isr || it->second.isrArg);
+}
+
+void raiseEdge(uint8_t pin, int edge) {
+  auto it = interrupts.find(pin);
+  if (it == interrupts.end()) return;
+  const InterruptHandler& handler = it->second;
+  if (handler.mode != CHANGE && handler.mode != edge) return;
+  if (handler.isrArg) {
+    handler.isrArg(handler.arg);
+  } else if (handler.isr) {
+    handler.isr();
+  }
+}
+
+}  // namespace internal
+
+}  // namespace sim
+
+// ============================================================================
+// TIMING AND GPIO
+// ============================================================================
+unsigned long millis() { return static_cast<unsigned long>(virtualMicros / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(virtualMicros); }
+void delay(uint32_t ms) { sim::sleepMicros(static_cast<uint64_t>(ms) * 1000); }
+void delayMicroseconds(uint32_t us) { sim::advanceMicros(us); }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+void digitalWrite(uint8_t pin, uint8_t val) {
+  int level = val ? HIGH : LOW;
+  auto watched = watchedPins.find(pin);
+  if (watched != watchedPins.end() && sim::pinLevel(pin) != level &&
+      watched->second.size() < watched->second.capacity()) {
+    watched->second.push_back(sim::PinEdge{virtualMicros, level});
+  }
+  pinLevels[pin] = level;
+  sim::internal::hx711PinWrite(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+  int level;
+  if (sim::internal::hx711PinRead(pin, level)) return level;
+  if (sim::internal::pn532PinRead(pin, level)) return level;
+  return sim::pinLevel(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  interrupts[pin] = InterruptHandler{isr, nullptr, nullptr, mode};
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode) {
+  interrupts[pin] = InterruptHandler{nullptr, isr, arg, mode};
+}
+
+// The entry stays, like the core's per-pin handler table, so attaching
+// again does not allocate
+void detachInterrupt(uint8_t pin) {
+  auto it = interrupts.find(pin);
+  if (it != interrupts.end()) it->second = InterruptHandler{nullptr, nullptr, nullptr, 0};
+}
+
+uint32_t esp_random() {
+  static uint32_t state = 0x2545F491;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+float temperatureRead() { return dieTemperature; }
+
+// ============================================================================
+// PRINT / STREAM
+// ============================================================================
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  if (!str) return 0;
+  size_t n = 0;
+  while (*str) n += write(static_cast<uint8_t>(*str++));
+  return n;
+}
+
+// Same buffering as the ESP32 core: 64 bytes on the stack, malloc beyond
+// that, so long printf lines show up in the heap monitor here as well
+size_t Print::printf(const char* format, ...) {
+  char localBuffer[64];
+  char* buffer = localBuffer;
+  va_list args, copy;
+  va_start(args, format);
+  va_copy(copy, args);
+  int len = std::vsnprintf(localBuffer, sizeof(localBuffer), format, copy);
+  va_end(copy);
+  if (len < 0) {
+    va_end(args);
+    return 0;
+  }
+  if (static_cast<size_t>(len) >= sizeof(localBuffer)) {
+    buffer = static_cast<char*>(std::malloc(static_cast<size_t>(len) + 1));
+    if (!buffer) {
+      va_end(args);
+      return 0;
+    }
+    std::vsnprintf(buffer, static_cast<size_t>(len) + 1, format, args);
+  }
+  va_end(args);
+  size_t n = write(reinterpret_cast<const uint8_t*>(buffer), static_cast<size_t>(len));
+  if (buffer != localBuffer) std::free(buffer);
+  return n;
+}
+
+long Stream::parseInt() {
+  return readStringUntil('\n').toInt();
+}
+
+float Stream::parseFloat() {
+  return readStringUntil('\n').toFloat();
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) result += static_cast<char>(c);
+  return result;
+}
+
+// Input is either already there or never coming, so no timeout is needed
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t n = 0;
+  int c;
+  while (n < length && (c = read()) >= 0 && c != terminator) buffer[n++] = static_cast<char>(c);
+  return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialEcho) std::fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (serialEcho) std::fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+int HardwareSerial::available() { return static_cast<int>(serialRx.size()); }
+
+int HardwareSerial::read() {
+  if (serialRx.empty()) return -1;
+  char c = serialRx.front();
+  serialRx.pop_front();
+  return static_cast<unsigned char>(c);
+}
+
+int HardwareSerial::peek() { return serialRx.empty() ? -1 : static_cast<unsigned char>(serialRx.front()); }
+
+// ============================================================================
+// ESP SYSTEM INFO
+// ============================================================================
+uint32_t EspClass::getFreeHeap() { return 200 * 1024; }
+uint32_t EspClass::getMinFreeHeap() { return 180 * 1024; }
+uint32_t EspClass::getMaxAllocHeap() { return 110 * 1024; }
+
+// Runs on the virtual clock, so only the time a task spends blocked
+// shows up; code between two waits takes no cycles at all
+uint32_t EspClass::getCycleCount() { return static_cast<uint32_t>(virtualMicros * getCpuFreqMHz()); }
+
+void EspClass::restart() {
+  std::fflush(stdout);
+  std::exit(0);
+}
+
+// ============================================================================
+// STRING
+// ============================================================================
+std::string String::formatInteger(unsigned long long value, unsigned char base, bool negative) {
+  if (base < 2 || base > 16) base = DEC;
+  char buffer[72];
+  char* p = buffer + sizeof(buffer);
+  *--p = '\0';
+  do {
+    *--p = "0123456789abcdef"[value % base];
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  return p;
+}
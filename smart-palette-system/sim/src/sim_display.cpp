@@ -0,0 +1,178 @@
+/*
+  Native simulator - GFX primitives and SSD1306 framebuffer
+*/
+
+#include <Adafruit_SSD1306.h>
+#include <SimControl.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+size_t fullFrames = 0;
+uint8_t panelAddress = 0;
+
+// Deterministic 5x7 pseudo-glyph column for character `c`
+uint8_t glyphColumn(unsigned char c, uint8_t column) {
+  if (c == ' ') return 0;
+  uint32_t h = (static_cast<uint32_t>(c) * 2654435761u) ^ (column * 40503u);
+  return static_cast<uint8_t>((h >> 11) & 0x7F);
+}
+}
+
+namespace sim {
+DisplayStats displayStats() { return DisplayStats{fullFrames, i2cBytesWritten(panelAddress)}; }
+}
+
+// ============================================================================
+// ADAFRUIT GFX
+// ============================================================================
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  int16_t dx = static_cast<int16_t>(std::abs(x1 - x0));
+  int16_t dy = static_cast<int16_t>(-std::abs(y1 - y0));
+  int16_t sx = x0 < x1 ? 1 : -1;
+  int16_t sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    drawPixel(x0, y0, color);
+    if (x0 == x1 && y0 == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 = static_cast<int16_t>(x0 + sx); }
+    if (e2 <= dx) { err += dx; y0 = static_cast<int16_t>(y0 + sy); }
+  }
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) drawPixel(static_cast<int16_t>(x + i), y, color);
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < h; i++) drawPixel(x, static_cast<int16_t>(y + i), color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, static_cast<int16_t>(y + h - 1), w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(static_cast<int16_t>(x + w - 1), y, h, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < h; i++) drawFastHLine(x, static_cast<int16_t>(y + i), w, color);
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  int16_t x = r, y = 0;
+  int err = 1 - r;
+  while (x >= y) {
+    drawPixel(static_cast<int16_t>(x0 + x), static_cast<int16_t>(y0 + y), color);
+    drawPixel(static_cast<int16_t>(x0 + y), static_cast<int16_t>(y0 + x), color);
+    drawPixel(static_cast<int16_t>(x0 - y), static_cast<int16_t>(y0 + x), color);
+    drawPixel(static_cast<int16_t>(x0 - x), static_cast<int16_t>(y0 + y), color);
+    drawPixel(static_cast<int16_t>(x0 - x), static_cast<int16_t>(y0 - y), color);
+    drawPixel(static_cast<int16_t>(x0 - y), static_cast<int16_t>(y0 - x), color);
+    drawPixel(static_cast<int16_t>(x0 + y), static_cast<int16_t>(y0 - x), color);
+    drawPixel(static_cast<int16_t>(x0 + x), static_cast<int16_t>(y0 - y), color);
+    y++;
+    if (err < 0) {
+      err += 2 * y + 1;
+    } else {
+      x--;
+      err += 2 * (y - x) + 1;
+    }
+  }
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  for (int16_t dy = static_cast<int16_t>(-r); dy <= r; dy++) {
+    for (int16_t dx = static_cast<int16_t>(-r); dx <= r; dx++) {
+      if (dx * dx + dy * dy <= r * r) drawPixel(static_cast<int16_t>(x0 + dx), static_cast<int16_t>(y0 + dy), color);
+    }
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size) {
+  for (uint8_t col = 0; col < 6; col++) {
+    uint8_t bits = col < 5 ? glyphColumn(c, col) : 0;
+    for (uint8_t row = 0; row < 8; row++, bits >>= 1) {
+      uint16_t pixel = (bits & 1) ? color : bg;
+      if (!(bits & 1) && bg == color) continue;
+      if (size == 1) {
+        drawPixel(static_cast<int16_t>(x + col), static_cast<int16_t>(y + row), pixel);
+      } else {
+        fillRect(static_cast<int16_t>(x + col * size), static_cast<int16_t>(y + row * size), size, size, pixel);
+      }
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX_ = 0;
+    cursorY_ = static_cast<int16_t>(cursorY_ + textSize_ * 8);
+  } else if (c != '\r') {
+    if (wrap_ && cursorX_ + textSize_ * 6 > width_) {
+      cursorX_ = 0;
+      cursorY_ = static_cast<int16_t>(cursorY_ + textSize_ * 8);
+    }
+    drawChar(cursorX_, cursorY_, c, textColor_, textBg_, textSize_);
+    cursorX_ = static_cast<int16_t>(cursorX_ + textSize_ * 6);
+  }
+  return 1;
+}
+
+// ============================================================================
+// SSD1306
+// ============================================================================
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi, int8_t)
+    : Adafruit_GFX(w, h), wire_(twi) {}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { std::free(buffer_); }
+
+bool Adafruit_SSD1306::begin(uint8_t, uint8_t i2caddr, bool, bool) {
+  if (!buffer_) {
+    buffer_ = static_cast<uint8_t*>(std::malloc(static_cast<size_t>(width_) * ((height_ + 7) / 8)));
+    if (!buffer_) return false;
+  }
+  address_ = i2caddr;
+  panelAddress = i2caddr;
+  clearDisplay();
+  return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  if (buffer_) std::memset(buffer_, 0, static_cast<size_t>(width_) * ((height_ + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (!buffer_ || x < 0 || y < 0 || x >= width_ || y >= height_) return;
+  uint8_t& cell = buffer_[x + (y / 8) * width_];
+  uint8_t mask = static_cast<uint8_t>(1 << (y & 7));
+  switch (color) {
+    case SSD1306_WHITE: cell |= mask; break;
+    case SSD1306_BLACK: cell &= static_cast<uint8_t>(~mask); break;
+    case SSD1306_INVERSE: cell ^= mask; break;
+  }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) {
+  if (!buffer_ || x < 0 || y < 0 || x >= width_ || y >= height_) return false;
+  return buffer_[x + (y / 8) * width_] & (1 << (y & 7));
+}
+
+void Adafruit_SSD1306::display() {
+  if (!buffer_) return;
+  // Full address window (control byte + 6 command bytes) followed by the
+  // whole buffer, clocked at 400 kHz like the Adafruit driver does
+  static const uint8_t window[] = {0x00, 0x22, 0x00, 0xFF, 0x21, 0x00, 0x7F};
+  size_t payload = static_cast<size_t>(width_) * ((height_ + 7) / 8);
+  uint32_t busClock = wire_->getClock();
+  wire_->setClock(400000);
+  wire_->beginTransmission(address_);
+  wire_->write(window, sizeof(window));
+  wire_->endTransmission();
+  wire_->beginTransmission(address_);
+  wire_->write(buffer_, payload);
+  wire_->endTransmission();
+  wire_->setClock(busClock);
+  fullFrames++;
+}
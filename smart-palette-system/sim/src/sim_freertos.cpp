@@ -0,0 +1,418 @@
+/*
+  Native simulator - FreeRTOS scheduler and primitives
+
+  Every task (plus the harness "main" context) gets its own host thread,
+  but only one of them ever runs at a time. Whenever the running task
+  blocks, the scheduler hands the CPU to the task with the earliest
+  virtual wake-up time (ties go to higher priority, then creation order)
+  and moves the virtual clock forward to it. The interleaving is
+  therefore identical on every run, and a simulated minute passes in
+  however long the firmware's code actually takes to execute.
+*/
+
+#include <Arduino.h>
+#include <SimControl.h>
+#include "sim_internal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+const uint64_t NEVER = UINT64_MAX;
+}
+
+struct SimTask {
+  TaskFunction_t function;
+  void* parameter;
+  const char* name;
+  UBaseType_t priority;
+  size_t id;
+  uint64_t wakeAtUs;
+  const void* waitingOn;
+  std::condition_variable cv;
+  std::chrono::steady_clock::time_point resumedAt;
+  uint64_t activations;
+  uint64_t hostNanos;
+  uint32_t notifyCount;
+  uint32_t stackDepth;
+};
+
+// Storage is allocated once at creation, as in FreeRTOS, so sending and
+// receiving never touch the heap from the calling task
+struct SimQueue {
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::vector<uint8_t> storage;
+  UBaseType_t head;
+  UBaseType_t count;
+};
+
+struct SimSemaphore {
+  SimTask* holder;
+};
+
+struct SimTimer {
+  const char* name;
+  TickType_t period;
+  bool autoReload;
+  void* id;
+  TimerCallbackFunction_t callback;
+  bool active;
+  uint64_t expiresAtUs;
+};
+
+namespace {
+
+std::mutex schedulerLock;
+std::vector<std::unique_ptr<SimTask>> tasks;
+std::vector<std::unique_ptr<SimQueue>> queues;
+std::vector<std::unique_ptr<SimSemaphore>> semaphores;
+std::vector<std::unique_ptr<SimTimer>> timers;
+bool timerTaskCreated = false;
+SimTask* running = nullptr;
+
+// Lock-free view of the task owning this host thread, for callers that
+// cannot take schedulerLock (the heap monitor runs inside malloc)
+thread_local SimTask* threadTask = nullptr;
+
+// The harness thread is adopted as the "main" task (Arduino's loopTask)
+SimTask* currentTask() {
+  if (!running) {
+    tasks.emplace_back(new SimTask{nullptr, nullptr, "main", 1, 0, 0, nullptr, {}, std::chrono::steady_clock::now(), 1, 0, 0, 0});
+    running = tasks.back().get();
+    threadTask = running;
+  }
+  return running;
+}
+
+SimTask* pickNext() {
+  SimTask* next = nullptr;
+  for (auto& task : tasks) {
+    if (task->wakeAtUs == NEVER) continue;
+    if (!next || task->wakeAtUs < next->wakeAtUs ||
+        (task->wakeAtUs == next->wakeAtUs && task->priority > next->priority)) {
+      next = task.get();
+    }
+  }
+  return next;
+}
+
+// Block the calling task until `wakeAtUs` (or until another task signals
+// `object`) and run whoever is due next. Returns once the caller is
+// scheduled again.
+void blockUntil(std::unique_lock<std::mutex>& lock, uint64_t wakeAtUs, const void* object = nullptr) {
+  SimTask* self = currentTask();
+  self->wakeAtUs = wakeAtUs;
+  self->waitingOn = object;
+  self->hostNanos += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - self->resumedAt).count());
+
+  SimTask* next;
+  while (true) {
+    next = pickNext();
+    if (!next) {
+      std::fprintf(stderr, "sim: deadlock - every task is blocked forever\n");
+      std::fflush(stdout);
+      std::_Exit(2);
+    }
+    if (next->wakeAtUs <= sim::nowMicros()) break;
+
+    // Idle until the next wake-up, running any ISR that falls due first.
+    // The ISR may wake a different task, so pick again afterwards.
+    lock.unlock();
+    bool fired = sim::internal::fireNextEvent(next->wakeAtUs);
+    lock.lock();
+    if (!fired) {
+      sim::advanceMicros(next->wakeAtUs - sim::nowMicros());
+      break;
+    }
+  }
+
+  running = next;
+  if (next != self) {
+    next->cv.notify_one();
+    self->cv.wait(lock, [self] { return running == self; });
+  }
+  self->waitingOn = nullptr;
+  self->activations++;
+  self->resumedAt = std::chrono::steady_clock::now();
+}
+
+void wakeWaiters(const void* object) {
+  for (auto& task : tasks) {
+    if (task->waitingOn == object && task->wakeAtUs > sim::nowMicros()) task->wakeAtUs = sim::nowMicros();
+  }
+}
+
+void taskEntry(SimTask* task) {
+  threadTask = task;
+  {
+    std::unique_lock<std::mutex> lock(schedulerLock);
+    task->cv.wait(lock, [task] { return running == task; });
+    task->activations++;
+    task->resumedAt = std::chrono::steady_clock::now();
+  }
+  task->function(task->parameter);
+
+  // FreeRTOS tasks must never return; park this one for good
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  blockUntil(lock, NEVER);
+}
+
+uint64_t deadlineFor(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) return NEVER;
+  return sim::nowMicros() + static_cast<uint64_t>(ticks) * 1000;
+}
+
+}  // namespace
+
+namespace sim {
+
+size_t registeredTaskCount() {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  size_t count = 0;
+  for (auto& task : tasks) count += task->function ? 1 : 0;
+  return count;
+}
+
+std::vector<TaskStats> taskStats() {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  std::vector<TaskStats> stats;
+  for (auto& task : tasks) stats.push_back(TaskStats{task->name, task->activations, task->hostNanos});
+  return stats;
+}
+
+void sleepMicros(uint64_t us) {
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  blockUntil(lock, nowMicros() + us);
+}
+
+void runFor(uint32_t ms) { sleepMicros(static_cast<uint64_t>(ms) * 1000); }
+
+}  // namespace sim
+
+// ============================================================================
+// TASKS
+// ============================================================================
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  currentTask();
+  tasks.emplace_back(new SimTask{task, parameter, name, priority, tasks.size(), sim::nowMicros(), nullptr, {}, {}, 0, 0, 0, stackDepth});
+  SimTask* created = tasks.back().get();
+  std::thread(taskEntry, created).detach();
+  if (handle) *handle = created;
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return threadTask; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  SimTask* t = task ? task : currentTask();
+  return t ? t->stackDepth : 0;
+}
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(sim::nowMicros() / 1000); }
+
+void vTaskDelay(TickType_t ticks) { sim::sleepMicros(static_cast<uint64_t>(ticks) * 1000); }
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+  TickType_t wake = *previousWakeTime + increment;
+  TickType_t now = xTaskGetTickCount();
+  *previousWakeTime = wake;
+  if (static_cast<int32_t>(wake - now) > 0) {
+    sim::sleepMicros(static_cast<uint64_t>(wake) * 1000 - sim::nowMicros());
+  } else {
+    sim::sleepMicros(0);
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  SimTask* self = currentTask();
+  uint64_t deadline = deadlineFor(ticksToWait);
+  while (self->notifyCount == 0) {
+    if (sim::nowMicros() >= deadline) return 0;
+    blockUntil(lock, deadline, &self->notifyCount);
+  }
+  uint32_t count = self->notifyCount;
+  self->notifyCount = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  task->notifyCount++;
+  wakeWaiters(&task->notifyCount);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  task->notifyCount++;
+  wakeWaiters(&task->notifyCount);
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdTRUE;
+}
+
+// ============================================================================
+// QUEUES
+// ============================================================================
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  queues.emplace_back(new SimQueue{length, itemSize, std::vector<uint8_t>(length * itemSize), 0, 0});
+  return queues.back().get();
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  if (!queue) return pdFALSE;
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  uint64_t deadline = deadlineFor(ticksToWait);
+  while (queue->count >= queue->length) {
+    if (sim::nowMicros() >= deadline) return pdFALSE;
+    blockUntil(lock, deadline, queue);
+  }
+  UBaseType_t tail = (queue->head + queue->count) % queue->length;
+  std::memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+  queue->count++;
+  wakeWaiters(queue);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  return xQueueSend(queue, item, ticksToWait);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+  if (!queue) return pdFALSE;
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  uint64_t deadline = deadlineFor(ticksToWait);
+  while (queue->count == 0) {
+    if (sim::nowMicros() >= deadline) return pdFALSE;
+    blockUntil(lock, deadline, queue);
+  }
+  std::memcpy(buffer, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  wakeWaiters(queue);
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  return queue ? queue->count : 0;
+}
+
+// ============================================================================
+// MUTEXES
+// ============================================================================
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  semaphores.emplace_back(new SimSemaphore{nullptr});
+  return semaphores.back().get();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  if (!semaphore) return pdFALSE;
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  SimTask* self = currentTask();
+  uint64_t deadline = deadlineFor(ticksToWait);
+  while (semaphore->holder && semaphore->holder != self) {
+    if (sim::nowMicros() >= deadline) return pdFALSE;
+    blockUntil(lock, deadline, semaphore);
+  }
+  semaphore->holder = self;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  if (!semaphore) return pdFALSE;
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  semaphore->holder = nullptr;
+  wakeWaiters(semaphore);
+  return pdTRUE;
+}
+
+// ============================================================================
+// SOFTWARE TIMERS
+// ============================================================================
+namespace {
+
+const UBaseType_t TIMER_TASK_PRIORITY = 1;  // configTIMER_TASK_PRIORITY on the ESP32
+
+// The timer service task: sleeps until the earliest active timer expires
+// (or a command changes the set) and runs its callback without the lock
+void timerServiceTask(void*) {
+  std::unique_lock<std::mutex> lock(schedulerLock);
+  while (true) {
+    SimTimer* due = nullptr;
+    for (auto& timer : timers) {
+      if (timer->active && (!due || timer->expiresAtUs < due->expiresAtUs)) due = timer.get();
+    }
+    if (!due || due->expiresAtUs > sim::nowMicros()) {
+      blockUntil(lock, due ? due->expiresAtUs : NEVER, &timers);
+      continue;
+    }
+
+    if (due->autoReload) {
+      due->expiresAtUs += static_cast<uint64_t>(due->period) * 1000;
+    } else {
+      due->active = false;
+    }
+    lock.unlock();
+    due->callback(due);
+    lock.lock();
+  }
+}
+
+BaseType_t restartTimer(TimerHandle_t timer) {
+  if (!timer) return pdFAIL;
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  timer->active = true;
+  timer->expiresAtUs = sim::nowMicros() + static_cast<uint64_t>(timer->period) * 1000;
+  wakeWaiters(&timers);
+  return pdPASS;
+}
+
+}  // namespace
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                           TimerCallbackFunction_t callback) {
+  if (!timerTaskCreated) {
+    timerTaskCreated = true;
+    xTaskCreatePinnedToCore(timerServiceTask, "Tmr Svc", 2048, nullptr, TIMER_TASK_PRIORITY, nullptr, 0);
+  }
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  timers.emplace_back(new SimTimer{name, period, autoReload != pdFALSE, id, callback, false, 0});
+  return timers.back().get();
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) { return restartTimer(timer); }
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t) { return restartTimer(timer); }
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t) {
+  if (!timer) return pdFAIL;
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  timer->active = false;
+  wakeWaiters(&timers);
+  return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+  std::lock_guard<std::mutex> lock(schedulerLock);
+  return timer && timer->active ? pdTRUE : pdFALSE;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) { return timer ? timer->id : nullptr; }
@@ -0,0 +1,144 @@
+/*
+  Native simulator - in-memory filesystem behind FS.h / LittleFS.h
+
+  Writes cost virtual time roughly like LittleFS on the ESP32's SPI
+  flash, so a task that journals to flash is seen to block for it.
+*/
+
+#include <FS.h>
+#include <LittleFS.h>
+#include <SimControl.h>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+fs::LittleFSFS LittleFS;
+
+namespace {
+
+const size_t VOLUME_BYTES = 1408 * 1024;     // Default "spiffs" partition
+const uint64_t WRITE_BASE_US = 120;          // Per write call: metadata + CTZ block
+const uint64_t WRITE_US_PER_BYTE = 1;        // ~1 MB/s program throughput
+
+std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+
+}  // namespace
+
+namespace fs {
+
+struct FileImpl {
+  std::string path;
+  std::shared_ptr<std::vector<uint8_t>> data;
+  size_t position;
+  bool writable;
+  bool append;
+};
+
+// ============================================================================
+// FILE
+// ============================================================================
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if (!impl_ || !impl_->writable) return 0;
+  std::vector<uint8_t>& data = *impl_->data;
+  if (impl_->append) impl_->position = data.size();
+  if (impl_->position + size > data.size()) data.resize(impl_->position + size);
+  std::memcpy(data.data() + impl_->position, buffer, size);
+  impl_->position += size;
+  sim::advanceMicros(WRITE_BASE_US + WRITE_US_PER_BYTE * size);
+  return size;
+}
+
+int File::available() {
+  if (!impl_) return 0;
+  return static_cast<int>(impl_->data->size() - impl_->position);
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!impl_ || impl_->position >= impl_->data->size()) return -1;
+  return (*impl_->data)[impl_->position];
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  if (!impl_) return 0;
+  const std::vector<uint8_t>& data = *impl_->data;
+  size_t n = impl_->position < data.size() ? std::min(size, data.size() - impl_->position) : 0;
+  std::memcpy(buffer, data.data() + impl_->position, n);
+  impl_->position += n;
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl_) return false;
+  long base = mode == SeekSet ? 0 : (mode == SeekCur ? static_cast<long>(impl_->position) : static_cast<long>(impl_->data->size()));
+  long target = base + static_cast<long>(static_cast<int32_t>(pos));
+  if (target < 0 || static_cast<size_t>(target) > impl_->data->size()) return false;
+  impl_->position = static_cast<size_t>(target);
+  return true;
+}
+
+size_t File::position() const { return impl_ ? impl_->position : 0; }
+
+size_t File::size() const { return impl_ ? impl_->data->size() : 0; }
+
+void File::close() { impl_.reset(); }
+
+const char* File::name() const { return impl_ ? impl_->path.c_str() : ""; }
+
+// ============================================================================
+// FILESYSTEM
+// ============================================================================
+File FS::open(const char* path, const char* mode, bool create) {
+  if (!mounted_ || !path || !mode) return File();
+  auto it = files.find(path);
+  bool reading = mode[0] == 'r';
+  if (it == files.end()) {
+    if (reading && !create) return File();
+    it = files.emplace(path, std::make_shared<std::vector<uint8_t>>()).first;
+  } else if (mode[0] == 'w') {
+    it->second->clear();
+  }
+  bool update = std::strchr(mode, '+') != nullptr;
+  std::shared_ptr<FileImpl> impl(new FileImpl{path, it->second, 0, !reading || update, mode[0] == 'a'});
+  return File(impl);
+}
+
+bool FS::exists(const char* path) { return mounted_ && path && files.count(path) > 0; }
+
+bool FS::remove(const char* path) { return mounted_ && path && files.erase(path) > 0; }
+
+bool FS::rename(const char* from, const char* to) {
+  if (!mounted_ || !from || !to) return false;
+  auto it = files.find(from);
+  if (it == files.end() || files.count(to)) return false;  // Strict: callers remove the target first
+  files[to] = it->second;
+  files.erase(it);
+  return true;
+}
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+  mounted_ = true;
+  return true;
+}
+
+bool LittleFSFS::format() {
+  files.clear();
+  return true;
+}
+
+size_t LittleFSFS::totalBytes() { return VOLUME_BYTES; }
+
+size_t LittleFSFS::usedBytes() {
+  size_t used = 0;
+  for (auto& entry : files) used += (entry.second->size() + 4095) / 4096 * 4096;
+  return used;
+}
+
+}  // namespace fs
@@ -0,0 +1,33 @@
+/*
+  Native simulator - route C++ allocations through malloc
+
+  On the ESP32, operator new is a thin wrapper over malloc, so wrapping
+  malloc at link time (-Wl,--wrap=malloc) also sees every new. On the
+  host, libstdc++'s operator new calls malloc from inside the shared
+  library where the wrap cannot reach it. Replacing it here puts the
+  call back in a linked object, so the firmware's allocation counters
+  behave the same in both builds.
+*/
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t size) {
+  void* p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return std::malloc(size ? size : 1); }
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return std::malloc(size ? size : 1); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
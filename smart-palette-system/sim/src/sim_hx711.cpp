@@ -0,0 +1,276 @@
+/*
+  Native simulator - HX711 trace replay
+
+  Each channel converts on a fixed schedule from its trace. DOUT goes
+  low when a conversion is ready and stays low until it is clocked out,
+  exactly like the chip - so a falling-edge interrupt only fires for a
+  conversion if the previous one was read in time. The channel can be
+  read either through the HX711 library class or by bit-banging SCK and
+  sampling DOUT; both paths share the same state. Holding SCK high for
+  60 us powers the channel down, as power_down() does, until SCK falls.
+*/
+
+#include <HX711.h>
+#include <SimControl.h>
+#include "sim_internal.h"
+#include <map>
+#include <vector>
+
+namespace {
+
+const long HX711_MIN_COUNT = -8388608;  // 24-bit two's complement range
+const long HX711_MAX_COUNT = 8388607;
+const uint64_t POWER_DOWN_US = 60;      // SCK high this long powers the chip down
+
+struct Hx711Channel : public sim::internal::EventSource {
+  uint8_t dout = 0;
+  uint8_t sck = 0xFF;
+  std::vector<long> raw;
+  uint32_t periodUs = 12500;
+  uint64_t startUs = 0;
+  bool poweredDown = false;
+  bool connected = true;
+  long lastReadIndex = -1;
+  long lastEdgeIndex = -1;
+  size_t samplesRead = 0;
+  size_t samplesMissed = 0;
+  uint64_t poweredDownUs = 0;
+
+  // SCK level as last written, and since when it has been high
+  bool sckHigh = false;
+  uint64_t sckHighSinceUs = 0;
+
+  // Bit-bang state: pulses clocked so far and the word being shifted out
+  uint8_t pulses = 0;
+  uint32_t shiftWord = 0;
+  long shiftIndex = -1;
+
+  // Index of the most recent conversion available on the virtual clock
+  long conversionIndex() const {
+    uint64_t now = sim::nowMicros();
+    if (now < startUs + periodUs) return -1;
+    return static_cast<long>((now - startUs) / periodUs) - 1;
+  }
+
+  uint64_t conversionTime(long index) const { return startUs + static_cast<uint64_t>(index + 1) * periodUs; }
+
+  bool asleep() const { return poweredDown || (sckHigh && sim::nowMicros() - sckHighSinceUs >= POWER_DOWN_US); }
+
+  bool dataReady() const { return connected && !asleep() && conversionIndex() > lastReadIndex; }
+
+  long sample(long index) const {
+    if (raw.empty()) return 0;
+    size_t i = static_cast<size_t>(index);
+    long value = i < raw.size() ? raw[i] : raw.back();
+    return value < HX711_MIN_COUNT ? HX711_MIN_COUNT : (value > HX711_MAX_COUNT ? HX711_MAX_COUNT : value);
+  }
+
+  void consume(long index) {
+    if (index > lastReadIndex + 1) samplesMissed += static_cast<size_t>(index - lastReadIndex - 1);
+    lastReadIndex = index;
+    samplesRead++;
+  }
+
+  // The chip needs one full conversion after wake before DOUT goes low;
+  // conversions it slept through are not missed
+  void wake() {
+    lastReadIndex = conversionIndex();
+    lastEdgeIndex = lastReadIndex;
+    pulses = 0;
+  }
+
+  // DOUT falls when the next unread conversion completes, provided DOUT
+  // was high beforehand (the previous conversion had been read)
+  bool nextEvent(uint64_t limitUs, uint64_t& atUs) override {
+    if (!connected || asleep() || pulses > 0 || !sim::internal::hasInterrupt(dout)) return false;
+    long next = lastReadIndex + 1;
+    if (next <= lastEdgeIndex) return false;
+    uint64_t at = conversionTime(next);
+    if (at > limitUs) return false;
+    atUs = at > sim::nowMicros() ? at : sim::nowMicros();
+    return true;
+  }
+
+  void fire() override {
+    lastEdgeIndex = lastReadIndex + 1;
+    sim::internal::raiseEdge(dout, FALLING);
+  }
+};
+
+std::map<uint8_t, Hx711Channel*> channels;
+
+Hx711Channel& channel(uint8_t dout) {
+  auto it = channels.find(dout);
+  if (it != channels.end()) return *it->second;
+  Hx711Channel* ch = new Hx711Channel();
+  ch->dout = dout;
+  channels[dout] = ch;
+  sim::internal::addEventSource(ch);
+  return *ch;
+}
+
+Hx711Channel* channelBySck(uint8_t sck) {
+  for (auto& entry : channels) {
+    if (entry.second->sck == sck) return entry.second;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+namespace sim {
+
+void loadHx711Trace(uint8_t doutPin, uint8_t sckPin, const std::vector<long>& rawCounts, uint32_t samplePeriodUs) {
+  Hx711Channel& ch = channel(doutPin);
+  ch.sck = sckPin;
+  ch.raw = rawCounts;
+  ch.periodUs = samplePeriodUs > 0 ? samplePeriodUs : 12500;
+  ch.startUs = nowMicros();
+  ch.lastReadIndex = -1;
+  ch.lastEdgeIndex = -1;
+  ch.samplesRead = 0;
+  ch.samplesMissed = 0;
+  ch.poweredDownUs = 0;
+}
+
+void setHx711Connected(uint8_t doutPin, bool connected) { channel(doutPin).connected = connected; }
+
+size_t hx711SamplesRead(uint8_t doutPin) { return channel(doutPin).samplesRead; }
+size_t hx711SamplesMissed(uint8_t doutPin) { return channel(doutPin).samplesMissed; }
+
+uint64_t hx711PoweredDownMicros(uint8_t doutPin) {
+  const Hx711Channel& ch = channel(doutPin);
+  uint64_t total = ch.poweredDownUs;
+  if (ch.sckHigh && sim::nowMicros() - ch.sckHighSinceUs >= POWER_DOWN_US) {
+    total += sim::nowMicros() - ch.sckHighSinceUs;
+  }
+  return total;
+}
+
+namespace internal {
+
+bool hx711PinRead(uint8_t pin, int& level) {
+  auto it = channels.find(pin);
+  if (it == channels.end()) return false;
+  const Hx711Channel& ch = *it->second;
+  if (ch.pulses > 0 && ch.pulses <= 24) {
+    level = (ch.shiftWord >> (24 - ch.pulses)) & 1 ? HIGH : LOW;
+  } else {
+    level = ch.dataReady() ? LOW : HIGH;
+  }
+  return true;
+}
+
+bool hx711PinWrite(uint8_t pin, uint8_t level) {
+  Hx711Channel* ch = channelBySck(pin);
+  if (!ch) return false;
+  if (level == LOW) {
+    // Falling SCK after a power-down wakes the chip
+    if (ch->sckHigh && sim::nowMicros() - ch->sckHighSinceUs >= POWER_DOWN_US) {
+      ch->poweredDownUs += sim::nowMicros() - ch->sckHighSinceUs;
+      ch->sckHigh = false;
+      ch->wake();
+    }
+    ch->sckHigh = false;
+    return true;
+  }
+  if (!ch->sckHigh) {
+    ch->sckHigh = true;
+    ch->sckHighSinceUs = sim::nowMicros();
+  }
+
+  // Rising SCK edge: latch a conversion on the first pulse, shift one bit
+  // per pulse, and retire it on the 25th (channel A, gain 128)
+  if (ch->pulses == 0) {
+    if (!ch->dataReady()) return true;
+    ch->shiftIndex = ch->conversionIndex();
+    ch->shiftWord = static_cast<uint32_t>(ch->sample(ch->shiftIndex)) & 0xFFFFFF;
+  }
+  ch->pulses++;
+  if (ch->pulses == 25) {
+    ch->consume(ch->shiftIndex);
+    ch->pulses = 0;
+  }
+  return true;
+}
+
+}  // namespace internal
+
+}  // namespace sim
+
+// ============================================================================
+// HX711 LIBRARY API
+// ============================================================================
+void HX711::begin(uint8_t dout, uint8_t pd_sck, uint8_t gain) {
+  dout_ = dout;
+  gain_ = gain;
+  channel(dout_).sck = pd_sck;
+}
+
+bool HX711::is_ready() {
+  return channel(dout_).dataReady();
+}
+
+void HX711::wait_ready(unsigned long delay_ms) {
+  Hx711Channel& ch = channel(dout_);
+  while (!is_ready()) {
+    if (delay_ms > 0) {
+      delay(delay_ms);
+    } else {
+      uint64_t due = ch.conversionTime(ch.lastReadIndex + 1);
+      sim::sleepMicros(due > sim::nowMicros() ? due - sim::nowMicros() : 0);
+    }
+  }
+}
+
+bool HX711::wait_ready_timeout(unsigned long timeout, unsigned long delay_ms) {
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    if (is_ready()) return true;
+    delay(delay_ms > 0 ? delay_ms : 1);
+  }
+  return false;
+}
+
+long HX711::read() {
+  Hx711Channel& ch = channel(dout_);
+  if (ch.poweredDown) power_up();
+  wait_ready();
+
+  long index = ch.conversionIndex();
+  ch.consume(index);
+
+  // Clocking out 25 bits takes roughly 50 us on the ESP32
+  sim::advanceMicros(50);
+  return ch.sample(index);
+}
+
+long HX711::read_average(uint8_t times) {
+  if (times == 0) times = 1;
+  long long sum = 0;
+  for (uint8_t i = 0; i < times; i++) sum += read();
+  return static_cast<long>(sum / times);
+}
+
+double HX711::get_value(uint8_t times) {
+  return static_cast<double>(read_average(times) - offset_);
+}
+
+float HX711::get_units(uint8_t times) {
+  return static_cast<float>(get_value(times) / scale_);
+}
+
+void HX711::tare(uint8_t times) {
+  set_offset(read_average(times));
+}
+
+void HX711::power_down() {
+  channel(dout_).poweredDown = true;
+}
+
+void HX711::power_up() {
+  Hx711Channel& ch = channel(dout_);
+  if (!ch.poweredDown) return;
+  ch.poweredDown = false;
+  ch.wake();
+}
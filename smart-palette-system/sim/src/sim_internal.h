@@ -0,0 +1,43 @@
+/*
+  Native simulator - hooks shared between the simulated peripherals
+
+  Peripherals that raise interrupts register an EventSource; the virtual
+  clock asks every source for its next edge before moving forward and
+  runs the attached ISR at exactly that virtual time.
+*/
+
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include <stdint.h>
+
+namespace sim {
+namespace internal {
+
+class EventSource {
+public:
+  virtual ~EventSource() = default;
+  // Earliest pending event at or before `limitUs`; false if none
+  virtual bool nextEvent(uint64_t limitUs, uint64_t& atUs) = 0;
+  virtual void fire() = 0;
+};
+
+void addEventSource(EventSource* source);
+
+// Fire the earliest hardware event due at or before `limitUs`, moving
+// the clock to it. Returns false if nothing was due.
+bool fireNextEvent(uint64_t limitUs);
+
+// GPIO interrupt plumbing
+bool hasInterrupt(uint8_t pin);
+void raiseEdge(uint8_t pin, int edge);
+
+// Pin-level device models get first refusal on GPIO reads and writes
+bool hx711PinRead(uint8_t pin, int& level);
+bool hx711PinWrite(uint8_t pin, uint8_t level);
+bool pn532PinRead(uint8_t pin, int& level);
+
+}  // namespace internal
+}  // namespace sim
+
+#endif
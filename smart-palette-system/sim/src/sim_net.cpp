@@ -0,0 +1,243 @@
+/*
+  Native simulator - I2C bus, WiFi and HTTP
+*/
+
+#include <Wire.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <SimControl.h>
+#include <map>
+#include <set>
+#include <vector>
+
+TwoWire Wire;
+WiFiClass WiFi;
+
+namespace {
+const uint64_t HTTP_ROUND_TRIP_US = 80000;   // Request + response over yard Wi-Fi
+const uint64_t TLS_HANDSHAKE_US = 650000;    // TCP connect + ECDHE/RSA verify on the ESP32
+const uint32_t WIFI_BYTES_PER_MS = 250;      // ~2 Mbit/s effective uplink
+
+bool wifiConnected = true;
+uint32_t linkEpoch = 0;  // Bumped on every drop; open connections die with it
+size_t tlsHandshakes = 0;
+size_t httpBytes = 0;
+int httpResponseCode = 201;
+size_t httpRequests = 0;
+std::string lastPayload;
+std::string lastUrl;
+std::map<std::string, std::string> lastHeaders;
+std::map<std::string, std::string> pendingHeaders;
+std::map<uint8_t, size_t> i2cBytes;
+int getResponseCode = 304;
+std::string getResponseBody;
+size_t getRequests = 0;
+std::map<std::string, sim::HttpGetHandler> getHandlers;
+std::map<std::string, sim::HttpPostHandler> postHandlers;
+std::set<std::string> storedKeys;
+std::vector<std::string> rejectedKeySuffixes;
+
+// Handler registered under the longest prefix of `url`, if any
+template <typename Handler>
+const Handler* findHandler(const std::map<std::string, Handler>& handlers, const std::string& url) {
+  const Handler* found = nullptr;
+  size_t foundLength = 0;
+  for (const auto& entry : handlers) {
+    if (url.compare(0, entry.first.size(), entry.first) == 0 && entry.first.size() >= foundLength) {
+      found = &entry.second;
+      foundLength = entry.first.size();
+    }
+  }
+  return found;
+}
+
+// {"results":[{"idempotency_key":...,"status":...},...]} for the keys in
+// a JSON batch; a MessagePack one gets an empty list
+std::string batchResults(const std::string& body) {
+  static const std::string field = "\"idempotency_key\":\"";
+  std::string results;
+  for (size_t at = body.find(field); at != std::string::npos; at = body.find(field, at)) {
+    at += field.size();
+    size_t end = body.find('"', at);
+    if (end == std::string::npos) break;
+    std::string key = body.substr(at, end - at);
+
+    const char* status = storedKeys.count(key) ? "duplicate" : "stored";
+    for (const std::string& suffix : rejectedKeySuffixes) {
+      if (key.size() >= suffix.size() && key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        status = "rejected";
+      }
+    }
+    if (std::string(status) == "stored") storedKeys.insert(key);
+    if (!results.empty()) results += ",";
+    results += "{\"idempotency_key\":\"" + key + "\",\"status\":\"" + status + "\"}";
+  }
+  return "{\"results\":[" + results + "]}";
+}
+}
+
+namespace sim {
+void setWifiConnected(bool connected) {
+  if (wifiConnected && !connected) linkEpoch++;
+  wifiConnected = connected;
+}
+void setHttpResponseCode(int code) { httpResponseCode = code; }
+size_t httpRequestCount() { return httpRequests; }
+size_t httpHandshakeCount() { return tlsHandshakes; }
+size_t httpBytesPosted() { return httpBytes; }
+const std::string& lastHttpPayload() { return lastPayload; }
+const std::string& lastHttpUrl() { return lastUrl; }
+std::string lastHttpHeader(const char* name) {
+  auto it = lastHeaders.find(name);
+  return it == lastHeaders.end() ? std::string() : it->second;
+}
+void setHttpGetResponse(int code, const std::string& body) {
+  getResponseCode = code;
+  getResponseBody = body;
+}
+size_t httpGetCount() { return getRequests; }
+void rejectIdempotencyKeys(const std::string& suffix) { rejectedKeySuffixes.push_back(suffix); }
+void setHttpGetHandler(const char* urlPrefix, HttpGetHandler handler) { getHandlers[urlPrefix] = handler; }
+void setHttpPostHandler(const char* urlPrefix, HttpPostHandler handler) { postHandlers[urlPrefix] = handler; }
+size_t i2cBytesWritten(uint8_t address) {
+  auto it = i2cBytes.find(address);
+  return it == i2cBytes.end() ? 0 : it->second;
+}
+}
+
+// ============================================================================
+// I2C
+// ============================================================================
+bool TwoWire::begin(int, int, uint32_t frequency) {
+  if (frequency) frequency_ = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress_ = address;
+  sim::advanceMicros(byteTimeUs());
+}
+
+uint8_t TwoWire::endTransmission(bool) { return 0; }
+
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t quantity, bool) {
+  sim::advanceMicros(static_cast<uint64_t>(quantity + 1) * byteTimeUs());
+  return 0;
+}
+
+size_t TwoWire::write(uint8_t) {
+  i2cBytes[txAddress_]++;
+  sim::advanceMicros(byteTimeUs());
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t*, size_t size) {
+  i2cBytes[txAddress_] += size;
+  sim::advanceMicros(static_cast<uint64_t>(size) * byteTimeUs());
+  return size;
+}
+
+// ============================================================================
+// WIFI
+// ============================================================================
+String IPAddress::toString() const {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", octets_[0], octets_[1], octets_[2], octets_[3]);
+  return String(buffer);
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) { return status(); }
+
+bool WiFiClass::disconnect(bool) { return true; }
+
+bool WiFiClass::reconnect() { return wifiConnected; }
+
+wl_status_t WiFiClass::status() { return wifiConnected ? WL_CONNECTED : WL_DISCONNECTED; }
+
+IPAddress WiFiClass::localIP() { return wifiConnected ? IPAddress(192, 168, 4, 2) : IPAddress(); }
+
+// ============================================================================
+// HTTP
+// ============================================================================
+bool HTTPClient::begin(const String& url) {
+  return begin(ownClient_, url);
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+  // A new host, or a new client object, means a new connection
+  String host = url.substring(0, url.indexOf('/', url.indexOf(':') + 3));
+  if (&client != client_ || host != client.host_) client.stop();
+  client_ = &client;
+  client.host_ = host;
+  url_ = url;
+  pendingHeaders.clear();
+  client.response_.clear();
+  client.responsePos_ = 0;
+  return true;
+}
+
+void HTTPClient::end() {
+  if (!reuse_) client_->stop();
+}
+
+bool HTTPClient::connect() {
+  if (!wifiConnected) {
+    client_->stop();
+    return false;
+  }
+  if (client_->connected() && client_->epoch_ == linkEpoch) return true;
+  tlsHandshakes++;
+  sim::sleepMicros(TLS_HANDSHAKE_US);
+  client_->connected_ = true;
+  client_->epoch_ = linkEpoch;
+  return true;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) { pendingHeaders[name.c_str()] = value.c_str(); }
+
+int HTTPClient::POST(const String& payload) {
+  return POST(reinterpret_cast<const uint8_t*>(payload.c_str()), payload.length());
+}
+
+int HTTPClient::POST(const uint8_t* payload, size_t size) {
+  const sim::HttpPostHandler* handler = findHandler(postHandlers, url_.c_str());
+  if (handler) {
+    if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+    httpBytes += size;
+    sim::sleepMicros(HTTP_ROUND_TRIP_US + size / WIFI_BYTES_PER_MS * 1000);
+    return (*handler)(url_.c_str(), std::string(reinterpret_cast<const char*>(payload), size));
+  }
+
+  httpRequests++;
+  lastUrl = url_.c_str();
+  lastPayload.assign(reinterpret_cast<const char*>(payload), size);
+  lastHeaders = pendingHeaders;
+  if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+  httpBytes += size;
+  sim::sleepMicros(HTTP_ROUND_TRIP_US + size / WIFI_BYTES_PER_MS * 1000);
+  if (httpResponseCode >= 200 && httpResponseCode < 300) client_->response_ = batchResults(lastPayload);
+  return httpResponseCode;
+}
+
+int HTTPClient::GET() {
+  const sim::HttpGetHandler* handler = findHandler(getHandlers, url_.c_str());
+  if (handler) {
+    if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+    int code = (*handler)(url_.c_str(), client_->response_);
+    sim::sleepMicros(HTTP_ROUND_TRIP_US + client_->response_.size() / WIFI_BYTES_PER_MS * 1000);
+    return code;
+  }
+
+  getRequests++;
+  if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+  if (getResponseCode == 200) client_->response_ = getResponseBody;
+  sim::sleepMicros(HTTP_ROUND_TRIP_US + client_->response_.size() / WIFI_BYTES_PER_MS * 1000);
+  return getResponseCode;
+}
+
+int HTTPClient::getSize() { return static_cast<int>(client_->response_.size()); }
+
+String HTTPClient::getString() {
+  if (client_->response_.empty()) return String("{}");
+  return String(client_->response_.substr(client_->responsePos_));
+}
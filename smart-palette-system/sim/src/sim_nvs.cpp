@@ -0,0 +1,89 @@
+/*
+  Native simulator - in-memory NVS behind Preferences.h
+*/
+
+#include <Preferences.h>
+#include <SimControl.h>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint64_t NVS_COMMIT_US = 2500;   // Entry write + page header update
+
+// namespace -> key -> value
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+
+}  // namespace
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+  // NVS namespace names are limited to 15 characters
+  if (open_ || !name || std::strlen(name) > 15) return false;
+  namespace_ = name;
+  readOnly_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end() { open_ = false; }
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  nvs.erase(namespace_);
+  sim::advanceMicros(NVS_COMMIT_US);
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!open_ || readOnly_) return false;
+  nvs[namespace_].erase(key);
+  sim::advanceMicros(NVS_COMMIT_US);
+  return true;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!open_) return false;
+  auto ns = nvs.find(namespace_);
+  return ns != nvs.end() && ns->second.count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  // NVS keys are limited to 15 characters
+  if (!open_ || readOnly_ || !key || std::strlen(key) > 15) return 0;
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  nvs[namespace_][key].assign(bytes, bytes + length);
+  sim::advanceMicros(NVS_COMMIT_US + length * 2);
+  return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!open_) return 0;
+  auto ns = nvs.find(namespace_);
+  if (ns == nvs.end()) return 0;
+  auto it = ns->second.find(key);
+  return it == ns->second.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  size_t length = getBytesLength(key);
+  if (length == 0 || length > maxLength) return 0;
+  std::memcpy(buffer, nvs[namespace_][key].data(), length);
+  return length;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t value;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+  int32_t value;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+float Preferences::getFloat(const char* key, float defaultValue) {
+  float value;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
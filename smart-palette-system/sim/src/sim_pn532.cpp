@@ -0,0 +1,206 @@
+/*
+  Native simulator - PN532 scripted taps
+
+  A scripted tap is a card resting in the field for a while. Every
+  InListPassiveTarget issued during that time finds it again, as the
+  real reader does, so a firmware that polls or re-arms quickly sees the
+  same card many times and has to debounce it.
+
+  With an IRQ pin attached the reader behaves like the chip in I2C mode:
+  startPassiveTargetIDDetection() only sends the command, and IRQ falls
+  once a card has been activated and the response is waiting.
+*/
+
+#include <Adafruit_PN532.h>
+#include <SimControl.h>
+#include "sim_internal.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint8_t MAX_UID_LENGTH = 7;
+const uint8_t NO_PIN = 0xFF;
+
+// I2C and RF timings of one exchange
+const uint32_t NFC_POLL_COST_US = 3000;      // Blocking InListPassiveTarget round trip
+const uint32_t NFC_COMMAND_COST_US = 1000;   // Command frame + ACK
+const uint32_t NFC_RESPONSE_COST_US = 1500;  // Reading the target data frame
+const uint32_t NFC_ACTIVATION_US = 6000;     // Card entering the field to IRQ
+
+// Fixed-size so delivering a tap never allocates inside the firmware's task
+struct ScriptedTap {
+  uint32_t atMillis;
+  uint32_t holdMillis;
+  uint8_t uid[MAX_UID_LENGTH];
+  uint8_t length;
+  bool read;
+};
+
+std::vector<ScriptedTap> taps;
+size_t targetsRead = 0;
+
+uint8_t irqPin = NO_PIN;
+bool detectionArmed = false;
+uint64_t armedAtUs = 0;
+bool responseReady = false;
+size_t responseTap = 0;
+
+// First card the reader can activate at or after `fromUs`
+bool nextActivation(uint64_t fromUs, uint64_t& atUs, size_t& index) {
+  for (size_t i = 0; i < taps.size(); i++) {
+    uint64_t start = static_cast<uint64_t>(taps[i].atMillis) * 1000;
+    uint64_t end = start + static_cast<uint64_t>(taps[i].holdMillis) * 1000;
+    uint64_t at = (start > fromUs ? start : fromUs) + NFC_ACTIVATION_US;
+    if (at < end) {
+      atUs = at;
+      index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Card in the field right now, for the blocking poll
+bool cardInField(size_t& index) {
+  uint64_t now = sim::nowMicros();
+  for (size_t i = 0; i < taps.size(); i++) {
+    uint64_t start = static_cast<uint64_t>(taps[i].atMillis) * 1000;
+    uint64_t end = start + static_cast<uint64_t>(taps[i].holdMillis) * 1000;
+    if (start <= now && now < end) {
+      index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool copyUid(size_t index, uint8_t* uid, uint8_t* uidLength) {
+  ScriptedTap& tap = taps[index];
+  std::memcpy(uid, tap.uid, tap.length);
+  *uidLength = tap.length;
+  tap.read = true;
+  targetsRead++;
+  return true;
+}
+
+// Without an ISR the firmware can still poll the IRQ level; the response
+// becomes ready whenever the clock passes the activation time
+bool responsePending() {
+  if (responseReady) return true;
+  uint64_t at;
+  size_t index;
+  if (detectionArmed && nextActivation(armedAtUs, at, index) && at <= sim::nowMicros()) {
+    responseReady = true;
+    responseTap = index;
+  }
+  return responseReady;
+}
+
+struct Pn532Irq : public sim::internal::EventSource {
+  bool nextEvent(uint64_t limitUs, uint64_t& atUs) override {
+    if (!detectionArmed || responseReady || irqPin == NO_PIN || !sim::internal::hasInterrupt(irqPin)) return false;
+    uint64_t at;
+    size_t index;
+    if (!nextActivation(armedAtUs, at, index) || at > limitUs) return false;
+    atUs = at > sim::nowMicros() ? at : sim::nowMicros();
+    return true;
+  }
+
+  void fire() override {
+    uint64_t at;
+    nextActivation(armedAtUs, at, responseTap);
+    responseReady = true;
+    sim::internal::raiseEdge(irqPin, FALLING);
+  }
+};
+
+Pn532Irq irqSource;
+bool irqSourceAdded = false;
+
+}  // namespace
+
+namespace sim {
+
+void scheduleNfcTap(uint32_t atMillis, const std::vector<uint8_t>& uid, uint32_t holdMillis) {
+  auto it = taps.begin();
+  while (it != taps.end() && it->atMillis <= atMillis) ++it;
+  ScriptedTap tap = {atMillis, holdMillis, {0},
+                     static_cast<uint8_t>(uid.size() > MAX_UID_LENGTH ? MAX_UID_LENGTH : uid.size()), false};
+  std::memcpy(tap.uid, uid.data(), tap.length);
+  taps.insert(it, tap);
+}
+
+size_t pendingNfcTaps() {
+  uint64_t now = nowMicros();
+  size_t pending = 0;
+  for (const ScriptedTap& tap : taps) {
+    uint64_t end = (static_cast<uint64_t>(tap.atMillis) + tap.holdMillis) * 1000;
+    if (!tap.read && end > now) pending++;
+  }
+  return pending;
+}
+
+size_t missedNfcTaps() {
+  uint64_t now = nowMicros();
+  size_t missed = 0;
+  for (const ScriptedTap& tap : taps) {
+    uint64_t end = (static_cast<uint64_t>(tap.atMillis) + tap.holdMillis) * 1000;
+    if (!tap.read && end <= now) missed++;
+  }
+  return missed;
+}
+
+size_t nfcTargetsRead() { return targetsRead; }
+
+namespace internal {
+
+bool pn532PinRead(uint8_t pin, int& level) {
+  if (irqPin == NO_PIN || pin != irqPin) return false;
+  level = responsePending() ? LOW : HIGH;
+  return true;
+}
+
+}  // namespace internal
+
+}  // namespace sim
+
+Adafruit_PN532::Adafruit_PN532(uint8_t irq, uint8_t reset, TwoWire* theWire)
+    : irq_(irq), reset_(reset), wire_(theWire) {}
+
+bool Adafruit_PN532::begin() {
+  irqPin = irq_;
+  if (!irqSourceAdded) {
+    sim::internal::addEventSource(&irqSource);
+    irqSourceAdded = true;
+  }
+  return true;
+}
+
+uint32_t Adafruit_PN532::getFirmwareVersion() { return 0x32010607; }
+
+bool Adafruit_PN532::SAMConfig() { return true; }
+
+bool Adafruit_PN532::readPassiveTargetID(uint8_t, uint8_t* uid, uint8_t* uidLength, uint16_t) {
+  sim::advanceMicros(NFC_POLL_COST_US);
+  size_t index;
+  if (!cardInField(index)) return false;
+  return copyUid(index, uid, uidLength);
+}
+
+// Returns the ACK, like the real driver; the card itself is reported on IRQ
+bool Adafruit_PN532::startPassiveTargetIDDetection(uint8_t) {
+  sim::advanceMicros(NFC_COMMAND_COST_US);
+  detectionArmed = true;
+  armedAtUs = sim::nowMicros();
+  responseReady = false;
+  return true;
+}
+
+bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength) {
+  if (!detectionArmed || !responsePending()) return false;
+  sim::advanceMicros(NFC_RESPONSE_COST_US);
+  detectionArmed = false;
+  responseReady = false;
+  return copyUid(responseTap, uid, uidLength);
+}
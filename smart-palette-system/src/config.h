@@ -11,17 +11,58 @@
 
 // Hardware Configuration
 #define PALETTE_ID "PAL_001"
-#define BOTTLE_WEIGHT 0.1f
-#define STABILITY_THRESHOLD 0.05f
-#define FILTER_SAMPLES 10
+#define DEFAULT_PRODUCT "175 mL" // Until `sku` selects another size
+#ifndef LOAD_CELLS
+#define LOAD_CELLS 2             // 4 for corner cells on the larger pallets
+#endif
+
+// Filter chain ahead of the weight window and estimator, fixed per pallet
+// variant at build time (FilterChain.h). All off by default.
+#ifndef VIBRATION_NOTCH_HZ
+#define VIBRATION_NOTCH_HZ 0     // Engine or conveyor ripple to notch out, Hz; 0 = none
+#endif
+#ifndef VIBRATION_NOTCH_Q10
+#define VIBRATION_NOTCH_Q10 10   // Notch Q x10; lower is wider and rings for less time
+#endif
+#ifndef WEIGHT_EMA_SHIFT
+#define WEIGHT_EMA_SHIFT 0       // EMA with alpha 1/2^n after the notch; 0 = none
+#endif
+
+// Glitch rejection on each cell's raw counts (a Hampel filter), ahead of
+// the fusion. A real step gets through GLITCH_WINDOW / 2 samples late.
+#ifndef GLITCH_WINDOW
+#define GLITCH_WINDOW 5          // Odd, 3 to 15 samples
+#endif
+#ifndef GLITCH_MIN_COUNTS
+#define GLITCH_MIN_COUNTS 350    // Never a glitch this close to the median (50 g at the nominal gain)
+#endif
+
+// Tuning defaults. Each can be overridden per pallet at run time with
+// `param <name> <value>` (kept in NVS, see TUNING_PARAMS in main.cpp).
+#define STABILITY_THRESHOLD 0.05f // 50g stability
+#define FILTER_SAMPLES 80         // 1 second window at 80 SPS
+#define PLATEAU_MIN_SAMPLES 40    // 0.5 s at 80 SPS before a cell's plateau counts (calibration)
+#define SETTLE_QUIET_MS   100     // No step in the weight for this long before it counts as settled
+#define WEIGHT_READ_DELAY 100     // ms between sample batches (~8 samples)
+#define API_SEND_INTERVAL 5000    // ms between progress samples
+#define DISPLAY_UPDATE    250     // Display poll; only changed text goes out
+#define IDLE_AFTER_MS     30000   // Quiet in IDLE this long: HX711s sleep between readings (0 = never)
+#define IDLE_SAMPLE_MS    500     // One reading per interval while idle
+#define WAKE_THRESHOLD_KG 0.2f    // An idle reading this far off brings full rate back
 
 // Pin Definitions
 #define HX711_1_DT    4
 #define HX711_1_SCK   5
 #define HX711_2_DT    16
 #define HX711_2_SCK   17
+#define HX711_3_DT    18
+#define HX711_3_SCK   19
+#define HX711_4_DT    13
+#define HX711_4_SCK   14
 #define PN532_SDA     21
 #define PN532_SCL     22
+#define PN532_IRQ     32
+#define PN532_RESET   33
 #define BLUE_LED      25
 #define GREEN_LED     26
 #define RED_LED       27
@@ -34,9 +75,6 @@
 #define SCREEN_ADDRESS 0x3C
 
 // Timing Constants
-#define DOUBLE_TAP_TIME   2000
-#define WEIGHT_READ_DELAY 100
-#define API_SEND_INTERVAL 5000
-#define DISPLAY_UPDATE    1000
+#define DOUBLE_TAP_TIME   2000  // 2 seconds for double tap
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+  Smart Inventory Palette - Heap allocation monitor
+
+  File: heap_monitor.cpp
+*/
+
+#include "heap_monitor.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+
+struct HeapTaskSlot {
+  TaskHandle_t task;
+  const char* name;
+  volatile uint32_t allocations;
+  volatile uint32_t frees;
+};
+
+static HeapTaskSlot slots[HEAP_MONITOR_MAX_TASKS];
+// Published with release only after the slot behind it is written, so a
+// reader never sees a half-filled slot
+static std::atomic<size_t> slotCount(0);
+
+// Serialises registration; tasks on both cores may register at once
+static portMUX_TYPE slotLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Each slot's counters are only ever incremented by its own task, so
+// lookups and counting take no lock
+static HeapTaskSlot* currentSlot() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  if (!self) return nullptr;
+  size_t count = slotCount.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    if (slots[i].task == self) return &slots[i];
+  }
+  return nullptr;
+}
+
+void heapMonitorRegisterTask(const char* name) {
+  portENTER_CRITICAL(&slotLock);
+  size_t count = slotCount.load(std::memory_order_relaxed);
+  if (count < HEAP_MONITOR_MAX_TASKS && !currentSlot()) {
+    HeapTaskSlot& slot = slots[count];
+    slot.task = xTaskGetCurrentTaskHandle();
+    slot.name = name;
+    slot.allocations = 0;
+    slot.frees = 0;
+    slotCount.store(count + 1, std::memory_order_release);
+  }
+  portEXIT_CRITICAL(&slotLock);
+}
+
+size_t heapMonitorTaskCount() {
+  return slotCount.load(std::memory_order_acquire);
+}
+
+HeapTaskStats heapMonitorTaskStats(size_t index) {
+  HeapTaskStats stats = {"", 0, 0};
+  if (index < slotCount.load(std::memory_order_acquire)) {
+    stats.name = slots[index].name;
+    stats.allocations = slots[index].allocations;
+    stats.frees = slots[index].frees;
+  }
+  return stats;
+}
+
+void heapMonitorPrint(Print& out) {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+  out.printf("Heap: free %u, min %u, largest %u", freeHeap, ESP.getMinFreeHeap(), largest);
+  out.printf(", frag %u%%\n", freeHeap ? 100 - (unsigned)((uint64_t)largest * 100 / freeHeap) : 0);
+  size_t count = slotCount.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; i++) {
+    out.printf("  %-14s allocs %u, frees %u\n", slots[i].name, slots[i].allocations, slots[i].frees);
+  }
+}
+
+// ============================================================================
+// LINK-TIME WRAPPERS
+// ============================================================================
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+  HeapTaskSlot* slot = currentSlot();
+  if (slot) slot->allocations = slot->allocations + 1;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  HeapTaskSlot* slot = currentSlot();
+  if (slot) slot->allocations = slot->allocations + 1;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  HeapTaskSlot* slot = currentSlot();
+  if (slot) slot->allocations = slot->allocations + 1;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr) {
+    HeapTaskSlot* slot = currentSlot();
+    if (slot) slot->frees = slot->frees + 1;
+  }
+  __real_free(ptr);
+}
+
+}  // extern "C"
@@ -0,0 +1,36 @@
+/*
+  Smart Inventory Palette - Heap allocation monitor
+
+  malloc/calloc/realloc/free are wrapped at link time (-Wl,--wrap=...
+  in platformio.ini) and every call is charged to the task that made
+  it, if that task has registered. The steady-state loops of the
+  registered tasks are meant to never touch the heap; a counter that
+  keeps climbing in the health report is a regression that would
+  fragment the heap over weeks of uptime.
+
+  File: heap_monitor.h
+*/
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+#define HEAP_MONITOR_MAX_TASKS 8
+
+struct HeapTaskStats {
+  const char* name;
+  uint32_t allocations;
+  uint32_t frees;
+};
+
+// Call from the task itself, before its loop
+void heapMonitorRegisterTask(const char* name);
+
+size_t heapMonitorTaskCount();
+HeapTaskStats heapMonitorTaskStats(size_t index);
+
+// Per-task counts plus free heap, low-water mark and fragmentation
+void heapMonitorPrint(Print& out);
+
+#endif
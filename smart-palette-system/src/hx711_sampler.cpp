@@ -0,0 +1,94 @@
+/*
+  Smart Inventory Palette - Interrupt-driven HX711 sampler
+
+  File: hx711_sampler.cpp
+*/
+
+#include "hx711_sampler.h"
+#include "freertos/FreeRTOS.h"
+
+// Held across each 25-pulse read; see shiftIn()
+static portMUX_TYPE shiftLock = portMUX_INITIALIZER_UNLOCKED;
+
+Hx711Sampler::Hx711Sampler(uint8_t doutPin, uint8_t sckPin)
+    : doutPin_(doutPin), sckPin_(sckPin) {}
+
+void Hx711Sampler::begin() {
+  pinMode(sckPin_, OUTPUT);
+  pinMode(doutPin_, INPUT);
+  digitalWrite(sckPin_, LOW);
+
+  // If a conversion is already waiting, DOUT is low and will not produce
+  // another edge until it has been read - drain it to re-arm the chip
+  if (digitalRead(doutPin_) == LOW) {
+    portENTER_CRITICAL(&shiftLock);
+    shiftIn();
+    portEXIT_CRITICAL(&shiftLock);
+  }
+  ring_.clear();
+
+  attachInterruptArg(digitalPinToInterrupt(doutPin_), onDataReady, this, FALLING);
+}
+
+void Hx711Sampler::end() {
+  detachInterrupt(digitalPinToInterrupt(doutPin_));
+}
+
+// DOUT floats high while the chip sleeps, so the interrupt goes first.
+// An ISR already running on the other core may still be mid-read; taking
+// shiftLock waits it out so SCK is not raised in the middle of a pulse train.
+void Hx711Sampler::powerDown() {
+  if (poweredDown_) return;
+  end();
+  portENTER_CRITICAL(&shiftLock);
+  digitalWrite(sckPin_, HIGH);
+  portEXIT_CRITICAL(&shiftLock);
+  poweredDown_ = true;
+}
+
+void Hx711Sampler::powerUp() {
+  if (!poweredDown_) return;
+  digitalWrite(sckPin_, LOW);
+  poweredDown_ = false;
+  ring_.clear();
+  attachInterruptArg(digitalPinToInterrupt(doutPin_), onDataReady, this, FALLING);
+}
+
+void IRAM_ATTR Hx711Sampler::onDataReady(void* arg) {
+  Hx711Sampler* sampler = static_cast<Hx711Sampler*>(arg);
+
+  // Our own clocking makes DOUT toggle and can latch a second edge;
+  // only a low DOUT with SCK idle means a real conversion
+  if (digitalRead(sampler->doutPin_) != LOW) return;
+
+  RawSample sample;
+  sample.timestampUs = micros();
+  portENTER_CRITICAL_ISR(&shiftLock);
+  sample.counts = sampler->shiftIn();
+  portEXIT_CRITICAL_ISR(&shiftLock);
+  sampler->ring_.push(sample);
+  sampler->taken_ = sampler->taken_ + 1;
+}
+
+// 24 data bits MSB first, then one extra pulse to select channel A at
+// gain 128 for the next conversion. SCK must not stay high for 60 us or
+// the chip powers down, so callers hold shiftLock, which masks the
+// interrupts that could stretch a pulse for the ~50 us the read takes.
+int32_t IRAM_ATTR Hx711Sampler::shiftIn() {
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < 24; i++) {
+    digitalWrite(sckPin_, HIGH);
+    delayMicroseconds(1);
+    value = (value << 1) | (digitalRead(doutPin_) == HIGH ? 1 : 0);
+    digitalWrite(sckPin_, LOW);
+    delayMicroseconds(1);
+  }
+  digitalWrite(sckPin_, HIGH);
+  delayMicroseconds(1);
+  digitalWrite(sckPin_, LOW);
+  delayMicroseconds(1);
+
+  // Sign-extend the 24-bit two's complement result
+  if (value & 0x800000) value |= 0xFF000000;
+  return static_cast<int32_t>(value);
+}
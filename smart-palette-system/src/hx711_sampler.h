@@ -0,0 +1,64 @@
+/*
+  Smart Inventory Palette - Interrupt-driven HX711 sampler
+
+  The HX711 pulls DOUT low when a conversion is ready (80 SPS with the
+  RATE pin high). A falling-edge ISR per chip clocks the 24-bit word out
+  straight away and pushes it, timestamped, into a lock-free ring that
+  the weight task drains in batches. Nothing is polled, so conversions
+  are not dropped while tasks are busy, and both cells are read within
+  microseconds of their own DRDY edge instead of whenever a task wakes.
+
+  powerDown() holds SCK high, which puts the chip to sleep (about 1 uA
+  instead of 1.5 mA) until powerUp() lets it fall again. The first
+  conversion after wake takes one full period plus the settling time.
+
+  File: hx711_sampler.h
+*/
+
+#ifndef HX711_SAMPLER_H
+#define HX711_SAMPLER_H
+
+#include <Arduino.h>
+#include <SampleRing.h>
+
+struct RawSample {
+  uint32_t timestampUs;
+  int32_t counts;
+};
+
+// ~400 ms of headroom at 80 SPS before the consumer must drain
+typedef SampleRing<RawSample, 32> RawSampleRing;
+
+class Hx711Sampler {
+public:
+  Hx711Sampler(uint8_t doutPin, uint8_t sckPin);
+
+  // Attach the DRDY interrupt. Call after any blocking HX711 library use
+  // (tare, calibration) - the library must not touch the pins afterwards.
+  void begin();
+  void end();
+
+  // Sleep between readings while the pallet is idle
+  void powerDown();
+  void powerUp();
+  bool poweredDown() const { return poweredDown_; }
+
+  uint8_t doutPin() const { return doutPin_; }
+  uint8_t sckPin() const { return sckPin_; }
+
+  RawSampleRing& samples() { return ring_; }
+  uint32_t overruns() const { return ring_.dropped(); }
+  uint32_t samplesTaken() const { return taken_; }
+
+private:
+  static void IRAM_ATTR onDataReady(void* arg);
+  int32_t IRAM_ATTR shiftIn();
+
+  uint8_t doutPin_;
+  uint8_t sckPin_;
+  RawSampleRing ring_;
+  volatile uint32_t taken_ = 0;
+  bool poweredDown_ = false;
+};
+
+#endif
@@ -19,61 +19,135 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <OledPanel.h>
 #include <HX711.h>
 #include <Adafruit_PN532.h>
+#include <WeightFilter.h>
+#include <FilterChain.h>
+#include <WeightEstimator.h>
+#include <LoadCellCalibration.h>
+#include <CellFusion.h>
+#include <BottleCounter.h>
+#include <Seqlock.h>
+#include <LittleFS.h>
+#include <TransactionJournal.h>
+#include <TruckRegistry.h>
+#include <Preferences.h>
+#include <ParameterStore.h>
+#include <atomic>
+#include "config.h"
+#include "hx711_sampler.h"
+#include "nfc_reader.h"
+#include "uplink_batcher.h"
+#include "heap_monitor.h"
+#include "trace_monitor.h"
+#include "serial_console.h"
+#include "remote_console.h"
+#include "truck_sync.h"
+#include "raw_recorder.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+// Automatic light sleep needs an SDK built with power management and
+// tickless idle, which the stock Arduino core is not; without it the idle
+// savings come from the sleeping HX711s and the longer task sleeps alone
+#if defined(ESP_PLATFORM) && CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#define LIGHT_SLEEP 1
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#else
+#define LIGHT_SLEEP 0
+#endif
 
 // ============================================================================
 // CONFIGURATION CONSTANTS
 // ============================================================================
 
-// WiFi Configuration
-const char* WIFI_SSID = "YOUR_WIFI_SSID";
-const char* WIFI_PASSWORD = "YOUR_WIFI_PASSWORD";
+// Wi-Fi, pins, the display and the tuning defaults are in config.h
 
 // API Configuration
 const char* API_BASE_URL = "https://your-saas-domain.com/api";
+const char* API_BATCH_URL = "https://your-saas-domain.com/api/palletBatch";
+const char* API_TRUCKS_URL = "https://your-saas-domain.com/api/palletTrucks";
+const char* API_CONSOLE_URL = "https://your-saas-domain.com/api/palletConsole";
 const char* API_KEY = "your-api-key";
+const char* API_ROOT_CA = nullptr;  // PEM root certificate of the API host; set for production
+
+// Weight processing; the plateau and estimator bounds scale with the
+// stability threshold
+const float PLATEAU_DRIFT_RATIO = 0.5;  // Noise allowed around a plateau
+const float PLATEAU_THRESHOLD_RATIO = 4;  // Accumulated excess that ends it
+const float ESTIMATE_NOISE_RATIO = 0.25;  // Sample noise the weight estimator assumes
+const float ESTIMATE_SETTLE_RATIO = 0.3;  // Uncertainty of a settled weight estimate
+const float DEFAULT_COUNTS_PER_KG = -7050.0;  // Nominal gain of an uncalibrated cell
 
-// Hardware Configuration
-const String PALETTE_ID = "PAL_001";
-const float BOTTLE_WEIGHT = 0.1;  // 100ml bottle = 0.1kg
-const float STABILITY_THRESHOLD = 0.05;  // 50g stability
-const int FILTER_SAMPLES = 10;
-
-// Pin Definitions
-#define HX711_1_DT    4
-#define HX711_1_SCK   5
-#define HX711_2_DT    16
-#define HX711_2_SCK   17
-#define PN532_SDA     21
-#define PN532_SCL     22
-#define BLUE_LED      25
-#define GREEN_LED     26
-#define RED_LED       27
-#define BUILTIN_LED   2
-
-// Display Configuration
-#define SCREEN_WIDTH  128
-#define SCREEN_HEIGHT 64
-#define OLED_RESET    -1
-#define SCREEN_ADDRESS 0x3C
+// Load cells, one HX711 each: two along the pallet, or four at the
+// corners of the larger pallets (build with -DLOAD_CELLS=4)
+static_assert(LOAD_CELLS >= 1 && LOAD_CELLS <= CellFusion::MAX_CELLS, "LOAD_CELLS out of range");
+const uint8_t NUM_CELLS = LOAD_CELLS;
 
 // Timing Constants
-#define DOUBLE_TAP_TIME   2000  // 2 seconds for double tap
-#define WEIGHT_READ_DELAY 100   // 100ms between weight readings
-#define API_SEND_INTERVAL 5000  // 5 seconds between API updates
-#define DISPLAY_UPDATE    1000  // 1 second display update
+#define MAX_PAIR_SKEW_US  6000  // Cell samples further apart are not paired
+#define CELL_SILENT_US    250000 // No conversion for this long: sets go on without the cell
+#define UPLINK_WINDOW     15000 // At most one uplink request per 15 seconds
+#define UPLINK_MAX_REJECTIONS 3 // Refusals of one transaction before it is set aside as a dead letter
+#define COMPLETE_HOLD_TIME 3000 // Completed state shown before returning to idle
+#define SETTLE_TIMEOUT    5000  // Longest wait for a stable weight after a completion tap
+#define TRUCK_SYNC_INTERVAL 600000 // Check the server for fleet changes every 10 minutes
+#define CONSOLE_POLL_INTERVAL 30000 // Check the server for queued maintenance commands
+#define HEALTH_INTERVAL   30000 // System health report on the serial monitor
+#define HX711_SPS         80    // Nominal conversion rate of each cell (RATE pin high)
+#define RAW_RECORD_SECONDS 60   // `rec start` without a duration
+#define IDLE_READ_TIMEOUT 200   // Wake to idle reading: a powered-up HX711 converts within ~100 ms
+#define IDLE_DISPLAY_INTERVAL 2000 // Display poll while the weight task samples at the idle rate
+#define IDLE_API_WAIT     5000  // API task's sleep while idle (1 s otherwise)
+#define JOURNAL_QUEUE_WAIT 100  // Weight task's longest wait for a journal queue slot; the sample rings hold ~400 ms
+
+// Task stacks, in bytes; `trace` shows how much of each was ever used
+#define WEIGHT_TASK_STACK  4096
+#define NFC_TASK_STACK     4096
+#define API_TASK_STACK     8192 // TLS handshakes run here
+#define JOURNAL_TASK_STACK 4096
+#define DISPLAY_TASK_STACK 2048
+
+// Fixed-size identifiers so SystemData can be copied as a plain struct
+#define CARD_ID_LENGTH     32   // "XX:" per byte, for logging only
+#define TRUCK_ID_LENGTH    sizeof(TruckEntry::truckId)
 
 // ============================================================================
 // GLOBAL OBJECTS
 // ============================================================================
-HX711 scale1, scale2;
+HX711 scales[NUM_CELLS];
+Hx711Sampler sampler1(HX711_1_DT, HX711_1_SCK);
+#if LOAD_CELLS >= 2
+Hx711Sampler sampler2(HX711_2_DT, HX711_2_SCK);
+#endif
+#if LOAD_CELLS >= 3
+Hx711Sampler sampler3(HX711_3_DT, HX711_3_SCK);
+#endif
+#if LOAD_CELLS >= 4
+Hx711Sampler sampler4(HX711_4_DT, HX711_4_SCK);
+#endif
+Hx711Sampler* const samplers[NUM_CELLS] = {
+  &sampler1,
+#if LOAD_CELLS >= 2
+  &sampler2,
+#endif
+#if LOAD_CELLS >= 3
+  &sampler3,
+#endif
+#if LOAD_CELLS >= 4
+  &sampler4,
+#endif
+};
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-Adafruit_PN532 nfc(PN532_SDA, PN532_SCL);
+OledPanel panel(display);
+Adafruit_PN532 nfc(PN532_IRQ, PN532_RESET);
+NfcReader nfcReader(nfc, PN532_IRQ);
 
 // ============================================================================
 // SYSTEM STATE VARIABLES
@@ -83,7 +157,10 @@ enum SystemState {
   STATE_LOAD_MODE,
   STATE_LOAD_COMPLETE,
   STATE_UNLOAD_MODE,
-  STATE_UNLOAD_COMPLETE
+  STATE_UNLOAD_COMPLETE,
+  STATE_LOAD_SETTLING,       // Completion tapped, waiting for a stable weight
+  STATE_UNLOAD_SETTLING,
+  STATE_ANY                  // Transition table wildcard, never current
 };
 
 struct SystemData {
@@ -91,15 +168,36 @@ struct SystemData {
   float totalWeight;
   float filteredWeight;
   int bottleCount;
-  String currentTruckId;
-  String lastNfcCardId;
+  bool countAmbiguous;       // bottleCount needs a check by hand
+  int16_t currentTruck;      // Registry handle, -1 = none
+  char currentTruckId[TRUCK_ID_LENGTH]; // Copied when the transaction starts; the handle may be reused
+  NfcUid lastNfcUid;
   unsigned long lastNfcTapTime;
   unsigned long transactionStartTime;
   bool isWeightStable;
+  int32_t rawCounts[NUM_CELLS];  // Mean raw reading per cell over its current plateau
+  float cellWeights[NUM_CELLS];  // kg, corner factors applied
+  float cellShares[NUM_CELLS];   // Of the total, learned while all cells were healthy
+  uint8_t cellFaults[NUM_CELLS]; // CellFault bits
+  uint32_t cellGlitches[NUM_CELLS]; // Raw samples rejected as glitches since boot
+  uint32_t cellOverruns[NUM_CELLS]; // Conversions lost to a full sample ring
+  uint32_t unpairedSamples;  // Conversions dropped, too far apart from the other cells'
+  uint8_t faultyCells;       // Bit per cell left out of the total
+  uint8_t transactionFaults; // faultyCells seen since the transaction started
+  bool cellsSettled;         // Every cell on a plateau: safe to capture
+  bool samplingIdle;         // HX711s asleep between idle-rate readings
+  float temperature;         // Die temperature used for compensation, C
   bool wifiConnected;
+  uint16_t pendingUploads;   // Journaled transactions not yet acknowledged
   int transactionCount;
   float initialWeight;
   float weightChange;
+  unsigned long captureRequestedAt;  // Completion tap
+  float capturedWeight;      // Settled estimate, or filtered weight on timeout
+  float capturedVariance;    // kg^2, of the settled estimate
+  unsigned long settleTime;  // Completion tap to settled weight, ms
+  bool captureSettled;
+  BottleCount capturedCount; // Of capturedWeight
 };
 
 SystemData systemData = {
@@ -107,39 +205,265 @@ SystemData systemData = {
   .totalWeight = 0.0,
   .filteredWeight = 0.0,
   .bottleCount = 0,
-  .currentTruckId = "",
-  .lastNfcCardId = "",
+  .countAmbiguous = false,
+  .currentTruck = -1,
+  .currentTruckId = {},
+  .lastNfcUid = {{0}, 0},
   .lastNfcTapTime = 0,
   .transactionStartTime = 0,
   .isWeightStable = false,
+  .rawCounts = {},
+  .cellWeights = {},
+  .cellShares = {},
+  .cellFaults = {},
+  .cellGlitches = {},
+  .cellOverruns = {},
+  .unpairedSamples = 0,
+  .faultyCells = 0,
+  .transactionFaults = 0,
+  .cellsSettled = false,
+  .samplingIdle = false,
+  .temperature = 0.0,
   .wifiConnected = false,
+  .pendingUploads = 0,
   .transactionCount = 0,
   .initialWeight = 0.0,
-  .weightChange = 0.0
+  .weightChange = 0.0,
+  .captureRequestedAt = 0,
+  .capturedWeight = 0.0,
+  .capturedVariance = 0.0,
+  .settleTime = 0,
+  .captureSettled = false,
+  .capturedCount = {}
+};
+
+// Workflow events. Other tasks and the workflow timers post them to
+// workflowQueue; the weight task runs them through workflowTable.
+enum WorkflowEvent {
+  EVT_TAP,                   // Known card; double taps are told apart on dispatch
+  EVT_DOUBLE_TAP,            // Same card again within DOUBLE_TAP_TIME
+  EVT_WEIGHT_STABLE,         // Filtered weight has just settled
+  EVT_SETTLE_TIMEOUT,        // Gave up waiting for it
+  EVT_HOLD_EXPIRED,          // Completed transaction shown long enough
+  EVT_NETWORK_ACK,           // Journal entries left unacknowledged changed
+  EVT_WIFI_CONNECTED,
+  EVT_WIFI_DISCONNECTED
+};
+
+struct WorkflowMessage {
+  WorkflowEvent event;
+  int16_t truck;                 // Registry handle, -1 = none
+  NfcUid uid;                    // length 0 when not caused by a tap
+  unsigned long at;              // millis() when the tap or event happened
+  uint16_t pendingUploads;       // EVT_NETWORK_ACK: journal entries left
+};
+
+// Thread-safe data sharing: the weight task owns `systemData` and is its
+// only writer. It publishes a copy after every batch; the other tasks read
+// that copy without locking and post WorkflowMessages instead of writing.
+Seqlock<SystemData> publishedData;
+QueueHandle_t workflowQueue;
+
+// One-shot timers for the workflow's waits; the callbacks only post events
+TimerHandle_t holdTimer;
+TimerHandle_t settleTimer;
+
+// OLED fields, owned by the display task
+TaskHandle_t displayTask = nullptr;  // Notified to redraw at once
+bool displayReady = false;
+int8_t weightField, bottlesField, stateField, truckField, uploadsField, statusField;
+
+// Completed transactions, handed from the weight task to the journal
+// writer by value. Plain fixed-size data only: FreeRTOS queues copy items
+// bytewise.
+enum ApiMessageType : uint8_t {
+  API_LOAD_COMPLETE,
+  API_UNLOAD_COMPLETE
+};
+
+struct ApiMessage {
+  ApiMessageType type;
+  char truckId[TRUCK_ID_LENGTH];
+  int32_t bottleCount;
+  float weight;
+  float initialWeight;
+  float weightChange;
+  float weightVariance;      // Of the captured estimate
+  uint32_t settleTime;       // ms
+  bool settled;              // False if captured on the settle timeout
+  uint8_t faultyCells;       // Cells estimated at some point during the transaction
+  uint8_t sku;               // Index into STANDARD_SKUS
+  uint8_t countConfidence;   // Percent
+  bool countCheck;           // Count not confident enough to accept
+  uint32_t startedAt;        // millis()
+  uint32_t completedAt;
+};
+
+QueueHandle_t journalQueue;
+
+// Completed transactions are only ever sent from flash, so they survive
+// Wi-Fi outages and reboots. The journal writer appends them and the API
+// task reads and acknowledges them; journalMutex serialises the two and
+// is never held across a request.
+TransactionJournal journal;
+SemaphoreHandle_t journalMutex;
+
+// Random per boot; a journaled timestamp only compares with millis() on
+// the boot that wrote it
+uint32_t bootId = 0;
+
+// Progress and journaled transactions leave in one request per window
+UplinkBatcher uplink(API_BATCH_URL, API_KEY, PALETTE_ID);
+
+// Raw counts and taps to flash on request (`rec`), for replaying a
+// field problem through the simulator
+RawRecorder rawRecorder(LittleFS);
+
+// Field tuning, defaults from config.h. `param` overrides a value per
+// pallet in NVS; bump TUNING_VERSION when an entry changes meaning. The
+// console (loop) and the remote console (API task) change the store
+// under tuningMutex and publish a copy, which the tasks pick up on their
+// next pass. The weight task restarts its filters when it changes.
+enum TuningParam : uint8_t {
+  TUNE_FILTER_SAMPLES,
+  TUNE_STABILITY,
+  TUNE_PLATEAU_SAMPLES,
+  TUNE_WEIGHT_READ_MS,
+  TUNE_PROGRESS_MS,
+  TUNE_DISPLAY_MS,
+  TUNE_IDLE_AFTER_MS,
+  TUNE_IDLE_SAMPLE_MS,
+  TUNE_WAKE_KG,
+  TUNE_SETTLE_QUIET_MS,
+  TUNING_PARAM_COUNT
+};
+
+const ParamSpec TUNING_PARAMS[TUNING_PARAM_COUNT] = {
+  {"filter_samples", PARAM_INT, 8, 400, FILTER_SAMPLES, "samples"},
+  {"stability_kg", PARAM_FLOAT, 0.005f, 1.0f, STABILITY_THRESHOLD, "kg"},
+  {"plateau_samples", PARAM_INT, 8, 400, PLATEAU_MIN_SAMPLES, "samples"},
+  {"weight_read_ms", PARAM_INT, 20, 300, WEIGHT_READ_DELAY, "ms"},  // The sample rings hold ~400 ms
+  {"progress_ms", PARAM_INT, 1000, 60000, API_SEND_INTERVAL, "ms"},
+  {"display_ms", PARAM_INT, 50, 5000, DISPLAY_UPDATE, "ms"},
+  {"idle_after_ms", PARAM_INT, 0, 3600000, IDLE_AFTER_MS, "ms"},
+  {"idle_sample_ms", PARAM_INT, 100, 2000, IDLE_SAMPLE_MS, "ms"},  // Bounds the wake latency
+  {"wake_kg", PARAM_FLOAT, 0.02f, 5.0f, WAKE_THRESHOLD_KG, "kg"},
+  {"settle_quiet_ms", PARAM_INT, 0, 2000, SETTLE_QUIET_MS, "ms"}
+};
+const uint16_t TUNING_VERSION = 1;
+
+struct Tuning {
+  uint32_t generation;       // ParameterStore::generation() of this copy
+  uint16_t filterSamples;
+  float stabilityKg;
+  uint16_t plateauSamples;
+  uint32_t weightReadMs;
+  uint32_t progressMs;
+  uint32_t displayMs;
+  uint32_t idleAfterMs;      // 0: never sample at the idle rate
+  uint32_t idleSampleMs;
+  float wakeKg;
+  uint32_t settleQuietMs;
 };
 
-// Thread-safe data sharing
-SemaphoreHandle_t dataMutex;
-QueueHandle_t apiQueue;
+ParameterStore tuningStore(TUNING_PARAMS, TUNING_PARAM_COUNT, TUNING_VERSION, "tuning");
+Seqlock<Tuning> publishedTuning;
+SemaphoreHandle_t tuningMutex;
+
+// Weight filtering (O(1) running mean + min/max over the window), in
+// fixed point: 10 mg per unit keeps well below one HX711 count and four
+// saturated cells inside int32. Kilograms again only for display,
+// counting and the uplink.
+const float WEIGHT_UNITS_PER_KG = 100000;
+WeightFilter weightFilter(FILTER_SAMPLES);
+
+// Ripple removal ahead of the window and the estimator, per sample of the
+// fused total; the stages are picked at build time in config.h and
+// compile to a single inline kernel
+typedef FilterChain<Notch<HX711_SPS, VIBRATION_NOTCH_HZ, VIBRATION_NOTCH_Q10>, Ema<WEIGHT_EMA_SHIFT>> WeightChain;
+WeightChain weightChain;
+
+// Transactions capture the settled weight estimate, not the window that
+// happens to be current when the card is tapped. The estimator follows a
+// step at once and settles as soon as the ringing has died away, where a
+// window or a plateau still needs its full length after it.
+WeightEstimator estimator(STABILITY_THRESHOLD * ESTIMATE_NOISE_RATIO, STABILITY_THRESHOLD * ESTIMATE_SETTLE_RATIO,
+                          SETTLE_QUIET_MS);
+
+// A single corrupt read (a bit slip, a knock on the pallet) is replaced
+// by the median of its neighbours before it reaches the fusion, where it
+// would read as a saturated cell or a step in the total
+typedef Hampel<GLITCH_WINDOW, GLITCH_MIN_COUNTS> GlitchFilter;
+GlitchFilter glitchFilters[NUM_CELLS];
+
+// Cells are fused into the total one sample set at a time, each watched
+// for faults. Every cell also keeps a raw plateau of its own for
+// calibration: a weight moved from one cell to another leaves the total
+// flat. Its bounds are the total's, in counts.
+const float CELL_PLATEAU_SCALE = fabsf(DEFAULT_COUNTS_PER_KG);
+CellFusion fusion(NUM_CELLS, STABILITY_THRESHOLD * PLATEAU_DRIFT_RATIO * CELL_PLATEAU_SCALE,
+                  STABILITY_THRESHOLD * PLATEAU_THRESHOLD_RATIO * CELL_PLATEAU_SCALE, PLATEAU_MIN_SAMPLES);
+uint32_t lastSampleUs[NUM_CELLS];
+uint32_t unpairedSamples = 0;
+
+// Idle-rate sampling (weight task only). After idleAfterMs in IDLE with
+// the weight at rest, the HX711s are powered up for one reading per
+// idleSampleMs and sleep in between. A reading wakeKg away from the
+// weight at rest, or any event that leaves IDLE (a tap), brings full
+// rate back; the `wake` trace stage times the switch-over.
+uint32_t quietSinceMs = 0;
+float idleBaselineKg = 0;
+bool wakePending = false;
+uint32_t wakeTriggerMs = 0;
+#if LIGHT_SLEEP
+esp_pm_lock_handle_t fullRateLock;  // Held while the DRDY interrupts must be served
+#endif
+
+// Counts-to-kg curve of each cell, restored from NVS at boot. The console
+// (loop) and the remote console (API task) change it under
+// calibrationMutex, which also keeps them to one Seqlock writer at a
+// time; the weight task picks up the published copy every batch.
+struct ScaleCalibration {
+  CellCalibration cells[NUM_CELLS];
+  float corners[NUM_CELLS];  // Load-position factors, 1 until solved
+};
+
+ScaleCalibration calibration;
+Seqlock<ScaleCalibration> publishedCalibration;
+SemaphoreHandle_t calibrationMutex;
+CalibrationStore calibrationStore;
+
+// NFC card to truck mapping, persisted to flash and provisioned over the
+// serial console or downloaded from the server. Trucks are referred to
+// by registry handle elsewhere. The NFC task looks cards up while the
+// console (loop) and the fleet download (API task) change entries, so
+// every access goes through registryMutex.
+TruckRegistry trucks;
+SemaphoreHandle_t registryMutex;
+TruckSync truckSync(API_TRUCKS_URL, API_KEY, PALETTE_ID);
+SerialConsole console(Serial);
 
-// Weight filtering
-float weightReadings[FILTER_SAMPLES];
-int readingIndex = 0;
-bool filterInitialized = false;
+// Product on this pallet, an index into STANDARD_SKUS. Set over the
+// console (loop or API task) and kept in NVS; the weight task reads it
+// for every count.
+std::atomic<uint8_t> activeProduct(0);
+Preferences productPrefs;
+RemoteConsole remoteConsole(console, API_CONSOLE_URL, API_KEY, PALETTE_ID);
 
-// NFC Card to Truck mapping
+// Seeded on first boot, until the fleet has been provisioned
 struct TruckMapping {
-  String cardId;
-  String truckId;
-  String driverName;
+  uint8_t uid[TruckRegistry::UID_MAX_LENGTH];
+  uint8_t uidLength;
+  const char* truckId;
+  const char* driverName;
 };
 
-TruckMapping truckCards[] = {
-  {"04:52:F3:2A", "TRUCK_A", "Driver John"},
-  {"04:A1:B2:3C", "TRUCK_B", "Driver Mike"},
-  {"04:C4:D5:E6", "TRUCK_C", "Driver Sarah"}
+const TruckMapping defaultTrucks[] = {
+  {{0x04, 0x52, 0xF3, 0x2A}, 4, "TRUCK_A", "Driver John"},
+  {{0x04, 0xA1, 0xB2, 0x3C}, 4, "TRUCK_B", "Driver Mike"},
+  {{0x04, 0xC4, 0xD5, 0xE6}, 4, "TRUCK_C", "Driver Sarah"}
 };
-const int NUM_TRUCKS = 3;
+const int NUM_DEFAULT_TRUCKS = 3;
 
 // ============================================================================
 // FUNCTION DECLARATIONS
@@ -151,34 +475,70 @@ void loop();
 void initializeHardware();
 void initializeWiFi();
 void initializeDisplay();
+void initializeDisplayLayout();
 void initializeNFC();
+void initializeCalibration();
 void initializeLEDs();
+void initializeJournal();
+void initializeTruckRegistry();
+void initializeProduct();
+void initializeTuning();
+void initializePowerManagement();
 
 // FreeRTOS Tasks
 void weightMonitoringTask(void* parameter);
 void nfcWorkflowTask(void* parameter);
 void apiCommunicationTask(void* parameter);
+void journalWriterTask(void* parameter);
 void displayUpdateTask(void* parameter);
 
 // Core functions
+void applyTuning(const Tuning& tuning);
+bool canSampleIdle();
+void enterIdleSampling(const Tuning& tuning);
+bool readIdleWeight(float& kg);
+float restingWeight(const int32_t* counts, const ScaleCalibration& cal, float tempC);
+void resumeFullRate(uint32_t triggerMs);
 void readWeightData();
-void processNfcEvent(String cardId);
-void updateSystemState();
-void controlLEDs();
-void sendApiUpdate();
-void updateDisplay();
+uint8_t nextSampleSet(RawSample* set);
+void reportCellFaults(uint8_t faultyCells);
+void processNfcEvent(const NfcTap& tap);
+WorkflowMessage makeWorkflowMessage(WorkflowEvent event);
+bool postWorkflowEvent(const WorkflowMessage& message, TickType_t ticksToWait);
+void dispatchWorkflowEvent(WorkflowMessage message);
+void onWorkflowTimer(TimerHandle_t timer);
+void queueCompletion(ApiMessageType type);
+void controlLEDs(const SystemData& data);
+void queueProgressSample(const SystemData& data);
+void updateDisplay(const SystemData& data);
+const char* stateLabel(SystemState state);
 
 // Utility functions
-String getTruckIdFromCard(String cardId);
-bool isDoubleTap(unsigned long currentTime);
+int16_t findTruckByUid(const NfcUid& uid);
+const char* truckName(int16_t truck, char* buffer, size_t size);
+void formatUid(const NfcUid& uid, char* buffer, size_t size);
+void handleTruckCommand(char* args, Print& out);
+void handleCalibrationCommand(char* args, Print& out);
+void handleProductCommand(char* args, Print& out);
+void handleTraceCommand(char* args, Print& out);
+void handleRecordCommand(char* args, Print& out);
+void handleParamCommand(char* args, Print& out);
+void printParam(uint8_t index, Print& out);
+void publishTuning();
+void printCalibration(const SystemData& data, Print& out);
+void printSampleLoss(const SystemData& data, Print& out);
+bool isDoubleTap(const SystemData& data, const WorkflowMessage& tap);
 void changeSystemState(SystemState newState);
-float calculateBottleCount(float weight);
+BottleCount countBottles(float weight, float noiseSd);
 bool isWeightStable();
+int32_t toWeightUnits(float kg);
+float weightUnitsToKg(int32_t units);
 
 // API functions
-bool sendLoadingTransaction(bool isComplete = false);
-bool sendUnloadingTransaction(bool isComplete = false);
-bool makeApiRequest(String endpoint, JsonDocument& payload);
+bool journalTransaction(const ApiMessage& message);
+bool flushUplink();
+void postUploadStatus();
+void syncTrucks();
 
 // ============================================================================
 // MAIN SETUP FUNCTION
@@ -195,52 +555,80 @@ void setup() {
   // Initialize hardware
   initializeHardware();
   
-  // Create mutex for thread-safe data access
-  dataMutex = xSemaphoreCreateMutex();
+  // Publish the initial state and create the event queue for other tasks
+  publishedData.write(systemData);
+  workflowQueue = xQueueCreate(8, sizeof(WorkflowMessage));
+  holdTimer = xTimerCreate("CompleteHold", pdMS_TO_TICKS(COMPLETE_HOLD_TIME), pdFALSE,
+                           reinterpret_cast<void*>(EVT_HOLD_EXPIRED), onWorkflowTimer);
+  settleTimer = xTimerCreate("SettleWait", pdMS_TO_TICKS(SETTLE_TIMEOUT), pdFALSE,
+                             reinterpret_cast<void*>(EVT_SETTLE_TIMEOUT), onWorkflowTimer);
   
-  // Create queue for API communication
-  apiQueue = xQueueCreate(10, sizeof(String));
+  // Completed transactions on their way to flash
+  journalQueue = xQueueCreate(10, sizeof(ApiMessage));
   
   // Create FreeRTOS tasks
+  TaskHandle_t task;
   xTaskCreatePinnedToCore(
     weightMonitoringTask,   // Function
     "WeightMonitor",        // Name
-    4096,                   // Stack size
+    WEIGHT_TASK_STACK,      // Stack size
     NULL,                   // Parameter
     2,                      // Priority
-    NULL,                   // Task handle
+    &task,                  // Task handle
     0                       // Core 0
   );
+  traceWatchTask(task, "WeightMonitor", WEIGHT_TASK_STACK);
   
   xTaskCreatePinnedToCore(
     nfcWorkflowTask,
     "NFCWorkflow",
-    4096,
+    NFC_TASK_STACK,
     NULL,
     3,                      // Higher priority for NFC
-    NULL,
+    &task,
     1                       // Core 1
   );
+  traceWatchTask(task, "NFCWorkflow", NFC_TASK_STACK);
   
   xTaskCreatePinnedToCore(
     apiCommunicationTask,
     "APIComm",
-    8192,                   // Larger stack for HTTP
+    API_TASK_STACK,
     NULL,
     1,
+    &task,
+    1                       // Core 1
+  );
+  traceWatchTask(task, "APIComm", API_TASK_STACK);
+  
+  xTaskCreatePinnedToCore(
+    journalWriterTask,
+    "JournalWriter",
+    JOURNAL_TASK_STACK,
     NULL,
+    2,                      // Ahead of the API task; they share only journalMutex
+    &task,
     1                       // Core 1
   );
+  traceWatchTask(task, "JournalWriter", JOURNAL_TASK_STACK);
   
   xTaskCreatePinnedToCore(
     displayUpdateTask,
     "DisplayUpdate",
-    2048,
+    DISPLAY_TASK_STACK,
     NULL,
     1,
-    NULL,
+    &task,
     0                       // Core 0
   );
+  traceWatchTask(task, "DisplayUpdate", DISPLAY_TASK_STACK);
+  displayTask = task;
+  
+  rawRecorder.begin(NUM_CELLS, HX711_SPS);
+  traceWatchTask(rawRecorder.task(), "RawRecorder", RawRecorder::STACK_SIZE);
+  
+  console.addCommand("trace", handleTraceCommand);
+  console.addCommand("rec", handleRecordCommand);
   
   Serial.println("System initialized successfully!");
   Serial.println("All tasks started. System ready for operation.");
@@ -251,16 +639,27 @@ void setup() {
 // MAIN LOOP (Minimal - Most work done in tasks)
 // ============================================================================
 void loop() {
+  static unsigned long lastHealthReport = 0;
+  
   // Main loop kept minimal since FreeRTOS tasks handle everything
   vTaskDelay(1000 / portTICK_PERIOD_MS);
   
-  // Monitor system health
-  if (millis() % 30000 == 0) {  // Every 30 seconds
+  // Maintenance commands typed on the serial monitor
+  console.poll();
+  
+  // Monitor system health. The loop wakes once a second at no particular
+  // millisecond, so this goes by elapsed time rather than millis() % N
+  if (millis() - lastHealthReport >= HEALTH_INTERVAL) {
+    lastHealthReport = millis();
+    SystemData snapshot = publishedData.read();
     Serial.printf("System Health: State=%d, Weight=%.2f kg, Bottles=%d, WiFi=%s\n", 
-                  systemData.currentState, 
-                  systemData.filteredWeight, 
-                  systemData.bottleCount,
-                  systemData.wifiConnected ? "OK" : "DISCONNECTED");
+                  snapshot.currentState, 
+                  snapshot.filteredWeight, 
+                  snapshot.bottleCount,
+                  snapshot.wifiConnected ? "OK" : "DISCONNECTED");
+    printSampleLoss(snapshot, Serial);
+    heapMonitorPrint(Serial);
+    tracePrintStacks(Serial);
   }
 }
 
@@ -277,21 +676,31 @@ void initializeHardware() {
   initializeLEDs();
   initializeDisplay();
   initializeNFC();
+  initializeJournal();
+  initializeTruckRegistry();
+  initializeProduct();
+  initializeTuning();
+  initializePowerManagement();
   
   // Initialize load cells
   Serial.print("Initializing load cells... ");
-  scale1.begin(HX711_1_DT, HX711_1_SCK);
-  scale2.begin(HX711_2_DT, HX711_2_SCK);
-  
-  if (scale1.is_ready() && scale2.is_ready()) {
-    Serial.println("SUCCESS");
-    // Set calibration factors (update these after calibration)
-    scale1.set_scale(-7050.0);  // Calibration factor for scale 1
-    scale2.set_scale(-7050.0);  // Calibration factor for scale 2
-    scale1.tare();
-    scale2.tare();
+  uint8_t ready = 0;
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    scales[i].begin(samplers[i]->doutPin(), samplers[i]->sckPin());
+    if (scales[i].is_ready()) ready++;
+  }
+  
+  if (ready == NUM_CELLS) {
+    Serial.printf("SUCCESS (%u cells)\n", NUM_CELLS);
   } else {
-    Serial.println("FAILED - Check connections");
+    Serial.printf("FAILED - %u of %u cells ready, check connections\n", ready, NUM_CELLS);
+  }
+  initializeCalibration();
+  
+  // From here on the DRDY interrupts own the HX711 pins
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    samplers[i]->begin();
+    lastSampleUs[i] = micros();
   }
   
   // Initialize WiFi
@@ -338,6 +747,26 @@ void initializeDisplay() {
   display.println("Smart Palette v2.0");
   display.println("Initializing...");
   display.display();
+  displayReady = true;
+}
+
+// One text row per 8-pixel page, so a changed value only costs the
+// columns it occupies on its own page
+void initializeDisplayLayout() {
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(0, 0);
+  display.println("Smart Palette v2.0");
+  display.drawLine(0, 10, SCREEN_WIDTH, 10, SSD1306_WHITE);
+
+  weightField = panel.addField(0, 16, OledPanel::MAX_FIELD_CHARS);
+  bottlesField = panel.addField(0, 24, OledPanel::MAX_FIELD_CHARS);
+  stateField = panel.addField(0, 32, OledPanel::MAX_FIELD_CHARS);
+  truckField = panel.addField(0, 40, OledPanel::MAX_FIELD_CHARS);
+  uploadsField = panel.addField(0, 48, OledPanel::MAX_FIELD_CHARS);
+  statusField = panel.addField(0, 56, OledPanel::MAX_FIELD_CHARS);
+  panel.begin(SCREEN_ADDRESS);
 }
 
 void initializeNFC() {
@@ -358,6 +787,123 @@ void initializeNFC() {
   nfc.SAMConfig();
 }
 
+void initializeJournal() {
+  Serial.print("Initializing transaction journal... ");
+  
+  bootId = esp_random();
+  journalMutex = xSemaphoreCreateMutex();
+  if (!LittleFS.begin(true) || !journal.begin(LittleFS, esp_random())) {
+    Serial.println("FAILED - transactions will not survive outages");
+    return;
+  }
+  
+  Serial.println("SUCCESS");
+  Serial.printf("Journal %08X: %u pending, %u bytes", journal.journalId(),
+                journal.pendingCount(), (unsigned)journal.sizeBytes());
+  if (journal.discardedBytes() > 0) {
+    Serial.printf(", %u corrupt bytes discarded", journal.discardedBytes());
+  }
+  Serial.println();
+}
+
+void initializeTruckRegistry() {
+  Serial.print("Loading truck registry... ");
+  
+  registryMutex = xSemaphoreCreateMutex();
+  console.addCommand("truck", handleTruckCommand);
+  
+  if (trucks.begin(LittleFS)) {
+    Serial.printf("%u trucks (version %u)\n", (unsigned)trucks.count(), trucks.version());
+    return;
+  }
+  
+  // Nothing saved yet (or unreadable): start from the built-in fleet and
+  // let the next download from the server replace it
+  for (int i = 0; i < NUM_DEFAULT_TRUCKS; i++) {
+    trucks.put(defaultTrucks[i].uid, defaultTrucks[i].uidLength,
+               defaultTrucks[i].truckId, defaultTrucks[i].driverName);
+  }
+  trucks.save();
+  Serial.printf("none saved, %u defaults\n", (unsigned)trucks.count());
+}
+
+void initializeProduct() {
+  Serial.print("Loading product... ");
+  
+  console.addCommand("sku", handleProductCommand);
+  
+  char size[16] = "";
+  if (productPrefs.begin("product", true)) {
+    productPrefs.getString("size", size, sizeof(size));
+    productPrefs.end();
+  }
+  int index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, size);
+  bool saved = index >= 0;
+  if (!saved) index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, DEFAULT_PRODUCT);
+  activeProduct = index >= 0 ? index : 0;
+  
+  const ProductSku& sku = STANDARD_SKUS[activeProduct.load()];
+  Serial.printf("%s, %u per case%s\n", sku.size, sku.bottlesPerCase, saved ? "" : " (default)");
+}
+
+void initializeTuning() {
+  Serial.print("Loading tuning... ");
+  
+  tuningMutex = xSemaphoreCreateMutex();
+  console.addCommand("param", handleParamCommand);
+  
+  uint8_t restored = tuningStore.load();
+  publishTuning();
+  Serial.printf("%u of %u parameters changed from the defaults\n", restored, tuningStore.count());
+}
+
+// Light sleep whenever every task is blocked, except while the weight
+// task samples at full rate: an edge on DRDY cannot wake the chip. The
+// PN532 holds IRQ low until it is read, so a level wake catches a tap.
+void initializePowerManagement() {
+#if LIGHT_SLEEP
+  Serial.print("Enabling light sleep... ");
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "full_rate", &fullRateLock);
+  esp_pm_lock_acquire(fullRateLock);
+  gpio_wakeup_enable(static_cast<gpio_num_t>(PN532_IRQ), GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  
+  // No frequency scaling: the traces count CPU cycles
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = getCpuFrequencyMhz();
+  config.min_freq_mhz = config.max_freq_mhz;
+  config.light_sleep_enable = true;
+  Serial.println(esp_pm_configure(&config) == ESP_OK ? "SUCCESS" : "FAILED");
+#endif
+}
+
+// Runs before the samplers take the HX711 pins over
+void initializeCalibration() {
+  Serial.print("Loading calibration... ");
+  
+  calibrationMutex = xSemaphoreCreateMutex();
+  console.addCommand("cal", handleCalibrationCommand);
+  
+  uint8_t restored = calibrationStore.load(calibration.cells, NUM_CELLS);
+  for (uint8_t i = 0; i < NUM_CELLS; i++) calibration.corners[i] = 1;
+  calibrationStore.loadCorners(calibration.corners, NUM_CELLS);
+  
+  // A cell never calibrated gets the nominal gain, zeroed on whatever is
+  // on the pallet now; it is not saved until someone calibrates it
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    if (calibration.cells[i].isValid()) continue;
+    long zero = scales[i].is_ready() ? scales[i].read_average(10) : 0;
+    calibration.cells[i].setLinear(zero, DEFAULT_COUNTS_PER_KG);
+  }
+  publishedCalibration.write(calibration);
+  
+  if (restored == NUM_CELLS) {
+    Serial.println("restored from NVS");
+  } else {
+    Serial.printf("%u of %u cells saved, others tared at boot\n", restored, NUM_CELLS);
+  }
+}
+
 void initializeLEDs() {
   Serial.print("Initializing LEDs... ");
   
@@ -391,83 +937,215 @@ void initializeLEDs() {
 // ============================================================================
 
 void weightMonitoringTask(void* parameter) {
-  TickType_t xLastWakeTime = xTaskGetTickCount();
+  TickType_t nextBatch = xTaskGetTickCount();
+  WorkflowMessage message;
+  heapMonitorRegisterTask("WeightMonitor");
+  Tuning tuning = publishedTuning.read();
+  applyTuning(tuning);
   
   while (true) {
-    readWeightData();
+    // Sleep until the next batch is due, but wake for a workflow event so
+    // a tap shows on the LEDs without waiting out the batch interval
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = static_cast<int32_t>(nextBatch - now) > 0 ? nextBatch - now : 0;
+    bool posted = xQueueReceive(workflowQueue, &message, wait) == pdTRUE;
+    
+    // A `param` change takes effect from this batch
+    Tuning latest = publishedTuning.read();
+    if (latest.generation != tuning.generation) {
+      tuning = latest;
+      applyTuning(tuning);
+    }
     
-    // Update system state based on weight changes
-    if (xSemaphoreTake(dataMutex, portMAX_DELAY)) {
-      updateSystemState();
-      xSemaphoreGive(dataMutex);
+    // At the idle rate a due batch is one reading; while the weight has
+    // not moved, nothing else has changed either
+    if (systemData.samplingIdle && !posted) {
+      float kg;
+      uint32_t readAt = millis();
+      bool stay = tuning.idleAfterMs > 0 && !rawRecorder.busy();
+      if (stay && readIdleWeight(kg) && fabsf(kg - idleBaselineKg) < tuning.wakeKg) {
+        for (uint8_t i = 0; i < NUM_CELLS; i++) samplers[i]->powerDown();
+        nextBatch = xTaskGetTickCount() + pdMS_TO_TICKS(tuning.idleSampleMs);
+        continue;
+      }
+      resumeFullRate(readAt);
+      nextBatch = xTaskGetTickCount();
+    }
+    
+    bool wasStable = systemData.isWeightStable;
+    if (!systemData.samplingIdle) readWeightData();
+    
+    // Events posted since the last batch, in order
+    unsigned long tapAt = 0;
+    bool tapped = false;
+    if (posted) {
+      do {
+        if (message.event == EVT_TAP && !tapped) {
+          tapAt = message.at;
+          tapped = true;
+        }
+        dispatchWorkflowEvent(message);
+      } while (xQueueReceive(workflowQueue, &message, 0));
+    } else {
+      nextBatch += pdMS_TO_TICKS(tuning.weightReadMs);
+    }
+    
+    // Leaving IDLE needs the cells at full rate straight away; an event
+    // that stays in IDLE (WiFi, uploads) keeps the idle schedule
+    if (systemData.samplingIdle && systemData.currentState != STATE_IDLE) {
+      resumeFullRate(tapped ? tapAt : millis());
+      nextBatch = xTaskGetTickCount() + pdMS_TO_TICKS(tuning.weightReadMs);
     }
     
-    vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(WEIGHT_READ_DELAY));
+    // The batch raises its own weight events
+    if (systemData.isWeightStable && !wasStable) {
+      dispatchWorkflowEvent(makeWorkflowMessage(EVT_WEIGHT_STABLE));
+    }
+    
+    // Readers pick this up lock-free; nothing here ever waits on them
+    publishedData.write(systemData);
+    controlLEDs(systemData);
+    if (wakePending && displayTask) xTaskNotifyGive(displayTask);
+    
+    // The tap is stamped at its IRQ edge, in milliseconds
+    if (tapped) TRACE_RECORD_US(TRACE_TAP_TO_LED, (millis() - tapAt) * 1000);
+    
+    // Quiet for long enough: drop to the idle rate
+    if (!systemData.samplingIdle) {
+      if (posted || !canSampleIdle()) {
+        quietSinceMs = millis();
+      } else if (tuning.idleAfterMs > 0 && millis() - quietSinceMs >= tuning.idleAfterMs) {
+        enterIdleSampling(tuning);
+        nextBatch = xTaskGetTickCount() + pdMS_TO_TICKS(tuning.idleSampleMs);
+        publishedData.write(systemData);
+      }
+    }
   }
 }
 
 void nfcWorkflowTask(void* parameter) {
-  uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };
-  uint8_t uidLength;
+  NfcTap tap;
+  char cardId[CARD_ID_LENGTH];
+  
+  // The reader's IRQ wakes this task, so it must arm from here. Attaching
+  // the interrupt allocates the core's handler entry once; the counters
+  // start after it and cover the tap loop.
+  nfcReader.begin();
+  heapMonitorRegisterTask("NFCWorkflow");
   
   while (true) {
-    // Check for NFC card
-    if (nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength)) {
-      // Convert UID to string
-      String cardId = "";
-      for (uint8_t i = 0; i < uidLength; i++) {
-        if (i > 0) cardId += ":";
-        if (uid[i] < 0x10) cardId += "0";
-        cardId += String(uid[i], HEX);
-      }
-      cardId.toUpperCase();
-      
-      Serial.printf("NFC Card detected: %s\n", cardId.c_str());
+    // Sleeps until the PN532 reports a card; repeat reads of a card
+    // still in the field are filtered out by the reader
+    if (nfcReader.waitForTap(tap, portMAX_DELAY)) {
+      formatUid(tap.uid, cardId, sizeof(cardId));
+      Serial.printf("NFC Card detected: %s\n", cardId);
+      rawRecorder.addTap(tap.timestampMs * 1000, tap.uid.bytes, tap.uid.length);
       
-      processNfcEvent(cardId);
-      
-      // Prevent multiple reads of same card
-      delay(1000);
+      processNfcEvent(tap);
     }
-    
-    vTaskDelay(pdMS_TO_TICKS(100));  // Check every 100ms
   }
 }
 
 void apiCommunicationTask(void* parameter) {
-  String apiMessage;
+  unsigned long lastUpdateTime = 0;
+  unsigned long lastFlushTime = 0;
+  unsigned long lastTruckSync = 0;
+  unsigned long lastConsolePoll = 0;
+  bool flushedOnce = false;
+  bool syncedOnce = false;
+  bool polledOnce = false;
+  bool consoleBusy = false;
+  heapMonitorRegisterTask("APIComm");
+  
+  uplink.begin(API_ROOT_CA, bootId);
+  truckSync.begin(API_ROOT_CA);
+  remoteConsole.begin(API_ROOT_CA);
+  postUploadStatus();  // Whatever the journal recovered at boot
   
   while (true) {
-    // Send periodic updates during active transactions
-    if (xSemaphoreTake(dataMutex, portMAX_DELAY)) {
-      if (systemData.currentState == STATE_LOAD_MODE || 
-          systemData.currentState == STATE_UNLOAD_MODE) {
-        
-        unsigned long currentTime = millis();
-        if (currentTime - systemData.transactionStartTime > API_SEND_INTERVAL) {
-          sendApiUpdate();
-          systemData.transactionStartTime = currentTime;
-        }
+    // Track connectivity; the weight task owns the published flag
+    SystemData snapshot = publishedData.read();
+    bool online = WiFi.status() == WL_CONNECTED;
+    if (online != snapshot.wifiConnected) {
+      postWorkflowEvent(makeWorkflowMessage(online ? EVT_WIFI_CONNECTED : EVT_WIFI_DISCONNECTED), pdMS_TO_TICKS(100));
+      Serial.printf("WiFi %s\n", online ? "reconnected" : "lost");
+    }
+    
+    // Sample progress during active transactions
+    if (snapshot.currentState == STATE_LOAD_MODE || 
+        snapshot.currentState == STATE_UNLOAD_MODE ||
+        snapshot.currentState == STATE_LOAD_SETTLING ||
+        snapshot.currentState == STATE_UNLOAD_SETTLING) {
+      
+      // Interval runs from the transaction start or the last update, whichever is later
+      unsigned long currentTime = millis();
+      unsigned long since = snapshot.transactionStartTime;
+      if ((long)(lastUpdateTime - since) > 0) since = lastUpdateTime;
+      if (currentTime - since > publishedTuning.read().progressMs) {
+        queueProgressSample(snapshot);
+        lastUpdateTime = currentTime;
+      }
+    }
+    
+    // One request per window carries the progress samples and any
+    // journaled transactions; nothing is sent while there is nothing new
+    if (online && uplink.enabled() && (!flushedOnce || millis() - lastFlushTime >= UPLINK_WINDOW)) {
+      if (flushUplink()) {
+        lastFlushTime = millis();
+        flushedOnce = true;
       }
-      xSemaphoreGive(dataMutex);
     }
     
-    // Process any queued API messages
-    if (xQueueReceive(apiQueue, &apiMessage, 0)) {
-      Serial.printf("Processing API message: %s\n", apiMessage.c_str());
-      // Process the API message here
+    // Fleet changes are rare; a lorry provisioned on the server is picked
+    // up within one interval
+    if (online && truckSync.enabled() && (!syncedOnce || millis() - lastTruckSync >= TRUCK_SYNC_INTERVAL)) {
+      syncTrucks();
+      lastTruckSync = millis();
+      syncedOnce = true;
+    }
+    
+    // Maintenance commands queued on the server (calibration, trucks);
+    // while a session is sending them the next poll follows at once
+    if (online && (!polledOnce || consoleBusy || millis() - lastConsolePoll >= CONSOLE_POLL_INTERVAL)) {
+      TRACE_SCOPE(TRACE_CONSOLE_POLL);
+      consoleBusy = remoteConsole.run() > 0;
+      lastConsolePoll = millis();
+      polledOnce = true;
     }
     
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Completed transactions reach flash through the journal writer, not
+    // this loop. Nothing is sampled while the pallet is idle, so the task
+    // sleeps longer.
+    vTaskDelay(pdMS_TO_TICKS(snapshot.samplingIdle ? IDLE_API_WAIT : 1000));
+  }
+}
+
+// Puts each completed transaction on flash as soon as the weight task
+// hands it over. It never waits on the network, so a TLS handshake or a
+// slow server in the API task cannot back the queue up.
+void journalWriterTask(void* parameter) {
+  ApiMessage message;
+  heapMonitorRegisterTask("JournalWriter");
+  
+  while (true) {
+    if (xQueueReceive(journalQueue, &message, portMAX_DELAY)) {
+      journalTransaction(message);
+      postUploadStatus();
+    }
   }
 }
 
 void displayUpdateTask(void* parameter) {
+  heapMonitorRegisterTask("DisplayUpdate");
+  if (displayReady) initializeDisplayLayout();
+  
   while (true) {
-    updateDisplay();
-    controlLEDs();
+    SystemData snapshot = publishedData.read();
+    updateDisplay(snapshot);
     
-    vTaskDelay(pdMS_TO_TICKS(DISPLAY_UPDATE));
+    // Idle, the weight does not move; the weight task notifies on wake
+    uint32_t interval = snapshot.samplingIdle ? IDLE_DISPLAY_INTERVAL : publishedTuning.read().displayMs;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(interval));
   }
 }
 
@@ -475,118 +1153,451 @@ void displayUpdateTask(void* parameter) {
 // CORE FUNCTIONS
 // ============================================================================
 
+// Weight task only. The filter window, the estimator and the plateaus
+// start over, so the weight reads as unstable until the new window has
+// filled.
+void applyTuning(const Tuning& tuning) {
+  weightFilter.resize(tuning.filterSamples);
+  weightChain.reset();
+  estimator = WeightEstimator(tuning.stabilityKg * ESTIMATE_NOISE_RATIO, tuning.stabilityKg * ESTIMATE_SETTLE_RATIO,
+                              tuning.settleQuietMs);
+  float drift = tuning.stabilityKg * PLATEAU_DRIFT_RATIO;
+  float threshold = tuning.stabilityKg * PLATEAU_THRESHOLD_RATIO;
+  fusion.setPlateau(drift * CELL_PLATEAU_SCALE, threshold * CELL_PLATEAU_SCALE, tuning.plateauSamples);
+}
+
 void readWeightData() {
-  if (!scale1.is_ready() || !scale2.is_ready()) {
-    return;
-  }
-  
-  float weight1 = scale1.get_units(1);
-  float weight2 = scale2.get_units(1);
-  
-  // Combine weights from both load cells
-  float totalWeight = weight1 + weight2;
-  
-  // Handle negative weights (sensor noise)
-  if (totalWeight < 0) totalWeight = 0;
+  TRACE_SCOPE(TRACE_WEIGHT_BATCH);
+  RawSample set[NUM_CELLS];
+  int32_t counts[NUM_CELLS];
+  uint8_t present;
+  float totalWeight = 0;
+  bool haveSample = false;
   
-  // Apply moving average filter
-  weightReadings[readingIndex] = totalWeight;
-  readingIndex = (readingIndex + 1) % FILTER_SAMPLES;
+  // Sample timestamps are micros(); the estimator is kept on the millis()
+  // clock the workflow uses
+  uint32_t nowMs = millis();
+  uint32_t nowUs = micros();
   
-  if (readingIndex == 0) filterInitialized = true;
+  // Temperature moves far slower than a batch
+  ScaleCalibration cal = publishedCalibration.read();
+  float temperature = temperatureRead();
   
-  if (filterInitialized) {
-    float sum = 0;
-    for (int i = 0; i < FILTER_SAMPLES; i++) {
-      sum += weightReadings[i];
+  // Drain everything the ISRs captured since the last batch
+  while ((present = nextSampleSet(set)) != 0) {
+    uint32_t stampUs = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      counts[i] = set[i].counts;
+      if (present & (1u << i)) stampUs = set[i].timestampUs;
+    }
+    uint32_t sampleMs = nowMs - (nowUs - stampUs) / 1000;
+    if (wakePending) {
+      TRACE_RECORD_US(TRACE_WAKE, (sampleMs - wakeTriggerMs) * 1000);
+      wakePending = false;
+    }
+    if (rawRecorder.recording()) rawRecorder.addSamples(stampUs, present, counts);
+    
+    // Recorded raw, so a replay goes through the same rejection
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      if (present & (1u << i)) counts[i] = glitchFilters[i].add(counts[i]);
     }
     
+    // Per-cell curves and corner factors; faulty cells are estimated.
+    // The fusion is float, so the total is only quantised here; fixed
+    // point from there through the filter chain and the window.
+    int32_t total = weightChain.add(toWeightUnits(fusion.add(counts, present, cal.cells, cal.corners,
+                                                             temperature, sampleMs)));
+    totalWeight = weightUnitsToKg(total);
+    
+    // Unclamped, so noise around zero does not bias an empty pallet
+    estimator.add(totalWeight, sampleMs);
+    
+    // Handle negative weights (sensor noise)
+    if (total < 0) {
+      total = 0;
+      totalWeight = 0;
+    }
+    
+    // Apply moving average filter
+    weightFilter.add(total);
+    haveSample = true;
+  }
+  
+  if (haveSample && weightFilter.isFull()) {
     systemData.totalWeight = totalWeight;
-    systemData.filteredWeight = sum / FILTER_SAMPLES;
-    systemData.bottleCount = calculateBottleCount(systemData.filteredWeight);
+    // Settled, the estimate is already at the new weight while the
+    // window still holds the step; the window's spread stands in for the
+    // uncertainty until then
+    if (estimator.isSettled()) {
+      systemData.filteredWeight = estimator.weight() > 0 ? estimator.weight() : 0;
+    } else {
+      systemData.filteredWeight = weightUnitsToKg(weightFilter.mean());
+    }
+    BottleCount count = countBottles(systemData.filteredWeight,
+                                     estimator.isSettled() ? sqrtf(estimator.variance())
+                                                           : weightUnitsToKg(weightFilter.maxDeviation()));
+    systemData.bottleCount = count.bottles;
+    systemData.countAmbiguous = count.ambiguous;
     systemData.isWeightStable = isWeightStable();
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      systemData.rawCounts[i] = fusion.rawMean(i);
+      systemData.cellWeights[i] = fusion.cellKg(i);
+      systemData.cellShares[i] = fusion.share(i);
+      systemData.cellFaults[i] = fusion.faults(i);
+      systemData.cellGlitches[i] = glitchFilters[i].rejected();
+      systemData.cellOverruns[i] = samplers[i]->overruns();
+    }
+    systemData.unpairedSamples = unpairedSamples;
+    if (fusion.faultyCells() != systemData.faultyCells) reportCellFaults(fusion.faultyCells());
+    systemData.faultyCells = fusion.faultyCells();
+    systemData.transactionFaults |= systemData.faultyCells;
+    systemData.cellsSettled = fusion.allSettled();
+    systemData.temperature = temperature;
   }
 }
 
-void processNfcEvent(String cardId) {
-  unsigned long currentTime = millis();
-  String truckId = getTruckIdFromCard(cardId);
+// Weight task only. Idle sampling needs a known weight at rest on every
+// cell to compare the idle readings with.
+bool canSampleIdle() {
+  return systemData.currentState == STATE_IDLE && systemData.isWeightStable && systemData.cellsSettled &&
+         systemData.faultyCells == 0 && !rawRecorder.busy();
+}
+
+void enterIdleSampling(const Tuning& tuning) {
+  ScaleCalibration cal = publishedCalibration.read();
+  idleBaselineKg = restingWeight(systemData.rawCounts, cal, systemData.temperature);
+  for (uint8_t i = 0; i < NUM_CELLS; i++) samplers[i]->powerDown();
+  systemData.samplingIdle = true;
+#if LIGHT_SLEEP
+  esp_pm_lock_release(fullRateLock);
+#endif
+  Serial.printf("Pallet idle - weight read every %lu ms\n", (unsigned long)tuning.idleSampleMs);
+}
+
+// One conversion from every cell, powering the HX711s up for it. They
+// are left running for the caller to power down or resume full rate.
+// False if a cell did not answer, which full rate will diagnose.
+bool readIdleWeight(float& kg) {
+  for (uint8_t i = 0; i < NUM_CELLS; i++) samplers[i]->powerUp();
   
-  if (truckId.isEmpty()) {
+  int32_t counts[NUM_CELLS];
+  uint8_t have = 0;
+  const uint8_t all = (1u << NUM_CELLS) - 1;
+  uint32_t start = millis();
+  while (have != all && millis() - start < IDLE_READ_TIMEOUT) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      RawSample sample;
+      while (samplers[i]->samples().pop(sample)) {
+        counts[i] = sample.counts;
+        have |= 1u << i;
+      }
+    }
+  }
+  if (have != all) return false;
+  
+  kg = restingWeight(counts, publishedCalibration.read(), temperatureRead());
+  return true;
+}
+
+// Total of the cells' curves without the fusion: idle readings and the
+// baseline they are compared with go through the same arithmetic
+float restingWeight(const int32_t* counts, const ScaleCalibration& cal, float tempC) {
+  float total = 0;
+  for (uint8_t i = 0; i < NUM_CELLS; i++) total += cal.cells[i].toKg(counts[i], tempC) * cal.corners[i];
+  return total;
+}
+
+// Back to full rate. The cells were at rest while idle, and their first
+// conversion is a period away, so neither reads as a fault.
+void resumeFullRate(uint32_t triggerMs) {
+#if LIGHT_SLEEP
+  esp_pm_lock_acquire(fullRateLock);
+#endif
+  uint32_t now = micros();
+  // The glitch windows still hold the weight from before; start them
+  // on the first sample instead of holding a changed weight back
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    samplers[i]->powerUp();
+    lastSampleUs[i] = now;
+    glitchFilters[i].reset();
+  }
+  fusion.resume(millis());
+  systemData.samplingIdle = false;
+  quietSinceMs = millis();
+  wakeTriggerMs = triggerMs;
+  wakePending = true;
+}
+
+// Logged when a cell drops out of the total or comes back
+void reportCellFaults(uint8_t faultyCells) {
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    bool was = systemData.faultyCells & (1u << i);
+    bool is = faultyCells & (1u << i);
+    if (is && !was) {
+      Serial.printf("Load cell %u %s - total estimated from the others\n", i + 1,
+                    CellFusion::faultName(fusion.faults(i)));
+    } else if (was && !is) {
+      Serial.printf("Load cell %u recovered\n", i + 1);
+    }
+  }
+}
+
+// The HX711s free-run on their own oscillators, so now and then a ring
+// holds a sample the others have no partner for. Take one sample per
+// cell with DRDY edges close together and discard the odd ones out. A
+// cell that has delivered nothing for CELL_SILENT_US is left out instead
+// of stalling the others. Returns a bit per cell in the set, 0 if no
+// complete set is waiting.
+uint8_t nextSampleSet(RawSample* set) {
+  uint32_t now = micros();
+  while (true) {
+    uint8_t present = 0;
+    uint32_t newestUs = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      if (samplers[i]->samples().peek(set[i])) {
+        if (!present || (int32_t)(set[i].timestampUs - newestUs) > 0) newestUs = set[i].timestampUs;
+        present |= 1u << i;
+      } else if ((int32_t)(now - lastSampleUs[i]) < CELL_SILENT_US) {
+        return 0;  // Its conversion is still to come
+      }
+    }
+    if (!present) return 0;
+    
+    bool dropped = false;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      if ((present & (1u << i)) && (int32_t)(newestUs - set[i].timestampUs) > MAX_PAIR_SKEW_US) {
+        samplers[i]->samples().pop(set[i]);
+        lastSampleUs[i] = set[i].timestampUs;
+        unpairedSamples++;
+        dropped = true;
+      }
+    }
+    if (dropped) continue;
+    
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      if (!(present & (1u << i))) continue;
+      samplers[i]->samples().pop(set[i]);
+      lastSampleUs[i] = set[i].timestampUs;
+    }
+    return present;
+  }
+}
+
+void processNfcEvent(const NfcTap& tap) {
+  int16_t truck = findTruckByUid(tap.uid);
+  if (truck < 0) {
     Serial.println("Unknown NFC card - ignoring");
     return;
   }
   
-  bool isDoubleTapEvent = isDoubleTap(currentTime);
-  
-  if (xSemaphoreTake(dataMutex, portMAX_DELAY)) {
-    switch (systemData.currentState) {
-      case STATE_IDLE:
-        if (isDoubleTapEvent) {
-          // Double tap in idle = start unload mode
-          changeSystemState(STATE_UNLOAD_MODE);
-          systemData.currentTruckId = truckId;
-          systemData.initialWeight = systemData.filteredWeight;
-          Serial.printf("Started UNLOAD mode for %s\n", truckId.c_str());
-        } else {
-          // Single tap in idle = start load mode
-          changeSystemState(STATE_LOAD_MODE);
-          systemData.currentTruckId = truckId;
-          systemData.initialWeight = systemData.filteredWeight;
-          Serial.printf("Started LOAD mode for %s\n", truckId.c_str());
-        }
-        systemData.transactionStartTime = currentTime;
-        break;
-        
-      case STATE_LOAD_MODE:
-        if (truckId == systemData.currentTruckId) {
-          // Second tap = complete loading
-          changeSystemState(STATE_LOAD_COMPLETE);
-          systemData.weightChange = systemData.filteredWeight - systemData.initialWeight;
-          sendLoadingTransaction(true);
-          Serial.printf("Completed LOAD transaction for %s\n", truckId.c_str());
-          
-          // Auto return to idle after 3 seconds
-          vTaskDelay(pdMS_TO_TICKS(3000));
-          changeSystemState(STATE_IDLE);
-        }
-        break;
-        
-      case STATE_UNLOAD_MODE:
-        if (truckId == systemData.currentTruckId) {
-          // Tap after unload = complete unloading
-          changeSystemState(STATE_UNLOAD_COMPLETE);
-          systemData.weightChange = systemData.initialWeight - systemData.filteredWeight;
-          sendUnloadingTransaction(true);
-          Serial.printf("Completed UNLOAD transaction for %s\n", truckId.c_str());
-          
-          // Auto return to idle after 3 seconds
-          vTaskDelay(pdMS_TO_TICKS(3000));
-          changeSystemState(STATE_IDLE);
-        }
-        break;
-        
-      default:
-        break;
-    }
+  // Double taps are judged by when the cards arrived, not when they were read
+  WorkflowMessage message = makeWorkflowMessage(EVT_TAP);
+  message.truck = truck;
+  message.uid = tap.uid;
+  message.at = tap.timestampMs;
+  postWorkflowEvent(message, pdMS_TO_TICKS(100));
+}
+
+// ============================================================================
+// WORKFLOW STATE MACHINE
+// ============================================================================
+// Dispatched in the weight task only, so the weight captured for a
+// transaction always comes from the batch current when the event arrived.
+// Nothing here waits: a pause (for the weight to settle, or for the
+// completed state to be read off the display) is a software timer that
+// posts an event when it runs out, and taps keep being handled meanwhile.
+
+typedef bool (*WorkflowGuard)(const WorkflowMessage& message);
+typedef void (*WorkflowAction)(const WorkflowMessage& message);
+
+struct WorkflowTransition {
+  SystemState state;         // STATE_ANY matches every state
+  WorkflowEvent event;
+  WorkflowGuard guard;       // nullptr = always
+  SystemState next;          // STATE_ANY = stay
+  WorkflowAction action;     // Runs before the state changes
+};
+
+bool isCurrentTruck(const WorkflowMessage& message) {
+  return message.truck == systemData.currentTruck;
+}
+
+bool isCurrentTruckSettled(const WorkflowMessage& message) {
+  return isCurrentTruck(message) && systemData.isWeightStable;
+}
+
+void startTransaction(const WorkflowMessage& message) {
+  xTimerStop(holdTimer, 0);
+  systemData.currentTruck = message.truck;
+  truckName(message.truck, systemData.currentTruckId, sizeof(systemData.currentTruckId));
+  systemData.initialWeight = estimator.isSettled() ? estimator.weight() : systemData.filteredWeight;
+  systemData.transactionStartTime = message.at;
+  systemData.transactionFaults = systemData.faultyCells;
+  Serial.printf("Transaction started for %s\n", systemData.currentTruckId);
+}
+
+void waitForSettledWeight(const WorkflowMessage& message) {
+  Serial.println("Weight not stable - waiting before capture");
+  systemData.captureRequestedAt = message.at;
+  xTimerStart(settleTimer, 0);
+}
+
+void completeTransaction(const WorkflowMessage& message) {
+  bool loading = systemData.currentState == STATE_LOAD_MODE ||
+                 systemData.currentState == STATE_LOAD_SETTLING;
+  xTimerStop(settleTimer, 0);
+  if (message.event == EVT_TAP) systemData.captureRequestedAt = message.at;
+  
+  // The weight may have settled before the tap; that is no wait at all
+  if (message.event != EVT_SETTLE_TIMEOUT && estimator.isSettled()) {
+    int32_t waited = (int32_t)(estimator.settledAt() - systemData.captureRequestedAt);
+    systemData.capturedWeight = estimator.weight();
+    systemData.capturedVariance = estimator.variance();
+    systemData.settleTime = waited > 0 ? waited : 0;
+    systemData.captureSettled = true;
+  } else {
+    Serial.println("Weight did not settle - capturing it as is");
+    systemData.capturedWeight = systemData.filteredWeight;
+    systemData.capturedVariance = 0;
+    systemData.settleTime = millis() - systemData.captureRequestedAt;
+    systemData.captureSettled = false;
+  }
+  
+  systemData.weightChange = loading ? systemData.capturedWeight - systemData.initialWeight
+                                    : systemData.initialWeight - systemData.capturedWeight;
+  if (systemData.capturedWeight < 0) systemData.capturedWeight = 0;
+  systemData.capturedCount = countBottles(systemData.capturedWeight, systemData.captureSettled
+                                                                         ? sqrtf(systemData.capturedVariance)
+                                                                         : weightUnitsToKg(weightFilter.maxDeviation()));
+  queueCompletion(loading ? API_LOAD_COMPLETE : API_UNLOAD_COMPLETE);
+  xTimerStart(holdTimer, 0);
+  Serial.printf("Completed %s transaction for %s: %.3f kg", loading ? "LOAD" : "UNLOAD",
+                systemData.currentTruckId, systemData.capturedWeight);
+  if (systemData.captureSettled) {
+    Serial.printf(" (sd %.1f g, settled after %lu ms)\n", sqrtf(systemData.capturedVariance) * 1000,
+                  systemData.settleTime);
+  } else {
+    Serial.println(" (unsettled)");
+  }
+  const BottleCount& count = systemData.capturedCount;
+  Serial.printf("%ld bottles in %ld cases (%+.0f g), %.0f%% sure%s\n", (long)count.bottles, (long)count.cases,
+                count.residualKg * 1000, count.confidence * 100, count.ambiguous ? " - count needs a check" : "");
+}
+
+void recordUploads(const WorkflowMessage& message) {
+  systemData.pendingUploads = message.pendingUploads;
+}
+
+void recordWifi(const WorkflowMessage& message) {
+  systemData.wifiConnected = message.event == EVT_WIFI_CONNECTED;
+}
+
+// First row matching the current state, the event and the guard wins.
+// Events without a row are dropped (a tap by another truck mid-transaction).
+const WorkflowTransition workflowTable[] = {
+  // From                 On                     If                     To                     Do
+  {STATE_IDLE,            EVT_TAP,               nullptr,               STATE_LOAD_MODE,       startTransaction},
+  {STATE_IDLE,            EVT_DOUBLE_TAP,        nullptr,               STATE_UNLOAD_MODE,     startTransaction},
+  
+  // The first tap of a double tap has already started a load
+  {STATE_LOAD_MODE,       EVT_DOUBLE_TAP,        isCurrentTruck,        STATE_UNLOAD_MODE,     startTransaction},
+  {STATE_LOAD_MODE,       EVT_TAP,               isCurrentTruckSettled, STATE_LOAD_COMPLETE,   completeTransaction},
+  {STATE_LOAD_MODE,       EVT_TAP,               isCurrentTruck,        STATE_LOAD_SETTLING,   waitForSettledWeight},
+  {STATE_LOAD_SETTLING,   EVT_WEIGHT_STABLE,     nullptr,               STATE_LOAD_COMPLETE,   completeTransaction},
+  {STATE_LOAD_SETTLING,   EVT_SETTLE_TIMEOUT,    nullptr,               STATE_LOAD_COMPLETE,   completeTransaction},
+  
+  {STATE_UNLOAD_MODE,     EVT_TAP,               isCurrentTruckSettled, STATE_UNLOAD_COMPLETE, completeTransaction},
+  {STATE_UNLOAD_MODE,     EVT_TAP,               isCurrentTruck,        STATE_UNLOAD_SETTLING, waitForSettledWeight},
+  {STATE_UNLOAD_SETTLING, EVT_WEIGHT_STABLE,     nullptr,               STATE_UNLOAD_COMPLETE, completeTransaction},
+  {STATE_UNLOAD_SETTLING, EVT_SETTLE_TIMEOUT,    nullptr,               STATE_UNLOAD_COMPLETE, completeTransaction},
+  
+  // The next truck does not wait for the completed screen to time out
+  {STATE_LOAD_COMPLETE,   EVT_TAP,               nullptr,               STATE_LOAD_MODE,       startTransaction},
+  {STATE_LOAD_COMPLETE,   EVT_HOLD_EXPIRED,      nullptr,               STATE_IDLE,            nullptr},
+  {STATE_UNLOAD_COMPLETE, EVT_TAP,               nullptr,               STATE_LOAD_MODE,       startTransaction},
+  {STATE_UNLOAD_COMPLETE, EVT_HOLD_EXPIRED,      nullptr,               STATE_IDLE,            nullptr},
+  
+  {STATE_ANY,             EVT_NETWORK_ACK,       nullptr,               STATE_ANY,             recordUploads},
+  {STATE_ANY,             EVT_WIFI_CONNECTED,    nullptr,               STATE_ANY,             recordWifi},
+  {STATE_ANY,             EVT_WIFI_DISCONNECTED, nullptr,               STATE_ANY,             recordWifi}
+};
+
+void dispatchWorkflowEvent(WorkflowMessage message) {
+  TRACE_SCOPE(TRACE_WORKFLOW);
+  if (message.event == EVT_TAP) {
+    if (isDoubleTap(systemData, message)) message.event = EVT_DOUBLE_TAP;
+    systemData.lastNfcUid = message.uid;
+    systemData.lastNfcTapTime = message.at;
+  }
+  
+  for (const WorkflowTransition& row : workflowTable) {
+    if (row.state != STATE_ANY && row.state != systemData.currentState) continue;
+    if (row.event != message.event) continue;
+    if (row.guard && !row.guard(message)) continue;
     
-    systemData.lastNfcCardId = cardId;
-    systemData.lastNfcTapTime = currentTime;
-    xSemaphoreGive(dataMutex);
+    if (row.action) row.action(message);
+    if (row.next != STATE_ANY) changeSystemState(row.next);
+    return;
   }
 }
 
-void updateSystemState() {
-  // This function can be used for additional state logic
-  // Currently weight monitoring is handled in readWeightData()
+WorkflowMessage makeWorkflowMessage(WorkflowEvent event) {
+  WorkflowMessage message;
+  message.event = event;
+  message.truck = -1;
+  message.uid.length = 0;
+  message.at = millis();
+  message.pendingUploads = 0;
+  return message;
 }
 
-void controlLEDs() {
+bool postWorkflowEvent(const WorkflowMessage& message, TickType_t ticksToWait) {
+  if (xQueueSend(workflowQueue, &message, ticksToWait) != pdTRUE) {
+    Serial.printf("Workflow queue full - event %d dropped\n", message.event);
+    return false;
+  }
+  return true;
+}
+
+// Timer service task: must not block, so a full queue drops the event
+void onWorkflowTimer(TimerHandle_t timer) {
+  WorkflowEvent event = static_cast<WorkflowEvent>(reinterpret_cast<uintptr_t>(pvTimerGetTimerID(timer)));
+  postWorkflowEvent(makeWorkflowMessage(event), 0);
+}
+
+// Never blocks: the weight task must not wait on the network side
+void queueCompletion(ApiMessageType type) {
+  ApiMessage message;
+  message.type = type;
+  memcpy(message.truckId, systemData.currentTruckId, sizeof(message.truckId));
+  message.bottleCount = systemData.capturedCount.bottles;
+  message.weight = systemData.capturedWeight;
+  message.initialWeight = systemData.initialWeight;
+  message.weightChange = systemData.weightChange;
+  message.weightVariance = systemData.capturedVariance;
+  message.settleTime = systemData.settleTime;
+  message.settled = systemData.captureSettled;
+  message.faultyCells = systemData.transactionFaults;
+  message.sku = activeProduct.load();
+  message.countConfidence = static_cast<uint8_t>(lroundf(systemData.capturedCount.confidence * 100));
+  message.countCheck = systemData.capturedCount.ambiguous;
+  message.startedAt = systemData.transactionStartTime;
+  message.completedAt = millis();
+  
+  // The writer frees a slot within one flash write; waiting that long
+  // costs no samples
+  if (xQueueSend(journalQueue, &message, pdMS_TO_TICKS(JOURNAL_QUEUE_WAIT)) != pdTRUE) {
+    Serial.println("Journal queue full - transaction NOT saved");
+  }
+}
+
+void controlLEDs(const SystemData& data) {
   // Update built-in LED for WiFi status
-  digitalWrite(BUILTIN_LED, systemData.wifiConnected ? HIGH : LOW);
+  digitalWrite(BUILTIN_LED, data.wifiConnected ? HIGH : LOW);
   
   // Control status LEDs based on system state
-  switch (systemData.currentState) {
+  switch (data.currentState) {
     case STATE_IDLE:
       digitalWrite(BLUE_LED, LOW);
       digitalWrite(GREEN_LED, LOW);
@@ -616,165 +1627,638 @@ void controlLEDs() {
       digitalWrite(GREEN_LED, HIGH);
       digitalWrite(RED_LED, LOW);
       break;
+      
+    // Green joins the mode colour while the captured weight settles
+    case STATE_LOAD_SETTLING:
+      digitalWrite(BLUE_LED, HIGH);
+      digitalWrite(GREEN_LED, HIGH);
+      digitalWrite(RED_LED, LOW);
+      break;
+      
+    case STATE_UNLOAD_SETTLING:
+      digitalWrite(BLUE_LED, LOW);
+      digitalWrite(GREEN_LED, HIGH);
+      digitalWrite(RED_LED, HIGH);
+      break;
+      
+    case STATE_ANY:
+      break;
   }
 }
 
-void sendApiUpdate() {
-  if (systemData.currentState == STATE_LOAD_MODE) {
-    sendLoadingTransaction(false);
-  } else if (systemData.currentState == STATE_UNLOAD_MODE) {
-    sendUnloadingTransaction(false);
+void queueProgressSample(const SystemData& data) {
+  ProgressSample sample;
+  sample.timestamp = millis();
+  sample.state = data.currentState;
+  snprintf(sample.truckId, sizeof(sample.truckId), "%s", data.currentTruckId);
+  sample.weight = data.filteredWeight;
+  sample.bottleCount = data.bottleCount;
+  uplink.addProgress(sample);
+}
+
+const char* stateLabel(SystemState state) {
+  switch (state) {
+    case STATE_IDLE:            return "IDLE";
+    case STATE_LOAD_MODE:       return "LOADING";
+    case STATE_LOAD_COMPLETE:   return "LOAD DONE";
+    case STATE_UNLOAD_MODE:     return "UNLOADING";
+    case STATE_UNLOAD_COMPLETE: return "UNLOAD DONE";
+    case STATE_LOAD_SETTLING:   return "LOAD SETTLE";
+    case STATE_UNLOAD_SETTLING: return "UNLOAD SETTLE";
+    case STATE_ANY:             break;
   }
+  return "";
 }
 
-void updateDisplay() {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
+void updateDisplay(const SystemData& data) {
+  if (!displayReady) return;
+  TRACE_SCOPE(TRACE_DISPLAY);
+
+  panel.printf(weightField, "Weight: %.2f kg", data.filteredWeight);
+  // An ambiguous count is approximate while loading, and waits for a
+  // check by hand once it has been recorded
+  bool completed = data.currentState == STATE_LOAD_COMPLETE || data.currentState == STATE_UNLOAD_COMPLETE;
+  if (completed && data.capturedCount.ambiguous) {
+    panel.printf(bottlesField, "Bottles: %ld CHECK", (long)data.capturedCount.bottles);
+  } else {
+    panel.printf(bottlesField, "Bottles: %s%d", data.countAmbiguous ? "~" : "", data.bottleCount);
+  }
+  panel.printf(stateField, "State: %s", stateLabel(data.currentState));
+
+  if (data.currentTruck >= 0) {
+    panel.printf(truckField, "Truck: %s", data.currentTruckId);
+  } else {
+    panel.setText(truckField, "");
+  }
+
+  if (data.pendingUploads > 0) {
+    panel.printf(uploadsField, "Unsent: %u", (unsigned)data.pendingUploads);
+  } else {
+    panel.setText(uploadsField, "All sent");
+  }
   
-  // Title
-  display.setCursor(0, 0);
-  display.println("Smart Palette v2.0");
-  display.drawLine(0, 10, SCREEN_WIDTH, 10, SSD1306_WHITE);
+  // A faulty cell takes the status line over until it recovers
+  uint8_t faulty = 0;
+  while (faulty < NUM_CELLS && !(data.faultyCells & (1u << faulty))) faulty++;
+  if (faulty < NUM_CELLS) {
+    panel.printf(statusField, "CELL %u %s", faulty + 1, CellFusion::faultName(data.cellFaults[faulty]));
+  } else {
+    panel.printf(statusField, "WiFi:%s Stable:%s",
+                 data.wifiConnected ? "OK" : "NO",
+                 data.isWeightStable ? "YES" : "NO");
+  }
+
+  // Sends nothing when no character changed
+  panel.flush();
+}
+
+// ============================================================================
+// UTILITY FUNCTIONS
+// ============================================================================
+
+int16_t findTruckByUid(const NfcUid& uid) {
+  TRACE_TAKE(registryMutex, TRACE_REGISTRY_WAIT);
+  int16_t truck = trucks.find(uid.bytes, uid.length);
+  xSemaphoreGive(registryMutex);
+  return truck;
+}
+
+// Copied out under the lock: the entry may be re-provisioned meanwhile
+const char* truckName(int16_t truck, char* buffer, size_t size) {
+  TRACE_TAKE(registryMutex, TRACE_REGISTRY_WAIT);
+  const TruckEntry* entry = trucks.entry(truck);
+  snprintf(buffer, size, "%s", entry ? entry->truckId : "");
+  xSemaphoreGive(registryMutex);
+  return buffer;
+}
+
+// "04:52:F3:2A" into a caller-owned buffer
+void formatUid(const NfcUid& uid, char* buffer, size_t size) {
+  TruckRegistry::formatUid(uid.bytes, uid.length, buffer, size);
+}
+
+// truck add <uid> <truck id> [driver name] | truck del <uid> | truck list
+void handleTruckCommand(char* args, Print& out) {
+  char* action = SerialConsole::nextWord(args);
+  char* uidText = action ? SerialConsole::nextWord(args) : nullptr;
+  uint8_t uid[TruckRegistry::UID_MAX_LENGTH];
+  uint8_t length = 0;
   
-  // Weight display
-  display.setCursor(0, 15);
-  display.printf("Weight: %.2f kg", systemData.filteredWeight);
+  if (action && strcmp(action, "list") == 0) {
+    char cardId[CARD_ID_LENGTH];
+    TRACE_TAKE(registryMutex, TRACE_REGISTRY_WAIT);
+    for (int16_t i = 0; i < (int16_t)TruckRegistry::CAPACITY; i++) {
+      const TruckEntry* entry = trucks.entry(i);
+      if (!entry) continue;
+      TruckRegistry::formatUid(entry->uid, entry->uidLength, cardId, sizeof(cardId));
+      out.printf("%s %s %s\n", cardId, entry->truckId, entry->driverName);
+    }
+    out.printf("%u trucks, version %u\n", (unsigned)trucks.count(), trucks.version());
+    xSemaphoreGive(registryMutex);
+    return;
+  }
   
-  display.setCursor(0, 25);
-  display.printf("Bottles: %d", systemData.bottleCount);
+  if (!uidText || !TruckRegistry::parseUid(uidText, uid, length)) {
+    out.println("Usage: truck add <uid> <truck id> [driver] | truck del <uid> | truck list");
+    return;
+  }
   
-  // State display
-  display.setCursor(0, 35);
-  display.print("State: ");
-  switch (systemData.currentState) {
-    case STATE_IDLE:
-      display.print("IDLE");
-      break;
-    case STATE_LOAD_MODE:
-      display.print("LOADING");
-      break;
-    case STATE_LOAD_COMPLETE:
-      display.print("LOAD DONE");
-      break;
-    case STATE_UNLOAD_MODE:
-      display.print("UNLOADING");
-      break;
-    case STATE_UNLOAD_COMPLETE:
-      display.print("UNLOAD DONE");
-      break;
+  bool changed = false;
+  TRACE_TAKE(registryMutex, TRACE_REGISTRY_WAIT);
+  if (strcmp(action, "add") == 0) {
+    char* truckId = SerialConsole::nextWord(args);
+    while (*args == ' ') args++;
+    changed = truckId && trucks.put(uid, length, truckId, args) >= 0;
+  } else if (strcmp(action, "del") == 0) {
+    changed = trucks.remove(uid, length);
   }
+  bool saved = changed && trucks.save();
+  size_t count = trucks.count();
+  xSemaphoreGive(registryMutex);
   
-  // Truck info
-  if (!systemData.currentTruckId.isEmpty()) {
-    display.setCursor(0, 45);
-    display.printf("Truck: %s", systemData.currentTruckId.c_str());
+  if (!changed) {
+    out.println("Truck not changed (unknown card, registry full or bad arguments)");
+  } else {
+    out.printf("Truck %s %s, %u registered%s\n", uidText, strcmp(action, "add") == 0 ? "saved" : "removed",
+               (unsigned)count, saved ? "" : " - NOT saved to flash");
   }
+}
+
+// Corner placements taken so far by `cal corner`, under calibrationMutex;
+// the factors are solved once every corner has one
+float cornerReadings[NUM_CELLS][NUM_CELLS];
+float cornerKnownKg[NUM_CELLS];
+uint8_t cornersTaken = 0;  // Bit per corner
+
+// cal [status] | cal zero | cal point <cell> <kg> | cal corner <cell> <kg> | cal tare
+// | cal tc <cell> <counts/C> [ppm/C] | cal tczero | cal clear. Readings are the
+// raw means over each cell's current plateau, so every capture needs the
+// load to have settled and every cell to be healthy.
+void handleCalibrationCommand(char* args, Print& out) {
+  char* action = SerialConsole::nextWord(args);
+  SystemData snapshot = publishedData.read();
+  float temperature = snapshot.temperature;
   
-  // Status indicators
-  display.setCursor(0, 55);
-  display.printf("WiFi:%s Stable:%s", 
-                systemData.wifiConnected ? "OK" : "NO",
-                systemData.isWeightStable ? "YES" : "NO");
+  if (!action || strcmp(action, "status") == 0) {
+    printCalibration(snapshot, out);
+    return;
+  }
   
-  display.display();
+  bool capture = strcmp(action, "zero") == 0 || strcmp(action, "point") == 0 ||
+                 strcmp(action, "corner") == 0 || strcmp(action, "tare") == 0 ||
+                 strcmp(action, "tczero") == 0;
+  if (capture && snapshot.faultyCells) {
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      if (snapshot.faultyCells & (1u << i)) {
+        out.printf("Load cell %u %s - fix it before calibrating\n", i + 1, CellFusion::faultName(snapshot.cellFaults[i]));
+      }
+    }
+    return;
+  }
+  if (capture && !snapshot.cellsSettled) {
+    out.println("Weight not settled - try again once the load is still");
+    return;
+  }
+  
+  TRACE_TAKE(calibrationMutex, TRACE_CALIBRATION_WAIT);
+  ScaleCalibration updated = calibration;
+  bool changed = false;
+  bool cleared = false;
+  
+  if (strcmp(action, "zero") == 0) {
+    // Replaces the 0 kg point only; the other points stay where they were
+    changed = true;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      changed = updated.cells[i].setPoint(snapshot.rawCounts[i], 0, temperature) && changed;
+    }
+  } else if (strcmp(action, "point") == 0) {
+    // The known weight stands over the one cell being calibrated
+    char* cellText = SerialConsole::nextWord(args);
+    char* kgText = cellText ? SerialConsole::nextWord(args) : nullptr;
+    int cell = cellText ? atoi(cellText) : 0;
+    float kg = kgText ? atof(kgText) : 0;
+    if (cell >= 1 && cell <= NUM_CELLS && kg > 0) {
+      changed = updated.cells[cell - 1].setPoint(snapshot.rawCounts[cell - 1], kg, temperature);
+    }
+  } else if (strcmp(action, "corner") == 0) {
+    // The known weight stands over one corner; once every corner has had
+    // it, the factors that make all placements read the same are solved
+    char* cellText = SerialConsole::nextWord(args);
+    char* kgText = cellText ? SerialConsole::nextWord(args) : nullptr;
+    int corner = cellText ? atoi(cellText) : 0;
+    float kg = kgText ? atof(kgText) : 0;
+    if (corner >= 1 && corner <= NUM_CELLS && kg > 0) {
+      for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        cornerReadings[corner - 1][i] = updated.cells[i].toKg(snapshot.rawCounts[i], temperature);
+      }
+      cornerKnownKg[corner - 1] = kg;
+      cornersTaken |= 1u << (corner - 1);
+      
+      if (cornersTaken != (1u << NUM_CELLS) - 1) {
+        xSemaphoreGive(calibrationMutex);
+        out.printf("Corner %d taken, %d of %u\n", corner, __builtin_popcount(cornersTaken), NUM_CELLS);
+        return;
+      }
+      cornersTaken = 0;
+      changed = CellFusion::solveCornerFactors(&cornerReadings[0][0], cornerKnownKg, NUM_CELLS, updated.corners);
+    }
+  } else if (strcmp(action, "tare") == 0) {
+    // Moves the whole curve; the gain of every segment is kept
+    changed = true;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      changed = updated.cells[i].tare(snapshot.rawCounts[i], temperature) && changed;
+    }
+  } else if (strcmp(action, "tc") == 0) {
+    char* cellText = SerialConsole::nextWord(args);
+    char* offsetText = cellText ? SerialConsole::nextWord(args) : nullptr;
+    char* spanText = offsetText ? SerialConsole::nextWord(args) : nullptr;
+    int cell = cellText ? atoi(cellText) : 0;
+    if (cell >= 1 && cell <= NUM_CELLS && offsetText) {
+      updated.cells[cell - 1].offsetTempco = atof(offsetText);
+      updated.cells[cell - 1].spanTempco = spanText ? atof(spanText) * 1e-6f : 0;
+      changed = true;
+    }
+  } else if (strcmp(action, "tczero") == 0) {
+    // Empty pallet, some degrees away from where the zero was taken
+    changed = true;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      changed = updated.cells[i].learnOffsetTempco(snapshot.rawCounts[i], temperature) && changed;
+    }
+  } else if (strcmp(action, "clear") == 0) {
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+      updated.cells[i].setLinear(snapshot.rawCounts[i], DEFAULT_COUNTS_PER_KG);
+      updated.corners[i] = 1;
+    }
+    cornersTaken = 0;
+    changed = cleared = true;
+  } else {
+    xSemaphoreGive(calibrationMutex);
+    out.println("Usage: cal [status] | cal zero | cal point <cell> <kg> | cal corner <cell> <kg> |");
+    out.println("       cal tare | cal tc <cell> <counts/C> [ppm/C] | cal tczero | cal clear");
+    return;
+  }
+  
+  bool saved = false;
+  if (changed) {
+    calibration = updated;
+    saved = cleared ? calibrationStore.erase()
+                    : calibrationStore.save(calibration.cells, NUM_CELLS) &&
+                      calibrationStore.saveCorners(calibration.corners, NUM_CELLS);
+    publishedCalibration.write(calibration);
+  }
+  xSemaphoreGive(calibrationMutex);
+  
+  if (!changed) {
+    out.println("Calibration not changed (bad arguments, reading out of order, corners inconsistent or too close in temperature)");
+    return;
+  }
+  out.printf("Calibration %s%s\n", cleared ? "cleared" : "updated", saved ? "" : " - NOT saved to NVS");
+  printCalibration(snapshot, out);
 }
 
-// ============================================================================
-// UTILITY FUNCTIONS
-// ============================================================================
+void printCalibration(const SystemData& data, Print& out) {
+  TRACE_TAKE(calibrationMutex, TRACE_CALIBRATION_WAIT);
+  ScaleCalibration cal = calibration;
+  xSemaphoreGive(calibrationMutex);
+  
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    const CellCalibration& cell = cal.cells[i];
+    out.printf("Cell %u: %u point%s", i + 1, cell.pointCount, cell.pointCount == 1 ? " (nominal gain)" : "s");
+    if (!isnan(cell.referenceTempC)) {
+      out.printf(", taken at %.1f C, %.2f counts/C, %.0f ppm/C", cell.referenceTempC,
+                 cell.offsetTempco, cell.spanTempco * 1e6f);
+    }
+    out.println();
+    for (uint8_t p = 0; p < cell.pointCount; p++) {
+      out.printf("  %8.3f kg at %ld\n", cell.points[p].kg, (long)cell.points[p].counts);
+    }
+    out.printf("  now %ld = %.3f kg, corner x%.4f, share %.0f%%, %s, %lu glitches\n", (long)data.rawCounts[i],
+               cell.toKg(data.rawCounts[i], data.temperature) * cal.corners[i], cal.corners[i],
+               data.cellShares[i] * 100, CellFusion::faultName(data.cellFaults[i]),
+               (unsigned long)data.cellGlitches[i]);
+  }
+  out.printf("Die %.1f C, load %s\n", data.temperature, data.cellsSettled ? "settled" : "moving");
+}
 
-String getTruckIdFromCard(String cardId) {
-  for (int i = 0; i < NUM_TRUCKS; i++) {
-    if (truckCards[i].cardId == cardId) {
-      return truckCards[i].truckId;
+// sku | sku list | sku <size>. The size is the server's, e.g. "300 mL";
+// counts of what is already on the pallet change with it.
+void handleProductCommand(char* args, Print& out) {
+  while (*args == ' ') args++;
+  
+  if (strcmp(args, "list") == 0) {
+    for (uint8_t i = 0; i < STANDARD_SKU_COUNT; i++) {
+      const ProductSku& sku = STANDARD_SKUS[i];
+      out.printf("%c %-8s %.3f kg, %2u per case, case %.2f kg\n", i == activeProduct.load() ? '*' : ' ',
+                 sku.size, sku.bottleKg, sku.bottlesPerCase, sku.caseKg);
     }
+    return;
   }
-  return "";
+  
+  if (*args) {
+    int index = BottleCounter::find(STANDARD_SKUS, STANDARD_SKU_COUNT, args);
+    if (index < 0) {
+      out.printf("Unknown size '%s' - see sku list\n", args);
+      return;
+    }
+    activeProduct = index;
+    bool saved = productPrefs.begin("product", false);
+    if (saved) {
+      saved = productPrefs.putString("size", STANDARD_SKUS[index].size) > 0;
+      productPrefs.end();
+    }
+    if (!saved) out.println("Product NOT saved to NVS");
+  }
+  
+  const ProductSku& sku = STANDARD_SKUS[activeProduct.load()];
+  out.printf("Product %s: %.3f kg a bottle, %u per case, case %.2f kg\n", sku.size, sku.bottleKg,
+             sku.bottlesPerCase, sku.caseKg);
+  // Counted as the old product until the weight task's next batch
+  if (!*args) {
+    SystemData snapshot = publishedData.read();
+    out.printf("On the pallet: %d bottles%s\n", snapshot.bottleCount, snapshot.countAmbiguous ? " (ambiguous)" : "");
+  }
+}
+
+// Every raw sample that did not make it into the weight, by cause
+void printSampleLoss(const SystemData& data, Print& out) {
+  out.print("Glitches rejected:");
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    out.printf(" cell %u %lu", i + 1, (unsigned long)data.cellGlitches[i]);
+  }
+  out.print(", ring overruns:");
+  for (uint8_t i = 0; i < NUM_CELLS; i++) {
+    out.printf(" cell %u %lu", i + 1, (unsigned long)data.cellOverruns[i]);
+  }
+  out.printf(", unpaired %lu\n", (unsigned long)data.unpairedSamples);
+}
+
+// trace | trace json | trace reset
+void handleTraceCommand(char* args, Print& out) {
+#if TRACE_ENABLED
+  char* action = SerialConsole::nextWord(args);
+  if (!action) {
+    tracePrint(out);
+    printSampleLoss(publishedData.read(), out);
+  } else if (strcmp(action, "json") == 0) {
+    tracePrintJson(out);
+  } else if (strcmp(action, "reset") == 0) {
+    traceReset();
+    out.println("Trace histograms cleared");
+  } else {
+    out.println("Usage: trace | trace json | trace reset");
+  }
+#else
+  out.println("Tracing compiled out (TRACE_ENABLED=0)");
+  tracePrintStacks(out);
+  printSampleLoss(publishedData.read(), out);
+#endif
+}
+
+// rec start [seconds] | rec stop | rec status | rec dump
+void handleRecordCommand(char* args, Print& out) {
+  char* action = SerialConsole::nextWord(args);
+  if (action && strcmp(action, "start") == 0) {
+    char* seconds = SerialConsole::nextWord(args);
+    uint32_t duration = seconds ? strtoul(seconds, nullptr, 10) : RAW_RECORD_SECONDS;
+    if (duration == 0) {
+      out.println("Usage: rec start [seconds]");
+      return;
+    }
+    TRACE_TAKE(calibrationMutex, TRACE_CALIBRATION_WAIT);
+    bool started = rawRecorder.start(calibration.cells, calibration.corners, duration);
+    xSemaphoreGive(calibrationMutex);
+    if (started) {
+      out.printf("Recording raw samples for %u s\n", (unsigned)duration);
+    } else {
+      out.println("Recorder busy - rec stop first");
+    }
+  } else if (action && strcmp(action, "stop") == 0) {
+    rawRecorder.stop();
+    out.println("Recording stopped");
+  } else if (action && strcmp(action, "dump") == 0) {
+    if (!rawRecorder.dump(out)) out.println("Nothing to dump, or still recording");
+  } else if (!action || strcmp(action, "status") == 0) {
+    out.printf("Recorder %s: %u bytes, %u sample sets, %u taps, %u dropped\n",
+               rawRecorder.busy() ? "busy" : "idle", (unsigned)rawRecorder.bytesWritten(),
+               (unsigned)rawRecorder.samplesWritten(), (unsigned)rawRecorder.tapsWritten(),
+               (unsigned)rawRecorder.dropped());
+  } else {
+    out.println("Usage: rec start [seconds] | rec stop | rec status | rec dump");
+  }
+}
+
+// Under tuningMutex, or before the tasks start
+void publishTuning() {
+  Tuning tuning;
+  tuning.generation = tuningStore.generation();
+  tuning.filterSamples = tuningStore.getInt(TUNE_FILTER_SAMPLES);
+  tuning.stabilityKg = tuningStore.getFloat(TUNE_STABILITY);
+  tuning.plateauSamples = tuningStore.getInt(TUNE_PLATEAU_SAMPLES);
+  tuning.weightReadMs = tuningStore.getInt(TUNE_WEIGHT_READ_MS);
+  tuning.progressMs = tuningStore.getInt(TUNE_PROGRESS_MS);
+  tuning.displayMs = tuningStore.getInt(TUNE_DISPLAY_MS);
+  tuning.idleAfterMs = tuningStore.getInt(TUNE_IDLE_AFTER_MS);
+  tuning.idleSampleMs = tuningStore.getInt(TUNE_IDLE_SAMPLE_MS);
+  tuning.wakeKg = tuningStore.getFloat(TUNE_WAKE_KG);
+  tuning.settleQuietMs = tuningStore.getInt(TUNE_SETTLE_QUIET_MS);
+  publishedTuning.write(tuning);
+}
+
+void printParam(uint8_t index, Print& out) {
+  const ParamSpec& spec = tuningStore.spec(index);
+  const char* mark = tuningStore.isDefault(index) ? "" : " *";
+  if (spec.type == PARAM_INT) {
+    out.printf("%-16s %8ld %-8s (%.0f..%.0f)%s\n", spec.key, (long)tuningStore.getInt(index), spec.unit,
+               spec.minimum, spec.maximum, mark);
+  } else {
+    out.printf("%-16s %8.3f %-8s (%g..%g)%s\n", spec.key, tuningStore.getFloat(index), spec.unit, spec.minimum,
+               spec.maximum, mark);
+  }
+}
+
+// param | param <name> <value> | param reset. Values that differ from
+// the config.h default are marked *.
+void handleParamCommand(char* args, Print& out) {
+  char* name = SerialConsole::nextWord(args);
+  char* value = SerialConsole::nextWord(args);
+  
+  TRACE_TAKE(tuningMutex, TRACE_TUNING_WAIT);
+  if (name && value) {
+    ParamResult result = tuningStore.set(name, value);
+    if (result == PARAM_OK || result == PARAM_NOT_SAVED) publishTuning();
+    if (result == PARAM_OK) {
+      printParam(tuningStore.find(name), out);
+    } else {
+      out.printf("%s: %s\n", name, ParameterStore::resultName(result));
+    }
+  } else if (name && strcmp(name, "reset") != 0) {
+    out.println("Usage: param | param <name> <value> | param reset");
+  } else {
+    if (name && !tuningStore.reset()) out.println("Defaults applied but NVS NOT cleared");
+    if (name) publishTuning();
+    for (uint8_t i = 0; i < tuningStore.count(); i++) printParam(i, out);
+  }
+  xSemaphoreGive(tuningMutex);
 }
 
-bool isDoubleTap(unsigned long currentTime) {
-  return (currentTime - systemData.lastNfcTapTime) < DOUBLE_TAP_TIME;
+// The same card again shortly after; any other card is a tap of its own
+bool isDoubleTap(const SystemData& data, const WorkflowMessage& tap) {
+  return tap.uid.length == data.lastNfcUid.length &&
+         memcmp(tap.uid.bytes, data.lastNfcUid.bytes, tap.uid.length) == 0 &&
+         tap.at - data.lastNfcTapTime < DOUBLE_TAP_TIME;
 }
 
 void changeSystemState(SystemState newState) {
   systemData.currentState = newState;
   systemData.transactionCount++;
-  Serial.printf("State changed to: %d\n", newState);
+  Serial.printf("State changed to: %s\n", stateLabel(newState));
 }
 
-float calculateBottleCount(float weight) {
-  if (weight < 0.05) return 0;  // Ignore weights below 50g
-  return weight / BOTTLE_WEIGHT;
+// Most likely whole count of the active product, never a truncated ratio
+BottleCount countBottles(float weight, float noiseSd) {
+  return BottleCounter::estimate(STANDARD_SKUS[activeProduct.load()], weight, noiseSd);
 }
 
+// The settled estimate alone decides. The window only supplies the
+// weight and its spread while the load moves; the cells' own plateaus
+// gate calibration and idle sampling, not this.
 bool isWeightStable() {
-  if (!filterInitialized) return false;
-  
-  float maxDev = 0;
-  for (int i = 0; i < FILTER_SAMPLES; i++) {
-    float dev = abs(weightReadings[i] - systemData.filteredWeight);
-    if (dev > maxDev) maxDev = dev;
-  }
-  
-  return maxDev < STABILITY_THRESHOLD;
+  return estimator.isSettled();
+}
+
+// Saturates rather than wraps on a runaway estimate
+int32_t toWeightUnits(float kg) {
+  float units = kg * WEIGHT_UNITS_PER_KG;
+  if (units >= INT32_MAX) return INT32_MAX;
+  if (units <= INT32_MIN) return INT32_MIN;
+  return static_cast<int32_t>(lroundf(units));
+}
+
+float weightUnitsToKg(int32_t units) {
+  return units / WEIGHT_UNITS_PER_KG;
 }
 
 // ============================================================================
 // API FUNCTIONS
 // ============================================================================
 
-// bool sendLoadingTransaction(bool isComplete) {
-//   if (!systemData.wifiConnected) return false;
-  
-//   DynamicJsonDocument doc(1024);
-//   doc["palette_id"] = PALETTE_ID;
-//   doc["truck_id"] = systemData.currentTruckId;
-//   doc["bottle_count"] = systemData.bottleCount;
-//   doc["weight"] = systemData.filteredWeight;
-//   doc["weight_change"] = systemData.weightChange;
-//   doc["timestamp"] = millis();
-//   doc["is_complete"] = isComplete;
-//   doc["transaction_type"] = "LOAD";
-  
-//   return makeApiRequest("/addNewLoading", doc);
-// }
-
-// bool sendUnloadingTransaction(bool isComplete) {
-//   if (!systemData.wifiConnected) return false;
-  
-//   DynamicJsonDocument doc(1024);
-//   doc["palette_id"] = PALETTE_ID;
-//   doc["truck_id"] = systemData.currentTruckId;
-//   doc["bottle_count"] = systemData.bottleCount;
-//   doc["weight"] = systemData.filteredWeight;
-//   doc["weight_change"] = systemData.weightChange;
-//   doc["timestamp"] = millis();
-//   doc["is_complete"] = isComplete;
-//   doc["transaction_type"] = "UNLOAD";
-  
-//   return makeApiRequest("/addNewUnloading", doc);
-// }
-
-// bool makeApiRequest(String endpoint, JsonDocument& payload) {
-//   HTTPClient http;
-//   http.begin(String(API_BASE_URL) + endpoint);
-//   http.addHeader("Content-Type", "application/json");
-//   http.addHeader("Authorization", "Bearer " + String(API_KEY));
-  
-//   String jsonString;
-//   serializeJson(payload, jsonString);
-  
-//   int httpResponseCode = http.POST(jsonString);
-  
-//   if (httpResponseCode > 0) {
-//     String response = http.getString();
-//     Serial.printf("API Response (%d): %s\n", httpResponseCode, response.c_str());
-//     http.end();
-//     return httpResponseCode == 200 || httpResponseCode == 201;
-//   }
-  
-//   Serial.printf("API Request failed: %d\n", httpResponseCode);
-//   http.end();
-//   return false;
-// }
\ No newline at end of file
+// Runs in the journal writer. The uplink only ever sends from the
+// journal, so a record is on flash before any attempt to send it.
+bool journalTransaction(const ApiMessage& message) {
+  TRACE_SCOPE(TRACE_JOURNAL);
+  JournalRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = message.type == API_LOAD_COMPLETE ? JOURNAL_LOAD : JOURNAL_UNLOAD;
+  snprintf(record.truckId, sizeof(record.truckId), "%s", message.truckId);
+  record.bottleCount = message.bottleCount;
+  record.weight = message.weight;
+  record.weightChange = message.weightChange;
+  record.weightVariance = message.weightVariance;
+  record.settleTime = message.settleTime > UINT16_MAX ? UINT16_MAX : message.settleTime;
+  record.settled = message.settled;
+  record.faultyCells = message.faultyCells;
+  record.sku = message.sku;
+  record.countConfidence = message.countConfidence;
+  record.countCheck = message.countCheck;
+  record.timestamp = message.completedAt;
+  record.bootId = bootId;
+  
+  TRACE_TAKE(journalMutex, TRACE_JOURNAL_WAIT);
+  bool saved = journal.append(record);
+  uint32_t pending = journal.pendingCount();
+  xSemaphoreGive(journalMutex);
+  
+  if (!saved) {
+    Serial.println("Journal full or unavailable - transaction NOT saved");
+    return false;
+  }
+  Serial.printf("Journaled transaction #%u (%u pending)\n", record.sequence, pending);
+  return true;
+}
+
+// Returns true if a request was attempted
+bool flushUplink() {
+  JournalRecord records[UplinkBatcher::MAX_TRANSACTIONS];
+  TRACE_TAKE(journalMutex, TRACE_JOURNAL_WAIT);
+  size_t count = journal.peek(records, UplinkBatcher::MAX_TRANSACTIONS);
+  uint32_t journalId = journal.journalId();
+  xSemaphoreGive(journalMutex);
+  for (size_t i = 0; i < count; i++) {
+    uplink.addTransaction(records[i]);
+  }
+  if (uplink.empty()) return false;
+  
+  size_t progress = uplink.progressCount();
+  int responseCode;
+  {
+    TRACE_SCOPE(TRACE_UPLINK);
+    responseCode = uplink.flush(journalId);
+  }
+  Serial.printf("Uplink: %u progress, %u transactions -> %d\n",
+                (unsigned)progress, (unsigned)count, responseCode);
+  
+  TRACE_TAKE(journalMutex, TRACE_JOURNAL_WAIT);
+  
+  // A refused request (a bad API key, an endpoint the server does not
+  // have yet) answers for none of them; they stay journaled until fixed
+  if (responseCode >= 400 && responseCode < 500 && count > 0) {
+    Serial.printf("Transactions #%u-#%u refused (%d) - kept, %u pending\n",
+                  records[0].sequence, records[count - 1].sequence, responseCode, journal.pendingCount());
+  }
+  
+  // Only what the server stored or already holds is cleared. Acks are a
+  // cursor, so that is the batch up to the first record it did not take;
+  // the rest are sent again and come back as duplicates. A record rejected
+  // UPLINK_MAX_REJECTIONS times in a row becomes a dead letter instead of
+  // holding back everything journaled after it.
+  static uint32_t rejectedSequence = 0;
+  static uint8_t rejections = 0;
+  uint32_t delivered = 0;
+  for (size_t i = 0; i < count; i++) {
+    UplinkResult result = uplink.result(i);
+    if (result == UPLINK_REJECTED) {
+      if (records[i].sequence != rejectedSequence) {
+        rejectedSequence = records[i].sequence;
+        rejections = 0;
+      }
+      if (++rejections < UPLINK_MAX_REJECTIONS) {
+        Serial.printf("Transaction #%u rejected (%u of %u) - kept\n", records[i].sequence,
+                      rejections, UPLINK_MAX_REJECTIONS);
+        break;
+      }
+      if (!journal.deadLetter(records[i])) break;
+      Serial.printf("Transaction #%u rejected %u times - set aside (%u dead letters)\n",
+                    records[i].sequence, rejections, journal.deadLetterCount());
+    } else if (result != UPLINK_STORED && result != UPLINK_DUPLICATE) {
+      break;
+    }
+    delivered = records[i].sequence;
+  }
+  
+  if (delivered > 0) journal.acknowledge(delivered);
+  xSemaphoreGive(journalMutex);
+  
+  if (delivered > 0) postUploadStatus();
+  return true;
+}
+
+// Lets the workflow show how many transactions still wait for the server
+void postUploadStatus() {
+  WorkflowMessage message = makeWorkflowMessage(EVT_NETWORK_ACK);
+  TRACE_TAKE(journalMutex, TRACE_JOURNAL_WAIT);
+  uint32_t pending = journal.pendingCount();
+  xSemaphoreGive(journalMutex);
+  message.pendingUploads = pending > UINT16_MAX ? UINT16_MAX : pending;
+  postWorkflowEvent(message, pdMS_TO_TICKS(100));
+}
+
+void syncTrucks() {
+  TRACE_SCOPE(TRACE_TRUCK_SYNC);
+  int responseCode = truckSync.run(trucks, registryMutex);
+  if (responseCode == 200) {
+    Serial.printf("Fleet updated: %u trucks\n", (unsigned)truckSync.lastCount());
+  } else if (responseCode != 304) {
+    Serial.printf("Fleet download failed (%d)\n", responseCode);
+  }
+}
+
@@ -0,0 +1,108 @@
+/*
+  Smart Inventory Palette - Interrupt-driven PN532 reader
+
+  File: nfc_reader.cpp
+*/
+
+#include "nfc_reader.h"
+#include "trace_monitor.h"
+#include <string.h>
+
+NfcReader::NfcReader(Adafruit_PN532& nfc, uint8_t irqPin) : nfc_(nfc), irqPin_(irqPin) {}
+
+void NfcReader::begin() {
+  task_ = xTaskGetCurrentTaskHandle();
+  attachInterruptArg(digitalPinToInterrupt(irqPin_), onIrq, this, FALLING);
+  arm();
+}
+
+void IRAM_ATTR NfcReader::onIrq(void* arg) {
+  NfcReader* reader = static_cast<NfcReader*>(arg);
+  reader->irqAtMs_ = millis();
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(reader->task_, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+bool NfcReader::arm() {
+  armed_ = nfc_.startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+  return armed_;
+}
+
+bool NfcReader::waitForTap(NfcTap& tap, TickType_t timeout) {
+  TickType_t start = xTaskGetTickCount();
+
+  while (true) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed >= timeout) return false;
+    TickType_t remaining = timeout - elapsed;
+
+    // Give a card that stays in the field a short rest before asking again
+    if (!armed_) {
+      int32_t rest = static_cast<int32_t>(rearmAtMs_ - millis());
+      if (rest > 0) {
+        TickType_t ticks = pdMS_TO_TICKS(rest);
+        vTaskDelay(ticks < remaining ? ticks : remaining);
+        continue;
+      }
+      if (!arm()) {
+        rearmAtMs_ = millis() + REARM_DELAY_MS;
+        continue;
+      }
+    }
+
+    // The ACK of the arm command pulses IRQ as well, so only a level
+    // that is still low means a card is waiting
+    if (digitalRead(irqPin_) != LOW) {
+      ulTaskNotifyTake(pdTRUE, remaining);
+      if (digitalRead(irqPin_) != LOW) continue;
+    }
+
+    armed_ = false;
+    rearmAtMs_ = millis() + REARM_DELAY_MS;
+
+    NfcUid uid;
+    bool read;
+    {
+      TRACE_SCOPE(TRACE_NFC_READ);
+      read = nfc_.readDetectedPassiveTargetID(uid.bytes, &uid.length);
+    }
+    if (!read) continue;
+    detections_++;
+
+    uint32_t seenAt = irqAtMs_;
+    if (!isNewTap(uid, seenAt)) continue;
+
+    tap.uid = uid;
+    tap.timestampMs = seenAt;
+    taps_++;
+    return true;
+  }
+}
+
+// True when `uid` was not in the field just before; refreshes its entry
+bool NfcReader::isNewTap(const NfcUid& uid, uint32_t seenAt) {
+  SeenCard* slot = nullptr;
+
+  for (uint8_t i = 0; i < TRACKED_CARDS; i++) {
+    SeenCard& card = seen_[i];
+    if (card.used && card.uid.length == uid.length && memcmp(card.uid.bytes, uid.bytes, uid.length) == 0) {
+      bool stillPresent = seenAt - card.lastSeenMs < RELEASE_MS;
+      card.lastSeenMs = seenAt;
+      return !stillPresent;
+    }
+
+    // Otherwise take a free entry, or else the card seen longest ago
+    if (!card.used) {
+      if (!slot || slot->used) slot = &card;
+    } else if (!slot || (slot->used && seenAt - card.lastSeenMs > seenAt - slot->lastSeenMs)) {
+      slot = &card;
+    }
+  }
+
+  slot->uid = uid;
+  slot->lastSeenMs = seenAt;
+  slot->used = true;
+  return true;
+}
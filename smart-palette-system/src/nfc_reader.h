@@ -0,0 +1,80 @@
+/*
+  Smart Inventory Palette - Interrupt-driven PN532 reader
+
+  The PN532 is armed with InListPassiveTarget and left alone: it keeps
+  looking for a card by itself and pulls IRQ low once one has been
+  activated. The falling edge timestamps the detection and wakes the
+  waiting task, which only then fetches the UID over I2C. Between cards
+  the reader costs no bus traffic and no CPU.
+
+  A card held against the reader is found again after every re-arm.
+  Each UID seen recently is remembered with the time it was last seen;
+  the card counts as a new tap only once it has been out of the field
+  for RELEASE_MS. Two quick taps of the same card therefore stay two
+  taps, while a card left in place is one.
+
+  File: nfc_reader.h
+*/
+
+#ifndef NFC_READER_H
+#define NFC_READER_H
+
+#include <Arduino.h>
+#include <Adafruit_PN532.h>
+#include <TruckRegistry.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Card UIDs are kept as raw bytes and only formatted for logging, so a tap
+// never touches the heap
+struct NfcUid {
+  uint8_t bytes[TruckRegistry::UID_MAX_LENGTH];
+  uint8_t length;
+};
+
+struct NfcTap {
+  NfcUid uid;
+  uint32_t timestampMs;     // millis() at the IRQ edge, not when it was read
+};
+
+class NfcReader {
+public:
+  static const uint32_t RELEASE_MS = 300;      // Absence that ends a tap
+  static const uint32_t REARM_DELAY_MS = 50;   // Bus rest while a card stays in the field
+  static const uint8_t TRACKED_CARDS = 4;
+
+  NfcReader(Adafruit_PN532& nfc, uint8_t irqPin);
+
+  // Attach the IRQ and arm the first detection. Call from the task that
+  // calls waitForTap(); the ISR wakes that task.
+  void begin();
+
+  // Block until a new tap or until `timeout` passes
+  bool waitForTap(NfcTap& tap, TickType_t timeout);
+
+  uint32_t detections() const { return detections_; }
+  uint32_t taps() const { return taps_; }
+
+private:
+  struct SeenCard {
+    NfcUid uid;
+    uint32_t lastSeenMs;
+    bool used;
+  };
+
+  static void IRAM_ATTR onIrq(void* arg);
+  bool arm();
+  bool isNewTap(const NfcUid& uid, uint32_t seenAt);
+
+  Adafruit_PN532& nfc_;
+  uint8_t irqPin_;
+  TaskHandle_t task_ = nullptr;
+  volatile uint32_t irqAtMs_ = 0;
+  bool armed_ = false;
+  uint32_t rearmAtMs_ = 0;
+  SeenCard seen_[TRACKED_CARDS] = {};
+  uint32_t detections_ = 0;
+  uint32_t taps_ = 0;
+};
+
+#endif
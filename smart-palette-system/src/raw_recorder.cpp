@@ -0,0 +1,211 @@
+/*
+  Smart Inventory Palette - Raw sample recorder
+
+  File: raw_recorder.cpp
+*/
+
+#include "raw_recorder.h"
+#include <string.h>
+
+RawRecorder::RawRecorder(fs::FS& fs, const char* path) : fs_(fs), path_(path) {}
+
+void RawRecorder::begin(uint8_t cells, uint16_t sampleRate) {
+  cells_ = cells < MAX_CELLS ? cells : MAX_CELLS;
+  sampleRate_ = sampleRate;
+  xTaskCreatePinnedToCore(taskEntry, "RawRecorder", STACK_SIZE, this, 1, &task_, 0);
+}
+
+bool RawRecorder::start(const CellCalibration* cells, const float* corners, uint32_t seconds) {
+  uint8_t idle = IDLE;
+  if (!task_ || !state_.compare_exchange_strong(idle, STARTING)) return false;
+  for (uint8_t i = 0; i < cells_; i++) {
+    calibration_[i] = cells[i];
+    corners_[i] = corners[i];
+  }
+  stopAtMs_ = millis() + seconds * 1000;
+  xTaskNotifyGive(task_);
+  return true;
+}
+
+void RawRecorder::stop() {
+  uint8_t recording = RECORDING;
+  if (state_.compare_exchange_strong(recording, STOPPING)) xTaskNotifyGive(task_);
+}
+
+void RawRecorder::addSamples(uint32_t timestampUs, uint8_t present, const int32_t* counts) {
+  if (!recording()) return;
+  SampleSet set;
+  set.timestampUs = timestampUs;
+  set.present = present;
+  memcpy(set.counts, counts, sizeof(int32_t) * cells_);
+  samples_.push(set);
+}
+
+void RawRecorder::addTap(uint32_t timestampUs, const uint8_t* uid, uint8_t length) {
+  if (!recording()) return;
+  Tap tap;
+  tap.timestampUs = timestampUs;
+  tap.length = length < MAX_UID_LENGTH ? length : MAX_UID_LENGTH;
+  memcpy(tap.uid, uid, tap.length);
+  taps_.push(tap);
+}
+
+// ============================================================================
+// WRITER TASK
+// ============================================================================
+void RawRecorder::taskEntry(void* arg) {
+  static_cast<RawRecorder*>(arg)->run();
+}
+
+void RawRecorder::run() {
+  while (true) {
+    uint8_t state = state_.load(std::memory_order_acquire);
+    if (state == IDLE || state == DUMPING) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    if (state == STARTING) {
+      state_.store(open() ? RECORDING : IDLE, std::memory_order_release);
+      continue;
+    }
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DRAIN_MS));
+    drain();
+
+    // Out of time or room: finish as if stopped
+    bool full = bytesWritten_ + RawTrace::RECORD_HEAD_SIZE + sizeof(int32_t) * cells_ > MAX_BYTES;
+    if (full || static_cast<int32_t>(millis() - stopAtMs_) >= 0) stop();
+
+    if (state_.load(std::memory_order_acquire) == STOPPING) {
+      drain();
+      close();
+      state_.store(IDLE, std::memory_order_release);
+    }
+  }
+}
+
+bool RawRecorder::open() {
+  // Whatever was pushed after the last recording stopped is stale
+  SampleSet set;
+  Tap tap;
+  while (samples_.pop(set)) {}
+  while (taps_.pop(tap)) {}
+  bytesWritten_ = 0;
+  samplesWritten_ = 0;
+  tapsWritten_ = 0;
+
+  file_ = fs_.open(path_, FILE_WRITE);
+  if (!file_) return false;
+
+  RawTraceHeader header;
+  RawTrace::makeHeader(header, cells_, sampleRate_, millis());
+  write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+
+  uint8_t payload[sizeof(CellCalibration) + sizeof(float)];
+  uint8_t record[RawTrace::RECORD_HEAD_SIZE + sizeof(payload)];
+  for (uint8_t i = 0; i < cells_; i++) {
+    memcpy(payload, &calibration_[i], sizeof(CellCalibration));
+    memcpy(payload + sizeof(CellCalibration), &corners_[i], sizeof(float));
+    write(record, RawTrace::encode(record, sizeof(record), RAW_CALIBRATION, i, micros(), payload, sizeof(payload)));
+  }
+  lastTemperatureMs_ = millis() - TEMPERATURE_MS;
+  return true;
+}
+
+// Samples and taps in time order, then the temperature when it is due
+void RawRecorder::drain() {
+  uint8_t chunk[512];
+  size_t used = 0;
+  SampleSet set;
+  Tap tap;
+  bool haveSet = samples_.peek(set);
+  bool haveTap = taps_.peek(tap);
+
+  while (haveSet || haveTap) {
+    bool tapFirst = haveTap && (!haveSet || static_cast<int32_t>(tap.timestampUs - set.timestampUs) <= 0);
+    size_t size = RawTrace::RECORD_HEAD_SIZE + (tapFirst ? tap.length : sizeof(int32_t) * cells_);
+    if (bytesWritten_ + used + size > MAX_BYTES) break;
+    if (used + size > sizeof(chunk)) {
+      write(chunk, used);
+      used = 0;
+    }
+    if (tapFirst) {
+      used += RawTrace::encode(chunk + used, sizeof(chunk) - used, RAW_TAP, 0, tap.timestampUs, tap.uid, tap.length);
+      taps_.pop(tap);
+      tapsWritten_++;
+      haveTap = taps_.peek(tap);
+    } else {
+      used += RawTrace::encodeSample(chunk + used, sizeof(chunk) - used, set.timestampUs, set.present, set.counts,
+                                     cells_);
+      samples_.pop(set);
+      samplesWritten_++;
+      haveSet = samples_.peek(set);
+    }
+  }
+
+  if (millis() - lastTemperatureMs_ >= TEMPERATURE_MS &&
+      bytesWritten_ + used + RawTrace::RECORD_HEAD_SIZE + sizeof(float) <= MAX_BYTES) {
+    lastTemperatureMs_ = millis();
+    float temperature = temperatureRead();
+    if (used + RawTrace::RECORD_HEAD_SIZE + sizeof(float) > sizeof(chunk)) {
+      write(chunk, used);
+      used = 0;
+    }
+    used += RawTrace::encode(chunk + used, sizeof(chunk) - used, RAW_TEMPERATURE, 0, micros(), &temperature,
+                             sizeof(temperature));
+  }
+  write(chunk, used);
+  file_.flush();
+}
+
+void RawRecorder::close() {
+  file_.close();
+}
+
+void RawRecorder::write(const uint8_t* data, size_t length) {
+  if (length) bytesWritten_ += file_.write(data, length);
+}
+
+// ============================================================================
+// DUMP
+// ============================================================================
+static const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 57 bytes make one 76-character line
+static void printBase64(Print& out, const uint8_t* data, size_t length) {
+  char line[77];
+  size_t n = 0;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+    if (i + 1 < length) group |= static_cast<uint32_t>(data[i + 1]) << 8;
+    if (i + 2 < length) group |= data[i + 2];
+    line[n++] = BASE64[(group >> 18) & 0x3F];
+    line[n++] = BASE64[(group >> 12) & 0x3F];
+    line[n++] = i + 1 < length ? BASE64[(group >> 6) & 0x3F] : '=';
+    line[n++] = i + 2 < length ? BASE64[group & 0x3F] : '=';
+  }
+  line[n] = '\0';
+  out.println(line);
+}
+
+bool RawRecorder::dump(Print& out) {
+  // Holds off start() so the file is not rewritten under the reader
+  uint8_t idle = IDLE;
+  if (!state_.compare_exchange_strong(idle, DUMPING)) return false;
+
+  fs::File file;
+  if (fs_.exists(path_)) file = fs_.open(path_, FILE_READ);
+  bool found = static_cast<bool>(file);
+  if (found) {
+    out.printf("-----BEGIN RAW TRACE----- %u bytes\n", (unsigned)file.size());
+    uint8_t buffer[57];
+    size_t length;
+    while ((length = file.read(buffer, sizeof(buffer))) > 0) {
+      printBase64(out, buffer, length);
+    }
+    out.println("-----END RAW TRACE-----");
+    file.close();
+  }
+  state_.store(IDLE, std::memory_order_release);
+  return found;
+}
@@ -0,0 +1,113 @@
+/*
+  Smart Inventory Palette - Raw sample recorder
+
+  Records every HX711 sample set, every NFC tap and the die temperature
+  at full rate to a RawTrace file on LittleFS, for replaying a real dock
+  event through the simulator (sim_main.cpp --replay) while tuning the
+  filters.
+
+  The weight task and the NFC task only push into lock-free rings; a
+  task of its own drains them to flash every DRAIN_MS, so a slow flash
+  write never holds up sampling. A ring that overflows counts the loss
+  instead of blocking. The file starts with the calibration in force, so
+  the replay converts counts to kilograms exactly as the scale did.
+
+  Recording stops by itself after the requested time or at MAX_BYTES.
+  dump() prints the file as base64 between BEGIN/END lines for copying
+  off the serial monitor.
+
+  File: raw_recorder.h
+*/
+
+#ifndef RAW_RECORDER_H
+#define RAW_RECORDER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SampleRing.h>
+#include <RawTrace.h>
+#include <LoadCellCalibration.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+class RawRecorder {
+public:
+  static const uint8_t MAX_CELLS = 4;
+  static const uint8_t MAX_UID_LENGTH = 10;
+  static const size_t MAX_BYTES = 256 * 1024;      // About 3 minutes on two cells
+  static const uint32_t DRAIN_MS = 250;
+  static const uint32_t TEMPERATURE_MS = 10000;
+  static const uint32_t STACK_SIZE = 3072;
+
+  explicit RawRecorder(fs::FS& fs, const char* path = "/raw.bin");
+
+  // Creates the writer task; the filesystem must be mounted
+  void begin(uint8_t cells, uint16_t sampleRate);
+
+  // Replaces the previous recording. Fails if one is in progress.
+  bool start(const CellCalibration* cells, const float* corners, uint32_t seconds);
+  void stop();
+  bool recording() const { return state_.load(std::memory_order_acquire) == RECORDING; }
+  bool busy() const { return state_.load(std::memory_order_acquire) != IDLE; }
+
+  // Weight task only; ignored unless recording
+  void addSamples(uint32_t timestampUs, uint8_t present, const int32_t* counts);
+  // NFC task only; ignored unless recording
+  void addTap(uint32_t timestampUs, const uint8_t* uid, uint8_t length);
+
+  uint32_t bytesWritten() const { return bytesWritten_; }
+  uint32_t samplesWritten() const { return samplesWritten_; }
+  uint32_t tapsWritten() const { return tapsWritten_; }
+  uint32_t dropped() const { return samples_.dropped() + taps_.dropped(); }
+  TaskHandle_t task() const { return task_; }
+
+  // The last recording as base64, 76 characters a line; false while
+  // recording or if there is none
+  bool dump(Print& out);
+
+private:
+  enum State : uint8_t { IDLE, STARTING, RECORDING, STOPPING, DUMPING };
+
+  struct SampleSet {
+    uint32_t timestampUs;
+    uint8_t present;
+    int32_t counts[MAX_CELLS];
+  };
+
+  struct Tap {
+    uint32_t timestampUs;
+    uint8_t length;
+    uint8_t uid[MAX_UID_LENGTH];
+  };
+
+  static void taskEntry(void* arg);
+  void run();
+  bool open();
+  void drain();
+  void close();
+  void write(const uint8_t* data, size_t length);
+
+  fs::FS& fs_;
+  const char* path_;
+  uint8_t cells_ = 0;
+  uint16_t sampleRate_ = 0;
+  TaskHandle_t task_ = nullptr;
+  std::atomic<uint8_t> state_{IDLE};
+
+  // Handed to the writer task by start()
+  CellCalibration calibration_[MAX_CELLS];
+  float corners_[MAX_CELLS];
+  uint32_t stopAtMs_ = 0;
+
+  SampleRing<SampleSet, 64> samples_;  // 800 ms at 80 SPS
+  SampleRing<Tap, 8> taps_;
+
+  fs::File file_;
+  uint32_t lastTemperatureMs_ = 0;
+  uint32_t bytesWritten_ = 0;
+  uint32_t samplesWritten_ = 0;
+  uint32_t tapsWritten_ = 0;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+  Smart Inventory Palette - Remote maintenance console
+
+  File: remote_console.cpp
+*/
+
+#include "remote_console.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Stop taking commands once the reply has less room than this left
+static const size_t REPLY_RESERVE = 256;
+static const char TRUNCATED[] = "...\n";
+
+// Commands that only report, allowed from an unauthenticated server.
+// Matched on whole words.
+static const char* const REMOTE_READ_ONLY[] = {
+  "cal", "cal status", "trace", "trace json", "truck list", "param", "sku", "rec status",
+};
+
+size_t RemoteConsole::ReplyWriter::write(uint8_t c) {
+  if (length_ + 1 >= size_) {
+    truncated_ = true;
+    return 0;
+  }
+  buffer_[length_++] = static_cast<char>(c);
+  return 1;
+}
+
+RemoteConsole::RemoteConsole(SerialConsole& console, const char* url, const char* apiKey, const char* paletteId)
+    : console_(console), url_(url), apiKey_(apiKey), paletteId_(paletteId) {}
+
+void RemoteConsole::begin(const char* rootCA) {
+  if (rootCA) {
+    client_.setCACert(rootCA);
+  } else {
+    client_.setInsecure();
+    Serial.println("Remote console: no root CA pinned, read-only commands only");
+  }
+  readOnly_ = rootCA == nullptr;
+  // Polled rarely: no second TLS session kept open, and no chunked body
+  http_.setReuse(false);
+  http_.useHTTP10(true);
+  http_.setTimeout(5000);
+
+  if (prefs_.begin("console", true)) {
+    lastSequence_ = prefs_.getUInt("seq", 0);
+    prefs_.end();
+  }
+}
+
+int RemoteConsole::run() {
+  char url[192];
+  snprintf(url, sizeof(url), "%s?palette_id=%s&after=%u", url_, paletteId_, (unsigned)lastSequence_);
+
+  http_.begin(client_, url);
+  http_.addHeader("Authorization", String("Bearer ") + apiKey_);
+  int code = http_.GET();
+  if (code != 200) {
+    http_.end();
+    return code == 204 || code == 304 ? 0 : -1;
+  }
+
+  replyLength_ = 0;
+  int ran = 0;
+  WiFiClient* stream = http_.getStreamPtr();
+  char line[SerialConsole::LINE_LENGTH];
+  while (ran < (int)MAX_COMMANDS_PER_POLL && REPLY_SIZE - replyLength_ > REPLY_RESERVE) {
+    size_t n = stream->readBytesUntil('\n', line, sizeof(line) - 1);
+    if (n == 0 && stream->available() <= 0) break;
+    if (n > 0 && line[n - 1] == '\r') n--;
+    line[n] = '\0';
+
+    // "<sequence> <command line>"
+    char* command;
+    uint32_t sequence = strtoul(line, &command, 10);
+    if (command == line || sequence <= lastSequence_) continue;
+    while (*command == ' ') command++;
+
+    Serial.printf("Remote command #%u: %s\n", (unsigned)sequence, command);
+    replyLength_ += snprintf(reply_ + replyLength_, REPLY_SIZE - replyLength_, "result %u\n", (unsigned)sequence);
+    // Room is kept for the marker of a reply cut short
+    ReplyWriter writer(reply_, REPLY_SIZE - sizeof(TRUNCATED), replyLength_);
+    if (readOnly_ && !isReadOnly(command)) {
+      writer.println("refused: read-only without a pinned server certificate");
+    } else {
+      console_.execute(command, writer);
+    }
+    if (writer.truncated()) {
+      memcpy(reply_ + replyLength_, TRUNCATED, sizeof(TRUNCATED) - 1);
+      replyLength_ += sizeof(TRUNCATED) - 1;
+    }
+
+    // Executed: never run it again, whatever happens to the reply
+    lastSequence_ = sequence;
+    ran++;
+  }
+  http_.end();
+  if (ran == 0) return 0;
+
+  saveSequence();
+  snprintf(url, sizeof(url), "%s?palette_id=%s", url_, paletteId_);
+  http_.begin(client_, url);
+  http_.addHeader("Authorization", String("Bearer ") + apiKey_);
+  http_.addHeader("Content-Type", "text/plain");
+  code = http_.POST(reinterpret_cast<uint8_t*>(reply_), replyLength_);
+  http_.end();
+  if (code < 200 || code >= 300) {
+    Serial.printf("Remote console reply failed (%d)\n", code);
+  }
+  return ran;
+}
+
+bool RemoteConsole::isReadOnly(const char* command) {
+  // Words joined by single spaces, so "cal  status" matches too
+  char words[SerialConsole::LINE_LENGTH];
+  size_t length = 0;
+  for (const char* c = command; *c && length + 1 < sizeof(words); c++) {
+    if (*c == ' ' || *c == '\t') {
+      if (length > 0 && words[length - 1] != ' ') words[length++] = ' ';
+    } else {
+      words[length++] = *c;
+    }
+  }
+  if (length > 0 && words[length - 1] == ' ') length--;
+  words[length] = '\0';
+
+  for (const char* allowed : REMOTE_READ_ONLY) {
+    if (strcmp(words, allowed) == 0) return true;
+  }
+  return false;
+}
+
+void RemoteConsole::saveSequence() {
+  if (prefs_.begin("console", false)) {
+    prefs_.putUInt("seq", lastSequence_);
+    prefs_.end();
+  }
+}
@@ -0,0 +1,94 @@
+/*
+  Smart Inventory Palette - Remote maintenance console
+
+  Runs serial console commands queued on the server for this palette,
+  so a site can be calibrated or provisioned without a laptop at every
+  pallet. Each poll asks for the commands after the last one executed:
+
+    GET <url>?palette_id=PAL_001&after=16
+
+    17 cal zero
+    18 cal status
+
+  Every line goes through the same handlers as a typed command, and the
+  replies are posted back in one request:
+
+    POST <url>?palette_id=PAL_001
+
+    result 17
+    Zero captured on both cells
+    result 18
+    ...
+
+  The sequence of the last executed command is kept in NVS and sent as
+  `after`, so a command runs once even if its reply is lost or the
+  palette reboots; the server treats `after` as the acknowledgement.
+
+  Without a pinned root certificate the server is not authenticated, and
+  anyone on the path could queue `cal clear` or `truck del`. Only the
+  read-only commands in REMOTE_READ_ONLY run then; the rest are answered
+  "refused" and consumed like any other command.
+
+  File: remote_console.h
+*/
+
+#ifndef REMOTE_CONSOLE_H
+#define REMOTE_CONSOLE_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <Preferences.h>
+#include "serial_console.h"
+
+class RemoteConsole {
+public:
+  static const size_t MAX_COMMANDS_PER_POLL = 8;
+  static const size_t REPLY_SIZE = 2048;
+
+  RemoteConsole(SerialConsole& console, const char* url, const char* apiKey, const char* paletteId);
+
+  // Without a root certificate the server is not authenticated and the
+  // console is read-only
+  void begin(const char* rootCA);
+  bool readOnly() const { return readOnly_; }
+
+  // One poll. Returns how many commands ran (0 if none were waiting),
+  // or -1 if the server could not be reached.
+  int run();
+
+private:
+  // Collects a handler's output in the reply body; output that does not
+  // fit is dropped and the reply marked as cut short
+  class ReplyWriter : public Print {
+  public:
+    ReplyWriter(char* buffer, size_t size, size_t& length) : buffer_(buffer), size_(size), length_(length) {}
+    size_t write(uint8_t c) override;
+    using Print::write;
+    bool truncated() const { return truncated_; }
+
+  private:
+    char* buffer_;
+    size_t size_;
+    size_t& length_;
+    bool truncated_ = false;
+  };
+
+  void saveSequence();
+  static bool isReadOnly(const char* command);
+
+  SerialConsole& console_;
+  const char* url_;
+  const char* apiKey_;
+  const char* paletteId_;
+
+  WiFiClientSecure client_;
+  HTTPClient http_;
+  Preferences prefs_;
+  uint32_t lastSequence_ = 0;
+  bool readOnly_ = true;
+  char reply_[REPLY_SIZE];
+  size_t replyLength_ = 0;
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+  Smart Inventory Palette - Serial maintenance console
+
+  File: serial_console.cpp
+*/
+
+#include "serial_console.h"
+#include <string.h>
+
+bool SerialConsole::addCommand(const char* name, ConsoleHandler handler) {
+  if (commandCount_ >= MAX_COMMANDS) return false;
+  commands_[commandCount_].name = name;
+  commands_[commandCount_].handler = handler;
+  commandCount_++;
+  return true;
+}
+
+void SerialConsole::poll() {
+  while (stream_.available() > 0) {
+    int c = stream_.read();
+    if (c < 0) break;
+
+    if (c == '\r' || c == '\n') {
+      if (overflow_) {
+        stream_.println("Line too long - ignored");
+      } else if (length_ > 0) {
+        line_[length_] = '\0';
+        execute(line_, stream_);
+      }
+      length_ = 0;
+      overflow_ = false;
+    } else if (length_ < LINE_LENGTH - 1) {
+      line_[length_++] = static_cast<char>(c);
+    } else {
+      overflow_ = true;
+    }
+  }
+}
+
+char* SerialConsole::nextWord(char*& args) {
+  while (*args == ' ') args++;
+  if (*args == '\0') return nullptr;
+  char* word = args;
+  while (*args != '\0' && *args != ' ') args++;
+  if (*args == ' ') *args++ = '\0';
+  return word;
+}
+
+void SerialConsole::execute(char* line, Print& out) {
+  char* args = line;
+  char* name = nextWord(args);
+  if (!name) return;
+
+  for (size_t i = 0; i < commandCount_; i++) {
+    if (strcmp(commands_[i].name, name) == 0) {
+      commands_[i].handler(args, out);
+      return;
+    }
+  }
+  out.printf("Unknown command: %s\n", name);
+}
@@ -0,0 +1,57 @@
+/*
+  Smart Inventory Palette - Serial maintenance console
+
+  Collects characters from a stream into a fixed line buffer and hands
+  each completed line to the command registered under its first word:
+
+    truck add 04:52:F3:2A TRUCK_D Driver Name
+
+  The handler receives the rest of the line ("add 04:52:...") and
+  prints its reply to the same stream. Nothing is allocated. Lines from
+  elsewhere (the remote console) run through the same handlers.
+
+  File: serial_console.h
+*/
+
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+
+typedef void (*ConsoleHandler)(char* args, Print& out);
+
+class SerialConsole {
+public:
+  static const size_t MAX_COMMANDS = 8;
+  static const size_t LINE_LENGTH = 96;
+
+  explicit SerialConsole(Stream& stream) : stream_(stream) {}
+
+  bool addCommand(const char* name, ConsoleHandler handler);
+
+  // Consume whatever input is waiting; never blocks
+  void poll();
+
+  // Run one command line as if it had been typed, replying to `out`
+  // instead of the stream. Used for commands arriving over the network.
+  void execute(char* line, Print& out);
+
+  // Split off the next space-separated word of `args` and advance past it.
+  // Returns nullptr once the line is used up.
+  static char* nextWord(char*& args);
+
+private:
+  struct Command {
+    const char* name;
+    ConsoleHandler handler;
+  };
+
+  Stream& stream_;
+  Command commands_[MAX_COMMANDS];
+  size_t commandCount_ = 0;
+  char line_[LINE_LENGTH];
+  size_t length_ = 0;
+  bool overflow_ = false;
+};
+
+#endif
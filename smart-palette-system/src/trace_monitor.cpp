@@ -0,0 +1,147 @@
+/*
+  Smart Inventory Palette - Stage latency tracing
+
+  File: trace_monitor.cpp
+*/
+
+#include "trace_monitor.h"
+
+struct TraceTask {
+  TaskHandle_t task;
+  const char* name;
+  uint32_t stackSize;
+};
+
+static TraceTask watched[TRACE_MAX_TASKS];
+static size_t watchedCount = 0;
+
+void traceWatchTask(TaskHandle_t task, const char* name, uint32_t stackSize) {
+  if (!task || watchedCount >= TRACE_MAX_TASKS) return;
+  watched[watchedCount++] = {task, name, stackSize};
+}
+
+void tracePrintStacks(Print& out) {
+  out.print("Stacks:");
+  for (size_t i = 0; i < watchedCount; i++) {
+    out.printf(" %s %u/%u", watched[i].name, (unsigned)uxTaskGetStackHighWaterMark(watched[i].task),
+               watched[i].stackSize);
+  }
+  out.println(" bytes free");
+}
+
+#if TRACE_ENABLED
+
+static const char* const STAGE_NAMES[TRACE_STAGE_COUNT] = {
+  "weight_batch",
+  "workflow",
+  "tap_to_led",
+  "wake",
+  "nfc_read",
+  "display",
+  "journal",
+  "uplink",
+  "truck_sync",
+  "console_poll",
+  "registry_wait",
+  "calibration_wait",
+  "tuning_wait",
+  "journal_wait",
+};
+
+struct TraceHistogram {
+  volatile uint32_t buckets[TRACE_BUCKETS];
+  volatile uint32_t count;
+  volatile uint32_t maxUs;
+  volatile uint64_t totalUs;
+};
+
+static TraceHistogram histograms[TRACE_STAGE_COUNT];
+
+static uint8_t bucketFor(uint32_t us) {
+  if (us == 0) return 0;
+  uint8_t bucket = 32 - __builtin_clz(us);
+  return bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1;
+}
+
+void traceRecord(TraceStage stage, uint32_t us) {
+  TraceHistogram& h = histograms[stage];
+  uint8_t bucket = bucketFor(us);
+  h.buckets[bucket] = h.buckets[bucket] + 1;
+  h.count = h.count + 1;
+  h.totalUs = h.totalUs + us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+// Upper edge of the bucket the `permille`th sample falls in, never
+// beyond the largest sample seen
+static uint32_t percentile(const TraceHistogram& h, uint32_t count, uint32_t maxUs, uint32_t permille) {
+  if (count == 0) return 0;
+  uint32_t rank = (static_cast<uint64_t>(count) * permille + 999) / 1000;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < TRACE_BUCKETS - 1; b++) {
+    seen += h.buckets[b];
+    if (seen >= rank) {
+      uint32_t edge = 1u << b;
+      return edge < maxUs ? edge : maxUs;
+    }
+  }
+  return maxUs;
+}
+
+TraceStats traceStats(TraceStage stage) {
+  const TraceHistogram& h = histograms[stage];
+  TraceStats stats;
+  stats.name = STAGE_NAMES[stage];
+  stats.count = h.count;
+  stats.maxUs = h.maxUs;
+  stats.totalUs = h.totalUs;
+  stats.p50Us = percentile(h, stats.count, stats.maxUs, 500);
+  stats.p95Us = percentile(h, stats.count, stats.maxUs, 950);
+  stats.p99Us = percentile(h, stats.count, stats.maxUs, 990);
+  return stats;
+}
+
+void traceReset() {
+  for (size_t s = 0; s < TRACE_STAGE_COUNT; s++) {
+    TraceHistogram& h = histograms[s];
+    for (uint8_t b = 0; b < TRACE_BUCKETS; b++) h.buckets[b] = 0;
+    h.count = 0;
+    h.maxUs = 0;
+    h.totalUs = 0;
+  }
+}
+
+void tracePrint(Print& out) {
+  out.printf("%-17s %7s %8s %8s %8s %8s %8s\n", "stage (us)", "count", "mean", "p50", "p95", "p99", "max");
+  for (size_t s = 0; s < TRACE_STAGE_COUNT; s++) {
+    TraceStats stats = traceStats(static_cast<TraceStage>(s));
+    if (stats.count == 0) continue;
+    out.printf("%-17s %7u %8u %8u %8u %8u %8u\n", stats.name, stats.count,
+               (unsigned)(stats.totalUs / stats.count), stats.p50Us, stats.p95Us, stats.p99Us, stats.maxUs);
+  }
+  tracePrintStacks(out);
+}
+
+// Printed field by field rather than built in a JsonDocument: the reply
+// goes out from whichever task ran the command, and none of them has a
+// kilobyte of stack to spare for it
+void tracePrintJson(Print& out) {
+  out.printf("{\"uptime_ms\":%lu,\"stages\":{", (unsigned long)millis());
+  bool first = true;
+  for (size_t s = 0; s < TRACE_STAGE_COUNT; s++) {
+    TraceStats stats = traceStats(static_cast<TraceStage>(s));
+    if (stats.count == 0) continue;
+    out.printf("%s\"%s\":{\"count\":%u,\"mean_us\":%u,\"p50_us\":%u,\"p95_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+               first ? "" : ",", stats.name, stats.count, (unsigned)(stats.totalUs / stats.count),
+               stats.p50Us, stats.p95Us, stats.p99Us, stats.maxUs);
+    first = false;
+  }
+  out.print("},\"stacks\":{");
+  for (size_t i = 0; i < watchedCount; i++) {
+    out.printf("%s\"%s\":{\"size\":%u,\"free_min\":%u}", i ? "," : "", watched[i].name, watched[i].stackSize,
+               (unsigned)uxTaskGetStackHighWaterMark(watched[i].task));
+  }
+  out.println("}}");
+}
+
+#endif
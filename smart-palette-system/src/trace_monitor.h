@@ -0,0 +1,122 @@
+/*
+  Smart Inventory Palette - Stage latency tracing
+
+  Each traced stage (a weight batch, a tap until its LED, an uplink, a
+  wait for a mutex...) keeps a fixed histogram of how long it took, in
+  power-of-two microsecond buckets: bucket 0 holds everything under
+  1 us, bucket b the range [2^(b-1), 2^b) us, and the last one whatever
+  is longer. A stage is timed by the CPU cycle counter, so a probe costs
+  a few instructions and never touches the heap; the counter wraps after
+  about 17 s at 240 MHz, which no stage should come near.
+
+  A stage is only ever recorded by one task, or under the mutex whose
+  wait it measures, so the counters are not locked. The console reads
+  them while they move; a percentile may be one sample stale.
+
+  Building with -DTRACE_ENABLED=0 removes every probe, the histograms
+  included. Stack high-water marks of the registered tasks are reported
+  either way.
+
+  File: trace_monitor.h
+*/
+
+#ifndef TRACE_MONITOR_H
+#define TRACE_MONITOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_MAX_TASKS 8
+#define TRACE_BUCKETS 24  // Last bucket starts at 2^22 us, about 4 s
+
+enum TraceStage : uint8_t {
+  TRACE_WEIGHT_BATCH,      // Draining and fusing one batch of samples
+  TRACE_WORKFLOW,          // Dispatching one workflow event
+  TRACE_TAP_TO_LED,        // NFC IRQ edge until the LEDs show the result
+  TRACE_WAKE,              // Idle wake trigger until the first full-rate sample set
+  TRACE_NFC_READ,          // Reading the UID of a detected card
+  TRACE_DISPLAY,           // Redrawing and flushing the panel
+  TRACE_JOURNAL,           // Appending a transaction to flash
+  TRACE_UPLINK,            // One batch request, answer included
+  TRACE_TRUCK_SYNC,        // Fleet download
+  TRACE_CONSOLE_POLL,      // Remote console round trip
+  TRACE_REGISTRY_WAIT,     // Waiting for registryMutex
+  TRACE_CALIBRATION_WAIT,  // Waiting for calibrationMutex
+  TRACE_TUNING_WAIT,       // Waiting for tuningMutex
+  TRACE_JOURNAL_WAIT,      // Waiting for journalMutex
+  TRACE_STAGE_COUNT
+};
+
+struct TraceStats {
+  const char* name;
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t p50Us;          // Upper edge of the bucket holding the percentile
+  uint32_t p95Us;
+  uint32_t p99Us;
+};
+
+// Call from setup() with the handle and stack size given to
+// xTaskCreatePinnedToCore
+void traceWatchTask(TaskHandle_t task, const char* name, uint32_t stackSize);
+
+// "Stacks: WeightMonitor 1234/4096 ..." - bytes never used, of the total
+void tracePrintStacks(Print& out);
+
+#if TRACE_ENABLED
+
+void traceRecord(TraceStage stage, uint32_t us);
+TraceStats traceStats(TraceStage stage);
+void traceReset();
+
+// One line per stage that has samples, then the stacks
+void tracePrint(Print& out);
+// The same as one JSON object
+void tracePrintJson(Print& out);
+
+inline uint32_t traceCyclesToUs(uint32_t cycles) {
+  return cycles / ESP.getCpuFreqMHz();
+}
+
+// Records the time from construction to the end of the enclosing scope
+class TraceScope {
+public:
+  explicit TraceScope(TraceStage stage) : stage_(stage), start_(ESP.getCycleCount()) {}
+  ~TraceScope() { traceRecord(stage_, traceCyclesToUs(ESP.getCycleCount() - start_)); }
+
+private:
+  TraceStage stage_;
+  uint32_t start_;
+};
+
+// Takes `mutex` without a timeout and records how long that took; the
+// mutex itself serialises the recording
+inline void traceTake(SemaphoreHandle_t mutex, TraceStage stage) {
+  uint32_t start = ESP.getCycleCount();
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  traceRecord(stage, traceCyclesToUs(ESP.getCycleCount() - start));
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(stage) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(stage)
+#define TRACE_RECORD_US(stage, us) traceRecord(stage, us)
+#define TRACE_TAKE(mutex, stage) traceTake(mutex, stage)
+
+#else
+
+// sizeof keeps the operands used without evaluating them
+#define TRACE_SCOPE(stage) do {} while (0)
+#define TRACE_RECORD_US(stage, us) do { (void)sizeof(us); } while (0)
+#define TRACE_TAKE(mutex, stage) xSemaphoreTake(mutex, portMAX_DELAY)
+
+#endif
+
+#endif
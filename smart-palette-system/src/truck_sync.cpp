@@ -0,0 +1,105 @@
+/*
+  Smart Inventory Palette - Fleet download
+
+  File: truck_sync.cpp
+*/
+
+#include "truck_sync.h"
+#include <string.h>
+#include <stdlib.h>
+
+TruckSync::TruckSync(const char* url, const char* apiKey, const char* paletteId)
+    : url_(url), apiKey_(apiKey), paletteId_(paletteId) {}
+
+void TruckSync::begin(const char* rootCA) {
+  enabled_ = rootCA != nullptr;
+  if (!enabled_) {
+    Serial.println("Fleet download: no root CA pinned, disabled");
+    return;
+  }
+  client_.setCACert(rootCA);
+  // Rare request: do not keep a second TLS session open between runs.
+  // HTTP/1.0 also rules out a chunked body, which is read raw below.
+  http_.setReuse(false);
+  http_.useHTTP10(true);
+  http_.setTimeout(5000);
+}
+
+int TruckSync::run(TruckRegistry& registry, SemaphoreHandle_t lock) {
+  if (!enabled_) return 0;
+  char url[192];
+  xSemaphoreTake(lock, portMAX_DELAY);
+  uint32_t known = registry.version();
+  xSemaphoreGive(lock);
+  snprintf(url, sizeof(url), "%s?palette_id=%s&version=%u", url_, paletteId_, (unsigned)known);
+
+  http_.begin(client_, url);
+  http_.addHeader("Authorization", String("Bearer ") + apiKey_);
+  int code = http_.GET();
+  if (code != 200) {
+    http_.end();
+    return code;
+  }
+
+  version_ = 0;
+  received_ = 0;
+  complete_ = false;
+  bool valid = true;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  registry.beginUpdate();
+  xSemaphoreGive(lock);
+
+  WiFiClient* stream = http_.getStreamPtr();
+  char line[LINE_LENGTH];
+  while (valid && !complete_) {
+    size_t n = stream->readBytesUntil('\n', line, sizeof(line) - 1);
+    if (n == 0 && stream->available() <= 0) break;
+    if (n > 0 && line[n - 1] == '\r') n--;
+    line[n] = '\0';
+    if (n > 0) valid = applyLine(line, registry, lock);
+  }
+  http_.end();
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (valid && complete_) {
+    registry.commitUpdate(version_);
+    if (registry.dirty()) registry.save();
+    lastCount_ = received_;
+  } else {
+    // Keep everyone; whatever did arrive is saved with the next change
+    registry.abortUpdate();
+    code = -1;
+  }
+  xSemaphoreGive(lock);
+  return code;
+}
+
+bool TruckSync::applyLine(char* line, TruckRegistry& registry, SemaphoreHandle_t lock) {
+  if (strncmp(line, "version ", 8) == 0) {
+    version_ = strtoul(line + 8, nullptr, 10);
+    return true;
+  }
+  if (strncmp(line, "end ", 4) == 0) {
+    complete_ = strtoul(line + 4, nullptr, 10) == received_;
+    return complete_;
+  }
+
+  // uid,truck_id[,driver name]
+  char* truckId = strchr(line, ',');
+  if (!truckId) return false;
+  *truckId++ = '\0';
+  char* driverName = strchr(truckId, ',');
+  if (driverName) *driverName++ = '\0';
+
+  uint8_t uid[TruckRegistry::UID_MAX_LENGTH];
+  uint8_t length;
+  if (!TruckRegistry::parseUid(line, uid, length)) return false;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  int16_t handle = registry.put(uid, length, truckId, driverName ? driverName : "");
+  xSemaphoreGive(lock);
+  if (handle < 0) return false;
+  received_++;
+  return true;
+}
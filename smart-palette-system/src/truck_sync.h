@@ -0,0 +1,69 @@
+/*
+  Smart Inventory Palette - Fleet download
+
+  Fetches the truck list for this palette and applies it to the
+  registry, so a new lorry is provisioned from the server instead of a
+  firmware build. The request carries the version the registry already
+  holds; the server answers 304 if nothing changed, otherwise 200 with
+  the complete fleet as plain text:
+
+    version 42
+    04:52:F3:2A,TRUCK_A,Driver John
+    04:A1:B2:3C,TRUCK_B,Driver Mike
+    end 2
+
+  Lines are parsed straight off the connection into a small buffer, so
+  the fleet size does not decide how much RAM the download needs. The
+  download only replaces the registry once its "end" line has arrived
+  with the right count; trucks are added as they stream in, but nobody
+  is removed from an incomplete list.
+
+  File: truck_sync.h
+*/
+
+#ifndef TRUCK_SYNC_H
+#define TRUCK_SYNC_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <TruckRegistry.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+class TruckSync {
+public:
+  TruckSync(const char* url, const char* apiKey, const char* paletteId);
+
+  // Without a root certificate the server is not authenticated, so the
+  // fleet is never downloaded: it would rewrite the registry from
+  // whoever answers, and the API key would go out unprotected
+  void begin(const char* rootCA);
+  bool enabled() const { return enabled_; }
+
+  // One download attempt. `lock` guards `registry` and is only held
+  // while an entry is changed or the registry is saved. Returns the HTTP
+  // status (<= 0 on transport errors); 200 means the fleet was replaced.
+  int run(TruckRegistry& registry, SemaphoreHandle_t lock);
+
+  size_t lastCount() const { return lastCount_; }
+
+private:
+  static const size_t LINE_LENGTH = 80;
+
+  bool applyLine(char* line, TruckRegistry& registry, SemaphoreHandle_t lock);
+
+  const char* url_;
+  const char* apiKey_;
+  const char* paletteId_;
+
+  WiFiClientSecure client_;
+  HTTPClient http_;
+  uint32_t version_ = 0;
+  size_t received_ = 0;
+  size_t lastCount_ = 0;
+  bool complete_ = false;
+  bool enabled_ = false;
+};
+
+#endif
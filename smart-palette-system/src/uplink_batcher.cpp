@@ -0,0 +1,171 @@
+/*
+  Smart Inventory Palette - Batched uplink
+
+  File: uplink_batcher.cpp
+*/
+
+#include "uplink_batcher.h"
+#include <BottleCounter.h>
+#include <string.h>
+
+UplinkBatcher::UplinkBatcher(const char* url, const char* apiKey, const char* paletteId)
+    : url_(url), apiKey_(apiKey), paletteId_(paletteId) {}
+
+void UplinkBatcher::begin(const char* rootCA, uint32_t bootId) {
+  bootId_ = bootId;
+  enabled_ = rootCA != nullptr;
+  if (!enabled_) {
+    Serial.println("Uplink: no root CA pinned, transactions stay journaled");
+    return;
+  }
+  client_.setCACert(rootCA);
+  http_.setReuse(true);
+  http_.setTimeout(5000);
+
+  // {"results": [{"idempotency_key": ..., "status": ...}, ...]}
+  JsonObject result = resultFilter_.createNestedArray("results").createNestedObject();
+  result["idempotency_key"] = true;
+  result["status"] = true;
+}
+
+void UplinkBatcher::addProgress(const ProgressSample& sample) {
+  progress_[(progressHead_ + progressCount_) % MAX_PROGRESS] = sample;
+  if (progressCount_ < MAX_PROGRESS) {
+    progressCount_++;
+  } else {
+    progressHead_ = (progressHead_ + 1) % MAX_PROGRESS;
+  }
+}
+
+bool UplinkBatcher::addTransaction(const JournalRecord& record) {
+  if (transactionCount_ >= MAX_TRANSACTIONS) return false;
+  transactions_[transactionCount_++] = record;
+  return true;
+}
+
+int UplinkBatcher::flush(uint32_t journalId) {
+  if (empty()) return 0;
+  if (!enabled_) {
+    transactionCount_ = 0;
+    return 0;
+  }
+
+  size_t length = encode(journalId);
+  for (size_t i = 0; i < MAX_TRANSACTIONS; i++) results_[i] = UPLINK_UNANSWERED;
+  if (length == 0) {
+    transactionCount_ = 0;
+    // Cannot happen with the fixed batch limits; never wedge on it
+    progressCount_ = 0;
+    return -1;
+  }
+
+  // Same client object every time, so an open TLS session is reused
+  http_.begin(client_, url_);
+  http_.addHeader("Content-Type", UPLINK_MSGPACK ? "application/msgpack" : "application/json");
+  http_.addHeader("Authorization", String("Bearer ") + apiKey_);
+  int code = http_.POST(body_, length);
+  if (code >= 200 && code < 300) readResults(journalId);
+  http_.end();
+
+  requests_++;
+  if (code > 0) bytesSent_ += length;
+  transactionCount_ = 0;
+
+  if (code >= 200 && code < 300) {
+    progressCount_ = 0;
+    progressHead_ = 0;
+  }
+  return code;
+}
+
+// Results are matched by key, not position, so a reply that skips or
+// reorders entries never clears the wrong record
+void UplinkBatcher::readResults(uint32_t journalId) {
+  DeserializationError error = deserializeJson(doc_, http_.getString(),
+                                               DeserializationOption::Filter(resultFilter_));
+  if (error) return;
+
+  char key[48];
+  JsonArray results = doc_["results"];
+  for (JsonObject entry : results) {
+    const char* resultKey = entry["idempotency_key"];
+    const char* status = entry["status"];
+    if (!resultKey || !status) continue;
+
+    UplinkResult result = UPLINK_UNANSWERED;
+    if (strcmp(status, "stored") == 0) result = UPLINK_STORED;
+    else if (strcmp(status, "duplicate") == 0) result = UPLINK_DUPLICATE;
+    else if (strcmp(status, "rejected") == 0) result = UPLINK_REJECTED;
+    else if (strcmp(status, "retry") == 0) result = UPLINK_RETRY;
+
+    for (size_t i = 0; i < transactionCount_; i++) {
+      formatKey(transactions_[i], journalId, key, sizeof(key));
+      if (strcmp(key, resultKey) == 0) {
+        results_[i] = result;
+        break;
+      }
+    }
+  }
+}
+
+void UplinkBatcher::formatKey(const JournalRecord& record, uint32_t journalId, char* key, size_t size) const {
+  snprintf(key, size, "%s-%08X-%u", paletteId_, (unsigned)journalId, (unsigned)record.sequence);
+}
+
+size_t UplinkBatcher::encode(uint32_t journalId) {
+  char key[48];
+  doc_.clear();
+  doc_["palette_id"] = paletteId_;
+  snprintf(key, sizeof(key), "%08X", (unsigned)journalId);
+  doc_["journal_id"] = key;
+  snprintf(key, sizeof(key), "%08X", (unsigned)bootId_);
+  doc_["boot_id"] = key;
+  doc_["sent_at"] = millis();
+
+  JsonArray progress = doc_.createNestedArray("progress");
+  for (size_t i = 0; i < progressCount_; i++) {
+    const ProgressSample& sample = progress_[(progressHead_ + i) % MAX_PROGRESS];
+    JsonObject entry = progress.createNestedObject();
+    entry["timestamp"] = sample.timestamp;
+    entry["state"] = sample.state;
+    entry["truck_id"] = sample.truckId;
+    entry["weight"] = sample.weight;
+    entry["bottle_count"] = sample.bottleCount;
+  }
+
+  // Each transaction carries its own idempotency key, so a batch that is
+  // retried after a lost response is deduplicated record by record
+  JsonArray transactions = doc_.createNestedArray("transactions");
+  for (size_t i = 0; i < transactionCount_; i++) {
+    const JournalRecord& record = transactions_[i];
+    JsonObject entry = transactions.createNestedObject();
+    formatKey(record, journalId, key, sizeof(key));
+    entry["idempotency_key"] = key;
+    entry["transaction_type"] = record.type == JOURNAL_LOAD ? "LOAD" : "UNLOAD";
+    entry["truck_id"] = record.truckId;
+    entry["bottle_count"] = record.bottleCount;
+    entry["weight"] = record.weight;
+    entry["weight_change"] = record.weightChange;
+    entry["settled"] = record.settled != 0;
+    entry["settle_ms"] = record.settleTime;
+    if (record.settled) entry["weight_variance"] = record.weightVariance;
+    if (record.faultyCells) entry["faulty_cells"] = record.faultyCells;
+    if (record.sku < STANDARD_SKU_COUNT) entry["product_size"] = STANDARD_SKUS[record.sku].size;
+    entry["count_confidence"] = record.countConfidence;
+    entry["count_check"] = record.countCheck != 0;
+    // Timestamps are millis() on the boot that journaled the record; the
+    // age is only known for this boot's records
+    entry["timestamp"] = record.timestamp;
+    snprintf(key, sizeof(key), "%08X", (unsigned)record.bootId);
+    entry["boot_id"] = key;
+    if (record.bootId == bootId_) entry["age_ms"] = millis() - record.timestamp;
+  }
+
+#if UPLINK_MSGPACK
+  if (measureMsgPack(doc_) > sizeof(body_)) return 0;
+  return serializeMsgPack(doc_, body_, sizeof(body_));
+#else
+  if (measureJson(doc_) >= sizeof(body_)) return 0;
+  return serializeJson(doc_, body_, sizeof(body_));
+#endif
+}
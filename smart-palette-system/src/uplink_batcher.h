@@ -0,0 +1,117 @@
+/*
+  Smart Inventory Palette - Batched uplink
+
+  Progress samples taken during an active transaction and completed
+  transactions waiting in the journal are coalesced into one POST per
+  window, sent over a single keep-alive TLS connection instead of a new
+  HTTPClient - and a new handshake - per update. The body is JSON, or
+  MessagePack when built with -DUPLINK_MSGPACK=1; both encode the same
+  document, so the server decodes either into the same object. The server
+  answers each transaction by its idempotency key.
+
+  File: uplink_batcher.h
+*/
+
+#ifndef UPLINK_BATCHER_H
+#define UPLINK_BATCHER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <TransactionJournal.h>
+
+#ifndef UPLINK_MSGPACK
+#define UPLINK_MSGPACK 0
+#endif
+
+// The server's verdict on one transaction of the last request
+enum UplinkResult : uint8_t {
+  UPLINK_UNANSWERED = 0,   // Transport error, non-2xx, or not in the reply
+  UPLINK_STORED,
+  UPLINK_DUPLICATE,        // Already stored by an earlier attempt
+  UPLINK_REJECTED,         // Will not be accepted as sent
+  UPLINK_RETRY             // The server could not decide this time
+};
+
+struct ProgressSample {
+  uint32_t timestamp;
+  uint8_t state;
+  char truckId[16];
+  float weight;
+  int32_t bottleCount;
+};
+
+class UplinkBatcher {
+public:
+  static const size_t MAX_PROGRESS = 12;
+  static const size_t MAX_TRANSACTIONS = 4;
+  static const size_t BODY_SIZE = 3072;
+
+  UplinkBatcher(const char* url, const char* apiKey, const char* paletteId);
+
+  // Without a root certificate the server is not authenticated and
+  // nothing is sent: the API key would go out unprotected. Transactions
+  // then stay journaled. `bootId` tells this boot's journal records from
+  // older ones, whose timestamps are on a millis() clock that has since
+  // restarted.
+  void begin(const char* rootCA, uint32_t bootId);
+  bool enabled() const { return enabled_; }
+
+  // Once full, the oldest progress sample is overwritten
+  void addProgress(const ProgressSample& sample);
+  bool addTransaction(const JournalRecord& record);
+
+  bool empty() const { return progressCount_ == 0 && transactionCount_ == 0; }
+  size_t progressCount() const { return progressCount_; }
+  size_t transactionCount() const { return transactionCount_; }
+
+  // Send everything queued as one request and return the HTTP status
+  // (<= 0 on transport errors, 0 if disabled). Transactions are always cleared - the
+  // journal keeps them until acknowledged - and result() then tells what
+  // the server did with each. Progress is kept for the next attempt
+  // unless it was delivered (2xx); the oldest samples give way to new
+  // ones if the server keeps refusing.
+  int flush(uint32_t journalId);
+
+  // Verdict on the index-th transaction added before the last flush()
+  UplinkResult result(size_t index) const {
+    return index < MAX_TRANSACTIONS ? results_[index] : UPLINK_UNANSWERED;
+  }
+
+  // Encode what is queued into the request body without sending or
+  // clearing it; returns its length, 0 if it does not fit
+  size_t encode(uint32_t journalId);
+  const uint8_t* body() const { return body_; }
+
+  uint32_t requests() const { return requests_; }
+  uint32_t bytesSent() const { return bytesSent_; }
+
+private:
+  void formatKey(const JournalRecord& record, uint32_t journalId, char* key, size_t size) const;
+  void readResults(uint32_t journalId);
+
+  const char* url_;
+  const char* apiKey_;
+  const char* paletteId_;
+  uint32_t bootId_ = 0;
+  bool enabled_ = false;
+
+  ProgressSample progress_[MAX_PROGRESS];
+  size_t progressHead_ = 0;
+  size_t progressCount_ = 0;
+  JournalRecord transactions_[MAX_TRANSACTIONS];
+  size_t transactionCount_ = 0;
+  UplinkResult results_[MAX_TRANSACTIONS] = {};
+
+  StaticJsonDocument<3072> doc_;
+  StaticJsonDocument<128> resultFilter_;  // Drops the reasons from the reply
+  uint8_t body_[BODY_SIZE];
+
+  WiFiClientSecure client_;
+  HTTPClient http_;
+  uint32_t requests_ = 0;
+  uint32_t bytesSent_ = 0;
+};
+
+#endif